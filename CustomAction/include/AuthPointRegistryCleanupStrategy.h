@@ -2,14 +2,32 @@
 
 #include <Windows.h>
 
+#include <span>
+#include <mutex>
 #include <vector>
+#include <cstdint>
 #include <string>
+#include <iterator>
 #include <optional>
 #include <algorithm>
 #include <functional>
 #include <string_view>
 #include <format>
-
+#include <cstring>
+#include <exception>
+#include <unordered_map>
+
+#include "KeyPathPool.h"
+#include "PathConstants.h"
+#include "PatternMatcher.h"
+#include "ConfigConstants.h"
+#include "WinRegistryAccess.h"
+#include "RegistryScanCache.h"
+#include "RegistrySelector.h"
+#include "RegistryValueIndex.h"
+#include "RegistryDeletionPlanner.h"
+#include "ScanToDeletePipeline.h"
+#include "ParallelRegistryScanner.h"
 #include "RegistryCleanupStrategy.h"
 
 namespace WinLogon::CustomActions::Cleanup::Strategies
@@ -17,38 +35,135 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
     // Strategy for cleaning registry entries related to AuthPoint/LogonApp
     class AuthPointRegistryCleanupStrategy : public RegistryCleanupStrategy
     {
-    private:
-        // Define a custom deleter for HKEY
-        struct HKeyDeleter
+    public:
+        enum class EntryType : std::uint8_t
+        {
+            Standard,
+            Product
+        };
+
+        // Structure to store registry entry information. The path and the display name live in the
+        // KeyPathPool of the scan that found the entry (see EntryList).
+        struct RegistryEntry
         {
-            void operator()(HKEY key) const
+            const Registry::KeyPathPool::Node* key;   // Full key path, prefix shared with the other entries
+            std::wstring_view displayName;            // Display name
+            EntryType type;                           // Entry type
+
+            std::wstring path( ) const
             {
-                if (key) RegCloseKey(key);
+                return Registry::KeyPathPool::toString(key);
+            }
+
+            // GUID for Product-type entries
+            std::wstring_view guid( ) const noexcept
+            {
+                return type == EntryType::Product ? key->name : std::wstring_view{ };
             }
         };
 
-        // Type alias for HKEY smart pointer
-        using HKeyPtr = std::unique_ptr<HKEY__, HKeyDeleter>;
+        // Entries of one scan, in the order execute removes them. Owns the pool the entries point into.
+        struct EntryList
+        {
+            std::shared_ptr<const Registry::KeyPathPool> pool;
+            std::vector<RegistryEntry> entries;
+
+            bool empty( ) const noexcept
+            {
+                return entries.empty( );
+            }
+
+            std::size_t size( ) const noexcept
+            {
+                return entries.size( );
+            }
+
+            auto begin( ) const noexcept
+            {
+                return entries.begin( );
+            }
+
+            auto end( ) const noexcept
+            {
+                return entries.end( );
+            }
+
+            const RegistryEntry& operator[](std::size_t index) const noexcept
+            {
+                return entries[index];
+            }
+        };
+
+        enum class ScanMode
+        {
+            CollectThenDelete,   // Scan everything, then delete (entries removed in walk order)
+            Streaming            // Delete matches while the scan goes on, with bounded memory
+        };
+
+        AuthPointRegistryCleanupStrategy( )
+            : m_registry(std::make_shared<Registry::WinRegistryAccess>(handleCache( ))), m_scanCache(sessionScanCache( )) {}
+
+        // Reads and deletes through the handles shared with the other registry strategies of the session
+        explicit AuthPointRegistryCleanupStrategy(std::shared_ptr<Registry::RegistryHandleCache> handleCache)
+            : RegistryCleanupStrategy(std::move(handleCache)),
+              m_registry(std::make_shared<Registry::WinRegistryAccess>(this->handleCache( ))), m_scanCache(sessionScanCache( )) {}
+
+        // Scans of another backend get a scan cache of their own
+        explicit AuthPointRegistryCleanupStrategy(std::shared_ptr<const Registry::IRegistryAccess> registry)
+            : m_registry(std::move(registry)), m_scanCache(std::make_shared<Registry::RegistryScanCache>( )) {}
 
-    public:
         bool execute(std::shared_ptr<Logger::ILogger> logger) override
         {
             using enum WinLogon::CustomActions::Logger::LogLevel;
             logger->log(LOG_INFO, L"=== AuthPoint/LogonApp Registry Cleanup - Started ===");
 
+            const bool success = (m_scanMode == ScanMode::Streaming) ? scanAndRemove(logger) : findAndRemove(logger);
+
+            logHandleCacheStatistics(logger);
+            logger->log(LOG_INFO, L"=== AuthPoint/LogonApp Registry Cleanup - Finished ===\n");
+            return success;
+        }
+
+
+        std::wstring getName( ) const override
+        {
+            return L"AuthPoint Registry Cleanup Strategy";
+        }
+
+        // Scans every search root without modifying anything. Works on any registry backend,
+        // e.g. an offline hive, and returns the entries in the order execute removes them.
+        EntryList findEntries(std::shared_ptr<Logger::ILogger> logger)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+
+            // Unchanged keys are answered from the scan cache of a previous scan of this process
+            const auto scanCache = openScanCache(logger);
+            const auto cacheStatistics = scanCache ? scanCache->getStatistics( ) : Registry::RegistryScanCache::Statistics{ };
+            const auto registry = scanRegistryAccess(scanCache);
+
+            // All search roots are scanned at once; results come back in sequential walk order
+            auto pool = std::make_shared<Registry::KeyPathPool>( );
+            LinkedValueIndex linkedValues;
+            auto scanResults = scanRegistry(*registry, *pool, { }, linkedValues);
+
+            logScanCacheStatistics(scanCache, cacheStatistics, logger);
+
             // All found results
-            std::vector<RegistryEntry> allEntries;
+            EntryList allEntries{ pool, { } };
 
             // Searching in standard paths
-            for (const auto& path : m_standardRegistryPaths)
+            for (std::size_t i = 0; i < m_standardSelectors.size( ); ++i)
             {
-                logger->log(LOG_INFO, std::format(L"Searching in HKLM\\{}", path));
-                auto entries = findStandardRegistryEntries(HKEY_LOCAL_MACHINE, path, logger);
+                const auto& entries = scanResults[i].matches;
+                logger->log(LOG_INFO, std::format(L"Searching in HKLM\\{}", m_standardSelectors[i]->getRootPath( )));
+                logger->log(LOG_TRACE, std::format(L"  Selector {}: {} keys visited, {} sub keys pruned.",
+                                                   m_standardSelectors[i]->getText( ), scanResults[i].keysVisited,
+                                                   scanResults[i].keysPruned));
                 if (!entries.empty( ))
                 {
                     logger->log(LOG_INFO,
                                 std::format(L"  Found {} entries in this path.", entries.size( )));
-                    allEntries.insert(allEntries.end( ), entries.begin( ), entries.end( ));
+                    allEntries.entries.insert(allEntries.entries.end( ), entries.begin( ), entries.end( ));
                 }
                 else
                 {
@@ -56,236 +171,574 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
                 }
             }
 
+            const auto linkedEntries = findLinkedEntries(linkedValues.index, *pool, logger);
+            allEntries.entries.insert(allEntries.entries.end( ), linkedEntries.begin( ), linkedEntries.end( ));
+
             // Searching in products
-            logger->log(LOG_INFO, std::format(L"Searching in HKLM\\{}", m_productsRegistryPath));
-            auto productEntries = findProductsRegistryEntries(HKEY_LOCAL_MACHINE,
-                                                             m_productsRegistryPath, logger);
+            const auto& productEntries = scanResults.back( ).matches;
+            logger->log(LOG_INFO, std::format(L"Searching in HKLM\\{}", m_productsSelector->getRootPath( )));
             if (!productEntries.empty( ))
             {
                 logger->log(LOG_INFO, std::format(L"  Found {} entries in Products.", productEntries.size( )));
-                allEntries.insert(allEntries.end( ), productEntries.begin( ), productEntries.end( ));
+                allEntries.entries.insert(allEntries.entries.end( ), productEntries.begin( ), productEntries.end( ));
             }
             else
             {
                 logger->log(LOG_INFO, L"  No entries found in Products.");
             }
 
-            // Summary and removal
-            bool success = true;
-            if (allEntries.empty( ))
+            const auto poolStatistics = pool->getStatistics( );
+            logger->log(LOG_TRACE, std::format(L"Path pool: {} keys, {} bytes in {} blocks.",
+                                               poolStatistics.nodes, poolStatistics.arenaBytes, poolStatistics.arenaBlocks));
+
+            return allEntries;
+        }
+
+        // Replaces the built-in search patterns (matched case-insensitively against display names), e.g.
+        // with the ones of the installer property ConfigConstants::CLEANUP_PATTERNS_PROPERTY
+        void setSearchPatterns(std::vector<std::wstring> patterns)
+        {
+            m_matcher = Text::PatternMatcher(std::move(patterns));
+        }
+
+        // Built-in search patterns, shared with the strategies that search other places for the same products
+        static const std::vector<std::wstring>& getDefaultSearchPatterns( ) noexcept
+        {
+            return defaultSearchStrings;
+        }
+
+        // Replaces the selectors of the standard paths. Each one names the value matched against the
+        // search patterns (DisplayName when omitted); see RegistrySelector for the syntax.
+        // The previous full recursion is expressed as e.g. "SOFTWARE\...\Uninstall\**:DisplayName".
+        void setSelectors(const std::vector<std::wstring>& selectors)
+        {
+            m_standardSelectors = compileSelectors(selectors);
+        }
+
+        // Keys of the fixed-shape standard paths (e.g. Uninstall\*) with a value pointing into one of these
+        // folders, e.g. InstallLocation, are removed as well, whatever their display name. The folders are
+        // matched as substrings, ignoring case. Empty turns it off; the values of the keys whose display
+        // name does not match are then not read.
+        void setLinkedFolders(std::vector<std::wstring> folders)
+        {
+            m_linkedFolders = std::move(folders);
+        }
+
+        // Keys the scan starts from, relative to HKEY_LOCAL_MACHINE
+        std::vector<std::wstring> getSearchRoots( ) const
+        {
+            std::vector<std::wstring> roots;
+            for (const auto& selector : m_standardSelectors)
             {
-                logger->log(LOG_INFO, L"No AuthPoint/LogonApp related entries found.");
+                roots.push_back(selector->getRootPath( ));
             }
-            else
-            {
-                logger->log(LOG_INFO,
-                            std::format(L"Total of {} entries found. Removing...", allEntries.size( )));
+            roots.push_back(m_productsSelector->getRootPath( ));
+            return roots;
+        }
 
-                for (const auto& entry : allEntries)
-                {
-                    logger->log(LOG_INFO, std::format(L"Removing: {} ({})",
-                                                      entry.path, entry.displayName));
+        // Number of threads scanning the registry, 0 = one per hardware thread
+        void setWorkerCount(std::size_t workerCount) noexcept
+        {
+            m_workerCount = workerCount;
+        }
 
-                    bool deleted = deleteRegistryKey(HKEY_LOCAL_MACHINE, entry.path, logger);
-                    if (!deleted)
-                    {
-                        logger->log(LOG_WARNING, L"  Failed to remove entry.");
-                        success = false;
-                    }
-                }
-            }
+        // How execute finds and removes the entries
+        void setScanMode(ScanMode scanMode) noexcept
+        {
+            m_scanMode = scanMode;
+        }
 
-            logger->log(LOG_INFO, L"=== AuthPoint/LogonApp Registry Cleanup - Finished ===\n");
-            return success;
+        // Maximum number of subtrees deleted at the same time
+        void setDeleteWorkerCount(std::size_t workerCount) noexcept
+        {
+            m_deleteWorkerCount = std::max<std::size_t>(1, workerCount);
         }
 
+        // Enables the registry scan cache (on by default, see ConfigConstants::DISABLE_SCAN_CACHE_VARIABLE)
+        void setScanCacheEnabled(bool enabled) noexcept
+        {
+            m_scanCacheEnabled = enabled;
+        }
 
-        std::wstring getName( ) const override
+        // Discards the scan cache the scans of the live registry share in this process, e.g. after the
+        // registry was changed in a way that does not update key write times (restored hive, clock change)
+        static void invalidateScanCache( )
         {
-            return L"AuthPoint Registry Cleanup Strategy";
+            sessionScanCache( )->invalidate( );
         }
 
     private:
-        // Structure to store registry entry information
-        struct RegistryEntry
-        {
-            std::wstring path;           // Full key path
-            std::wstring displayName;    // Display name
-            std::wstring guid;           // GUID for Product-type entries
-            std::wstring type;           // Entry type (Standard or Product)
-        };
 
-        const std::vector<std::wstring> m_searchStrings = {
+        // Registry deletions contend on the hive, a few concurrent ones are enough
+        static constexpr std::size_t DEFAULT_DELETE_WORKER_COUNT = 4;
+
+        // Matches waiting for deletion in streaming mode before the scan is held back
+        static constexpr std::size_t STREAMING_QUEUE_CAPACITY = 256;
+
+        // Result of the deletion of each subtree root already removed, by key
+        using DeletedRoots = std::unordered_map<const Registry::KeyPathPool::Node*, LONG>;
+
+        using Pipeline = Registry::ScanToDeletePipeline<RegistryEntry>;
+
+        static inline const std::vector<std::wstring> defaultSearchStrings = {
             L"AuthPoint", L"Logon App", L"LogonApp", L"WatchGuard"
         };
 
-        const std::vector<std::wstring> m_standardRegistryPaths = {
-            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData",
-            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
-            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\Managed"
+        // Values of the keys of the fixed-shape standard paths whose display name did not match, added by
+        // the scan workers as they go
+        struct LinkedValueIndex
+        {
+            std::mutex mutex;
+            Registry::RegistryValueIndex index;
         };
 
-        const std::wstring m_productsRegistryPath = L"Software\\Classes\\Installer\\Products";
+        // Where Windows Installer and uninstall entries keep their display names. Only UserData and
+        // Uninstall have a fixed shape; Managed is still searched entirely.
+        static inline const std::vector<std::wstring> defaultSelectors = {
+            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData\\*\\Products\\*\\InstallProperties:DisplayName",
+            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\*:DisplayName",
+            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\Managed\\**:DisplayName"
+        };
+
+        std::vector<std::shared_ptr<const Registry::RegistrySelector>> m_standardSelectors = compileSelectors(defaultSelectors);
+
+        // Only the GUIDs directly under Products are inspected
+        const std::shared_ptr<const Registry::RegistrySelector> m_productsSelector =
+            std::make_shared<Registry::RegistrySelector>(L"Software\\Classes\\Installer\\Products\\*");
+
+        std::shared_ptr<const Registry::IRegistryAccess> m_registry;
+        std::shared_ptr<Registry::RegistryScanCache> m_scanCache;
+        std::size_t m_workerCount = 0;
+        std::size_t m_deleteWorkerCount = DEFAULT_DELETE_WORKER_COUNT;
+        ScanMode m_scanMode = ScanMode::CollectThenDelete;
+        bool m_scanCacheEnabled = true;
+        std::vector<std::wstring> m_linkedFolders = defaultLinkedFolders( );
+
+        Text::PatternMatcher m_matcher{ defaultSearchStrings };
+
+
+        bool matchesAnyPattern(std::wstring_view value) const
+        {
+            return m_matcher.matchesAny(value);
+        }
 
 
-        bool matchesAnyPattern(const std::wstring& value) const
+        bool findAndRemove(std::shared_ptr<Logger::ILogger> logger)
         {
-            return std::any_of(m_searchStrings.begin( ), m_searchStrings.end( ),
-                               [&value](const std::wstring& pattern)
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+
+            // All found results
+            const auto allEntries = findEntries(logger);
+
+            // Summary and removal
+            if (allEntries.empty( ))
             {
-                return value.find(pattern) != std::wstring::npos;
-            });
+                logger->log(LOG_INFO, L"No AuthPoint/LogonApp related entries found.");
+                return true;
+            }
+
+            logger->log(LOG_INFO,
+                        std::format(L"Total of {} entries found. Removing...", allEntries.size( )));
+
+            DeletedRoots deletedRoots;
+            return removeEntries(allEntries.entries, deletedRoots, logger);
         }
 
 
-        std::optional<std::wstring> getRegistryValue(HKEY rootKey, const std::wstring& keyPath, const std::wstring& valueName, std::shared_ptr<Logger::ILogger> logger) const
+        // Streaming mode: matches are removed by this thread while the scan goes on, see ScanToDeletePipeline
+        bool scanAndRemove(std::shared_ptr<Logger::ILogger> logger)
         {
-            HKEY hKey = nullptr;
-            if (RegOpenKeyExW(rootKey, keyPath.data( ), 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+
+            const auto scanCache = openScanCache(logger);
+            const auto cacheStatistics = scanCache ? scanCache->getStatistics( ) : Registry::RegistryScanCache::Statistics{ };
+            const auto registry = scanRegistryAccess(scanCache);
+            auto pool = std::make_shared<Registry::KeyPathPool>( );
+
+            DeletedRoots deletedRoots;
+            LinkedValueIndex linkedValues;
+            const Pipeline pipeline(STREAMING_QUEUE_CAPACITY);
+            const auto result = pipeline.run(
+                [&](const Pipeline::Sink& sink)
+                {
+                    return scanRegistry(*registry, *pool, sink, linkedValues);
+                },
+                [&](std::span<const RegistryEntry> entries)
+                {
+                    return removeEntries(entries, deletedRoots, logger);
+                });
+
+            if (result.removeError)
+            {
+                logger->log(LOG_ERROR, std::format(L"Registry deletion stopped: {}", describe(result.removeError)));
+            }
+            if (result.heldBackCount != 0)
+            {
+                logger->log(LOG_TRACE, std::format(L"Streaming: removed {} entries held back until the end of the scan.", result.heldBackCount));
+            }
+            if (result.scanError)
             {
-                return std::nullopt;
+                logger->log(LOG_ERROR, std::format(L"Registry scan stopped: {}", describe(result.scanError)));
             }
+            logScanCacheStatistics(scanCache, cacheStatistics, logger);
 
-            // RAII to ensure key closure
-            HKeyPtr keyPtr(hKey);
+            // Linked entries are only known once the scan is over
+            bool linkedRemoved = true;
+            std::size_t linkedCount = 0;
+            if (!result.removeError && !result.scanError)
+            {
+                const auto linkedEntries = findLinkedEntries(linkedValues.index, *pool, logger);
+                linkedCount = linkedEntries.size( );
+                linkedRemoved = linkedEntries.empty( ) || removeEntries(linkedEntries, deletedRoots, logger);
+            }
 
-            WCHAR buffer[1024];
-            DWORD bufferSize = sizeof(buffer);
-            DWORD type;
+            logger->log(LOG_TRACE, std::format(L"Streaming: {} keys visited.", result.keysVisited));
+            logger->log(LOG_TRACE, std::format(L"Streaming: {} entries queued, at most {} at once, {} waits for room.",
+                                               result.queue.pushed, result.queue.highWaterMark, result.queue.producerWaits));
 
-            if (RegQueryValueExW(hKey, valueName.data( ), nullptr, &type,
-                                 reinterpret_cast<LPBYTE>(buffer), &bufferSize) == ERROR_SUCCESS)
+            const bool success = result.removed && !result.scanError && linkedRemoved;
+            if (result.entryCount + linkedCount == 0 && success)
             {
-                if (type == REG_SZ || type == REG_EXPAND_SZ)
-                {
-                    return std::wstring(buffer);
-                }
+                logger->log(LOG_INFO, L"No AuthPoint/LogonApp related entries found.");
             }
+            return success;
+        }
 
-            return std::nullopt;
+
+        static std::wstring describe(const std::exception_ptr& error)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception& e)
+            {
+                return std::wstring(e.what( ), e.what( ) + strlen(e.what( )));
+            }
+            catch (...)
+            {
+                return L"unknown error.";
+            }
         }
 
 
-        std::vector<RegistryEntry> findStandardRegistryEntries(HKEY rootKey, const std::wstring& path, std::shared_ptr<Logger::ILogger> logger) const
+        // Removes entries, in order. Entries below another entry of the list, or below a root removed
+        // earlier (see deletedRoots), are not deleted again but reported with the key that removed them.
+        bool removeEntries(std::span<const RegistryEntry> entries, DeletedRoots& deletedRoots,
+                           std::shared_ptr<Logger::ILogger> logger) const
         {
-            std::vector<RegistryEntry> results;
+            using enum WinLogon::CustomActions::Logger::LogLevel;
 
-            HKEY hKey = nullptr;
-            if (RegOpenKeyExW(rootKey, path.data( ), 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+            // Entries below another entry go away with it: only the topmost ones are deleted
+            std::vector<const Registry::KeyPathPool::Node*> keys;
+            keys.reserve(entries.size( ));
+            for (const auto& entry : entries)
             {
-                return results;
+                keys.push_back(entry.key);
             }
+            const auto plan = Registry::RegistryDeletionPlanner::plan(keys);
 
-            // RAII to ensure key closure
-            HKeyPtr keyPtr(hKey);
+            // Roots still to delete; the others are inside a subtree that is already gone
+            std::vector<const Registry::KeyPathPool::Node*> removedBy(plan.roots.size( ), nullptr);
+            std::vector<std::wstring> rootPaths;
+            std::vector<std::size_t> rootsToDelete;
+            for (std::size_t i = 0; i < plan.roots.size( ); ++i)
+            {
+                for (const auto* ancestor = plan.roots[i]; ancestor && !removedBy[i]; ancestor = ancestor->parent)
+                {
+                    if (deletedRoots.contains(ancestor))
+                    {
+                        removedBy[i] = ancestor;
+                    }
+                }
 
-            searchRecursive(hKey, path, L"", [&](const std::wstring& keyPath, const std::wstring& relativePath)
+                if (!removedBy[i])
+                {
+                    rootPaths.push_back(Registry::KeyPathPool::toString(plan.roots[i]));
+                    rootsToDelete.push_back(i);
+                }
+            }
+
+            // The subtrees are disjoint, so they are deleted concurrently; results are reported per entry
+            const auto results = deleteRegistryTrees(HKEY_LOCAL_MACHINE, rootPaths, m_deleteWorkerCount);
+            for (std::size_t i = 0; i < rootsToDelete.size( ); ++i)
+            {
+                deletedRoots.emplace(plan.roots[rootsToDelete[i]], results[i]);
+            }
+
+            bool success = true;
+            std::vector<bool> reported(plan.roots.size( ), false);
+            for (std::size_t i = 0; i < entries.size( ); ++i)
             {
-                // Try to get the DisplayName property
-                auto displayName = getRegistryValue(rootKey, keyPath, L"DisplayName", logger);
-                if (displayName && matchesAnyPattern(*displayName))
+                const auto& entry = entries[i];
+                const std::size_t root = plan.rootOf[i];
+                const std::wstring path = entry.path( );
+                logger->log(LOG_INFO, std::format(L"Removing: {} ({})",
+                                                  path, entry.displayName));
+
+                const auto* deletedKey = removedBy[root] ? removedBy[root] : plan.roots[root];
+                const LONG result = deletedRoots.at(deletedKey);
+                if (entry.key != deletedKey || reported[root])
                 {
-                    results.push_back({
-                        .path = keyPath,
-                        .displayName = *displayName,
-                        .type = L"Standard"
-                                      });
+                    const bool removed = result == ERROR_SUCCESS || result == ERROR_FILE_NOT_FOUND;
+                    logger->log(removed ? LOG_INFO : LOG_WARNING,
+                                std::format(L"  {} with {}.", removed ? L"Removed" : L"Not removed",
+                                            Registry::KeyPathPool::toString(deletedKey)));
+                    continue;
                 }
-            }, logger);
 
-            return results;
+                reported[root] = true;
+                bool deleted = reportKeyDeletion(path, result, logger);
+                if (!deleted)
+                {
+                    logger->log(LOG_WARNING, L"  Failed to remove entry.");
+                    success = false;
+                }
+            }
+
+            return success;
         }
 
 
-        std::vector<RegistryEntry> findProductsRegistryEntries(HKEY rootKey, const std::wstring& path, std::shared_ptr<Logger::ILogger> logger) const
+        std::shared_ptr<const Registry::IRegistryAccess> scanRegistryAccess(const std::shared_ptr<Registry::RegistryScanCache>& scanCache) const
         {
-            std::vector<RegistryEntry> results;
+            if (scanCache)
+            {
+                return std::make_shared<Registry::CachingRegistryAccess>(m_registry, scanCache);
+            }
+            return m_registry;
+        }
 
-            HKEY hKey = nullptr;
-            if (RegOpenKeyExW(rootKey, path.data( ), 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+
+        static void logScanCacheStatistics(const std::shared_ptr<Registry::RegistryScanCache>& scanCache,
+                                           const Registry::RegistryScanCache::Statistics& before,
+                                           std::shared_ptr<Logger::ILogger> logger)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            if (!scanCache)
             {
-                return results;
+                return;
             }
 
-            // RAII to ensure key closure
-            HKeyPtr keyPtr(hKey);
+            const auto statistics = scanCache->getStatistics( );
+            logger->log(LOG_TRACE, std::format(L"Scan cache: {} reads from cache, {} from the registry.",
+                                               statistics.hits - before.hits, statistics.misses - before.misses));
+        }
+
 
-            WCHAR subKeyName[256];
-            DWORD subKeyNameSize = sizeof(subKeyName) / sizeof(WCHAR);
+        // Shared by the scans of the live registry in this process, e.g. the cleanup actions of one session
+        static const std::shared_ptr<Registry::RegistryScanCache>& sessionScanCache( )
+        {
+            static const auto scanCache = std::make_shared<Registry::RegistryScanCache>( );
+            return scanCache;
+        }
 
-            // Enumerate all GUIDs directly under Products
-            for (DWORD i = 0;
-                 RegEnumKeyExW(hKey, i, subKeyName, &subKeyNameSize, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS;
-                 ++i)
+
+        std::shared_ptr<Registry::RegistryScanCache> openScanCache(std::shared_ptr<Logger::ILogger> logger) const
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+
+            const std::wstring variable{ Constants::ConfigConstants::DISABLE_SCAN_CACHE_VARIABLE };
+            if (!m_scanCacheEnabled || GetEnvironmentVariableW(variable.c_str( ), nullptr, 0) != 0)
             {
-                subKeyNameSize = sizeof(subKeyName) / sizeof(WCHAR);
+                logger->log(LOG_TRACE, L"Registry scan cache disabled.");
+                return nullptr;
+            }
+            return m_scanCache;
+        }
 
-                std::wstring guidKey = std::format(L"{}\\{}", path, subKeyName);
 
-                // First try ProductName, then InstallProperties/DisplayName
-                auto productName = getRegistryValue(rootKey, guidKey, L"ProductName", logger);
-                if (!productName)
-                {
-                    std::wstring installPropsKey = std::format(L"{}\\InstallProperties", guidKey);
-                    productName = getRegistryValue(rootKey, installPropsKey, L"DisplayName", logger);
-                }
+        using Scanner = Registry::ParallelRegistryScanner<RegistryEntry>;
+
+        static std::vector<std::shared_ptr<const Registry::RegistrySelector>> compileSelectors(const std::vector<std::wstring>& selectors)
+        {
+            std::vector<std::shared_ptr<const Registry::RegistrySelector>> compiled;
+            compiled.reserve(selectors.size( ));
+            for (const auto& selector : selectors)
+            {
+                compiled.push_back(std::make_shared<Registry::RegistrySelector>(selector));
+            }
+            return compiled;
+        }
+
+
+        // With a sink, matches are handed to it as soon as they are found instead of being collected.
+        // The keys of the fixed-shape standard paths that do not match go to linkedValues.
+        std::vector<Scanner::RootResult> scanRegistry(const Registry::IRegistryAccess& registry, Registry::KeyPathPool& pool,
+                                                      const Pipeline::Sink& sink, LinkedValueIndex& linkedValues) const
+        {
+            std::vector<Scanner::Root> roots;
+
+            // The pool keeps the first spelling of a path; interning the roots first makes it independent of thread timing
+            for (const auto& selector : m_standardSelectors)
+            {
+                pool.intern(selector->getRootPath( ));
+            }
+            pool.intern(m_productsSelector->getRootPath( ));
+
+            for (const auto& selector : m_standardSelectors)
+            {
+                // Managed\** holds far too many keys to read all their values
+                const bool bounded = selector->getMaxDepth( ) != Registry::RegistrySelector::UNLIMITED_DEPTH;
+                LinkedValueIndex* const linked = (bounded && !m_linkedFolders.empty( )) ? &linkedValues : nullptr;
+
+                std::vector<std::wstring> valueNames{ selector->getValueName( ).empty( ) ? L"DisplayName" : selector->getValueName( ) };
+                roots.push_back({
+                    .key = registry.openKey(Registry::RegistryHive::LocalMachine, selector->getRootPath( )),
+                    .path = selector->getRootPath( ),
+                    .visitor = [this, &pool, &sink, linked, valueNames = std::move(valueNames), maxDepth = selector->getMaxDepth( )]
+                               (const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t depth)
+                    {
+                        return Pipeline::forward(matchStandardEntry(pool, keyPath, key, valueNames, linked), sink, depth < maxDepth);
+                    },
+                    .maxDepth = selector->getMaxDepth( ),
+                    .selector = selector });
+            }
 
-                if (productName && matchesAnyPattern(*productName))
+            roots.push_back({
+                .key = registry.openKey(Registry::RegistryHive::LocalMachine, m_productsSelector->getRootPath( )),
+                .path = m_productsSelector->getRootPath( ),
+                .visitor = [this, &pool, &sink, maxDepth = m_productsSelector->getMaxDepth( )]
+                           (const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t depth)
                 {
-                    results.push_back({
-                        .path = guidKey,
-                        .displayName = *productName,
-                        .guid = subKeyName,
-                        .type = L"Product" });
-                }
+                    return Pipeline::forward(matchProductEntry(pool, keyPath, key), sink, depth < maxDepth);
+                },
+                .maxDepth = m_productsSelector->getMaxDepth( ),
+                .selector = m_productsSelector });
+
+            Scanner scanner(m_workerCount);
+            return scanner.scan(std::move(roots));
+        }
+
+
+        // Values are read into a per-thread buffer and only copied for matching keys
+        static Registry::StringValueBatch& valueBatch( )
+        {
+            thread_local Registry::StringValueBatch batch;
+            return batch;
+        }
+
+
+        std::optional<RegistryEntry> matchStandardEntry(Registry::KeyPathPool& pool, const std::wstring& keyPath,
+                                                        const Registry::IRegistryKey& key, std::span<const std::wstring> valueNames,
+                                                        LinkedValueIndex* linked) const
+        {
+            // Try to get the selected value through the already open key
+            auto& values = valueBatch( );
+            key.getStringValues(valueNames, values);
+
+            const auto displayName = values[0];
+            if (displayName && matchesAnyPattern(*displayName))
+            {
+                return RegistryEntry{
+                    .key = pool.intern(keyPath),
+                    .displayName = pool.store(*displayName),
+                    .type = EntryType::Standard };
             }
 
-            return results;
+            if (linked)
+            {
+                const auto allValues = key.enumerateValues( );
+                const std::lock_guard lock(linked->mutex);
+                linked->index.add(Registry::RegistryHive::LocalMachine, keyPath, allValues);
+            }
+            return std::nullopt;
         }
 
-        void searchRecursive(HKEY hKey, const std::wstring& keyPath, const std::wstring& relativePath,
-                             const std::function<void(const std::wstring&, const std::wstring&)>& callback,
-                             std::shared_ptr<Logger::ILogger> logger) const
+
+        // Drive-less Logon App folders, so that an installation on another drive is found too
+        static std::vector<std::wstring> defaultLinkedFolders( )
         {
-            // Call the callback for this key
-            std::wstring currentPath = keyPath;
-            if (!relativePath.empty( ))
+            std::vector<std::wstring> folders;
+            for (const auto folder : Constants::PathConstants::logonAppFoldersPath)
             {
-                currentPath = std::format(L"{}\\{}", keyPath, relativePath);
+                folders.emplace_back(folder.substr(folder.find(L'\\')));
             }
-            callback(currentPath, relativePath);
+            return folders;
+        }
+
+
+        // Entries of keys whose display name did not match but one of whose values points into a linked
+        // folder, in path order
+        std::vector<RegistryEntry> findLinkedEntries(const Registry::RegistryValueIndex& index, Registry::KeyPathPool& pool,
+                                                     std::shared_ptr<Logger::ILogger> logger) const
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            using Condition = Registry::RegistryValueIndex::Condition;
 
-            HKEY hSubKey = nullptr;
-            if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, currentPath.data( ), 0, KEY_READ, &hSubKey) != ERROR_SUCCESS)
+            if (m_linkedFolders.empty( ))
             {
-                return;
+                return { };
             }
 
-            // RAII to ensure key closure
-            HKeyPtr keyPtr(hSubKey);
+            std::vector<Registry::RegistryValueIndex::KeyId> keys;
+            for (const auto& folder : m_linkedFolders)
+            {
+                const auto found = index.find({ Condition::anyValueContains(folder) });
 
-            // Enumerate subkeys
-            WCHAR subKeyName[256];
-            DWORD subKeyNameSize = sizeof(subKeyName) / sizeof(WCHAR);
-            for (DWORD i = 0;
-                 RegEnumKeyExW(hSubKey, i, subKeyName, &subKeyNameSize, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS;
-                 ++i)
+                std::vector<Registry::RegistryValueIndex::KeyId> either;
+                std::set_union(keys.begin( ), keys.end( ), found.begin( ), found.end( ), std::back_inserter(either));
+                keys = std::move(either);
+            }
+
+            // Keys were indexed in the order the scan workers visited them
+            std::sort(keys.begin( ), keys.end( ), [&index](auto lhs, auto rhs)
             {
-                subKeyNameSize = sizeof(subKeyName) / sizeof(WCHAR);
+                return Text::lessIgnoreCase(index.getKey(lhs).path, index.getKey(rhs).path);
+            });
 
-                std::wstring newRelativePath = relativePath;
-                if (!newRelativePath.empty( ))
-                {
-                    newRelativePath = std::format(L"{}\\{}", relativePath, subKeyName);
-                }
-                else
+            std::vector<RegistryEntry> entries;
+            entries.reserve(keys.size( ));
+            for (const auto key : keys)
+            {
+                entries.push_back({
+                    .key = pool.intern(index.getKey(key).path),
+                    .displayName = pool.store(index.getValue(key, L"DisplayName").value_or(std::wstring_view{ })),
+                    .type = EntryType::Standard });
+            }
+
+            logger->log(LOG_INFO, L"Searching for entries pointing into the Logon App folders");
+            logger->log(LOG_TRACE, std::format(L"  {} keys with other display names indexed, with {} values.",
+                                               index.getKeyCount( ), index.getValueCount( )));
+            logger->log(LOG_INFO, entries.empty( ) ? std::wstring(L"  No entries found.")
+                                                   : std::format(L"  Found {} entries through their values.", entries.size( )));
+            return entries;
+        }
+
+
+        // ProductName of a Products\<GUID> key, else its InstallProperties\DisplayName; a view into values
+        static std::optional<std::wstring_view> readProductName(const Registry::IRegistryKey& guidKey, Registry::StringValueBatch& values)
+        {
+            static const std::wstring productNameValue[] = { L"ProductName" };
+            static const std::wstring displayNameValue[] = { L"DisplayName" };
+
+            guidKey.getStringValues(productNameValue, values);
+            auto productName = values[0];
+            if (!productName)
+            {
+                if (auto installPropsKey = guidKey.openSubKey(L"InstallProperties"))
                 {
-                    newRelativePath = subKeyName;
+                    installPropsKey->getStringValues(displayNameValue, values);
+                    productName = values[0];
                 }
+            }
+            return productName;
+        }
 
-                // Recursive call for the subkey
-                searchRecursive(hKey, keyPath, newRelativePath, callback, logger);
+
+        std::optional<RegistryEntry> matchProductEntry(Registry::KeyPathPool& pool, const std::wstring& keyPath,
+                                                       const Registry::IRegistryKey& guidKey) const
+        {
+            const auto productName = readProductName(guidKey, valueBatch( ));
+            if (productName && matchesAnyPattern(*productName))
+            {
+                return RegistryEntry{
+                    .key = pool.intern(keyPath),
+                    .displayName = pool.store(*productName),
+                    .type = EntryType::Product };
             }
+
+            return std::nullopt;
         }
     };
 }
\ No newline at end of file
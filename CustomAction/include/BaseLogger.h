@@ -1,7 +1,8 @@
 #pragma once
 
-#include <map>
+#include <array>
 #include <string>
+#include <string_view>
 
 #include "ILogger.h"
 
@@ -11,16 +12,22 @@ namespace WinLogon::CustomActions::Logger
     class BaseLogger : public ILogger
     {
     protected:
-        static inline const std::map<LogLevel, std::wstring> levelPrefixes = {
-            {LogLevel::LOG_TRACE, L"[TRACE]:\t  "},
-            {LogLevel::LOG_INFO, L"[INFO]:\t   "},
-            {LogLevel::LOG_WARNING, L"[WARNING]  "},
-            {LogLevel::LOG_ERROR, L"[ERROR]\t  "}
+        // Indexed by LogLevel
+        static constexpr std::array<std::wstring_view, 4> levelPrefixes = {
+            L"[TRACE]:\t  ",
+            L"[INFO]:\t   ",
+            L"[WARNING]  ",
+            L"[ERROR]\t  "
         };
 
         std::wstring formatLogMessage(LogLevel level, const std::wstring& message) const
         {
-            return levelPrefixes.at(level) + message;
+            const std::wstring_view prefix = levelPrefixes.at(static_cast<std::size_t>(level));
+
+            std::wstring formatted;
+            formatted.reserve(prefix.size( ) + message.size( ));
+            formatted.append(prefix).append(message);
+            return formatted;
         }
 
     public:
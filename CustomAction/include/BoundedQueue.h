@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <condition_variable>
+
+namespace WinLogon::CustomActions::Threading
+{
+    // Multi-producer queue with a fixed capacity. Producers block while it is full (back-pressure);
+    // the consumer takes everything available at once. Closing wakes everybody: producers then fail,
+    // the consumer still drains what was queued.
+    template<typename T>
+    class BoundedQueue
+    {
+    public:
+        struct Statistics
+        {
+            std::size_t pushed = 0;
+            std::size_t producerWaits = 0;   // Pushes that had to wait for room
+            std::size_t highWaterMark = 0;   // Largest number of queued items
+        };
+
+        explicit BoundedQueue(std::size_t capacity) : m_capacity(std::max<std::size_t>(1, capacity)) {}
+
+        // Blocks while the queue is full. Returns false, dropping the item, once the queue is closed.
+        bool push(T item)
+        {
+            std::unique_lock lock(m_mutex);
+            if (m_items.size( ) >= m_capacity && !m_closed)
+            {
+                ++m_statistics.producerWaits;
+                m_notFull.wait(lock, [this]
+                {
+                    return m_items.size( ) < m_capacity || m_closed;
+                });
+            }
+
+            if (m_closed)
+            {
+                return false;
+            }
+
+            m_items.push_back(std::move(item));
+            ++m_statistics.pushed;
+            m_statistics.highWaterMark = std::max(m_statistics.highWaterMark, m_items.size( ));
+            lock.unlock( );
+
+            m_notEmpty.notify_one( );
+            return true;
+        }
+
+        // Blocks until items are available and moves all of them into batch (which is cleared first).
+        // Returns false once the queue is closed and empty.
+        bool popAll(std::vector<T>& batch)
+        {
+            batch.clear( );
+
+            std::unique_lock lock(m_mutex);
+            m_notEmpty.wait(lock, [this]
+            {
+                return !m_items.empty( ) || m_closed;
+            });
+
+            if (m_items.empty( ))
+            {
+                return false;
+            }
+
+            std::move(m_items.begin( ), m_items.end( ), std::back_inserter(batch));
+            m_items.clear( );
+            lock.unlock( );
+
+            m_notFull.notify_all( );
+            return true;
+        }
+
+        // No more items are accepted; queued ones can still be popped
+        void close( )
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_closed = true;
+            }
+            m_notFull.notify_all( );
+            m_notEmpty.notify_all( );
+        }
+
+        Statistics getStatistics( ) const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_statistics;
+        }
+
+    private:
+        const std::size_t m_capacity;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_notFull;
+        std::condition_variable m_notEmpty;
+        std::deque<T> m_items;
+        bool m_closed = false;
+        Statistics m_statistics;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+
+namespace WinLogon::CustomActions::Text
+{
+    // Locale independent simple case folding (to lower case) for the scripts product and
+    // vendor names realistically use: ASCII, Latin-1, Latin Extended-A, Greek, Cyrillic and
+    // fullwidth Latin. Registry names and values are compared with it everywhere, so the
+    // result is the same on every machine and every platform.
+    constexpr wchar_t foldCase(wchar_t ch) noexcept
+    {
+        if (ch < 0x80)
+        {
+            return (ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + 0x20) : ch;
+        }
+
+        // Latin-1 Supplement (except the multiplication sign)
+        if (ch >= 0x00C0 && ch <= 0x00DE && ch != 0x00D7)
+        {
+            return static_cast<wchar_t>(ch + 0x20);
+        }
+
+        // Latin Extended-A, upper and lower case letters alternate
+        if (ch >= 0x0100 && ch <= 0x017F)
+        {
+            if (ch == 0x0178) return 0x00FF;    // Y with diaeresis
+            if (ch == 0x017F) return L's';      // Long s
+            if (ch == 0x0130 || ch == 0x0131 || ch == 0x0138 || ch == 0x0149) return ch;
+
+            const bool oddUpperCase = (ch >= 0x0139 && ch <= 0x0148) || (ch >= 0x0179 && ch <= 0x017E);
+            const bool isUpperCase = oddUpperCase ? (ch % 2 == 1) : (ch % 2 == 0);
+            return isUpperCase ? static_cast<wchar_t>(ch + 1) : ch;
+        }
+
+        // Greek
+        if (ch >= 0x0391 && ch <= 0x03A9 && ch != 0x03A2)
+        {
+            return static_cast<wchar_t>(ch + 0x20);
+        }
+
+        // Cyrillic
+        if (ch >= 0x0400 && ch <= 0x040F)
+        {
+            return static_cast<wchar_t>(ch + 0x50);
+        }
+        if (ch >= 0x0410 && ch <= 0x042F)
+        {
+            return static_cast<wchar_t>(ch + 0x20);
+        }
+
+        // Fullwidth Latin
+        if (ch >= 0xFF21 && ch <= 0xFF3A)
+        {
+            return static_cast<wchar_t>(ch + 0x20);
+        }
+
+        return ch;
+    }
+
+    constexpr bool equalsIgnoreCase(std::wstring_view lhs, std::wstring_view rhs) noexcept
+    {
+        return std::equal(lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), [](wchar_t a, wchar_t b)
+        {
+            return foldCase(a) == foldCase(b);
+        });
+    }
+
+    constexpr bool lessIgnoreCase(std::wstring_view lhs, std::wstring_view rhs) noexcept
+    {
+        return std::lexicographical_compare(lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), [](wchar_t a, wchar_t b)
+        {
+            return foldCase(a) < foldCase(b);
+        });
+    }
+
+    // Transparent comparator for maps and sets keyed by registry names
+    struct CaseInsensitiveLess
+    {
+        using is_transparent = void;
+
+        constexpr bool operator()(std::wstring_view lhs, std::wstring_view rhs) const noexcept
+        {
+            return lessIgnoreCase(lhs, rhs);
+        }
+    };
+}
\ No newline at end of file
@@ -3,44 +3,118 @@
 #include <Windows.h>
 #include <msi.h>
 #include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <type_traits>
 
 #include "CleanupManager.h"
 #include "V3FilesCleanupStrategy.h"
 #include "V4FilesCleanupStrategy.h"
 #include "RegistryEntriesCleanupStrategy.h"
 #include "AuthPointRegistryCleanupStrategy.h"
+#include "PerUserRegistryCleanupStrategy.h"
+#include "OrphanedComClassCleanupStrategy.h"
 
 namespace WinLogon::CustomActions::Cleanup
 {
     class CleanupFactory
     {
     public:
+        using FlushMode = Registry::RegistryHandleCache::FlushMode;
+        using FolderRemoval = Strategies::V4FilesCleanupStrategy::FolderRemoval;
+
+        // The registry deletions of a session are left to the lazy writer of the registry unless flushMode
+        // asks for explicit flushes
         template<typename... StrategyTypes>
-        static std::unique_ptr<CleanupManager> createManager(MSIHANDLE handle)
+        static std::unique_ptr<CleanupManager> createManager(MSIHANDLE handle,
+                                                             FlushMode flushMode = FlushMode::Lazy)
+        {
+            // The registry strategies of a manager share their open registry handles
+            auto handleCache = createRegistryHandleCache(flushMode);
+            auto manager = createManager<StrategyTypes...>(handle, handleCache);
+
+            if constexpr ((std::is_base_of_v<RegistryCleanupStrategy, StrategyTypes> || ...))
+            {
+                manager->addCommitStep([handleCache](std::shared_ptr<Logger::ILogger> logger)
+                {
+                    return commitRegistryChanges(*handleCache, logger);
+                });
+            }
+            return manager;
+        }
+
+        // Manager whose registry strategies use the handle cache of the whole custom action. Its deletions
+        // are committed once, by commitRegistryChanges, after the last manager of the action ran.
+        template<typename... StrategyTypes>
+        static std::unique_ptr<CleanupManager> createManager(MSIHANDLE handle,
+                                                             const std::shared_ptr<Registry::RegistryHandleCache>& handleCache)
         {
             auto manager = std::make_unique<CleanupManager>(handle);
-            (addStrategyToManager<StrategyTypes>(manager), ...);
+            (addStrategyToManager<StrategyTypes>(manager, handle, handleCache), ...);
             return manager;
         }
 
+        // One per custom action invocation, shared by all of its managers
+        static std::shared_ptr<Registry::RegistryHandleCache> createRegistryHandleCache(FlushMode flushMode = FlushMode::Lazy)
+        {
+            auto handleCache = std::make_shared<Registry::RegistryHandleCache>( );
+            handleCache->setFlushMode(flushMode);
+            return handleCache;
+        }
+
+        // End of the session of handleCache: flushes its modified hives in PerSession mode
+        static bool commitRegistryChanges(Registry::RegistryHandleCache& handleCache, std::shared_ptr<Logger::ILogger> logger)
+        {
+            if (handleCache.getFlushMode( ) != FlushMode::PerSession)
+            {
+                return true;
+            }
+            return RegistryCleanupStrategy::commitRegistryChanges(handleCache, logger);
+        }
+
         static std::unique_ptr<CleanupManager> createV3CleanupManager(MSIHANDLE handle)
         {
             return createManager<Strategies::V3FilesCleanupStrategy>(handle);
         }
 
-        static std::unique_ptr<CleanupManager> createV4CleanupManager(MSIHANDLE handle)
+        static std::unique_ptr<CleanupManager> createV4CleanupManager(MSIHANDLE handle,
+                                                                      FolderRemoval folderRemoval = FolderRemoval::InPlace)
+        {
+            auto manager = std::make_unique<CleanupManager>(handle);
+            const std::wstring session = (folderRemoval == FolderRemoval::Tombstone) ? getTombstoneSession(handle) : std::wstring( );
+            auto strategy = std::make_unique<Strategies::V4FilesCleanupStrategy>(folderRemoval, session);
+            strategy->setParallelDeletion(getDirectoryDeleteWorkers(handle));
+            manager->addStrategy(std::move(strategy));
+            return manager;
+        }
+
+        static std::unique_ptr<CleanupManager> createRegistryCleanupManager(MSIHANDLE handle,
+                                                                            std::shared_ptr<Registry::RegistryHandleCache> handleCache = nullptr)
+        {
+            return handleCache ? createManager<Strategies::RegistryEntriesCleanupStrategy>(handle, handleCache)
+                               : createManager<Strategies::RegistryEntriesCleanupStrategy>(handle);
+        }
+
+        static std::unique_ptr<CleanupManager> createAuthPointRegistryCleanupManager(MSIHANDLE handle,
+                                                                                     std::shared_ptr<Registry::RegistryHandleCache> handleCache = nullptr)
         {
-            return createManager<Strategies::V4FilesCleanupStrategy>(handle);
+            return handleCache ? createManager<Strategies::AuthPointRegistryCleanupStrategy>(handle, handleCache)
+                               : createManager<Strategies::AuthPointRegistryCleanupStrategy>(handle);
         }
 
-        static std::unique_ptr<CleanupManager> createRegistryCleanupManager(MSIHANDLE handle)
+        static std::unique_ptr<CleanupManager> createPerUserRegistryCleanupManager(MSIHANDLE handle,
+                                                                                   std::shared_ptr<Registry::RegistryHandleCache> handleCache = nullptr)
         {
-            return createManager<Strategies::RegistryEntriesCleanupStrategy>(handle);
+            return handleCache ? createManager<Strategies::PerUserRegistryCleanupStrategy>(handle, handleCache)
+                               : createManager<Strategies::PerUserRegistryCleanupStrategy>(handle);
         }
 
-        static std::unique_ptr<CleanupManager> createAuthPointRegistryCleanupManager(MSIHANDLE handle)
+        static std::unique_ptr<CleanupManager> createOrphanedComClassCleanupManager(MSIHANDLE handle,
+                                                                                    std::shared_ptr<Registry::RegistryHandleCache> handleCache = nullptr)
         {
-            return createManager<Strategies::AuthPointRegistryCleanupStrategy>(handle);
+            return handleCache ? createManager<Strategies::OrphanedComClassCleanupStrategy>(handle, handleCache)
+                               : createManager<Strategies::OrphanedComClassCleanupStrategy>(handle);
         }
 
         static std::unique_ptr<CleanupManager> createFullCleanupManager(MSIHANDLE handle)
@@ -53,13 +127,120 @@ namespace WinLogon::CustomActions::Cleanup
             >(handle);
         }
 
+        // Session of the tombstones of this installation, from the installer property TOMBSTONE_SESSION;
+        // empty when it is not set
+        static std::wstring getTombstoneSession(MSIHANDLE handle)
+        {
+            return getSetting(handle, Constants::ConfigConstants::TOMBSTONE_SESSION_PROPERTY);
+        }
+
     private:
         CleanupFactory( ) = delete;  // Prevent initialization
 
         template<typename StrategyType>
-        static void addStrategyToManager(std::unique_ptr<CleanupManager> const& manager)
+        static void addStrategyToManager(std::unique_ptr<CleanupManager> const& manager, MSIHANDLE handle,
+                                         const std::shared_ptr<Registry::RegistryHandleCache>& handleCache)
+        {
+            std::unique_ptr<StrategyType> strategy;
+            if constexpr (std::is_base_of_v<RegistryCleanupStrategy, StrategyType>)
+            {
+                strategy = std::make_unique<StrategyType>(handleCache);
+            }
+            else
+            {
+                strategy = std::make_unique<StrategyType>( );
+            }
+
+            if constexpr (std::is_same_v<StrategyType, Strategies::AuthPointRegistryCleanupStrategy> ||
+                          std::is_same_v<StrategyType, Strategies::PerUserRegistryCleanupStrategy>)
+            {
+                if (auto patterns = getSearchPatterns(handle); !patterns.empty( ))
+                {
+                    strategy->setSearchPatterns(std::move(patterns));
+                }
+            }
+
+            if constexpr (std::is_base_of_v<DirectoryCleanupStrategy, StrategyType>)
+            {
+                strategy->setParallelDeletion(getDirectoryDeleteWorkers(handle));
+            }
+            manager->addStrategy(std::move(strategy));
+        }
+
+        // Patterns of the installer property CLEANUP_PATTERNS; empty when it is not set
+        static std::vector<std::wstring> getSearchPatterns(MSIHANDLE handle)
+        {
+            return Text::PatternMatcher::parsePatterns(getSetting(handle, Constants::ConfigConstants::CLEANUP_PATTERNS_PROPERTY));
+        }
+
+        // Threads of the directory deleter from the installer property DIRECTORY_DELETE_WORKERS;
+        // std::nullopt (std::filesystem::remove_all) when it is not set or not a number
+        static std::optional<std::size_t> getDirectoryDeleteWorkers(MSIHANDLE handle)
         {
-            manager->addStrategy(std::make_unique<StrategyType>( ));
+            const std::wstring value = getSetting(handle, Constants::ConfigConstants::DIRECTORY_DELETE_WORKERS_PROPERTY);
+            if (value.empty( ) || value.size( ) > 3)
+            {
+                return std::nullopt;
+            }
+
+            std::size_t workerCount = 0;
+            for (const wchar_t ch : value)
+            {
+                if (ch < L'0' || ch > L'9')
+                {
+                    return std::nullopt;
+                }
+                workerCount = workerCount * 10 + static_cast<std::size_t>(ch - L'0');
+            }
+            return workerCount;
+        }
+
+        // Installer property, or the entry of that name of the CustomActionData of a deferred action;
+        // empty when neither is set
+        static std::wstring getSetting(MSIHANDLE handle, std::wstring_view name)
+        {
+            std::wstring value = getProperty(handle, std::wstring(name).c_str( ));
+            if (value.empty( ))
+            {
+                // CustomActionData format: key=value;key=value;...
+                const std::wstring customActionData = getProperty(handle, L"CustomActionData");
+                std::wstring_view data = customActionData;
+                while (!data.empty( ) && value.empty( ))
+                {
+                    const auto end = data.find(L';');
+                    const auto token = data.substr(0, end);
+                    data = (end == std::wstring_view::npos) ? std::wstring_view{ } : data.substr(end + 1);
+
+                    const auto equalPos = token.find(L'=');
+                    if (equalPos != std::wstring_view::npos && token.substr(0, equalPos) == name)
+                    {
+                        value = token.substr(equalPos + 1);
+                    }
+                }
+            }
+            return value;
+        }
+
+        // Value of an installer property, empty when it is not set or not available (deferred
+        // custom actions only see a few properties, ProductCode among them)
+        static std::wstring getProperty(MSIHANDLE handle, const wchar_t* name)
+        {
+            WCHAR empty[1] = { 0 };
+            DWORD length = 0;
+            if (MsiGetPropertyW(handle, name, empty, &length) != ERROR_MORE_DATA)
+            {
+                return { };
+            }
+
+            std::wstring value(static_cast<std::size_t>(length) + 1, L'\0');
+            length = static_cast<DWORD>(value.size( ));
+            if (MsiGetPropertyW(handle, name, value.data( ), &length) != ERROR_SUCCESS)
+            {
+                return { };
+            }
+
+            value.resize(length);
+            return value;
         }
     };
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <format>
+#include <functional>
 
 #include "LoggerFactory.h"
 #include "ICleanupStrategy.h"
@@ -19,6 +20,14 @@ namespace WinLogon::CustomActions::Cleanup
             strategies.emplace_back(std::move(strategy));
         }
 
+        using CommitStep = std::function<bool(std::shared_ptr<Logger::ILogger>)>;
+
+        // Runs once every strategy has been executed, e.g. to flush what the strategies deferred
+        void addCommitStep(CommitStep step)
+        {
+            commitSteps.emplace_back(std::move(step));
+        }
+
         bool executeAll( )
         {
             bool overallSuccess = true;
@@ -29,6 +38,7 @@ namespace WinLogon::CustomActions::Cleanup
                             std::format(L"Executing cleanup strategy: {}", strategy->getName( )));
 
                 bool success = strategy->execute(logger);
+                success &= strategy->commit(logger);
                 if (!success)
                 {
                     logger->log(Logger::LogLevel::LOG_WARNING,
@@ -38,11 +48,17 @@ namespace WinLogon::CustomActions::Cleanup
                 overallSuccess &= success;
             }
 
+            for (const auto& step : commitSteps)
+            {
+                overallSuccess &= step(logger);
+            }
+
             return overallSuccess;
         }
 
     private:
         std::shared_ptr<Logger::ILogger> logger;
         std::vector<std::unique_ptr<ICleanupStrategy>> strategies;
+        std::vector<CommitStep> commitSteps;
     };
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <system_error>
+
+#include "ParallelFor.h"
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Finds the COM classes (CLSID\{GUID}) whose in-process server is one of our binaries: a file with
+    // one of the given names, wherever it is, or any file below one of the given folders.
+    // A CLSID key has tens of thousands of sub keys. Their names are enumerated once, then split into
+    // chunks read by several threads: each class costs a single open of {GUID}\InprocServer32, relative
+    // to the CLSID key, and a single read of its default value.
+    class ComClassScanner
+    {
+    public:
+        // Expands the environment variables of a REG_EXPAND_SZ server path (e.g. %ProgramFiles%)
+        using PathExpander = std::function<std::wstring(const std::wstring& path)>;
+
+        struct Match
+        {
+            std::wstring clsid;           // Sub key name, e.g. {BCB72349-...}
+            std::wstring serverPath;      // Server as registered, unquoted and expanded
+        };
+
+        struct Result
+        {
+            std::vector<Match> matches;   // In enumeration order
+            std::size_t classCount = 0;   // Sub keys of the CLSID key
+            std::size_t serverCount = 0;  // Classes with an in-process server
+        };
+
+        // What the file system tells about the server file of a class
+        enum class ServerState
+        {
+            Present,
+            Missing,
+            Unknown                       // Could not be checked, e.g. access denied
+        };
+
+        using ServerProbe = std::function<ServerState(const std::wstring& serverPath)>;
+
+        struct Orphans
+        {
+            std::vector<Match> orphaned;  // Server missing, the class can be removed
+            std::vector<Match> kept;      // Server present or unknown
+        };
+
+        // workerCount == 0 selects one worker per hardware thread
+        ComClassScanner(const std::vector<std::wstring_view>& ownedFolders, const std::vector<std::wstring_view>& ownedFileNames,
+                        std::size_t workerCount = 0, PathExpander expander = nullptr)
+            : m_workerCount(workerCount != 0 ? workerCount : std::max<std::size_t>(1, std::thread::hardware_concurrency( ))),
+              m_expander(std::move(expander))
+        {
+            for (const auto folder : ownedFolders)
+            {
+                std::wstring prefix{ folder };
+                if (!prefix.ends_with(L'\\'))
+                {
+                    prefix.push_back(L'\\');
+                }
+                m_ownedFolders.push_back(std::move(prefix));
+            }
+            for (const auto fileName : ownedFileNames)
+            {
+                m_ownedFileNames.emplace_back(fileName);
+            }
+        }
+
+        // Scans the classes under hive\clsidPath (e.g. HKEY_CLASSES_ROOT\CLSID); an empty result when the key does not exist
+        Result scan(const IRegistryAccess& registry, RegistryHive hive, std::wstring_view clsidPath) const
+        {
+            Result result;
+            const auto classes = registry.openKey(hive, clsidPath);
+            if (!classes)
+            {
+                return result;
+            }
+
+            const auto names = classes->enumerateSubKeys( );
+            result.classCount = names.size( );
+
+            // Chunks keep the hand-out cheap and let each worker read neighbouring keys of the hive
+            struct Chunk
+            {
+                std::vector<Match> matches;
+                std::size_t serverCount = 0;
+            };
+            std::vector<Chunk> chunks((names.size( ) + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+            Threading::parallelFor(chunks.size( ), m_workerCount, [&](std::size_t chunkIndex)
+            {
+                Chunk& chunk = chunks[chunkIndex];
+                std::wstring serverKeyPath;
+
+                const std::size_t end = std::min(names.size( ), (chunkIndex + 1) * CHUNK_SIZE);
+                for (std::size_t i = chunkIndex * CHUNK_SIZE; i < end; ++i)
+                {
+                    serverKeyPath.assign(names[i]);
+                    serverKeyPath.append(SERVER_KEY_SUFFIX);
+
+                    const auto serverKey = classes->openSubKey(serverKeyPath);
+                    const auto server = serverKey ? serverKey->getStringValue(L"") : std::nullopt;
+                    if (!server || server->empty( ))
+                    {
+                        continue;
+                    }
+
+                    ++chunk.serverCount;
+                    if (auto serverPath = getOwnedServerPath(*server))
+                    {
+                        chunk.matches.push_back({ names[i], std::move(*serverPath) });
+                    }
+                }
+            });
+
+            for (auto& chunk : chunks)
+            {
+                result.serverCount += chunk.serverCount;
+                std::move(chunk.matches.begin( ), chunk.matches.end( ), std::back_inserter(result.matches));
+            }
+            return result;
+        }
+
+        // Splits matches by the state of their server, in scan order. Only a server known to be missing
+        // makes a class orphaned; when in doubt the class is kept.
+        static Orphans findOrphans(std::vector<Match> matches, const ServerProbe& probe)
+        {
+            Orphans orphans;
+            for (auto& match : matches)
+            {
+                auto& list = (probe(match.serverPath) == ServerState::Missing) ? orphans.orphaned : orphans.kept;
+                list.push_back(std::move(match));
+            }
+            return orphans;
+        }
+
+        // State of a server file. One registered without a folder is loaded from systemFolder; it is
+        // Unknown when systemFolder is empty.
+        static ServerState probeServer(const std::wstring& serverPath, const std::filesystem::path& systemFolder)
+        {
+            std::filesystem::path path(serverPath);
+            if (!path.has_parent_path( ))
+            {
+                if (systemFolder.empty( ))
+                {
+                    return ServerState::Unknown;
+                }
+                path = systemFolder / path;
+            }
+
+            std::error_code error;
+            const bool exists = std::filesystem::exists(path, error);
+            if (error)
+            {
+                return ServerState::Unknown;
+            }
+            return exists ? ServerState::Present : ServerState::Missing;
+        }
+
+    private:
+        static constexpr std::size_t CHUNK_SIZE = 256;
+        static constexpr std::wstring_view SERVER_KEY_SUFFIX = L"\\InprocServer32";
+
+        const std::size_t m_workerCount;
+        PathExpander m_expander;
+        std::vector<std::wstring> m_ownedFolders;     // With a trailing backslash
+        std::vector<std::wstring> m_ownedFileNames;
+
+        // Server path when it is one of ours, nullopt otherwise. Expansion is left for the few
+        // paths that need it; both the raw and the expanded path are checked.
+        std::optional<std::wstring> getOwnedServerPath(std::wstring_view server) const
+        {
+            server = unquote(server);
+            if (isOwned(server))
+            {
+                return std::wstring(server);
+            }
+
+            if (m_expander && server.find(L'%') != std::wstring_view::npos)
+            {
+                std::wstring expanded = m_expander(std::wstring(server));
+                if (isOwned(expanded))
+                {
+                    return expanded;
+                }
+            }
+            return std::nullopt;
+        }
+
+        bool isOwned(std::wstring_view path) const
+        {
+            const auto separator = path.find_last_of(L"\\/");
+            const std::wstring_view fileName = (separator == std::wstring_view::npos) ? path : path.substr(separator + 1);
+
+            const auto isFileName = [fileName](const std::wstring& ownedFileName)
+            {
+                return Text::equalsIgnoreCase(fileName, ownedFileName);
+            };
+            const auto isInFolder = [path](const std::wstring& folder)
+            {
+                return path.size( ) > folder.size( ) && Text::equalsIgnoreCase(path.substr(0, folder.size( )), folder);
+            };
+            return std::any_of(m_ownedFileNames.begin( ), m_ownedFileNames.end( ), isFileName) ||
+                   std::any_of(m_ownedFolders.begin( ), m_ownedFolders.end( ), isInFolder);
+        }
+
+        static std::wstring_view unquote(std::wstring_view path) noexcept
+        {
+            while (!path.empty( ) && (path.front( ) == L' ' || path.front( ) == L'\t'))
+            {
+                path.remove_prefix(1);
+            }
+            while (!path.empty( ) && (path.back( ) == L' ' || path.back( ) == L'\t'))
+            {
+                path.remove_suffix(1);
+            }
+
+            if (path.size( ) >= 2 && path.front( ) == L'"')
+            {
+                const auto closingQuote = path.find(L'"', 1);
+                return path.substr(1, (closingQuote == std::wstring_view::npos ? path.size( ) : closingQuote) - 1);
+            }
+            return path;
+        }
+    };
+}
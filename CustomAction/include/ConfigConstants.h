@@ -1,6 +1,9 @@
 #pragma once
 
+#include <Windows.h>
+
 #include <string>
+#include <string_view>
 #include <filesystem>
 
 namespace WinLogon::CustomActions::Constants
@@ -10,16 +13,34 @@ namespace WinLogon::CustomActions::Constants
     public:
         static inline constexpr std::wstring_view DEFAULT_CONFIG_FILE_NAME = L"wlconfig.cfg";
 
-        static inline const std::filesystem::path SYSTEM32_CONFIG_PATH = L"C:\\Windows\\System32\\wlconfig.cfg";
-        static inline const std::filesystem::path DRIVERS_ETC_CONFIG_PATH = L"C:\\Windows\\System32\\drivers\\etc\\wlconfig.cfg";
+        static inline constexpr std::wstring_view SYSTEM32_CONFIG_PATH = L"C:\\Windows\\System32\\wlconfig.cfg";
+        static inline constexpr std::wstring_view DRIVERS_ETC_CONFIG_PATH = L"C:\\Windows\\System32\\drivers\\etc\\wlconfig.cfg";
 
-        static inline const std::filesystem::path CONFIG_PROGRAM_DATA_DESTINATION = L"C:\\ProgramData\\WatchGuard\\Logon App";
-        static inline const std::filesystem::path CONFIG_PROGRAM_FILES_DESTINATION = L"C:\\Program Files\\WatchGuard\\Logon App\\Resources";
+        static inline constexpr std::wstring_view CONFIG_PROGRAM_DATA_DESTINATION = L"C:\\ProgramData\\WatchGuard\\Logon App";
+        static inline constexpr std::wstring_view CONFIG_PROGRAM_FILES_DESTINATION = L"C:\\Program Files\\WatchGuard\\Logon App\\Resources";
 
 
         static inline constexpr std::wstring_view TEMP_INSTALL_CONFIG_NAME = L"InstallConfig.cfg";
         static inline constexpr std::wstring_view TEMP_LOCAL_CONFIG_NAME = L"LocalConfig.cfg";
 
+        // Installer property overriding the AuthPoint registry search patterns, separated by '|'. Deferred
+        // actions read it from their CustomActionData, as CLEANUP_PATTERNS=<patterns>. Nothing is read
+        // from disk: a patterns file in a user-writable folder would choose what the elevated action deletes.
+        static inline constexpr std::wstring_view CLEANUP_PATTERNS_PROPERTY = L"CLEANUP_PATTERNS";
+
+        // Installer property switching the folder removals from std::filesystem::remove_all to the
+        // multi-threaded ParallelTreeDeleter, with its number of threads (0: one per hardware thread).
+        // Read like CLEANUP_PATTERNS. Unset or not a number, remove_all is used.
+        static inline constexpr std::wstring_view DIRECTORY_DELETE_WORKERS_PROPERTY = L"DIRECTORY_DELETE_WORKERS";
+
+        // CustomActionData entry naming the tombstones of one installation, e.g. a GUID generated for it. The
+        // installer passes the same value to executeV4CleanupWithTombstones and rollbackV4Tombstones, so a
+        // rollback only restores what that installation buried. Unset, the folders are deleted in place.
+        static inline constexpr std::wstring_view TOMBSTONE_SESSION_PROPERTY = L"TOMBSTONE_SESSION";
+
+        // When set (to any value), registry scans do not use the in-memory scan cache
+        static inline constexpr std::wstring_view DISABLE_SCAN_CACHE_VARIABLE = L"WATCHGUARD_CLEANUP_NO_SCAN_CACHE";
+
         // Get the temporary directory for config files
         static inline std::filesystem::path GetTempConfigDir( )
         {
@@ -157,8 +157,8 @@ namespace WinLogon::CustomActions::Config
 
             try
             {
-                const auto& system32Path = Constants::ConfigConstants::SYSTEM32_CONFIG_PATH;
-                const auto& driversEtcPath = Constants::ConfigConstants::DRIVERS_ETC_CONFIG_PATH;
+                const std::filesystem::path system32Path{ Constants::ConfigConstants::SYSTEM32_CONFIG_PATH };
+                const std::filesystem::path driversEtcPath{ Constants::ConfigConstants::DRIVERS_ETC_CONFIG_PATH };
                 const auto tempDir = Constants::ConfigConstants::GetTempConfigDir( );
 
                 // Create temp directory if it doesn't exist
@@ -219,8 +219,8 @@ namespace WinLogon::CustomActions::Config
                 const auto tempInstallConfigPath = tempDir / Constants::ConfigConstants::TEMP_INSTALL_CONFIG_NAME;
                 const auto tempLocalConfigPath = tempDir / Constants::ConfigConstants::TEMP_LOCAL_CONFIG_NAME;
 
-                const auto& programFilesDir = Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION;
-                const auto& programDataDir = Constants::ConfigConstants::CONFIG_PROGRAM_DATA_DESTINATION;
+                const std::filesystem::path programFilesDir{ Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION };
+                const std::filesystem::path programDataDir{ Constants::ConfigConstants::CONFIG_PROGRAM_DATA_DESTINATION };
                 const auto& defaultFileName = Constants::ConfigConstants::DEFAULT_CONFIG_FILE_NAME;
 
 
@@ -372,7 +372,7 @@ namespace WinLogon::CustomActions::Config
                             std::format(L"Creating {} file...", Constants::ConfigConstants::DEFAULT_CONFIG_FILE_NAME));
 
                 // Create directory if it doesn't exist
-                auto destDir = Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION;
+                const std::filesystem::path destDir{ Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION };
                 if (!std::filesystem::exists(destDir))
                 {
                     logger->log(Logger::LogLevel::LOG_INFO, L"Creating destination directory...");
@@ -424,7 +424,7 @@ namespace WinLogon::CustomActions::Config
                 std::wstring sourcePath = NormalizeSourcePath(configPath, logger);
 
                 // Create destination directory if it doesn't exist
-                auto destDir = Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION;
+                const std::filesystem::path destDir{ Constants::ConfigConstants::CONFIG_PROGRAM_FILES_DESTINATION };
                 if (!std::filesystem::exists(destDir))
                 {
                     logger->log(Logger::LogLevel::LOG_INFO, L"Creating destination directory...");
@@ -68,11 +68,12 @@ namespace WinLogon::CustomActions
             {
                 auto logger = Logger::LoggerFactory::createLogger(hInstall);
 
-                // Create managers individually
+                // Create managers individually; their registry strategies share the open keys of this action
+                const auto handleCache = Cleanup::CleanupFactory::createRegistryHandleCache( );
                 auto v3CleanupManager = Cleanup::CleanupFactory::createV3CleanupManager(hInstall);
                 auto v4CleanupManager = Cleanup::CleanupFactory::createV4CleanupManager(hInstall);
-                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall);
-                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall);
+                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall, handleCache);
+                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall, handleCache);
 
                 // Execute each strategy sequentially
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing V3 files cleanup...");
@@ -87,8 +88,10 @@ namespace WinLogon::CustomActions
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing AuthPoint registry cleanup...");
                 bool authPointSuccess = authPointRegistryCleanupManager->executeAll( );
 
+                bool commitSuccess = Cleanup::CleanupFactory::commitRegistryChanges(*handleCache, logger);
+
                 // Check overall success of all operations
-                bool overallSuccess = v3Success && v4Success && registrySuccess && authPointSuccess;
+                bool overallSuccess = v3Success && v4Success && registrySuccess && authPointSuccess && commitSuccess;
 
                 return overallSuccess ? ERROR_SUCCESS : ERROR_INSTALL_FAILURE;
             }
@@ -107,10 +110,11 @@ namespace WinLogon::CustomActions
             {
                 auto logger = Logger::LoggerFactory::createLogger(hInstall);
 
-                // Create managers individually
+                // Create managers individually; their registry strategies share the open keys of this action
+                const auto handleCache = Cleanup::CleanupFactory::createRegistryHandleCache( );
                 auto v3CleanupManager = Cleanup::CleanupFactory::createV3CleanupManager(hInstall);
-                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall);
-                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall);
+                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall, handleCache);
+                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall, handleCache);
 
                 // Execute each strategy sequentially
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing V3 files cleanup...");
@@ -122,8 +126,10 @@ namespace WinLogon::CustomActions
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing AuthPoint registry cleanup...");
                 bool authPointSuccess = authPointRegistryCleanupManager->executeAll( );
 
+                bool commitSuccess = Cleanup::CleanupFactory::commitRegistryChanges(*handleCache, logger);
+
                 // Check overall success of all operations
-                bool overallSuccess = v3Success && registrySuccess && authPointSuccess;
+                bool overallSuccess = v3Success && registrySuccess && authPointSuccess && commitSuccess;
 
                 return overallSuccess ? ERROR_SUCCESS : ERROR_INSTALL_FAILURE;
             }
@@ -135,16 +141,18 @@ namespace WinLogon::CustomActions
             }
         }
 
-        static UINT executeV4Cleanup(MSIHANDLE hInstall)
+        static UINT executeV4Cleanup(MSIHANDLE hInstall,
+                                     Cleanup::CleanupFactory::FolderRemoval folderRemoval = Cleanup::CleanupFactory::FolderRemoval::InPlace)
         {
             try
             {
                 auto logger = Logger::LoggerFactory::createLogger(hInstall);
 
-                // Create managers individually
-                auto v4CleanupManager = Cleanup::CleanupFactory::createV4CleanupManager(hInstall);
-                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall);
-                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall);
+                // Create managers individually; their registry strategies share the open keys of this action
+                const auto handleCache = Cleanup::CleanupFactory::createRegistryHandleCache( );
+                auto v4CleanupManager = Cleanup::CleanupFactory::createV4CleanupManager(hInstall, folderRemoval);
+                auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall, handleCache);
+                auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall, handleCache);
 
                 // Execute each strategy sequentially
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing V4 files cleanup...");
@@ -156,8 +164,10 @@ namespace WinLogon::CustomActions
                 logger->log(Logger::LogLevel::LOG_INFO, L"Executing AuthPoint registry cleanup...");
                 bool authPointSuccess = authPointRegistryCleanupManager->executeAll( );
 
+                bool commitSuccess = Cleanup::CleanupFactory::commitRegistryChanges(*handleCache, logger);
+
                 // Check overall success of all operations
-                bool overallSuccess = v4Success && registrySuccess && authPointSuccess;
+                bool overallSuccess = v4Success && registrySuccess && authPointSuccess && commitSuccess;
 
                 return overallSuccess ? ERROR_SUCCESS : ERROR_INSTALL_FAILURE;
             }
@@ -169,6 +179,89 @@ namespace WinLogon::CustomActions
             }
         }
 
+        // Optional action, scheduled separately: it loads and searches the hive of every user profile. Its
+        // failures are logged but never fail the installation, whose own product is already removed.
+        static UINT executePerUserRegistryCleanup(MSIHANDLE hInstall)
+        {
+            auto logger = Logger::LoggerFactory::createLogger(hInstall);
+            try
+            {
+                logger->log(Logger::LogLevel::LOG_INFO, L"Executing per-user registry cleanup...");
+                auto perUserRegistryCleanupManager = Cleanup::CleanupFactory::createPerUserRegistryCleanupManager(hInstall);
+                if (!perUserRegistryCleanupManager->executeAll( ))
+                {
+                    logger->log(Logger::LogLevel::LOG_WARNING, L"Per-user registry cleanup reported issues; the installation continues.");
+                }
+            }
+            catch (...)
+            {
+                logger->log(Logger::LogLevel::LOG_ERROR, L"Unknown exception during per-user registry cleanup");
+            }
+            return ERROR_SUCCESS;
+        }
+
+        // Optional action, scheduled separately: it scans every COM class registration of the machine.
+        // Like the per-user cleanup, its failures are logged but never fail the installation.
+        static UINT executeOrphanedComClassCleanup(MSIHANDLE hInstall)
+        {
+            auto logger = Logger::LoggerFactory::createLogger(hInstall);
+            try
+            {
+                logger->log(Logger::LogLevel::LOG_INFO, L"Executing orphaned COM classes cleanup...");
+                auto orphanedComClassCleanupManager = Cleanup::CleanupFactory::createOrphanedComClassCleanupManager(hInstall);
+                if (!orphanedComClassCleanupManager->executeAll( ))
+                {
+                    logger->log(Logger::LogLevel::LOG_WARNING, L"Orphaned COM classes cleanup reported issues; the installation continues.");
+                }
+            }
+            catch (...)
+            {
+                logger->log(Logger::LogLevel::LOG_ERROR, L"Unknown exception during orphaned COM classes cleanup");
+            }
+            return ERROR_SUCCESS;
+        }
+
+        // Deferred action: same as executeV4Cleanup, but the Logon App folders are only renamed to tombstones.
+        // The installer must also schedule commitV4Tombstones (commit) and rollbackV4Tombstones (rollback),
+        // and pass this action and the rollback the same TOMBSTONE_SESSION in their CustomActionData.
+        static UINT executeV4CleanupWithTombstones(MSIHANDLE hInstall)
+        {
+            return executeV4Cleanup(hInstall, Cleanup::CleanupFactory::FolderRemoval::Tombstone);
+        }
+
+        // Commit action: purges the tombstones before returning. The purge is not left to a thread of its own:
+        // msiexec may end this process as soon as the action returns. What is locked is deleted at the next boot.
+        static UINT commitV4Tombstones(MSIHANDLE hInstall)
+        {
+            auto logger = Logger::LoggerFactory::createLogger(hInstall);
+            try
+            {
+                Cleanup::Strategies::V4FilesCleanupStrategy::purgeTombstones(logger);
+            }
+            catch (...)
+            {
+                // Whatever is left is purged by the next commit
+                logger->log(Logger::LogLevel::LOG_ERROR, L"Unknown exception while purging V4 tombstones");
+            }
+            return ERROR_SUCCESS;
+        }
+
+        // Rollback action: renames the tombstones of this installation's TOMBSTONE_SESSION back to the Logon App folders
+        static UINT rollbackV4Tombstones(MSIHANDLE hInstall)
+        {
+            auto logger = Logger::LoggerFactory::createLogger(hInstall);
+            try
+            {
+                return Cleanup::Strategies::V4FilesCleanupStrategy::restoreTombstones(
+                    Cleanup::CleanupFactory::getTombstoneSession(hInstall), logger) ? ERROR_SUCCESS : ERROR_INSTALL_FAILURE;
+            }
+            catch (...)
+            {
+                logger->log(Logger::LogLevel::LOG_ERROR, L"Unknown exception while restoring V4 tombstones");
+                return ERROR_INSTALL_FAILURE;
+            }
+        }
+
         static UINT copyConfigFileToDestination(MSIHANDLE hInstall)
         {
             try
@@ -3,120 +3,59 @@
 #include <format>
 
 #include <Windows.h>
+#include <optional>
 #include <filesystem>
 
 #include "ICleanupStrategy.h"
+#include "DirectoryRemoval.h"
+#include "DirectoryTombstone.h"
 
 namespace WinLogon::CustomActions::Cleanup
 {
     class DirectoryCleanupStrategy : public ICleanupStrategy
     {
-    protected:
-        static bool isDirectoryEmpty(const std::filesystem::path& path)
+    public:
+        // Removes directory trees with a ParallelTreeDeleter of workerCount threads (0: one per hardware
+        // thread) instead of std::filesystem::remove_all; std::nullopt restores remove_all. Opt-in, through
+        // the installer property ConfigConstants::DIRECTORY_DELETE_WORKERS_PROPERTY: on the trees measured
+        // so far remove_all was faster, with one worker as with eight (see Tests/Benchmarks/TreeDeleterBenchmark.cpp).
+        void setParallelDeletion(std::optional<std::size_t> workerCount) noexcept
         {
-            return std::filesystem::is_empty(path);
+            m_deleteWorkerCount = workerCount;
         }
 
+    protected:
+        // See FileSystem::DirectoryRemoval::removeDirectory
         bool removeDirectory(const std::filesystem::path& path, std::shared_ptr<Logger::ILogger> logger, bool forceRemove = true) const
         {
-            using enum WinLogon::CustomActions::Logger::LogLevel;
-            try
-            {
-                if (!std::filesystem::exists(path))
-                {
-                    logger->log(Logger::LogLevel::LOG_INFO,
-                                std::format(L"  Directory already deleted (not found): {}", path.wstring( )));
-                    return true; // Consider it a success if the directory already doesn't exist
-                }
-
-                if (!forceRemove && !isDirectoryEmpty(path))
-                {
-                    logger->log(LOG_WARNING,
-                                std::format(L"  The {} folder contains other files or sub-folders.", path.wstring( )));
-                    logger->log(LOG_INFO,
-                                L"  Listing remaining content:");
-
-                    // List the remaining items in the parent folder
-                    for (const auto& entry : std::filesystem::directory_iterator(path))
-                    {
-                        logger->log(LOG_INFO,
-                                    std::format(L"    - {}", entry.path( ).filename( ).wstring( )));
-                    }
-
-                    logger->log(LOG_WARNING,
-                                std::format(L"  The {} folder will not be removed to preserve the data above.", path.wstring( )));
-                    return true; // Return true since this is expected behavior
-                }
-
-                std::error_code errorCode;
-                std::size_t itemsRemoved = std::filesystem::remove_all(path, errorCode);
-
-                if (errorCode)
-                {
-                    logger->log(LOG_ERROR,
-                                std::format(L"  Failed to remove directory: {} - Error: {}",
-                                            path.wstring( ),
-                                            std::wstring(errorCode.message( ).begin( ), errorCode.message( ).end( ))));
-                    return false;
-                }
+            return FileSystem::DirectoryRemoval::removeDirectory(path, logger, forceRemove, m_deleteWorkerCount);
+        }
 
-                logger->log(Logger::LogLevel::LOG_INFO,
-                            std::format(L"Directory successfully removed: {} ({} items deleted)",
-                                        path.wstring( ), itemsRemoved));
-                return true;
-            }
-            catch (const std::filesystem::filesystem_error& e)
+        // Moves the directory out of the way with a single rename, to a tombstone of session; it is deleted when
+        // the tombstones of its volume are purged. False, with the directory left in place, when it cannot be
+        // renamed or the tombstone folder of the volume is not trusted.
+        bool buryDirectory(const std::filesystem::path& path, std::wstring_view session, std::shared_ptr<Logger::ILogger> logger) const
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            std::error_code errorCode;
+            const auto tombstone = FileSystem::DirectoryTombstone::bury(path, session, errorCode);
+            if (errorCode)
             {
-                logger->log(LOG_ERROR,
-                            std::format(L"  Exception while removing directory: {} - {}",
+                logger->log(LOG_WARNING,
+                            std::format(L"  Could not move {} to a tombstone - Error: {}",
                                         path.wstring( ),
-                                        std::wstring(e.what( ), e.what( ) + strlen(e.what( )))));
-
-                // Try to identify if there are files in use
-                logProblematicFiles(path, logger);
-
+                                        std::wstring(errorCode.message( ).begin( ), errorCode.message( ).end( ))));
                 return false;
             }
+
+            logger->log(LOG_INFO,
+                        std::format(L"Directory moved to tombstone: {} -> {} (purged once the installation commits)",
+                                    path.wstring( ), tombstone.wstring( )));
+            return true;
         }
 
     private:
-        void logProblematicFiles(const std::filesystem::path& path, std::shared_ptr<Logger::ILogger> logger) const
-        {
-            logger->log(Logger::LogLevel::LOG_INFO, L"  Attempting to identify problematic files...");
-
-            try
-            {
-                // Iterate through the files in the folder to identify which ones might be causing problems
-                for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
-                {
-                    try
-                    {
-                        // Try to change file attributes to check if it's accessible
-                        if (std::filesystem::is_regular_file(entry))
-                        {
-                            DWORD attributes = GetFileAttributesW(entry.path( ).c_str( ));
-
-                            if ((attributes != INVALID_FILE_ATTRIBUTES) &&
-                                (!SetFileAttributesW(entry.path( ).c_str( ), FILE_ATTRIBUTE_NORMAL)))
-                            {
-                                logger->log(Logger::LogLevel::LOG_WARNING,
-                                            std::format(L"  - File possibly in use: {}", entry.path( ).wstring( )));
-                            }
-
-                        }
-                    }
-                    catch (...)
-                    {
-                        logger->log(Logger::LogLevel::LOG_WARNING,
-                                    std::format(L"  - Unable to access: {}", entry.path( ).wstring( )));
-                    }
-                }
-            }
-            catch (...)
-            {
-                logger->log(Logger::LogLevel::LOG_INFO, L"  - Unable to analyze directory contents.");
-            }
-        }
+        std::optional<std::size_t> m_deleteWorkerCount;   // Unset: std::filesystem::remove_all
 
     public:
         // Implementation will be provided by derived classes
@@ -0,0 +1,340 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <winternl.h>
+#pragma comment(lib, "ntdll.lib")
+#else
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include <cerrno>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <filesystem>
+#include <system_error>
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // An open directory whose children are listed, opened and deleted relative to it, so the system
+    // resolves the directory path once instead of once per file (openat/unlinkat on POSIX, NtOpenFile
+    // with a root directory and SetFileInformationByHandle on Windows). Children are never followed:
+    // symbolic links and junctions are reported and deleted as they are.
+    // Listing is not thread safe; opening and deleting children are.
+    class DirectoryHandle
+    {
+    public:
+        using Name = std::filesystem::path::string_type;
+
+        struct Entry
+        {
+            Name name;
+            bool isDirectory = false;   // A real directory to descend into, not a link to one
+        };
+
+        DirectoryHandle( ) = default;
+        DirectoryHandle(const DirectoryHandle&) = delete;
+        DirectoryHandle& operator=(const DirectoryHandle&) = delete;
+
+        DirectoryHandle(DirectoryHandle&& other) noexcept
+        {
+            swap(other);
+        }
+
+        DirectoryHandle& operator=(DirectoryHandle&& other) noexcept
+        {
+            DirectoryHandle(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        ~DirectoryHandle( )
+        {
+            close( );
+        }
+
+        // Opens the directory at path; an invalid handle with errorCode set when it cannot be opened
+        static DirectoryHandle open(const std::filesystem::path& path, std::error_code& errorCode)
+        {
+            errorCode.clear( );
+            DirectoryHandle directory;
+#ifdef _WIN32
+            directory.m_handle = CreateFileW(path.c_str( ), FILE_LIST_DIRECTORY | SYNCHRONIZE,
+                                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                             FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+            if (directory.m_handle == INVALID_HANDLE_VALUE)
+            {
+                errorCode = lastError( );
+            }
+#else
+            directory.m_descriptor = ::open(path.c_str( ), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (directory.m_descriptor < 0)
+            {
+                errorCode = lastError( );
+            }
+#endif
+            return directory;
+        }
+
+        // Opens the sub directory name, relative to this one
+        DirectoryHandle openSubDirectory(const Name& name, std::error_code& errorCode) const
+        {
+            errorCode.clear( );
+            DirectoryHandle directory;
+#ifdef _WIN32
+            directory.m_handle = openRelative(name, FILE_LIST_DIRECTORY | SYNCHRONIZE, FILE_DIRECTORY_FILE, errorCode);
+#else
+            directory.m_descriptor = ::openat(m_descriptor, name.c_str( ), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (directory.m_descriptor < 0)
+            {
+                errorCode = lastError( );
+            }
+#endif
+            return directory;
+        }
+
+        bool isOpen( ) const noexcept
+        {
+#ifdef _WIN32
+            return m_handle != INVALID_HANDLE_VALUE;
+#else
+            return m_descriptor >= 0;
+#endif
+        }
+
+        // Next children of the directory, a buffer at a time ("." and ".." excluded). Returns false, with
+        // entries empty, once every child was listed or when errorCode is set. Children deleted meanwhile
+        // do not disturb the listing.
+        bool read(std::vector<Entry>& entries, std::error_code& errorCode)
+        {
+            entries.clear( );
+            errorCode.clear( );
+#ifdef _WIN32
+            m_buffer.resize(READ_BUFFER_SIZE);
+            while (entries.empty( ))
+            {
+                const auto informationClass = m_listed ? FileIdBothDirectoryInfo : FileIdBothDirectoryRestartInfo;
+                if (!GetFileInformationByHandleEx(m_handle, informationClass, m_buffer.data( ), static_cast<DWORD>(m_buffer.size( ))))
+                {
+                    const DWORD error = GetLastError( );
+                    if (error != ERROR_NO_MORE_FILES)
+                    {
+                        errorCode.assign(static_cast<int>(error), std::system_category( ));
+                    }
+                    return false;
+                }
+                m_listed = true;
+
+                for (std::size_t offset = 0;;)
+                {
+                    const auto* information = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(m_buffer.data( ) + offset);
+                    Name name(information->FileName, information->FileNameLength / sizeof(WCHAR));
+                    if (name != L"." && name != L"..")
+                    {
+                        const bool isDirectory = (information->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+                                                 !(information->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+                        entries.push_back(Entry{ std::move(name), isDirectory });
+                    }
+
+                    if (information->NextEntryOffset == 0)
+                    {
+                        break;
+                    }
+                    offset += information->NextEntryOffset;
+                }
+            }
+            return true;
+#else
+            if (!m_stream)
+            {
+                const int descriptor = ::dup(m_descriptor);
+                m_stream = descriptor >= 0 ? ::fdopendir(descriptor) : nullptr;
+                if (!m_stream)
+                {
+                    errorCode = lastError( );
+                    if (descriptor >= 0)
+                    {
+                        ::close(descriptor);
+                    }
+                    return false;
+                }
+            }
+
+            while (entries.size( ) < READ_BATCH_SIZE)
+            {
+                errno = 0;
+                const dirent* entry = ::readdir(m_stream);
+                if (!entry)
+                {
+                    if (errno != 0)
+                    {
+                        errorCode = lastError( );
+                        return false;
+                    }
+                    break;
+                }
+
+                const Name name(entry->d_name);
+                if (name == "." || name == "..")
+                {
+                    continue;
+                }
+
+                bool isDirectory = entry->d_type == DT_DIR;
+                if (entry->d_type == DT_UNKNOWN)
+                {
+                    struct stat status{ };
+                    isDirectory = ::fstatat(m_descriptor, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(status.st_mode);
+                }
+                entries.push_back(Entry{ name, isDirectory });
+            }
+            return !entries.empty( );
+#endif
+        }
+
+        // Deletes the child name: a file, a link, or an empty directory (isDirectory as listed).
+        // Returns false without an error when the child no longer exists.
+        bool remove(const Name& name, bool isDirectory, std::error_code& errorCode) const
+        {
+            errorCode.clear( );
+#ifdef _WIN32
+            const HANDLE child = openRelative(name, DELETE | FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES | SYNCHRONIZE, 0, errorCode);
+            if (child == INVALID_HANDLE_VALUE)
+            {
+                return clearNotFound(errorCode);
+            }
+
+            // POSIX semantics free the name at once; older systems and some file systems only know the
+            // classic disposition, which refuses read-only files
+            FILE_DISPOSITION_INFO_EX dispositionEx{ FILE_DISPOSITION_FLAG_DELETE | FILE_DISPOSITION_FLAG_POSIX_SEMANTICS |
+                                                    FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE };
+            bool deleted = SetFileInformationByHandle(child, FileDispositionInfoEx, &dispositionEx, sizeof(dispositionEx));
+            if (!deleted)
+            {
+                FILE_BASIC_INFO basicInformation{ };
+                if (GetFileInformationByHandleEx(child, FileBasicInfo, &basicInformation, sizeof(basicInformation)) &&
+                    (basicInformation.FileAttributes & FILE_ATTRIBUTE_READONLY))
+                {
+                    basicInformation.FileAttributes &= ~FILE_ATTRIBUTE_READONLY;
+                    basicInformation.FileAttributes |= (basicInformation.FileAttributes == 0) ? FILE_ATTRIBUTE_NORMAL : 0;
+                    SetFileInformationByHandle(child, FileBasicInfo, &basicInformation, sizeof(basicInformation));
+                }
+
+                FILE_DISPOSITION_INFO disposition{ TRUE };
+                deleted = SetFileInformationByHandle(child, FileDispositionInfo, &disposition, sizeof(disposition));
+            }
+            if (!deleted)
+            {
+                errorCode = lastError( );
+            }
+            CloseHandle(child);
+            return deleted;
+#else
+            static_cast<void>(isDirectory);
+            if (::unlinkat(m_descriptor, name.c_str( ), isDirectory ? AT_REMOVEDIR : 0) != 0)
+            {
+                errorCode = lastError( );
+                return clearNotFound(errorCode);
+            }
+            return true;
+#endif
+        }
+
+        void close( ) noexcept
+        {
+#ifdef _WIN32
+            if (m_handle != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(m_handle);
+                m_handle = INVALID_HANDLE_VALUE;
+            }
+            m_listed = false;
+#else
+            if (m_stream)
+            {
+                ::closedir(m_stream);
+                m_stream = nullptr;
+            }
+            if (m_descriptor >= 0)
+            {
+                ::close(m_descriptor);
+                m_descriptor = -1;
+            }
+#endif
+        }
+
+    private:
+#ifdef _WIN32
+        static constexpr std::size_t READ_BUFFER_SIZE = 64 * 1024;
+
+        HANDLE m_handle = INVALID_HANDLE_VALUE;
+        bool m_listed = false;
+        std::vector<std::byte> m_buffer;        // Listing buffer, allocated by the first read
+#else
+        static constexpr std::size_t READ_BATCH_SIZE = 256;
+
+        int m_descriptor = -1;
+        DIR* m_stream = nullptr;                // Listing state, on a duplicate of m_descriptor
+#endif
+
+        void swap(DirectoryHandle& other) noexcept
+        {
+#ifdef _WIN32
+            std::swap(m_handle, other.m_handle);
+            std::swap(m_listed, other.m_listed);
+            m_buffer.swap(other.m_buffer);
+#else
+            std::swap(m_descriptor, other.m_descriptor);
+            std::swap(m_stream, other.m_stream);
+#endif
+        }
+
+        static std::error_code lastError( ) noexcept
+        {
+#ifdef _WIN32
+            return std::error_code(static_cast<int>(GetLastError( )), std::system_category( ));
+#else
+            return std::error_code(errno, std::generic_category( ));
+#endif
+        }
+
+        static bool clearNotFound(std::error_code& errorCode) noexcept
+        {
+            if (errorCode == std::errc::no_such_file_or_directory)
+            {
+                errorCode.clear( );
+            }
+            return false;
+        }
+
+#ifdef _WIN32
+        // NtOpenFile of name relative to this directory, without following reparse points
+        HANDLE openRelative(const Name& name, ACCESS_MASK access, ULONG options, std::error_code& errorCode) const
+        {
+            UNICODE_STRING objectName{ };
+            objectName.Buffer = const_cast<PWSTR>(name.c_str( ));
+            objectName.Length = static_cast<USHORT>(name.size( ) * sizeof(WCHAR));
+            objectName.MaximumLength = objectName.Length;
+
+            OBJECT_ATTRIBUTES attributes{ };
+            InitializeObjectAttributes(&attributes, &objectName, OBJ_CASE_INSENSITIVE, m_handle, nullptr);
+
+            HANDLE handle = INVALID_HANDLE_VALUE;
+            IO_STATUS_BLOCK ioStatus{ };
+            const NTSTATUS status = NtOpenFile(&handle, access, &attributes, &ioStatus,
+                                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                               options | FILE_OPEN_REPARSE_POINT | FILE_OPEN_FOR_BACKUP_INTENT | FILE_SYNCHRONOUS_IO_NONALERT);
+            if (status < 0)   // Not NT_SUCCESS
+            {
+                errorCode.assign(static_cast<int>(RtlNtStatusToDosError(status)), std::system_category( ));
+                return INVALID_HANDLE_VALUE;
+            }
+            return handle;
+        }
+#endif
+    };
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include "ILogger.h"
+#include "ParallelTreeDeleter.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // Folder removal of the directory cleanup strategies, with what it logs. Whether std::filesystem::remove_all
+    // or the ParallelTreeDeleter deletes the tree, a failure is reported entry by entry with the error each
+    // entry failed with, as recorded while deleting: the tree is never walked again just to find them.
+    class DirectoryRemoval
+    {
+    public:
+        // Removes path and everything in it; with forceRemove false, only when it is empty. deleteWorkerCount
+        // selects the ParallelTreeDeleter with that many threads (0: one per hardware thread) instead of
+        // remove_all. False when something was left behind.
+        static bool removeDirectory(const std::filesystem::path& path, std::shared_ptr<Logger::ILogger> logger,
+                                    bool forceRemove = true, std::optional<std::size_t> deleteWorkerCount = std::nullopt)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            try
+            {
+                if (!std::filesystem::exists(path))
+                {
+                    logger->log(LOG_INFO, L"  Directory already deleted (not found): " + path.wstring( ));
+                    return true; // Consider it a success if the directory already doesn't exist
+                }
+
+                if (!forceRemove && !std::filesystem::is_empty(path))
+                {
+                    logger->log(LOG_WARNING, L"  The " + path.wstring( ) + L" folder contains other files or sub-folders.");
+                    logger->log(LOG_INFO, L"  Listing remaining content:");
+
+                    // List the remaining items in the parent folder
+                    for (const auto& entry : std::filesystem::directory_iterator(path))
+                    {
+                        logger->log(LOG_INFO, L"    - " + entry.path( ).filename( ).wstring( ));
+                    }
+
+                    logger->log(LOG_WARNING, L"  The " + path.wstring( ) + L" folder will not be removed to preserve the data above.");
+                    return true; // Return true since this is expected behavior
+                }
+
+                std::error_code errorCode;
+                std::uintmax_t itemsRemoved = 0;
+                ParallelTreeDeleter deleter(deleteWorkerCount.value_or(1));
+                if (deleteWorkerCount)
+                {
+                    itemsRemoved = deleter.removeAll(path, errorCode);
+                }
+                else
+                {
+                    itemsRemoved = std::filesystem::remove_all(path, errorCode);
+                    if (errorCode)
+                    {
+                        // remove_all stops at the first entry it cannot remove and does not say which one: a
+                        // one-worker deleter removes what is left, recording every entry it cannot remove
+                        std::error_code remainderError;
+                        const std::uintmax_t remainderRemoved = deleter.removeAll(path, remainderError);
+                        if (!remainderError)
+                        {
+                            errorCode.clear( );     // What failed went away meanwhile
+                            itemsRemoved = remainderRemoved;
+                        }
+                    }
+                }
+
+                if (errorCode)
+                {
+                    logger->log(LOG_ERROR, L"  Failed to remove directory: " + path.wstring( ) + L" - Error: " + toWide(errorCode.message( )));
+                    logFailures(deleter, logger);
+                    return false;
+                }
+
+                logger->log(LOG_INFO, L"Directory successfully removed: " + path.wstring( ) +
+                                      L" (" + std::to_wstring(itemsRemoved) + L" items deleted)");
+
+                if (deleteWorkerCount)
+                {
+                    const auto statistics = deleter.getStatistics( );
+                    logger->log(LOG_TRACE, L"  " + std::to_wstring(statistics.filesRemoved) + L" files and " +
+                                           std::to_wstring(statistics.directoriesRemoved) + L" directories removed by " +
+                                           std::to_wstring(deleter.getWorkerCount( )) + L" workers (" +
+                                           std::to_wstring(statistics.steals) + L" directories stolen, at most " +
+                                           std::to_wstring(statistics.highWaterMark) + L" waiting).");
+                }
+                return true;
+            }
+            catch (const std::filesystem::filesystem_error& e)
+            {
+                logger->log(LOG_ERROR, L"  Exception while removing directory: " + path.wstring( ) + L" - " + toWide(e.what( )));
+                return false;
+            }
+        }
+
+    private:
+        // Entries the deleter could not remove, as it recorded them
+        static void logFailures(const ParallelTreeDeleter& deleter, const std::shared_ptr<Logger::ILogger>& logger)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            logger->log(LOG_INFO, L"  Entries that could not be removed:");
+
+            for (const auto& failure : deleter.getFailures( ))
+            {
+                logger->log(LOG_WARNING, L"  - " + failure.path.wstring( ) + (isInUse(failure.error) ? L" (possibly in use)" : L"") +
+                                         L": " + toWide(failure.error.message( )));
+            }
+
+            const std::size_t failureCount = deleter.getStatistics( ).failureCount;
+            if (failureCount > deleter.getFailures( ).size( ))
+            {
+                logger->log(LOG_WARNING, L"  - ... and " + std::to_wstring(failureCount - deleter.getFailures( ).size( )) + L" more.");
+            }
+        }
+
+        static bool isInUse(const std::error_code& errorCode)
+        {
+#ifdef _WIN32
+            if (errorCode.category( ) == std::system_category( ))
+            {
+                switch (errorCode.value( ))
+                {
+                    case ERROR_SHARING_VIOLATION:
+                    case ERROR_LOCK_VIOLATION:
+                    case ERROR_USER_MAPPED_FILE:
+                        return true;
+
+                    default:
+                        break;
+                }
+            }
+#endif
+            return errorCode == std::errc::device_or_resource_busy || errorCode == std::errc::text_file_busy;
+        }
+
+        // Error messages are ASCII
+        static std::wstring toWide(std::string_view text)
+        {
+            return std::wstring(text.begin( ), text.end( ));
+        }
+    };
+}
@@ -0,0 +1,534 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <sddl.h>
+#include <aclapi.h>
+#pragma comment(lib, "advapi32.lib")
+#else
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include "CaseFolding.h"
+#include "DirectoryHandle.h"
+#include "ParallelTreeDeleter.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // Removes directories in two steps. bury renames a directory into a hidden tombstone folder at the
+    // root of its volume: a single rename whatever the size of the tree, after which the directory is
+    // gone from its location. Until it is purged, restore renames it back. purgeAll deletes the
+    // tombstones and leaves what is locked to be deleted at the next boot.
+    // Every tombstone has an origin record next to it with its original path. A purge deletes the records
+    // first, so a tombstone without a record is no longer restorable, and a purge that was interrupted is
+    // completed by the next one.
+    // The tombstone folder has a predictable path and its records say where to rename what, so nothing
+    // in it is acted on unless the folder is trusted (see isTrustedRoot): it is created with a protected
+    // DACL granting SYSTEM and Administrators only, and an existing one a standard user owns is refused.
+    // Tombstone names carry the session of the installation that buried them, restoreAll only restores
+    // that session's, and origins are checked against the paths the caller allows before any rename.
+    class DirectoryTombstone
+    {
+    public:
+        struct RestoreResult
+        {
+            std::filesystem::path tombstone;
+            std::filesystem::path origin;     // Empty when the origin record is missing or unreadable
+            std::error_code error;
+        };
+
+        struct PurgeResult
+        {
+            std::size_t tombstonesPurged = 0;  // Tombstones deleted completely
+            std::size_t tombstonesRefused = 0; // Left alone with their record: their origin is not allowed
+            std::uintmax_t itemsRemoved = 0;
+            std::size_t itemsScheduled = 0;    // Locked entries, deleted at the next boot
+            std::error_code error;             // First error that left something behind, or the root refused
+        };
+
+        // Tombstone folder of the volume of path
+        static std::filesystem::path getRoot(const std::filesystem::path& path)
+        {
+            return path.root_path( ) / ROOT_NAME;
+        }
+
+        // A session names the tombstones of one installation, e.g. a GUID: 1 to 64 letters, digits, '-', '{' or '}'
+        static bool isValidSession(std::wstring_view session) noexcept
+        {
+            return !session.empty( ) && session.size( ) <= 64 && std::all_of(session.begin( ), session.end( ), [](wchar_t ch)
+            {
+                return (ch >= L'0' && ch <= L'9') || (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') ||
+                       ch == L'-' || ch == L'{' || ch == L'}';
+            });
+        }
+
+        // A directory, not a link, owned by SYSTEM, Administrators or the user running us (SYSTEM for a deferred
+        // action). Without Windows ACLs: owned by root or the current user, and not writable by its group or others.
+        static bool isTrustedRoot(const std::filesystem::path& root)
+        {
+#ifdef _WIN32
+            const DWORD attributes = GetFileAttributesW(root.c_str( ));
+            if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY) || (attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            {
+                return false;
+            }
+
+            PSID owner = nullptr;
+            PSECURITY_DESCRIPTOR descriptor = nullptr;
+            if (GetNamedSecurityInfoW(root.c_str( ), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION, &owner, nullptr, nullptr, nullptr, &descriptor) != ERROR_SUCCESS)
+            {
+                return false;
+            }
+            const bool trusted = IsWellKnownSid(owner, WinLocalSystemSid) || IsWellKnownSid(owner, WinBuiltinAdministratorsSid) ||
+                                 isCurrentUser(owner);
+            LocalFree(descriptor);
+            return trusted;
+#else
+            struct stat status;
+            if (lstat(root.c_str( ), &status) != 0 || !S_ISDIR(status.st_mode))
+            {
+                return false;
+            }
+            return (status.st_uid == 0 || status.st_uid == geteuid( )) && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+        }
+
+        // Renames target into the tombstone folder of its volume and returns the tombstone. Returns an
+        // empty path with errorCode set when the directory cannot be renamed (e.g. one of its files is open).
+        static std::filesystem::path bury(const std::filesystem::path& target, std::wstring_view session, std::error_code& errorCode)
+        {
+            const auto origin = std::filesystem::absolute(target, errorCode);
+            if (errorCode)
+            {
+                return { };
+            }
+            return bury(origin, getRoot(origin), session, errorCode);
+        }
+
+        // Same, into the tombstone folder root, which must be on the volume of target. Fails with
+        // permission_denied when root exists but is not trusted.
+        static std::filesystem::path bury(const std::filesystem::path& target, const std::filesystem::path& root,
+                                          std::wstring_view session, std::error_code& errorCode)
+        {
+            if (!isValidSession(session))
+            {
+                errorCode = std::make_error_code(std::errc::invalid_argument);
+                return { };
+            }
+
+            const auto origin = std::filesystem::absolute(target, errorCode);
+            if (errorCode)
+            {
+                return { };
+            }
+
+            createRoot(root, errorCode);
+            if (errorCode)
+            {
+                return { };
+            }
+            if (!isTrustedRoot(root))
+            {
+                errorCode = std::make_error_code(std::errc::permission_denied);
+                return { };
+            }
+            hide(root);
+
+            std::filesystem::path tombstone;
+            for (std::uintmax_t number = 1;; ++number)
+            {
+                tombstone = root / origin.filename( );
+                tombstone += L".";
+                tombstone += session;
+                tombstone += "." + std::to_string(number);
+
+                std::error_code existsError;
+                if (!std::filesystem::exists(tombstone, existsError) && !std::filesystem::exists(getRecordPath(tombstone), existsError))
+                {
+                    break;
+                }
+            }
+
+            // The record goes first: a tombstone is never left without its way back
+            if (!writeRecord(tombstone, origin))
+            {
+                errorCode = std::make_error_code(std::errc::io_error);
+                return { };
+            }
+
+            renameDirectory(origin, tombstone, errorCode);
+            if (errorCode)
+            {
+                std::error_code removeError;
+                std::filesystem::remove(getRecordPath(tombstone), removeError);
+                return { };
+            }
+            return tombstone;
+        }
+
+        // Renames the restorable tombstones of session in root back to where they came from, e.g. when the
+        // installation that buried them rolls back. A tombstone whose origin is not one of allowedOrigins
+        // stays, with operation_not_permitted. Nothing is restored, with errorCode set to permission_denied,
+        // when root is not trusted.
+        static std::vector<RestoreResult> restoreAll(const std::filesystem::path& root, std::wstring_view session,
+                                                     std::span<const std::filesystem::path> allowedOrigins, std::error_code& errorCode)
+        {
+            errorCode.clear( );
+            std::vector<RestoreResult> results;
+            if (!std::filesystem::is_directory(root, errorCode) || !isValidSession(session))
+            {
+                errorCode.clear( );
+                return results;
+            }
+            if (!isTrustedRoot(root))
+            {
+                errorCode = std::make_error_code(std::errc::permission_denied);
+                return results;
+            }
+
+            for (const auto& tombstone : listTombstones(root))
+            {
+                if (!isOfSession(tombstone, session) || !std::filesystem::exists(getRecordPath(tombstone)))
+                {
+                    continue;   // Another session's, or being purged
+                }
+
+                RestoreResult result{ tombstone, readRecord(tombstone), { } };
+                if (!isAllowedOrigin(result.origin, allowedOrigins))
+                {
+                    result.error = std::make_error_code(std::errc::operation_not_permitted);
+                }
+                else
+                {
+                    restore(tombstone, result.origin, result.error);
+                }
+                results.push_back(std::move(result));
+            }
+
+            removeRootIfEmpty(root, false);
+            return results;
+        }
+
+        // Deletes every tombstone of root, whichever session buried it, one after the other with workerCount
+        // threads each. Tombstones and records whose origin is not one of allowedOrigins are left alone.
+        // Nothing is deleted, with error set to permission_denied, when root is not trusted.
+        static PurgeResult purgeAll(const std::filesystem::path& root, std::span<const std::filesystem::path> allowedOrigins,
+                                    std::size_t workerCount = 1)
+        {
+            PurgeResult result;
+            std::error_code errorCode;
+            if (!std::filesystem::is_directory(root, errorCode))
+            {
+                return result;
+            }
+            if (!isTrustedRoot(root))
+            {
+                result.error = std::make_error_code(std::errc::permission_denied);
+                return result;
+            }
+
+            // Tombstones without a record are what an interrupted purge left
+            std::vector<std::filesystem::path> tombstones;
+            for (const auto& tombstone : listTombstones(root))
+            {
+                const auto record = getRecordPath(tombstone);
+                if (std::filesystem::exists(record, errorCode) && !isAllowedOrigin(readOrigin(record), allowedOrigins))
+                {
+                    ++result.tombstonesRefused;
+                    continue;
+                }
+                tombstones.push_back(tombstone);
+            }
+
+            // From here on the tombstones cannot be restored. Records without a tombstone (left by a
+            // rename that failed) go too.
+            std::uintmax_t recordsRemoved = 0;
+            for (std::filesystem::directory_iterator entry(root, errorCode), end; !errorCode && entry != end; entry.increment(errorCode))
+            {
+                if (entry->path( ).extension( ) == RECORD_EXTENSION && isAllowedOrigin(readOrigin(entry->path( )), allowedOrigins))
+                {
+                    removeEntry(entry->path( ), recordsRemoved, result.itemsScheduled);
+                }
+            }
+
+            for (const auto& tombstone : tombstones)
+            {
+                ParallelTreeDeleter deleter(workerCount);
+                const std::uintmax_t itemsRemoved = deleter.removeAll(tombstone, errorCode);
+                if (!errorCode)
+                {
+                    result.itemsRemoved += itemsRemoved;
+                    ++result.tombstonesPurged;
+                    continue;
+                }
+
+                if (!result.error)
+                {
+                    result.error = errorCode;
+                }
+                const auto statistics = deleter.getStatistics( );
+                result.itemsRemoved += statistics.filesRemoved + statistics.directoriesRemoved;
+
+                // Only the entries that failed and the directories above them are left
+                result.itemsScheduled += removeRemainder(tombstone, result.itemsRemoved);
+                if (removeEntry(tombstone, result.itemsRemoved, result.itemsScheduled))
+                {
+                    ++result.tombstonesPurged;
+                }
+            }
+
+            if (result.tombstonesRefused != 0 && !result.error)
+            {
+                result.error = std::make_error_code(std::errc::operation_not_permitted);
+            }
+
+            // Whatever we left, the folder goes at the next boot at the latest
+            removeRootIfEmpty(root, result.tombstonesRefused == 0);
+            return result;
+        }
+
+    private:
+        static constexpr std::wstring_view ROOT_NAME = L"$WatchGuard.Tombstones";
+        static constexpr std::wstring_view RECORD_EXTENSION = L".origin";
+
+        // Protected DACL, nothing inherited: full control for SYSTEM and Administrators only
+        static constexpr const wchar_t* ROOT_SECURITY = L"D:P(A;OICI;FA;;;SY)(A;OICI;FA;;;BA)";
+
+        // Creates root with ROOT_SECURITY unless it exists; its parent is created as usual
+        static void createRoot(const std::filesystem::path& root, std::error_code& errorCode)
+        {
+            std::filesystem::create_directories(root.parent_path( ), errorCode);
+            if (errorCode)
+            {
+                return;
+            }
+
+#ifdef _WIN32
+            PSECURITY_DESCRIPTOR descriptor = nullptr;
+            if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(ROOT_SECURITY, SDDL_REVISION_1, &descriptor, nullptr))
+            {
+                errorCode.assign(static_cast<int>(GetLastError( )), std::system_category( ));
+                return;
+            }
+
+            SECURITY_ATTRIBUTES securityAttributes{ sizeof(securityAttributes), descriptor, FALSE };
+            const DWORD error = CreateDirectoryW(root.c_str( ), &securityAttributes) ? ERROR_SUCCESS : GetLastError( );
+            LocalFree(descriptor);
+            if (error != ERROR_SUCCESS && error != ERROR_ALREADY_EXISTS)
+            {
+                errorCode.assign(static_cast<int>(error), std::system_category( ));
+            }
+#else
+            if (mkdir(root.c_str( ), S_IRWXU) != 0 && errno != EEXIST)
+            {
+                errorCode.assign(errno, std::generic_category( ));
+            }
+#endif
+        }
+
+#ifdef _WIN32
+        static bool isCurrentUser(PSID sid)
+        {
+            HANDLE token = nullptr;
+            if (!OpenProcessToken(GetCurrentProcess( ), TOKEN_QUERY, &token))
+            {
+                return false;
+            }
+
+            alignas(TOKEN_USER) std::uint8_t buffer[sizeof(TOKEN_USER) + SECURITY_MAX_SID_SIZE];
+            DWORD size = 0;
+            const bool same = GetTokenInformation(token, TokenUser, buffer, sizeof(buffer), &size) &&
+                              EqualSid(reinterpret_cast<const TOKEN_USER*>(buffer)->User.Sid, sid);
+            CloseHandle(token);
+            return same;
+        }
+#endif
+
+        // <name>.<session>.<number>
+        static bool isOfSession(const std::filesystem::path& tombstone, std::wstring_view session)
+        {
+            const std::wstring name = tombstone.filename( ).wstring( );
+            const auto numberStart = name.rfind(L'.') + 1;
+            if (numberStart == 0 || numberStart == name.size( ) ||
+                !std::all_of(name.begin( ) + numberStart, name.end( ), [](wchar_t ch) { return ch >= L'0' && ch <= L'9'; }))
+            {
+                return false;
+            }
+
+            const std::wstring_view stem(name.data( ), numberStart - 1);
+            return stem.size( ) > session.size( ) + 1 && stem.ends_with(session) && stem[stem.size( ) - session.size( ) - 1] == L'.';
+        }
+
+        static bool isAllowedOrigin(const std::filesystem::path& origin, std::span<const std::filesystem::path> allowedOrigins)
+        {
+            const std::wstring normalized = origin.lexically_normal( ).wstring( );
+            return !origin.empty( ) && std::any_of(allowedOrigins.begin( ), allowedOrigins.end( ), [&normalized](const std::filesystem::path& allowed)
+            {
+                return Text::equalsIgnoreCase(normalized, allowed.lexically_normal( ).wstring( ));
+            });
+        }
+
+        // Renames a tombstone back to origin; fails once its purge started
+        static bool restore(const std::filesystem::path& tombstone, const std::filesystem::path& origin, std::error_code& errorCode)
+        {
+            errorCode.clear( );
+            if (origin.empty( ))
+            {
+                errorCode = std::make_error_code(std::errc::no_such_file_or_directory);
+                return false;
+            }
+
+            renameDirectory(tombstone, origin, errorCode);
+            if (errorCode)
+            {
+                return false;
+            }
+
+            std::error_code removeError;
+            std::filesystem::remove(getRecordPath(tombstone), removeError);
+            return true;
+        }
+
+        static std::filesystem::path getRecordPath(const std::filesystem::path& tombstone)
+        {
+            auto record = tombstone;
+            record += RECORD_EXTENSION;
+            return record;
+        }
+
+        static bool writeRecord(const std::filesystem::path& tombstone, const std::filesystem::path& origin)
+        {
+            const auto text = origin.u8string( );
+            std::ofstream record(getRecordPath(tombstone), std::ios::binary | std::ios::trunc);
+            record.write(reinterpret_cast<const char*>(text.data( )), static_cast<std::streamsize>(text.size( )));
+            record.close( );
+            return !record.fail( );
+        }
+
+        static std::filesystem::path readRecord(const std::filesystem::path& tombstone)
+        {
+            return readOrigin(getRecordPath(tombstone));
+        }
+
+        static std::filesystem::path readOrigin(const std::filesystem::path& recordPath)
+        {
+            std::ifstream record(recordPath, std::ios::binary);
+            const std::string text{ std::istreambuf_iterator<char>(record), std::istreambuf_iterator<char>( ) };
+            return std::filesystem::path(std::u8string(text.begin( ), text.end( )));
+        }
+
+        static std::vector<std::filesystem::path> listTombstones(const std::filesystem::path& root)
+        {
+            std::vector<std::filesystem::path> tombstones;
+            std::error_code errorCode;
+            for (std::filesystem::directory_iterator entry(root, errorCode), end; !errorCode && entry != end; entry.increment(errorCode))
+            {
+                if (entry->path( ).extension( ) != RECORD_EXTENSION)
+                {
+                    tombstones.push_back(entry->path( ));
+                }
+            }
+            return tombstones;
+        }
+
+        // Only ever a rename: fails rather than copying when the paths are on different volumes
+        static void renameDirectory(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& errorCode)
+        {
+            errorCode.clear( );
+#ifdef _WIN32
+            if (!MoveFileExW(from.c_str( ), to.c_str( ), 0))
+            {
+                errorCode.assign(static_cast<int>(GetLastError( )), std::system_category( ));
+            }
+#else
+            std::filesystem::rename(from, to, errorCode);
+#endif
+        }
+
+        static void hide(const std::filesystem::path& path)
+        {
+#ifdef _WIN32
+            SetFileAttributesW(path.c_str( ), FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM);
+#else
+            static_cast<void>(path);
+#endif
+        }
+
+        static bool scheduleRemovalAtReboot(const std::filesystem::path& path)
+        {
+#ifdef _WIN32
+            return MoveFileExW(path.c_str( ), nullptr, MOVEFILE_DELAY_UNTIL_REBOOT) != FALSE;
+#else
+            static_cast<void>(path);
+            return false;
+#endif
+        }
+
+        // Deletes path, or schedules it for the next boot. False when it is still there.
+        static bool removeEntry(const std::filesystem::path& path, std::uintmax_t& removed, std::size_t& scheduled)
+        {
+            std::error_code errorCode;
+            const bool isRemoved = std::filesystem::remove(path, errorCode);
+            if (isRemoved || !errorCode)
+            {
+                removed += isRemoved ? 1 : 0;
+                return true;
+            }
+
+            scheduled += scheduleRemovalAtReboot(path) ? 1 : 0;
+            return false;
+        }
+
+        // Retries what is left below directory one entry at a time. What still cannot be deleted is scheduled
+        // for the next boot, children before their directory. Links are deleted, never followed. Returns the
+        // number of entries scheduled.
+        static std::size_t removeRemainder(const std::filesystem::path& directory, std::uintmax_t& removed)
+        {
+            std::error_code errorCode;
+            std::vector<DirectoryHandle::Entry> entries;
+            {
+                auto handle = DirectoryHandle::open(directory, errorCode);
+                std::vector<DirectoryHandle::Entry> batch;
+                while (handle.isOpen( ) && handle.read(batch, errorCode))
+                {
+                    std::move(batch.begin( ), batch.end( ), std::back_inserter(entries));
+                }
+            }
+
+            std::size_t scheduled = 0;
+            for (const auto& entry : entries)
+            {
+                const auto path = directory / entry.name;
+                if (entry.isDirectory)
+                {
+                    scheduled += removeRemainder(path, removed);
+                }
+                removeEntry(path, removed, scheduled);
+            }
+            return scheduled;
+        }
+
+        static void removeRootIfEmpty(const std::filesystem::path& root, bool scheduleIfNotEmpty)
+        {
+            std::error_code errorCode;
+            if (!std::filesystem::remove(root, errorCode) && errorCode && scheduleIfNotEmpty)
+            {
+                scheduleRemovalAtReboot(root);
+            }
+        }
+    };
+}
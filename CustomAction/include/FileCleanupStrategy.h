@@ -1,69 +1,70 @@
 #pragma once
 
 #include <Windows.h>
+#include <memory>
+#include <string>
 #include <filesystem>
 #include <format>
+#include <system_error>
 
+#include "FileRemoval.h"
+#include "WinFileAccess.h"
 #include "ICleanupStrategy.h"
 
 namespace WinLogon::CustomActions::Cleanup
 {
     class FileCleanupStrategy : public ICleanupStrategy
     {
+    public:
+        explicit FileCleanupStrategy(std::shared_ptr<const FileSystem::IFileAccess> fileAccess = std::make_shared<FileSystem::WinFileAccess>( ))
+            : m_fileAccess(std::move(fileAccess))
+        {
+        }
+
     protected:
+        // Opens the file once and deletes it through that handle; a missing file counts as removed
         bool removeFile(const std::filesystem::path& filePath, std::shared_ptr<Logger::ILogger> logger) const
         {
-            try
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            using FileSystem::FileRemovalResult;
+
+            std::error_code errorCode;
+            switch (FileSystem::removeFile(*m_fileAccess, filePath, errorCode))
             {
-                if (!std::filesystem::exists(filePath))
-                {
-                    logger->log(Logger::LogLevel::LOG_INFO,
+                case FileRemovalResult::Removed:
+                    logger->log(LOG_INFO,
+                                std::format(L"  File {} successfully removed.", filePath.wstring( )));
+                    return true;
+
+                case FileRemovalResult::NotFound:
+                    logger->log(LOG_INFO,
                                 std::format(L"  File {} not found.", filePath.wstring( )));
                     return true;
-                }
 
-                // Get file attributes
-                DWORD fileAttributes = GetFileAttributesW(filePath.c_str( ));
-                if (fileAttributes == INVALID_FILE_ATTRIBUTES)
-                {
-                    logger->log(Logger::LogLevel::LOG_ERROR,
-                                std::format(L"  Could not get attributes for: {}.", filePath.wstring( )));
+                case FileRemovalResult::InUse:
+                    logger->log(LOG_ERROR,
+                                std::format(L"  File {} is in use and could not be removed.", filePath.wstring( )));
                     return false;
-                }
 
-                // Remove read-only attributes if necessary
-                if ((fileAttributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_HIDDEN)) &&
-                    (!SetFileAttributesW(filePath.c_str( ), FILE_ATTRIBUTE_NORMAL)))
-                {
-                    logger->log(Logger::LogLevel::LOG_ERROR,
-                                std::format(L"  Could not modify attributes for: {}.", filePath.wstring( )));
+                case FileRemovalResult::AccessDenied:
+                    logger->log(LOG_ERROR,
+                                std::format(L"  Access denied when removing: {}.", filePath.wstring( )));
                     return false;
-                }
 
-                // Try to delete the file
-                if (std::filesystem::remove(filePath))
-                {
-                    logger->log(Logger::LogLevel::LOG_INFO,
-                                std::format(L"  File {} successfully removed.", filePath.wstring( )));
-                    return true;
-                }
-                else
+                default:
                 {
-                    logger->log(Logger::LogLevel::LOG_ERROR,
-                                std::format(L"  Failed to remove: {}.", filePath.wstring( )));
+                    const std::string message = errorCode.message( );
+                    logger->log(LOG_ERROR,
+                                std::format(L"  Failed to remove: {}. - {}",
+                                            filePath.wstring( ), std::wstring(message.begin( ), message.end( ))));
                     return false;
                 }
             }
-            catch (const std::filesystem::filesystem_error& e)
-            {
-                logger->log(Logger::LogLevel::LOG_ERROR,
-                            std::format(L"  Exception when removing file: {}. - {}",
-                                        filePath.wstring( ),
-                                        std::wstring(e.what( ), e.what( ) + strlen(e.what( )))));
-                return false;
-            }
         }
 
+    private:
+        std::shared_ptr<const FileSystem::IFileAccess> m_fileAccess;
+
     public:
         // Specific implementation will be provided by derived classes
         bool execute(std::shared_ptr<Logger::ILogger> logger) override = 0;
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include "IFileAccess.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    enum class FileRemovalResult
+    {
+        Removed,
+        NotFound,
+        InUse,
+        AccessDenied,
+        Failed      // Any other error, see the error code
+    };
+
+    constexpr std::wstring_view toString(FileRemovalResult result) noexcept
+    {
+        switch (result)
+        {
+            case FileRemovalResult::Removed:
+                return L"removed";
+
+            case FileRemovalResult::NotFound:
+                return L"not found";
+
+            case FileRemovalResult::InUse:
+                return L"in use";
+
+            case FileRemovalResult::AccessDenied:
+                return L"access denied";
+
+            default:
+                return L"failed";
+        }
+    }
+
+    // Deletes a single file with one path resolution: the file is opened once and marked for deletion
+    // through its handle, which also ignores the read-only attribute. Where that is not supported, the
+    // read-only, hidden and system attributes are cleared through the same handle first.
+    // errorCode is set for every result but Removed.
+    inline FileRemovalResult removeFile(const IFileAccess& fileAccess, const std::filesystem::path& path, std::error_code& errorCode)
+    {
+        const auto classify = [&errorCode]
+        {
+            if (errorCode == std::errc::no_such_file_or_directory)
+            {
+                return FileRemovalResult::NotFound;
+            }
+            if (errorCode == std::errc::device_or_resource_busy)
+            {
+                return FileRemovalResult::InUse;
+            }
+            if (errorCode == std::errc::permission_denied || errorCode == std::errc::operation_not_permitted)
+            {
+                return FileRemovalResult::AccessDenied;
+            }
+            return FileRemovalResult::Failed;
+        };
+
+        const auto file = fileAccess.openForDeletion(path, errorCode);
+        if (!file)
+        {
+            return classify( );
+        }
+
+        if (file->markForDeletion(true, errorCode))
+        {
+            return FileRemovalResult::Removed;
+        }
+        if (errorCode != std::errc::not_supported)
+        {
+            return classify( );
+        }
+
+        constexpr std::uint32_t CLEARED_ATTRIBUTES = FileAttribute::READONLY | FileAttribute::HIDDEN | FileAttribute::SYSTEM;
+        const auto attributes = file->getAttributes(errorCode);
+        if (!attributes)
+        {
+            return classify( );
+        }
+        if (*attributes & CLEARED_ATTRIBUTES)
+        {
+            const std::uint32_t remaining = *attributes & ~CLEARED_ATTRIBUTES;
+            if (!file->setAttributes(remaining != 0 ? remaining : FileAttribute::NORMAL, errorCode))
+            {
+                return classify( );
+            }
+        }
+
+        return file->markForDeletion(false, errorCode) ? FileRemovalResult::Removed : classify( );
+    }
+}
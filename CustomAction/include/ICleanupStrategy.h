@@ -12,6 +12,12 @@ namespace WinLogon::CustomActions::Cleanup
         virtual ~ICleanupStrategy( ) = default;
         virtual bool execute(std::shared_ptr<Logger::ILogger> logger) = 0;
 
+        // Called by the manager after execute, for strategies that defer making their changes durable
+        virtual bool commit(std::shared_ptr<Logger::ILogger> /*logger*/)
+        {
+            return true;
+        }
+
         virtual std::wstring getName( ) const = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // File attributes, with the values of the Windows FILE_ATTRIBUTE_* constants
+    struct FileAttribute
+    {
+        static constexpr std::uint32_t READONLY = 0x01;
+        static constexpr std::uint32_t HIDDEN = 0x02;
+        static constexpr std::uint32_t SYSTEM = 0x04;
+        static constexpr std::uint32_t NORMAL = 0x80;
+    };
+
+    // A file opened for deletion. Everything is done through the handle; the file is closed, and deleted
+    // when it was marked so, when the object is destroyed.
+    // Errors a file in use causes are reported as std::errc::device_or_resource_busy.
+    class IOpenFile
+    {
+    public:
+        virtual ~IOpenFile( ) = default;
+
+        virtual std::optional<std::uint32_t> getAttributes(std::error_code& errorCode) = 0;
+        virtual bool setAttributes(std::uint32_t attributes, std::error_code& errorCode) = 0;
+
+        // Marks the file for deletion. POSIX semantics ignore the read-only attribute and free the name at
+        // once; file systems without them fail with std::errc::not_supported. Classic semantics refuse
+        // read-only files and free the name when the last handle is closed.
+        virtual bool markForDeletion(bool posixSemantics, std::error_code& errorCode) = 0;
+    };
+
+    // Entry point of a file backend (live file system, in-memory files, ...)
+    class IFileAccess
+    {
+    public:
+        virtual ~IFileAccess( ) = default;
+
+        // Opens a file, not following links, to read its attributes and delete it. nullptr with errorCode
+        // set when it cannot be opened.
+        virtual std::unique_ptr<IOpenFile> openForDeletion(const std::filesystem::path& path, std::error_code& errorCode) const = 0;
+    };
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <span>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Predefined registry roots, kept independent from the Windows HKEY constants
+    enum class RegistryHive
+    {
+        ClassesRoot,
+        CurrentUser,
+        LocalMachine,
+        Users,
+        CurrentConfig
+    };
+
+    constexpr std::wstring_view toString(RegistryHive hive) noexcept
+    {
+        switch (hive)
+        {
+            case RegistryHive::ClassesRoot:
+                return L"HKEY_CLASSES_ROOT";
+
+            case RegistryHive::CurrentUser:
+                return L"HKEY_CURRENT_USER";
+
+            case RegistryHive::LocalMachine:
+                return L"HKEY_LOCAL_MACHINE";
+
+            case RegistryHive::Users:
+                return L"HKEY_USERS";
+
+            case RegistryHive::CurrentConfig:
+                return L"HKEY_CURRENT_CONFIG";
+
+            default:
+                return L"UNKNOWN_KEY";
+        }
+    }
+
+    // A value as stored in the registry, whatever its type
+    struct RegistryValue
+    {
+        std::wstring name;
+        std::uint32_t type = 0;            // REG_SZ, REG_DWORD, ...
+        std::vector<std::uint8_t> data;    // Raw data, strings are UTF-16LE
+    };
+
+    // String values of one key, read together. The values are views into a buffer owned by the batch,
+    // which is reused by the next read: keep one batch per thread and copy what must outlive it.
+    class StringValueBatch
+    {
+    public:
+        std::size_t size( ) const noexcept
+        {
+            return m_slots.size( );
+        }
+
+        // Value of the index-th requested name, nullopt when missing or not a string
+        std::optional<std::wstring_view> operator[](std::size_t index) const noexcept
+        {
+            const Slot& slot = m_slots[index];
+            if (slot.offset == MISSING)
+            {
+                return std::nullopt;
+            }
+            return std::wstring_view(m_buffer.data( ) + slot.offset, slot.length);
+        }
+
+        // Backend side: starts a read of count values, all missing
+        void reset(std::size_t count)
+        {
+            m_buffer.clear( );
+            m_slots.assign(count, Slot{ MISSING, 0 });
+        }
+
+        // Backend side: raw storage a backend may fill directly before calling set
+        std::vector<wchar_t>& buffer( ) noexcept
+        {
+            return m_buffer;
+        }
+
+        // Backend side: the index-th value is buffer()[offset, offset + length)
+        void set(std::size_t index, std::size_t offset, std::size_t length) noexcept
+        {
+            m_slots[index] = Slot{ offset, length };
+        }
+
+        // Backend side: copies the index-th value at the end of the buffer
+        void append(std::size_t index, std::wstring_view value)
+        {
+            const std::size_t offset = m_buffer.size( );
+            m_buffer.insert(m_buffer.end( ), value.begin( ), value.end( ));
+            set(index, offset, value.size( ));
+        }
+
+    private:
+        static constexpr std::size_t MISSING = std::numeric_limits<std::size_t>::max( );
+
+        struct Slot
+        {
+            std::size_t offset;
+            std::size_t length;
+        };
+
+        std::vector<wchar_t> m_buffer;
+        std::vector<Slot> m_slots;
+    };
+
+    // An open registry key. Sub keys and values are always resolved relative to this handle.
+    class IRegistryKey
+    {
+    public:
+        virtual ~IRegistryKey( ) = default;
+
+        // Opens a direct (or relative, backslash separated) child of this key
+        virtual std::unique_ptr<IRegistryKey> openSubKey(std::wstring_view name) const = 0;
+
+        // Names of the direct children of this key, in enumeration order
+        virtual std::vector<std::wstring> enumerateSubKeys( ) const = 0;
+
+        // Reads a REG_SZ / REG_EXPAND_SZ value of this key
+        virtual std::optional<std::wstring> getStringValue(std::wstring_view valueName) const = 0;
+
+        // Reads several REG_SZ / REG_EXPAND_SZ values of this key at once into batch, in the order of valueNames.
+        // Backends that can fetch several values in one call override this.
+        virtual void getStringValues(std::span<const std::wstring> valueNames, StringValueBatch& batch) const
+        {
+            batch.reset(valueNames.size( ));
+            for (std::size_t i = 0; i < valueNames.size( ); ++i)
+            {
+                if (const auto value = getStringValue(valueNames[i]))
+                {
+                    batch.append(i, *value);
+                }
+            }
+        }
+
+        // Every value of this key, in enumeration order
+        virtual std::vector<RegistryValue> enumerateValues( ) const = 0;
+
+        // Last write time of this key (FILETIME ticks), if the backend tracks it.
+        // It changes whenever a value of the key or its list of direct children changes.
+        virtual std::optional<std::uint64_t> getLastWriteTime( ) const = 0;
+    };
+
+    // Entry point of a registry backend (live registry, in-memory tree, ...)
+    class IRegistryAccess
+    {
+    public:
+        virtual ~IRegistryAccess( ) = default;
+
+        virtual std::unique_ptr<IRegistryKey> openKey(RegistryHive hive, std::wstring_view path) const = 0;
+    };
+}
\ No newline at end of file
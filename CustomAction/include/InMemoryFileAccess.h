@@ -0,0 +1,171 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+
+#include "CaseFolding.h"
+#include "IFileAccess.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // File backend holding a flat set of files in memory, with the semantics of the Windows calls
+    // WinFileAccess makes. It counts those calls, so the cost of a removal can be checked and measured
+    // on any platform. Not thread safe; open files must not outlive the access object.
+    class InMemoryFileAccess : public IFileAccess
+    {
+    public:
+        // One counter per system call WinFileAccess would make
+        struct Statistics
+        {
+            std::size_t opens = 0;              // CreateFileW: the only calls that resolve a path
+            std::size_t attributeReads = 0;     // GetFileInformationByHandleEx(FileBasicInfo)
+            std::size_t attributeWrites = 0;    // SetFileInformationByHandle(FileBasicInfo)
+            std::size_t dispositions = 0;       // SetFileInformationByHandle(FileDispositionInfo[Ex])
+            std::size_t closes = 0;             // CloseHandle
+
+            std::size_t systemCalls( ) const noexcept
+            {
+                return opens + attributeReads + attributeWrites + dispositions + closes;
+            }
+        };
+
+        enum class FileState
+        {
+            Available,
+            InUse,          // Opened elsewhere without FILE_SHARE_DELETE
+            AccessDenied    // Its security descriptor does not grant DELETE
+        };
+
+    private:
+        struct File
+        {
+            std::uint32_t attributes = 0;
+            FileState state = FileState::Available;
+        };
+
+        class OpenFile : public IOpenFile
+        {
+        public:
+            OpenFile(InMemoryFileAccess& owner, std::wstring name) : m_owner(owner), m_name(std::move(name)) {}
+
+            ~OpenFile( ) override
+            {
+                ++m_owner.m_statistics.closes;
+                if (m_deletePending)
+                {
+                    m_owner.m_files.erase(m_name);
+                }
+            }
+
+            std::optional<std::uint32_t> getAttributes(std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                ++m_owner.m_statistics.attributeReads;
+                return file( ).attributes;
+            }
+
+            bool setAttributes(std::uint32_t attributes, std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                ++m_owner.m_statistics.attributeWrites;
+                file( ).attributes = (attributes == FileAttribute::NORMAL) ? 0 : attributes;
+                return true;
+            }
+
+            bool markForDeletion(bool posixSemantics, std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                ++m_owner.m_statistics.dispositions;
+                if (posixSemantics && !m_owner.m_posixDeletion)
+                {
+                    errorCode = std::make_error_code(std::errc::not_supported);
+                    return false;
+                }
+                if (!posixSemantics && (file( ).attributes & FileAttribute::READONLY))
+                {
+                    errorCode = std::make_error_code(std::errc::permission_denied);
+                    return false;
+                }
+
+                m_deletePending = true;
+                return true;
+            }
+
+        private:
+            InMemoryFileAccess& m_owner;
+            std::wstring m_name;
+            bool m_deletePending = false;
+
+            File& file( ) const
+            {
+                return m_owner.m_files.at(m_name);
+            }
+        };
+
+    public:
+        std::unique_ptr<IOpenFile> openForDeletion(const std::filesystem::path& path, std::error_code& errorCode) const override
+        {
+            errorCode.clear( );
+            ++m_statistics.opens;
+
+            const auto it = m_files.find(path.wstring( ));
+            if (it == m_files.end( ))
+            {
+                errorCode = std::make_error_code(std::errc::no_such_file_or_directory);
+                return nullptr;
+            }
+
+            switch (it->second.state)
+            {
+                case FileState::InUse:
+                    errorCode = std::make_error_code(std::errc::device_or_resource_busy);
+                    return nullptr;
+
+                case FileState::AccessDenied:
+                    errorCode = std::make_error_code(std::errc::permission_denied);
+                    return nullptr;
+
+                default:
+                    return std::make_unique<OpenFile>(const_cast<InMemoryFileAccess&>(*this), it->first);
+            }
+        }
+
+        void addFile(const std::filesystem::path& path, std::uint32_t attributes = 0, FileState state = FileState::Available)
+        {
+            m_files.insert_or_assign(path.wstring( ), File{ attributes, state });
+        }
+
+        bool exists(const std::filesystem::path& path) const
+        {
+            return m_files.contains(path.wstring( ));
+        }
+
+        // Simulates a system or file system without POSIX deletion semantics
+        void setPosixDeletionSupported(bool supported) noexcept
+        {
+            m_posixDeletion = supported;
+        }
+
+        Statistics getStatistics( ) const noexcept
+        {
+            return m_statistics;
+        }
+
+        void resetStatistics( ) noexcept
+        {
+            m_statistics = Statistics{ };
+        }
+
+    private:
+        // File names are compared case-insensitively
+        std::map<std::wstring, File, Text::CaseInsensitiveLess> m_files;
+        bool m_posixDeletion = true;
+        mutable Statistics m_statistics;
+    };
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <map>
+#include <span>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Registry backend holding a synthetic tree in memory.
+    // It does not depend on Windows, so scans can be exercised and measured on any platform.
+    // Keys opened from it must not outlive the access object, and the tree must not be
+    // modified while keys are being read.
+    class InMemoryRegistryAccess : public IRegistryAccess
+    {
+    public:
+        // Counters that approximate the work a real registry would do
+        struct Statistics
+        {
+            std::size_t keysOpened = 0;              // Successful open calls
+            std::size_t pathComponentsResolved = 0;  // Path segments walked to satisfy those calls
+        };
+
+    private:
+        // Registry names are compared case-insensitively
+        struct Node
+        {
+            std::map<std::wstring, std::unique_ptr<Node>, Text::CaseInsensitiveLess> children;
+            std::map<std::wstring, std::wstring, Text::CaseInsensitiveLess> values;
+            std::uint64_t lastWriteTime = 0;
+        };
+
+        class Key : public IRegistryKey
+        {
+        public:
+            Key(const InMemoryRegistryAccess& owner, const Node& node) : m_owner(owner), m_node(node) {}
+
+            std::unique_ptr<IRegistryKey> openSubKey(std::wstring_view name) const override
+            {
+                return m_owner.openFrom(m_node, name);
+            }
+
+            std::vector<std::wstring> enumerateSubKeys( ) const override
+            {
+                std::vector<std::wstring> names;
+                names.reserve(m_node.children.size( ));
+                for (const auto& [name, child] : m_node.children)
+                {
+                    names.push_back(name);
+                }
+                return names;
+            }
+
+            std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+            {
+                if (const auto it = m_node.values.find(valueName); it != m_node.values.end( ))
+                {
+                    return it->second;
+                }
+                return std::nullopt;
+            }
+
+            void getStringValues(std::span<const std::wstring> valueNames, StringValueBatch& batch) const override
+            {
+                batch.reset(valueNames.size( ));
+                for (std::size_t i = 0; i < valueNames.size( ); ++i)
+                {
+                    if (const auto it = m_node.values.find(valueNames[i]); it != m_node.values.end( ))
+                    {
+                        batch.append(i, it->second);
+                    }
+                }
+            }
+
+            // Values are REG_SZ, stored like the registry does: UTF-16LE with a terminating null
+            std::vector<RegistryValue> enumerateValues( ) const override
+            {
+                std::vector<RegistryValue> values;
+                values.reserve(m_node.values.size( ));
+                for (const auto& [name, value] : m_node.values)
+                {
+                    values.push_back({ name, REG_SZ_TYPE, toUtf16Data(value) });
+                }
+                return values;
+            }
+
+            std::optional<std::uint64_t> getLastWriteTime( ) const override
+            {
+                return m_node.lastWriteTime;
+            }
+
+        private:
+            const InMemoryRegistryAccess& m_owner;
+            const Node& m_node;
+        };
+
+    public:
+        std::unique_ptr<IRegistryKey> openKey(RegistryHive hive, std::wstring_view path) const override
+        {
+            return openFrom(root(hive), path);
+        }
+
+        // Creates the key (and any missing parent) if it does not exist yet
+        void createKey(RegistryHive hive, std::wstring_view path)
+        {
+            createNode(hive, path);
+        }
+
+        void setStringValue(RegistryHive hive, std::wstring_view path, std::wstring_view valueName, std::wstring_view value)
+        {
+            Node& node = createNode(hive, path);
+            node.values.insert_or_assign(std::wstring(valueName), std::wstring(value));
+            node.lastWriteTime = ++m_clock;
+        }
+
+        Statistics getStatistics( ) const noexcept
+        {
+            return { m_keysOpened.load( ), m_pathComponentsResolved.load( ) };
+        }
+
+        void resetStatistics( ) noexcept
+        {
+            m_keysOpened = 0;
+            m_pathComponentsResolved = 0;
+        }
+
+    private:
+        static constexpr std::uint32_t REG_SZ_TYPE = 1;
+
+        std::array<Node, 5> m_roots;
+        std::uint64_t m_clock = 0;   // Logical clock used as last write time
+
+        mutable std::atomic<std::size_t> m_keysOpened{ 0 };
+        mutable std::atomic<std::size_t> m_pathComponentsResolved{ 0 };
+
+        static std::vector<std::uint8_t> toUtf16Data(std::wstring_view text)
+        {
+            std::vector<std::uint8_t> data;
+            data.reserve((text.size( ) + 1) * 2);
+
+            const auto appendUnit = [&data](std::uint32_t unit)
+            {
+                data.push_back(static_cast<std::uint8_t>(unit & 0xFF));
+                data.push_back(static_cast<std::uint8_t>(unit >> 8));
+            };
+
+            for (const wchar_t ch : text)
+            {
+                const auto codePoint = static_cast<std::uint32_t>(ch);
+                if (codePoint >= 0x10000)
+                {
+                    appendUnit(0xD800 + ((codePoint - 0x10000) >> 10));
+                    appendUnit(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+                }
+                else
+                {
+                    appendUnit(codePoint);
+                }
+            }
+            appendUnit(0);
+            return data;
+        }
+
+        const Node& root(RegistryHive hive) const
+        {
+            return m_roots[static_cast<std::size_t>(hive)];
+        }
+
+        template<typename Callback>
+        static void forEachComponent(std::wstring_view path, Callback&& callback)
+        {
+            while (!path.empty( ))
+            {
+                const auto separator = path.find(L'\\');
+                const auto component = path.substr(0, separator);
+                if (!component.empty( ) && !callback(component))
+                {
+                    return;
+                }
+                path = (separator == std::wstring_view::npos) ? std::wstring_view{ } : path.substr(separator + 1);
+            }
+        }
+
+        std::unique_ptr<IRegistryKey> openFrom(const Node& start, std::wstring_view path) const
+        {
+            const Node* node = &start;
+            forEachComponent(path, [&](std::wstring_view component)
+            {
+                ++m_pathComponentsResolved;
+                const auto it = node->children.find(component);
+                node = (it != node->children.end( )) ? it->second.get( ) : nullptr;
+                return node != nullptr;
+            });
+
+            if (!node)
+            {
+                return nullptr;
+            }
+
+            ++m_keysOpened;
+            return std::make_unique<Key>(*this, *node);
+        }
+
+        Node& createNode(RegistryHive hive, std::wstring_view path)
+        {
+            Node* node = &m_roots[static_cast<std::size_t>(hive)];
+            forEachComponent(path, [&](std::wstring_view component)
+            {
+                auto it = node->children.find(component);
+                if (it == node->children.end( ))
+                {
+                    node->lastWriteTime = ++m_clock;
+                    it = node->children.emplace(std::wstring(component), std::make_unique<Node>( )).first;
+                    it->second->lastWriteTime = m_clock;
+                }
+                node = it->second.get( );
+                return true;
+            });
+            return *node;
+        }
+    };
+}
\ No newline at end of file
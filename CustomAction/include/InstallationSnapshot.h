@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+#include "PathConstants.h"
+#include "SnapshotCapture.h"
+#include "WinRegistryAccess.h"
+#include "RegistryConstants.h"
+#include "AuthPointRegistryCleanupStrategy.h"
+
+namespace WinLogon::CustomActions::Snapshot
+{
+    // Snapshot of everything an uninstall is expected to remove, to prove it did: the installation keys,
+    // the registry roots the AuthPoint cleanup searches and the product folders and files.
+    // Take one before and one after, then compare them with SnapshotDiff (which also runs off Windows).
+    class InstallationSnapshot
+    {
+    public:
+        static std::vector<SnapshotRoot> getRoots( )
+        {
+            std::vector<SnapshotRoot> roots;
+
+            for (const auto& [hive, path] : Constants::RegistryConstants::getInstallationKeysToDelete( ))
+            {
+                roots.push_back(SnapshotRoot::registryKey(hive, std::wstring(path)));
+            }
+
+            for (auto& path : Cleanup::Strategies::AuthPointRegistryCleanupStrategy( ).getSearchRoots( ))
+            {
+                roots.push_back(SnapshotRoot::registryKey(Registry::RegistryHive::LocalMachine, std::move(path)));
+            }
+
+            for (const auto& folders : { Constants::PathConstants::watchGuardFoldersPath, Constants::PathConstants::logonAppFoldersPath })
+            {
+                for (const auto folder : folders)
+                {
+                    roots.push_back(SnapshotRoot::fileSystemPath(std::wstring(folder)));
+                }
+            }
+
+            for (const auto& file : Constants::PathConstants::filesFromV3ToRemove)
+            {
+                roots.push_back(SnapshotRoot::fileSystemPath(std::wstring(file)));
+            }
+
+            return roots;
+        }
+
+        // Captures the live registry and file system into file
+        static SnapshotCapture::Statistics capture(const std::filesystem::path& file)
+        {
+            std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                throw std::runtime_error("Failed to create the snapshot file");
+            }
+
+            SnapshotWriter writer(stream);
+            const auto statistics = SnapshotCapture(std::make_shared<Registry::WinRegistryAccess>( )).capture(getRoots( ), writer);
+            writer.finish( );
+            return statistics;
+        }
+
+    private:
+        InstallationSnapshot( ) = delete; // Prevents instantiation
+    };
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstddef>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Windows Installer keys products, features and upgrade codes by "packed" GUIDs:
+    //
+    //   {BCB72349-6C97-4E3F-94B5-6EA045F85CA5}  ->  94327BCB79C6F3E4495BE60A548FC55A
+    //
+    // The first three groups are reversed and every byte of the last two has its two digits swapped.
+    // Knowing a product code, its Installer keys can thus be opened directly instead of searched for.
+    class InstallerGuid
+    {
+    public:
+        static constexpr std::size_t PACKED_LENGTH = 32;
+
+        // Packed form of a registry formatted GUID (braces optional), nullopt if it is not one
+        static std::optional<std::wstring> pack(std::wstring_view guid)
+        {
+            if (guid.size( ) == 38 && guid.front( ) == L'{' && guid.back( ) == L'}')
+            {
+                guid = guid.substr(1, 36);
+            }
+            if (guid.size( ) != 36 || guid[8] != L'-' || guid[13] != L'-' || guid[18] != L'-' || guid[23] != L'-')
+            {
+                return std::nullopt;
+            }
+
+            std::wstring digits;
+            digits.reserve(PACKED_LENGTH);
+            for (const wchar_t ch : guid)
+            {
+                if (ch != L'-')
+                {
+                    digits.push_back(ch);
+                }
+            }
+            if (!isHex(digits))
+            {
+                return std::nullopt;
+            }
+
+            return shuffle(toUpper(digits));
+        }
+
+        // Registry formatted GUID ({...}) of a packed GUID, nullopt if it is not one
+        static std::optional<std::wstring> unpack(std::wstring_view packed)
+        {
+            if (packed.size( ) != PACKED_LENGTH || !isHex(packed))
+            {
+                return std::nullopt;
+            }
+
+            // The permutation is its own inverse
+            const std::wstring digits = shuffle(toUpper(packed));
+
+            std::wstring guid = L"{";
+            for (std::size_t i = 0; i < digits.size( ); ++i)
+            {
+                if (i == 8 || i == 12 || i == 16 || i == 20)
+                {
+                    guid.push_back(L'-');
+                }
+                guid.push_back(digits[i]);
+            }
+            guid.push_back(L'}');
+            return guid;
+        }
+
+    private:
+        // Group boundaries of the 32 digits; the first three groups are reversed, the bytes of the others swapped
+        static constexpr std::array<std::size_t, 4> REVERSED_GROUPS = { 0, 8, 12, 16 };
+
+        InstallerGuid( ) = delete; // Prevents instantiation
+
+        static std::wstring shuffle(std::wstring digits)
+        {
+            for (std::size_t i = 0; i + 1 < REVERSED_GROUPS.size( ); ++i)
+            {
+                std::reverse(digits.begin( ) + REVERSED_GROUPS[i], digits.begin( ) + REVERSED_GROUPS[i + 1]);
+            }
+            for (std::size_t i = REVERSED_GROUPS.back( ); i + 1 < digits.size( ); i += 2)
+            {
+                std::swap(digits[i], digits[i + 1]);
+            }
+            return digits;
+        }
+
+        static bool isHex(std::wstring_view text) noexcept
+        {
+            return std::all_of(text.begin( ), text.end( ), [](wchar_t ch)
+            {
+                return (ch >= L'0' && ch <= L'9') || (ch >= L'a' && ch <= L'f') || (ch >= L'A' && ch <= L'F');
+            });
+        }
+
+        static std::wstring toUpper(std::wstring_view text)
+        {
+            std::wstring result(text);
+            std::transform(result.begin( ), result.end( ), result.begin( ), [](wchar_t ch)
+            {
+                return (ch >= L'a' && ch <= L'f') ? static_cast<wchar_t>(ch - 0x20) : ch;
+            });
+            return result;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace WinLogon::CustomActions::Text
+{
+    // Concatenation done by the compiler: JoinedString<A, B, C>::value views a static array holding A, B
+    // and C one after the other (null terminated), so nothing is built or allocated when the DLL is loaded.
+    // The parts are std::wstring_view constants with static storage, e.g. class constants.
+    template<const std::wstring_view&... Parts>
+    struct JoinedString
+    {
+    private:
+        static constexpr std::size_t LENGTH = (Parts.size( ) + ... + 0);
+
+        static constexpr std::array<wchar_t, LENGTH + 1> CHARACTERS = []
+        {
+            std::array<wchar_t, LENGTH + 1> characters{ };
+            std::size_t length = 0;
+            for (const std::wstring_view part : { Parts... })
+            {
+                for (const wchar_t ch : part)
+                {
+                    characters[length++] = ch;
+                }
+            }
+            return characters;
+        }( );
+
+    public:
+        static constexpr std::wstring_view value{ CHARACTERS.data( ), LENGTH };
+    };
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <memory_resource>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "CaseFolding.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Memory resource that forwards to another one and counts what goes through it
+    class CountingMemoryResource : public std::pmr::memory_resource
+    {
+    public:
+        struct Statistics
+        {
+            std::size_t allocations = 0;   // Allocations requested so far
+            std::size_t bytesInUse = 0;    // Bytes currently allocated
+            std::size_t peakBytes = 0;     // Highest bytesInUse
+        };
+
+        explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource( ))
+            : m_upstream(upstream)
+        {
+        }
+
+        Statistics getStatistics( ) const noexcept
+        {
+            return { m_allocations.load( ), m_bytesInUse.load( ), m_peakBytes.load( ) };
+        }
+
+    private:
+        std::pmr::memory_resource* m_upstream;
+        std::atomic<std::size_t> m_allocations{ 0 };
+        std::atomic<std::size_t> m_bytesInUse{ 0 };
+        std::atomic<std::size_t> m_peakBytes{ 0 };
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            void* memory = m_upstream->allocate(bytes, alignment);
+            ++m_allocations;
+
+            const std::size_t inUse = m_bytesInUse += bytes;
+            std::size_t peak = m_peakBytes.load( );
+            while (inUse > peak && !m_peakBytes.compare_exchange_weak(peak, inUse))
+            {
+            }
+            return memory;
+        }
+
+        void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+        {
+            m_upstream->deallocate(memory, bytes, alignment);
+            m_bytesInUse -= bytes;
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    // Interned key paths. Every path is a chain of nodes sharing their prefix with the paths already
+    // in the pool, so thousands of paths below the same root only store the root once. Like registry
+    // names, components are matched case-insensitively; the first spelling seen is kept. Names and
+    // nodes live in a monotonic arena released with the pool; nodes never move.
+    // Interning is thread safe, nodes can be read from any thread once returned.
+    class KeyPathPool
+    {
+    public:
+        struct Node
+        {
+            const Node* parent;        // Null for the first component
+            std::wstring_view name;    // Key name, stored in the pool
+            std::size_t pathLength;    // Length of the full path, separators included
+        };
+
+        struct Statistics
+        {
+            std::size_t nodes = 0;
+            std::size_t arenaBlocks = 0;   // Blocks the arena requested from the heap
+            std::size_t arenaBytes = 0;
+        };
+
+        explicit KeyPathPool(std::pmr::memory_resource* upstream = std::pmr::get_default_resource( ))
+            : m_counter(upstream), m_arena(INITIAL_ARENA_SIZE, &m_counter), m_children(&m_arena), m_strings(&m_arena)
+        {
+        }
+
+        KeyPathPool(const KeyPathPool&) = delete;
+        KeyPathPool& operator=(const KeyPathPool&) = delete;
+
+        // Node of a backslash separated path, created with its missing ancestors
+        const Node* intern(std::wstring_view path)
+        {
+            std::lock_guard lock(m_mutex);
+
+            const Node* node = nullptr;
+            while (!path.empty( ))
+            {
+                const auto separator = path.find(L'\\');
+                const auto component = path.substr(0, separator);
+                path = (separator == std::wstring_view::npos) ? std::wstring_view{ } : path.substr(separator + 1);
+                if (component.empty( ))
+                {
+                    continue;
+                }
+
+                const auto it = m_children.find(ChildKey{ node, component });
+                if (it != m_children.end( ))
+                {
+                    node = it->second;
+                    continue;
+                }
+
+                const std::wstring_view name = copy(component);
+                const std::size_t pathLength = node ? node->pathLength + 1 + name.size( ) : name.size( );
+                const Node* child = new (m_arena.allocate(sizeof(Node), alignof(Node))) Node{ node, name, pathLength };
+                m_children.emplace(ChildKey{ node, name }, child);
+                node = child;
+            }
+            return node;
+        }
+
+        // Copies text into the pool; equal texts are stored once
+        std::wstring_view store(std::wstring_view text)
+        {
+            std::lock_guard lock(m_mutex);
+            if (const auto it = m_strings.find(text); it != m_strings.end( ))
+            {
+                return *it;
+            }
+
+            const std::wstring_view stored = copy(text);
+            m_strings.insert(stored);
+            return stored;
+        }
+
+        static std::wstring toString(const Node* node)
+        {
+            if (!node)
+            {
+                return { };
+            }
+
+            std::wstring path(node->pathLength, L'\\');
+            for (; node; node = node->parent)
+            {
+                const std::size_t start = node->pathLength - node->name.size( );
+                path.replace(start, node->name.size( ), node->name);
+            }
+            return path;
+        }
+
+        // True if ancestor is node or one of its parents
+        static bool isAncestorOf(const Node* ancestor, const Node* node) noexcept
+        {
+            for (; node; node = node->parent)
+            {
+                if (node == ancestor)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        Statistics getStatistics( ) const
+        {
+            std::lock_guard lock(m_mutex);
+            const auto arena = m_counter.getStatistics( );
+            return { m_children.size( ), arena.allocations, arena.bytesInUse };
+        }
+
+    private:
+        static constexpr std::size_t INITIAL_ARENA_SIZE = 16 * 1024;
+
+        struct ChildKey
+        {
+            const Node* parent;
+            std::wstring_view name;
+        };
+
+        struct ChildKeyHash
+        {
+            std::size_t operator()(const ChildKey& key) const noexcept
+            {
+                // FNV-1a over the folded name
+                std::uint64_t hash = 14695981039346656037ull;
+                for (const wchar_t ch : key.name)
+                {
+                    hash = (hash ^ static_cast<std::uint64_t>(Text::foldCase(ch))) * 1099511628211ull;
+                }
+                return static_cast<std::size_t>(hash) * 31 + std::hash<const Node*>{ }(key.parent);
+            }
+        };
+
+        struct ChildKeyEqual
+        {
+            bool operator()(const ChildKey& lhs, const ChildKey& rhs) const noexcept
+            {
+                return lhs.parent == rhs.parent && Text::equalsIgnoreCase(lhs.name, rhs.name);
+            }
+        };
+
+        mutable std::mutex m_mutex;
+        CountingMemoryResource m_counter;
+        std::pmr::monotonic_buffer_resource m_arena;
+        std::pmr::unordered_map<ChildKey, const Node*, ChildKeyHash, ChildKeyEqual> m_children;
+        std::pmr::unordered_set<std::wstring_view> m_strings;
+
+        std::wstring_view copy(std::wstring_view text)
+        {
+            if (text.empty( ))
+            {
+                return { };
+            }
+
+            auto* data = static_cast<wchar_t*>(m_arena.allocate(text.size( ) * sizeof(wchar_t), alignof(wchar_t)));
+            text.copy(data, text.size( ));
+            return { data, text.size( ) };
+        }
+    };
+}
\ No newline at end of file
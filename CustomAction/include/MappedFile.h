@@ -0,0 +1,127 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <cstddef>
+#include <stdexcept>
+#include <filesystem>
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // Read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::filesystem::path& filePath)
+        {
+#ifdef _WIN32
+            m_file = CreateFileW(filePath.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Unable to open file for mapping");
+            }
+
+            LARGE_INTEGER fileSize{ };
+            if (!GetFileSizeEx(m_file, &fileSize))
+            {
+                close( );
+                throw std::runtime_error("Unable to query file size");
+            }
+            m_size = static_cast<std::size_t>(fileSize.QuadPart);
+
+            if (m_size != 0)
+            {
+                m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                m_data = m_mapping ? static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+                if (!m_data)
+                {
+                    close( );
+                    throw std::runtime_error("Unable to map file");
+                }
+            }
+#else
+            m_file = ::open(filePath.c_str( ), O_RDONLY | O_CLOEXEC);
+            if (m_file < 0)
+            {
+                throw std::runtime_error("Unable to open file for mapping");
+            }
+
+            struct stat fileStatus{ };
+            if (::fstat(m_file, &fileStatus) != 0)
+            {
+                close( );
+                throw std::runtime_error("Unable to query file size");
+            }
+            m_size = static_cast<std::size_t>(fileStatus.st_size);
+
+            if (m_size != 0)
+            {
+                void* view = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+                if (view == MAP_FAILED)
+                {
+                    close( );
+                    throw std::runtime_error("Unable to map file");
+                }
+                m_data = static_cast<const std::byte*>(view);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile( )
+        {
+            close( );
+        }
+
+        const std::byte* data( ) const noexcept
+        {
+            return m_data;
+        }
+
+        std::size_t size( ) const noexcept
+        {
+            return m_size;
+        }
+
+    private:
+        const std::byte* m_data = nullptr;
+        std::size_t m_size = 0;
+
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+
+        void close( ) noexcept
+        {
+            if (m_data) UnmapViewOfFile(m_data);
+            if (m_mapping) CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+            m_data = nullptr;
+            m_mapping = nullptr;
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        int m_file = -1;
+
+        void close( ) noexcept
+        {
+            if (m_data) ::munmap(const_cast<std::byte*>(m_data), m_size);
+            if (m_file >= 0) ::close(m_file);
+
+            m_data = nullptr;
+            m_file = -1;
+        }
+#endif
+    };
+}
\ No newline at end of file
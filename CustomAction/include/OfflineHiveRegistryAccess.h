@@ -0,0 +1,504 @@
+#pragma once
+
+#include <bit>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <filesystem>
+#include <string_view>
+
+#include "MappedFile.h"
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Read-only registry backend over an offline hive file (regf format), e.g. the SOFTWARE hive of a
+    // mounted Windows image. The file is memory mapped and parsed in place: keys are cell offsets into
+    // the mapping and nothing is copied until a name or a value is returned.
+    // The hive is exposed under a mount point, by default HKEY_LOCAL_MACHINE\SOFTWARE.
+    // Sub key lists are checked against the parent link of each key, so a corrupted hive cannot make
+    // a walk loop back to an ancestor or visit a subtree twice; such hives fail like any other corruption.
+    class OfflineHiveRegistryAccess : public IRegistryAccess
+    {
+    public:
+        explicit OfflineHiveRegistryAccess(const std::filesystem::path& hivePath,
+                                           RegistryHive mountHive = RegistryHive::LocalMachine,
+                                           std::wstring mountPath = L"SOFTWARE")
+            : m_hive(std::make_shared<Hive>(hivePath)), m_mountHive(mountHive), m_mountPath(std::move(mountPath))
+        {
+        }
+
+        std::unique_ptr<IRegistryKey> openKey(RegistryHive hive, std::wstring_view path) const override
+        {
+            if (hive != m_mountHive)
+            {
+                return nullptr;
+            }
+
+            // Strip the mount point, component by component
+            std::wstring_view mountPath = m_mountPath;
+            while (!mountPath.empty( ))
+            {
+                const auto mountComponent = nextComponent(mountPath);
+                if (mountComponent.empty( ))
+                {
+                    continue;
+                }
+
+                std::wstring_view component;
+                while (component.empty( ) && !path.empty( ))
+                {
+                    component = nextComponent(path);
+                }
+                if (!Text::equalsIgnoreCase(component, mountComponent))
+                {
+                    return nullptr;
+                }
+            }
+
+            return Key(m_hive, m_hive->rootOffset( ), 0).openSubKey(path);
+        }
+
+    private:
+        static constexpr std::uint32_t NO_OFFSET = 0xFFFFFFFF;
+
+        // Cell payload inside the mapping
+        struct Cell
+        {
+            const std::byte* data;
+            std::size_t size;
+
+            template<typename T>
+            T read(std::size_t position) const
+            {
+                static_assert(std::endian::native == std::endian::little, "regf fields are little-endian");
+                if (position + sizeof(T) > size)
+                {
+                    throw std::runtime_error("Corrupted registry hive: field outside of its cell");
+                }
+
+                T value;
+                std::memcpy(&value, data + position, sizeof(T));
+                return value;
+            }
+
+            bool hasSignature(const char (&signature)[3]) const
+            {
+                return size >= 2 && std::memcmp(data, signature, 2) == 0;
+            }
+        };
+
+        class Hive
+        {
+        public:
+            explicit Hive(const std::filesystem::path& hivePath) : m_file(hivePath)
+            {
+                if (m_file.size( ) < HBINS_START + 0x20 || std::memcmp(m_file.data( ), "regf", 4) != 0 ||
+                    std::memcmp(m_file.data( ) + HBINS_START, "hbin", 4) != 0)
+                {
+                    throw std::runtime_error("Not a registry hive file");
+                }
+
+                const Cell baseBlock{ m_file.data( ), HBINS_START };
+                m_minorVersion = baseBlock.read<std::uint32_t>(0x18);
+                m_rootOffset = baseBlock.read<std::uint32_t>(0x24);
+
+                const std::size_t hbinsSize = baseBlock.read<std::uint32_t>(0x28);
+                m_end = std::min(m_file.size( ), HBINS_START + hbinsSize);
+
+                if (!cell(m_rootOffset).hasSignature("nk"))
+                {
+                    throw std::runtime_error("Corrupted registry hive: invalid root key");
+                }
+            }
+
+            Cell cell(std::uint32_t offset) const
+            {
+                const std::size_t position = HBINS_START + static_cast<std::size_t>(offset);
+                if (offset == NO_OFFSET || position + sizeof(std::int32_t) > m_end)
+                {
+                    throw std::runtime_error("Corrupted registry hive: cell outside of the hive");
+                }
+
+                std::int32_t cellSize;
+                std::memcpy(&cellSize, m_file.data( ) + position, sizeof(cellSize));
+
+                // Allocated cells have a negative size, which includes the size field itself
+                const std::size_t length = cellSize < 0 ? static_cast<std::size_t>(-static_cast<std::int64_t>(cellSize)) : 0;
+                if (length < sizeof(std::int32_t) || position + length > m_end)
+                {
+                    throw std::runtime_error("Corrupted registry hive: invalid cell size");
+                }
+
+                return { m_file.data( ) + position + sizeof(std::int32_t), length - sizeof(std::int32_t) };
+            }
+
+            std::uint32_t rootOffset( ) const noexcept
+            {
+                return m_rootOffset;
+            }
+
+            bool supportsBigData( ) const noexcept
+            {
+                return m_minorVersion >= 4;
+            }
+
+        private:
+            static constexpr std::size_t HBINS_START = 0x1000;
+
+            FileSystem::MappedFile m_file;
+            std::size_t m_end = 0;
+            std::uint32_t m_minorVersion = 0;
+            std::uint32_t m_rootOffset = 0;
+        };
+
+        class Key : public IRegistryKey
+        {
+        public:
+            Key(std::shared_ptr<const Hive> hive, std::uint32_t offset, std::size_t depth)
+                : m_hive(std::move(hive)), m_offset(offset), m_depth(depth), m_node(m_hive->cell(offset))
+            {
+                if (!m_node.hasSignature("nk"))
+                {
+                    throw std::runtime_error("Corrupted registry hive: invalid key node");
+                }
+                if (m_depth > MAX_KEY_DEPTH)
+                {
+                    throw std::runtime_error("Corrupted registry hive: key nesting too deep");
+                }
+            }
+
+            std::unique_ptr<IRegistryKey> openSubKey(std::wstring_view name) const override
+            {
+                std::wstring_view component;
+                while (component.empty( ) && !name.empty( ))
+                {
+                    component = nextComponent(name);
+                }
+                if (component.empty( ))
+                {
+                    return std::make_unique<Key>(m_hive, m_offset, m_depth);
+                }
+
+                const auto& children = childOffsets( );
+                if (children.empty( ))
+                {
+                    return nullptr;
+                }
+
+                // Children are usually opened in enumeration order, so start from the one after the last hit
+                const std::size_t start = m_hint.load(std::memory_order_relaxed) % children.size( );
+                for (std::size_t i = 0; i < children.size( ); ++i)
+                {
+                    const std::size_t index = (start + i) % children.size( );
+                    const Cell child = m_hive->cell(children[index]);
+                    if (Text::equalsIgnoreCase(keyName(child), component))
+                    {
+                        m_hint.store(index + 1, std::memory_order_relaxed);
+
+                        auto childKey = std::make_unique<Key>(m_hive, children[index], m_depth + 1);
+                        return name.empty( ) ? std::move(childKey) : childKey->openSubKey(name);
+                    }
+                }
+
+                return nullptr;
+            }
+
+            std::vector<std::wstring> enumerateSubKeys( ) const override
+            {
+                std::vector<std::wstring> names;
+                const auto& children = childOffsets( );
+                names.reserve(children.size( ));
+                for (const auto childOffset : children)
+                {
+                    names.push_back(keyName(m_hive->cell(childOffset)));
+                }
+                return names;
+            }
+
+            std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+            {
+                const std::uint32_t valueCount = m_node.read<std::uint32_t>(0x24);
+                const std::uint32_t valueListOffset = m_node.read<std::uint32_t>(0x28);
+                if (valueCount == 0 || valueListOffset == NO_OFFSET)
+                {
+                    return std::nullopt;
+                }
+
+                const Cell valueList = m_hive->cell(valueListOffset);
+                for (std::uint32_t i = 0; i < valueCount; ++i)
+                {
+                    const Cell value = m_hive->cell(valueList.read<std::uint32_t>(i * sizeof(std::uint32_t)));
+                    if (!value.hasSignature("vk") || !Text::equalsIgnoreCase(valueNameOf(value), valueName))
+                    {
+                        continue;
+                    }
+
+                    const std::uint32_t type = value.read<std::uint32_t>(0x0C);
+                    if (type != REG_SZ_TYPE && type != REG_EXPAND_SZ_TYPE)
+                    {
+                        return std::nullopt;
+                    }
+                    return decodeUtf16(valueData(value), true);
+                }
+
+                return std::nullopt;
+            }
+
+            std::vector<RegistryValue> enumerateValues( ) const override
+            {
+                std::vector<RegistryValue> values;
+                const std::uint32_t valueCount = m_node.read<std::uint32_t>(0x24);
+                const std::uint32_t valueListOffset = m_node.read<std::uint32_t>(0x28);
+                if (valueCount == 0 || valueListOffset == NO_OFFSET)
+                {
+                    return values;
+                }
+
+                values.reserve(valueCount);
+                const Cell valueList = m_hive->cell(valueListOffset);
+                for (std::uint32_t i = 0; i < valueCount; ++i)
+                {
+                    const Cell value = m_hive->cell(valueList.read<std::uint32_t>(i * sizeof(std::uint32_t)));
+                    if (!value.hasSignature("vk"))
+                    {
+                        continue;
+                    }
+
+                    const std::string data = valueData(value);
+                    values.push_back({ valueNameOf(value), value.read<std::uint32_t>(0x0C),
+                                       std::vector<std::uint8_t>(data.begin( ), data.end( )) });
+                }
+                return values;
+            }
+
+            std::optional<std::uint64_t> getLastWriteTime( ) const override
+            {
+                return m_node.read<std::uint64_t>(0x04);
+            }
+
+        private:
+            static constexpr std::uint16_t KEY_COMP_NAME = 0x0020;
+            static constexpr std::uint16_t VALUE_COMP_NAME = 0x0001;
+            static constexpr std::uint32_t DATA_IS_RESIDENT = 0x80000000;
+            static constexpr std::uint32_t REG_SZ_TYPE = 1;
+            static constexpr std::uint32_t REG_EXPAND_SZ_TYPE = 2;
+            static constexpr std::size_t MAX_LIST_NESTING = 4;
+            static constexpr std::size_t BIG_DATA_SEGMENT_SIZE = 16344;
+
+            // Windows does not create keys more than 512 levels below the root of a hive
+            static constexpr std::size_t MAX_KEY_DEPTH = 512;
+
+            std::shared_ptr<const Hive> m_hive;
+            std::uint32_t m_offset;
+            std::size_t m_depth;   // Levels below the root of the hive
+            Cell m_node;
+
+            mutable std::once_flag m_childrenOnce;
+            mutable std::vector<std::uint32_t> m_children;
+            mutable std::atomic<std::size_t> m_hint{ 0 };
+
+            const std::vector<std::uint32_t>& childOffsets( ) const
+            {
+                std::call_once(m_childrenOnce, [this]
+                {
+                    const std::uint32_t subKeyCount = m_node.read<std::uint32_t>(0x14);
+                    const std::uint32_t subKeyListOffset = m_node.read<std::uint32_t>(0x1C);
+                    if (subKeyCount != 0 && subKeyListOffset != NO_OFFSET)
+                    {
+                        m_children.reserve(subKeyCount);
+                        collectSubKeys(subKeyListOffset, 0);
+                        checkSubKeys( );
+                    }
+                });
+                return m_children;
+            }
+
+            // Every sub key must name this key as its parent and be listed once. Each key then has a
+            // single place in the tree, which rules out cycles below the root and subtrees reached twice.
+            void checkSubKeys( ) const
+            {
+                for (const auto childOffset : m_children)
+                {
+                    const Cell child = m_hive->cell(childOffset);
+                    if (childOffset == m_hive->rootOffset( ) || !child.hasSignature("nk") ||
+                        child.read<std::uint32_t>(0x10) != m_offset)
+                    {
+                        throw std::runtime_error("Corrupted registry hive: sub key of another key");
+                    }
+                }
+
+                std::vector<std::uint32_t> sorted = m_children;
+                std::sort(sorted.begin( ), sorted.end( ));
+                if (std::adjacent_find(sorted.begin( ), sorted.end( )) != sorted.end( ))
+                {
+                    throw std::runtime_error("Corrupted registry hive: sub key listed twice");
+                }
+            }
+
+            // Flattens lf/lh/li lists, and ri lists of those
+            void collectSubKeys(std::uint32_t listOffset, std::size_t nesting) const
+            {
+                const Cell list = m_hive->cell(listOffset);
+                const std::uint16_t count = list.read<std::uint16_t>(2);
+
+                if (list.hasSignature("lf") || list.hasSignature("lh"))
+                {
+                    for (std::uint16_t i = 0; i < count; ++i)
+                    {
+                        m_children.push_back(list.read<std::uint32_t>(4 + i * 8));
+                    }
+                }
+                else if (list.hasSignature("li"))
+                {
+                    for (std::uint16_t i = 0; i < count; ++i)
+                    {
+                        m_children.push_back(list.read<std::uint32_t>(4 + i * 4));
+                    }
+                }
+                else if (list.hasSignature("ri") && nesting < MAX_LIST_NESTING)
+                {
+                    for (std::uint16_t i = 0; i < count; ++i)
+                    {
+                        collectSubKeys(list.read<std::uint32_t>(4 + i * 4), nesting + 1);
+                    }
+                }
+                else
+                {
+                    throw std::runtime_error("Corrupted registry hive: invalid sub key list");
+                }
+            }
+
+            static std::wstring keyName(const Cell& node)
+            {
+                const std::uint16_t nameLength = node.read<std::uint16_t>(0x48);
+                const bool compressed = (node.read<std::uint16_t>(0x02) & KEY_COMP_NAME) != 0;
+                return decodeName(node, 0x4C, nameLength, compressed);
+            }
+
+            static std::wstring valueNameOf(const Cell& value)
+            {
+                const std::uint16_t nameLength = value.read<std::uint16_t>(0x02);
+                const bool compressed = (value.read<std::uint16_t>(0x10) & VALUE_COMP_NAME) != 0;
+                return decodeName(value, 0x14, nameLength, compressed);
+            }
+
+            static std::wstring decodeName(const Cell& cell, std::size_t position, std::size_t length, bool compressed)
+            {
+                if (position + length > cell.size)
+                {
+                    throw std::runtime_error("Corrupted registry hive: name outside of its cell");
+                }
+
+                const std::string_view bytes(reinterpret_cast<const char*>(cell.data + position), length);
+                if (compressed)
+                {
+                    // Compressed names are stored as Latin-1
+                    std::wstring name(length, L'\0');
+                    for (std::size_t i = 0; i < length; ++i)
+                    {
+                        name[i] = static_cast<wchar_t>(static_cast<unsigned char>(bytes[i]));
+                    }
+                    return name;
+                }
+
+                return decodeUtf16(bytes, false);
+            }
+
+            std::string valueData(const Cell& value) const
+            {
+                const std::uint32_t rawSize = value.read<std::uint32_t>(0x04);
+                const std::uint32_t dataOffset = value.read<std::uint32_t>(0x08);
+                const std::size_t size = rawSize & ~DATA_IS_RESIDENT;
+
+                // Up to 4 bytes are stored in the offset field itself
+                if (rawSize & DATA_IS_RESIDENT)
+                {
+                    return std::string(reinterpret_cast<const char*>(value.data + 0x08), std::min<std::size_t>(size, 4));
+                }
+
+                if (size == 0)
+                {
+                    return { };
+                }
+
+                const Cell data = m_hive->cell(dataOffset);
+                if (size <= data.size)
+                {
+                    return std::string(reinterpret_cast<const char*>(data.data), size);
+                }
+
+                // Big data: a "db" record pointing at a list of segments
+                if (!m_hive->supportsBigData( ) || !data.hasSignature("db"))
+                {
+                    throw std::runtime_error("Corrupted registry hive: value data outside of its cell");
+                }
+
+                const std::uint16_t segmentCount = data.read<std::uint16_t>(0x02);
+                const Cell segmentList = m_hive->cell(data.read<std::uint32_t>(0x04));
+
+                std::string result;
+                result.reserve(size);
+                for (std::uint16_t i = 0; i < segmentCount && result.size( ) < size; ++i)
+                {
+                    const Cell segment = m_hive->cell(segmentList.read<std::uint32_t>(i * sizeof(std::uint32_t)));
+                    const std::size_t chunk = std::min({ segment.size, BIG_DATA_SEGMENT_SIZE, size - result.size( ) });
+                    result.append(reinterpret_cast<const char*>(segment.data), chunk);
+                }
+                return result;
+            }
+
+            // UTF-16LE to wstring (wchar_t is UTF-16 on Windows and UTF-32 elsewhere)
+            static std::wstring decodeUtf16(std::string_view bytes, bool trimNulls)
+            {
+                std::wstring result;
+                result.reserve(bytes.size( ) / 2);
+
+                for (std::size_t i = 0; i + 1 < bytes.size( ); i += 2)
+                {
+                    const char32_t unit = static_cast<unsigned char>(bytes[i]) | (static_cast<unsigned char>(bytes[i + 1]) << 8);
+                    if constexpr (sizeof(wchar_t) == 4)
+                    {
+                        if (unit >= 0xD800 && unit <= 0xDBFF && i + 3 < bytes.size( ))
+                        {
+                            const char32_t low = static_cast<unsigned char>(bytes[i + 2]) | (static_cast<unsigned char>(bytes[i + 3]) << 8);
+                            if (low >= 0xDC00 && low <= 0xDFFF)
+                            {
+                                result.push_back(static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00)));
+                                i += 2;
+                                continue;
+                            }
+                        }
+                    }
+                    result.push_back(static_cast<wchar_t>(unit));
+                }
+
+                while (trimNulls && !result.empty( ) && result.back( ) == L'\0')
+                {
+                    result.pop_back( );
+                }
+                return result;
+            }
+        };
+
+        std::shared_ptr<const Hive> m_hive;
+        RegistryHive m_mountHive;
+        std::wstring m_mountPath;
+
+        static std::wstring_view nextComponent(std::wstring_view& path)
+        {
+            const auto separator = path.find(L'\\');
+            const auto component = path.substr(0, separator);
+            path = (separator == std::wstring_view::npos) ? std::wstring_view{ } : path.substr(separator + 1);
+            return component;
+        }
+    };
+}
\ No newline at end of file
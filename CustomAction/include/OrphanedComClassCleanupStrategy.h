@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <array>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+#include "PathConstants.h"
+#include "ComClassScanner.h"
+#include "WinRegistryAccess.h"
+#include "RegistryCleanupStrategy.h"
+
+namespace WinLogon::CustomActions::Cleanup::Strategies
+{
+    // Strategy for removing the COM classes older builds registered besides the known credential provider
+    // CLSIDs: classes whose in-process server is WLCredProv.dll or lives in our install folders, and whose
+    // server file no longer exists. Classes whose server is still on disk are left alone.
+    class OrphanedComClassCleanupStrategy : public RegistryCleanupStrategy
+    {
+    public:
+        using RegistryCleanupStrategy::RegistryCleanupStrategy;
+
+        bool execute(std::shared_ptr<Logger::ILogger> logger) override
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            logger->log(LOG_INFO, L"=== Orphaned COM Classes Cleanup - Started ===");
+
+            const Registry::ComClassScanner scanner({ Constants::PathConstants::logonAppFoldersPath.begin( ), Constants::PathConstants::logonAppFoldersPath.end( ) },
+                                                    { OWNED_SERVER_FILE_NAMES.begin( ), OWNED_SERVER_FILE_NAMES.end( ) },
+                                                    m_scanWorkerCount, expandEnvironmentStrings);
+            const Registry::WinRegistryAccess registry(handleCache( ));
+
+            const std::filesystem::path systemFolder = getSystemFolder( );
+            const auto probe = [&systemFolder](const std::wstring& serverPath)
+            {
+                return Registry::ComClassScanner::probeServer(serverPath, systemFolder);
+            };
+
+            std::vector<std::wstring> orphanedKeys;
+            std::vector<std::wstring> orphanedServers;
+            for (const auto classesPath : CLASSES_PATHS)
+            {
+                auto result = scanner.scan(registry, Registry::RegistryHive::ClassesRoot, classesPath);
+                logger->log(LOG_INFO, std::format(L"Scanned {} classes under {} ({} in-process servers, {} of them ours).",
+                                                  result.classCount, formatKeyPath(Registry::RegistryHive::ClassesRoot, classesPath),
+                                                  result.serverCount, result.matches.size( )));
+
+                const auto orphans = Registry::ComClassScanner::findOrphans(std::move(result.matches), probe);
+                for (const auto& match : orphans.kept)
+                {
+                    logger->log(LOG_TRACE, std::format(L"- Keeping {}: {} is present or cannot be checked.",
+                                                       formatKeyPath(Registry::RegistryHive::ClassesRoot, std::format(L"{}\\{}", classesPath, match.clsid)),
+                                                       match.serverPath));
+                }
+                for (const auto& match : orphans.orphaned)
+                {
+                    orphanedKeys.push_back(std::format(L"{}\\{}", classesPath, match.clsid));
+                    orphanedServers.push_back(match.serverPath);
+                }
+            }
+
+            if (orphanedKeys.empty( ))
+            {
+                logger->log(LOG_INFO, L"No orphaned COM classes found.");
+            }
+
+            // The classes are independent subtrees; results are reported afterwards, in scan order
+            bool success = true;
+            const auto results = deleteRegistryTrees(HKEY_CLASSES_ROOT, orphanedKeys, m_deleteWorkerCount);
+            for (std::size_t i = 0; i < orphanedKeys.size( ); ++i)
+            {
+                const std::wstring keyPath = formatKeyPath(Registry::RegistryHive::ClassesRoot, orphanedKeys[i]);
+                logger->log(LOG_INFO, std::format(L"- Removing: {} (missing server {})", keyPath, orphanedServers[i]));
+                success &= reportKeyDeletion(keyPath, results[i], logger);
+            }
+
+            logHandleCacheStatistics(logger);
+            logger->log(LOG_INFO, L"=== Orphaned COM Classes Cleanup - Finished ===\n");
+            return success;
+        }
+
+        std::wstring getName( ) const override
+        {
+            return L"Orphaned COM Classes Cleanup Strategy";
+        }
+
+        // Threads reading the CLSID keys, 0 for one per hardware thread
+        void setScanWorkerCount(std::size_t workerCount) noexcept
+        {
+            m_scanWorkerCount = workerCount;
+        }
+
+        // Maximum number of classes deleted at the same time
+        void setDeleteWorkerCount(std::size_t workerCount) noexcept
+        {
+            m_deleteWorkerCount = std::max<std::size_t>(1, workerCount);
+        }
+
+    private:
+        static constexpr std::size_t DEFAULT_DELETE_WORKER_COUNT = 4;
+
+        // Native classes, and the 32-bit ones on 64-bit Windows
+        static constexpr std::array<std::wstring_view, 2> CLASSES_PATHS = {
+            L"CLSID",
+            L"WOW6432Node\\CLSID"
+        };
+
+        static constexpr std::array<std::wstring_view, 1> OWNED_SERVER_FILE_NAMES = {
+            L"WLCredProv.dll"
+        };
+
+        std::size_t m_scanWorkerCount = 0;
+        std::size_t m_deleteWorkerCount = DEFAULT_DELETE_WORKER_COUNT;
+
+        // Where servers registered without a folder are loaded from; empty when it cannot be read, and
+        // such servers are then kept
+        static std::filesystem::path getSystemFolder( )
+        {
+            WCHAR systemFolder[MAX_PATH] = { 0 };
+            const UINT length = GetSystemDirectoryW(systemFolder, MAX_PATH);
+            if (length == 0 || length >= MAX_PATH)
+            {
+                return { };
+            }
+            return std::filesystem::path(systemFolder);
+        }
+    };
+}
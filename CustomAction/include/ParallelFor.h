@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <system_error>
+
+namespace WinLogon::CustomActions::Threading
+{
+    // Calls task(i) for every i in [0, count) on up to workerCount threads, the calling thread included.
+    // Indexes are handed out in increasing order; if no thread can be started the calling thread runs
+    // them all. task must not throw.
+    template<typename Task>
+    void parallelFor(std::size_t count, std::size_t workerCount, Task&& task)
+    {
+        std::atomic<std::size_t> next{ 0 };
+
+        const auto runNext = [&]
+        {
+            for (std::size_t i = next++; i < count; i = next++)
+            {
+                task(i);
+            }
+        };
+
+        workerCount = std::min(workerCount, count);
+        if (workerCount <= 1)
+        {
+            runNext( );
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount - 1);
+        try
+        {
+            for (std::size_t i = 1; i < workerCount; ++i)
+            {
+                workers.emplace_back(runNext);
+            }
+        }
+        catch (const std::system_error&)
+        {
+        }
+
+        runNext( );
+        for (auto& worker : workers)
+        {
+            worker.join( );
+        }
+    }
+}
\ No newline at end of file
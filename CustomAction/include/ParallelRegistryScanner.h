@@ -0,0 +1,410 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <string_view>
+#include <condition_variable>
+
+#include "IRegistryAccess.h"
+#include "RegistrySelector.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Scans several registry subtrees with a pool of work-stealing workers.
+    // Keys close to the scan roots (e.g. each SID under UserData, each product GUID) become
+    // independent work items; deeper levels are walked inline by the worker that owns the item.
+    // Results are merged by their position in the tree, so the output is exactly the pre-order
+    // a sequential walk would produce, whatever the thread timing was.
+    // A root may carry a RegistrySelector: the visitor then only sees the selected keys, and sub keys
+    // whose name rules out every match are skipped without being opened.
+    template<typename Result>
+    class ParallelRegistryScanner
+    {
+    public:
+        // Called for every visited key; must be safe to call from several threads at once
+        using Visitor = std::function<std::optional<Result>(const std::wstring& keyPath, const IRegistryKey& key, std::size_t depth)>;
+
+        static constexpr std::size_t UNLIMITED_DEPTH = std::numeric_limits<std::size_t>::max( );
+
+        struct Root
+        {
+            std::unique_ptr<IRegistryKey> key;        // Open scan root, may be null when the path does not exist
+            std::wstring path;                        // Path reported for the root key
+            Visitor visitor;
+            std::size_t maxDepth = UNLIMITED_DEPTH;   // Deepest level visited below the root
+            std::shared_ptr<const RegistrySelector> selector;   // Optional pruning, null visits every key
+        };
+
+        struct RootResult
+        {
+            std::vector<Result> matches;              // Visitor results in pre-order
+            std::size_t keysVisited = 0;              // Keys opened
+            std::size_t keysPruned = 0;               // Sub keys skipped by the selector, with their subtrees
+        };
+
+        // workerCount == 0 selects one worker per hardware thread.
+        // Keys up to splitDepth levels below a root are scheduled as separate work items.
+        explicit ParallelRegistryScanner(std::size_t workerCount = 0, std::size_t splitDepth = 3)
+            : m_workerCount(workerCount != 0 ? workerCount : std::max<std::size_t>(1, std::thread::hardware_concurrency( ))),
+              m_splitDepth(splitDepth)
+        {
+        }
+
+        std::vector<RootResult> scan(std::vector<Root> roots)
+        {
+            m_roots = std::move(roots);
+            m_queues = std::vector<WorkQueue>(m_workerCount);
+            m_buckets = std::vector<std::vector<Bucket>>(m_workerCount);
+            m_pending = 0;
+            m_queued = 0;
+            m_aborted = false;
+            m_error = nullptr;
+
+            for (std::uint32_t i = 0; i < m_roots.size( ); ++i)
+            {
+                if (m_roots[i].key)
+                {
+                    // Root keys stay owned by m_roots; items only borrow them
+                    const auto state = m_roots[i].selector ? m_roots[i].selector->initialState( ) : 0;
+                    push(i % m_workerCount, WorkItem{ nullptr, m_roots[i].key.get( ), m_roots[i].path, { i }, 0, state });
+                }
+            }
+
+            if (m_workerCount == 1)
+            {
+                workerLoop(0);
+            }
+            else
+            {
+                std::vector<std::thread> workers;
+                workers.reserve(m_workerCount);
+                for (std::size_t i = 0; i < m_workerCount; ++i)
+                {
+                    workers.emplace_back([this, i]
+                    {
+                        workerLoop(i);
+                    });
+                }
+
+                for (auto& worker : workers)
+                {
+                    worker.join( );
+                }
+            }
+
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+
+            return merge( );
+        }
+
+        std::size_t getWorkerCount( ) const noexcept
+        {
+            return m_workerCount;
+        }
+
+    private:
+        struct WorkItem
+        {
+            std::unique_ptr<IRegistryKey> ownedKey;   // Set for every item except the scan roots
+            const IRegistryKey* key;
+            std::wstring path;
+            std::vector<std::uint32_t> order;         // Root index followed by the child index at each level
+            std::size_t depth;
+            RegistrySelector::StateSet state;         // Selector state of the key, unused without selector
+        };
+
+        // Results of one work item, in pre-order of the keys the item walked
+        struct Bucket
+        {
+            std::vector<std::uint32_t> order;
+            std::vector<Result> matches;
+            std::size_t keysVisited = 0;
+            std::size_t keysPruned = 0;
+        };
+
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<WorkItem> items;
+        };
+
+        const std::size_t m_workerCount;
+        const std::size_t m_splitDepth;
+
+        std::vector<Root> m_roots;
+        std::vector<WorkQueue> m_queues;
+        std::vector<std::vector<Bucket>> m_buckets;   // One list per worker, merged after the scan
+
+        std::atomic<std::size_t> m_pending{ 0 };      // Items queued or being processed
+        std::atomic<std::size_t> m_queued{ 0 };       // Items waiting in a queue
+        std::atomic<bool> m_aborted{ false };
+
+        std::mutex m_idleMutex;
+        std::condition_variable m_idleCondition;
+
+        std::mutex m_errorMutex;
+        std::exception_ptr m_error;
+
+        void push(std::size_t worker, WorkItem item)
+        {
+            ++m_pending;
+            ++m_queued;
+            {
+                std::lock_guard lock(m_queues[worker].mutex);
+                m_queues[worker].items.push_back(std::move(item));
+            }
+            notifyIdleWorkers(false);
+        }
+
+        // Owners take the most recent item (depth-first, cache friendly), thieves take the oldest (largest subtree)
+        std::optional<WorkItem> take(std::size_t worker)
+        {
+            {
+                auto& own = m_queues[worker];
+                std::lock_guard lock(own.mutex);
+                if (!own.items.empty( ))
+                {
+                    WorkItem item = std::move(own.items.back( ));
+                    own.items.pop_back( );
+                    return item;
+                }
+            }
+
+            for (std::size_t offset = 1; offset < m_workerCount; ++offset)
+            {
+                auto& victim = m_queues[(worker + offset) % m_workerCount];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.items.empty( ))
+                {
+                    WorkItem item = std::move(victim.items.front( ));
+                    victim.items.pop_front( );
+                    return item;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        void notifyIdleWorkers(bool all)
+        {
+            // Taking the lock orders the notification after a waiter's predicate check
+            {
+                std::lock_guard lock(m_idleMutex);
+            }
+
+            if (all)
+            {
+                m_idleCondition.notify_all( );
+            }
+            else
+            {
+                m_idleCondition.notify_one( );
+            }
+        }
+
+        void workerLoop(std::size_t worker)
+        {
+            while (true)
+            {
+                if (auto item = take(worker))
+                {
+                    --m_queued;
+                    if (!m_aborted)
+                    {
+                        try
+                        {
+                            process(worker, std::move(*item));
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard lock(m_errorMutex);
+                            if (!m_error)
+                            {
+                                m_error = std::current_exception( );
+                            }
+                            m_aborted = true;
+                        }
+                    }
+
+                    if (--m_pending == 0)
+                    {
+                        notifyIdleWorkers(true);
+                    }
+                    continue;
+                }
+
+                std::unique_lock lock(m_idleMutex);
+                m_idleCondition.wait(lock, [this]
+                {
+                    return m_pending == 0 || m_queued > 0;
+                });
+
+                if (m_pending == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        void process(std::size_t worker, WorkItem item)
+        {
+            const Root& root = m_roots[item.order.front( )];
+
+            Bucket bucket;
+            bucket.order = item.order;
+            visit(root, *item.key, item.path, item.depth, item.state, bucket);
+
+            if (canDescend(root, item.depth, item.state))
+            {
+                const auto subKeyNames = item.key->enumerateSubKeys( );
+                for (std::uint32_t i = 0; i < subKeyNames.size( ); ++i)
+                {
+                    const auto subKeyState = nextState(root, item.state, subKeyNames[i], bucket);
+                    if (!subKeyState)
+                    {
+                        continue;
+                    }
+
+                    auto subKey = item.key->openSubKey(subKeyNames[i]);
+                    if (!subKey)
+                    {
+                        continue;
+                    }
+
+                    std::wstring subKeyPath = item.path + L"\\" + subKeyNames[i];
+                    if (item.depth + 1 <= m_splitDepth)
+                    {
+                        // Hand the child out as its own work item
+                        std::vector<std::uint32_t> order = item.order;
+                        order.push_back(i);
+                        const IRegistryKey* subKeyPtr = subKey.get( );
+                        push(worker, WorkItem{ std::move(subKey), subKeyPtr, std::move(subKeyPath), std::move(order), item.depth + 1, *subKeyState });
+                    }
+                    else
+                    {
+                        walkInline(root, *subKey, subKeyPath, item.depth + 1, *subKeyState, bucket);
+                    }
+                }
+            }
+
+            m_buckets[worker].push_back(std::move(bucket));
+        }
+
+        void walkInline(const Root& root, const IRegistryKey& key, std::wstring& path, std::size_t depth,
+                        RegistrySelector::StateSet state, Bucket& bucket)
+        {
+            if (m_aborted)
+            {
+                return;
+            }
+
+            visit(root, key, path, depth, state, bucket);
+            if (!canDescend(root, depth, state))
+            {
+                return;
+            }
+
+            const std::size_t pathLength = path.size( );
+            for (const auto& subKeyName : key.enumerateSubKeys( ))
+            {
+                const auto subKeyState = nextState(root, state, subKeyName, bucket);
+                if (!subKeyState)
+                {
+                    continue;
+                }
+
+                auto subKey = key.openSubKey(subKeyName);
+                if (!subKey)
+                {
+                    continue;
+                }
+
+                path.push_back(L'\\');
+                path.append(subKeyName);
+                walkInline(root, *subKey, path, depth + 1, *subKeyState, bucket);
+                path.resize(pathLength);
+            }
+        }
+
+        void visit(const Root& root, const IRegistryKey& key, const std::wstring& path, std::size_t depth,
+                   RegistrySelector::StateSet state, Bucket& bucket)
+        {
+            ++bucket.keysVisited;
+            if (root.selector && !root.selector->accepts(state))
+            {
+                return;
+            }
+
+            if (auto match = root.visitor(path, key, depth))
+            {
+                bucket.matches.push_back(std::move(*match));
+            }
+        }
+
+        static bool canDescend(const Root& root, std::size_t depth, RegistrySelector::StateSet state)
+        {
+            return depth < root.maxDepth && (!root.selector || root.selector->canDescend(state));
+        }
+
+        // Selector state of a sub key, nullopt when the sub key is pruned
+        static std::optional<RegistrySelector::StateSet> nextState(const Root& root, RegistrySelector::StateSet state,
+                                                                   std::wstring_view subKeyName, Bucket& bucket)
+        {
+            if (!root.selector)
+            {
+                return state;
+            }
+
+            const auto subKeyState = root.selector->next(state, subKeyName);
+            if (subKeyState == 0)
+            {
+                ++bucket.keysPruned;
+                return std::nullopt;
+            }
+            return subKeyState;
+        }
+
+        // Lexicographic order of the tree positions is the sequential pre-order
+        std::vector<RootResult> merge( )
+        {
+            std::vector<Bucket> buckets;
+            for (auto& workerBuckets : m_buckets)
+            {
+                std::move(workerBuckets.begin( ), workerBuckets.end( ), std::back_inserter(buckets));
+            }
+            m_buckets.clear( );
+
+            std::sort(buckets.begin( ), buckets.end( ), [](const Bucket& lhs, const Bucket& rhs)
+            {
+                return lhs.order < rhs.order;
+            });
+
+            std::vector<RootResult> results(m_roots.size( ));
+            for (auto& bucket : buckets)
+            {
+                auto& rootResult = results[bucket.order.front( )];
+                rootResult.keysVisited += bucket.keysVisited;
+                rootResult.keysPruned += bucket.keysPruned;
+                std::move(bucket.matches.begin( ), bucket.matches.end( ), std::back_inserter(rootResult.matches));
+            }
+
+            m_roots.clear( );
+            return results;
+        }
+    };
+}
\ No newline at end of file
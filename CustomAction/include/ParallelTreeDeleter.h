@@ -0,0 +1,408 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <condition_variable>
+
+#include "ParallelFor.h"
+#include "DirectoryHandle.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // Alternative to std::filesystem::remove_all that deletes a directory tree with several threads.
+    // DirectoryCleanupStrategy only uses it when setParallelDeletion opts in; remove_all is its default.
+    // Directories waiting to be read sit in per-worker queues (no recursion): a worker reads its newest
+    // directory first, so the queues stay about as deep as the tree; an idle worker steals the oldest
+    // directory of another queue, which is the largest subtree still waiting. A directory is removed by
+    // whichever worker finishes its last child, so the tree disappears bottom-up.
+    // Each directory is opened once, relative to its parent, and its children are listed and deleted
+    // relative to that handle: no operation resolves a full path, however deep the tree is.
+    // Like remove_all, symbolic links and junctions are removed, never followed. Unlike remove_all, an entry
+    // that cannot be removed does not stop the deletion: it is recorded with its error, and only it and
+    // the directories above it are left in place.
+    class ParallelTreeDeleter
+    {
+    public:
+        struct Statistics
+        {
+            std::uintmax_t filesRemoved = 0;
+            std::uintmax_t directoriesRemoved = 0;
+            std::size_t steals = 0;            // Directories read by another worker than the one that found them
+            std::size_t highWaterMark = 0;     // Largest number of directories waiting to be read
+            std::size_t failureCount = 0;      // Entries that could not be read or removed, recorded or not
+        };
+
+        // An entry that could not be read or removed. The directories above it are left in place
+        // without being recorded.
+        struct Failure
+        {
+            std::filesystem::path path;
+            std::error_code error;
+        };
+
+        // workerCount == 0 selects one worker per hardware thread, up to DEFAULT_MAX_WORKER_COUNT
+        explicit ParallelTreeDeleter(std::size_t workerCount = 0)
+            : m_workerCount(workerCount != 0 ? workerCount
+                                             : std::clamp<std::size_t>(std::thread::hardware_concurrency( ), 1, DEFAULT_MAX_WORKER_COUNT))
+        {
+        }
+
+        // Same contract as std::filesystem::remove_all(path, errorCode): the number of files and directories
+        // removed, 0 when path does not exist, or static_cast<std::uintmax_t>(-1) with errorCode set to the
+        // first error when an entry could not be read or removed. getFailures lists those entries.
+        std::uintmax_t removeAll(const std::filesystem::path& path, std::error_code& errorCode)
+        {
+            errorCode.clear( );
+            m_statistics = Statistics{ };
+            m_failures.clear( );
+
+            const auto status = std::filesystem::symlink_status(path, errorCode);
+            if (status.type( ) == std::filesystem::file_type::not_found)
+            {
+                errorCode.clear( );
+                return 0;
+            }
+            if (errorCode)
+            {
+                return static_cast<std::uintmax_t>(-1);
+            }
+            if (status.type( ) != std::filesystem::file_type::directory)
+            {
+                if (std::filesystem::remove(path, errorCode))
+                {
+                    return 1;
+                }
+                if (errorCode)
+                {
+                    recordFailure(path, errorCode);
+                    return static_cast<std::uintmax_t>(-1);
+                }
+                return 0;
+            }
+
+            m_queues = std::vector<WorkQueue>(m_workerCount);
+            m_pending = 0;
+            m_queued = 0;
+            m_aborted = false;
+            m_filesRemoved = 0;
+            m_directoriesRemoved = 0;
+            m_error.clear( );
+
+            push(0, std::make_shared<Directory>(path, DirectoryHandle::Name{ }, nullptr));
+            Threading::parallelFor(m_workerCount, m_workerCount, [this](std::size_t worker)
+            {
+                workerLoop(worker);
+            });
+            m_queues.clear( );
+
+            if (m_error)
+            {
+                errorCode = m_error;
+                return static_cast<std::uintmax_t>(-1);
+            }
+            return m_filesRemoved + m_directoriesRemoved;
+        }
+
+        Statistics getStatistics( ) const noexcept
+        {
+            Statistics statistics = m_statistics;
+            statistics.filesRemoved = m_filesRemoved;
+            statistics.directoriesRemoved = m_directoriesRemoved;
+            return statistics;
+        }
+
+        // Entries that could not be read or removed by the last removeAll, in no particular order. At most
+        // MAX_RECORDED_FAILURES are kept; Statistics::failureCount has the total.
+        const std::vector<Failure>& getFailures( ) const noexcept
+        {
+            return m_failures;
+        }
+
+        std::size_t getWorkerCount( ) const noexcept
+        {
+            return m_workerCount;
+        }
+
+    private:
+        // Deleting is bound by the file system: past a few threads the disk, not the CPU, is the limit
+        static constexpr std::size_t DEFAULT_MAX_WORKER_COUNT = 8;
+
+    public:
+        // Enough to diagnose a deletion; a tree where everything fails would flood the log otherwise
+        static constexpr std::size_t MAX_RECORDED_FAILURES = 1000;
+
+    private:
+
+        // A directory being emptied. It is removed when its own listing and every sub directory are done.
+        struct Directory
+        {
+            Directory(std::filesystem::path directoryPath, DirectoryHandle::Name directoryName, std::shared_ptr<Directory> parentDirectory)
+                : path(std::move(directoryPath)), name(std::move(directoryName)), parent(std::move(parentDirectory))
+            {
+            }
+
+            std::filesystem::path path;                // Only opened for the root; kept for reporting
+            DirectoryHandle::Name name;                // Relative to the parent
+            std::shared_ptr<Directory> parent;
+            DirectoryHandle handle;                    // Open from the listing until the directory is removed
+            std::atomic<std::size_t> remaining{ 1 };   // Sub directories not removed yet, plus the listing itself
+            std::atomic<bool> incomplete{ false };     // Something below could not be removed, so neither can it
+        };
+
+        struct WorkItem
+        {
+            std::shared_ptr<Directory> directory;
+            std::size_t foundBy;
+        };
+
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<WorkItem> items;
+        };
+
+        const std::size_t m_workerCount;
+        std::vector<WorkQueue> m_queues;
+
+        std::atomic<std::size_t> m_pending{ 0 };        // Directories queued or being read
+        std::atomic<std::size_t> m_queued{ 0 };         // Directories waiting in a queue
+        std::atomic<bool> m_aborted{ false };
+        std::atomic<std::uintmax_t> m_filesRemoved{ 0 };
+        std::atomic<std::uintmax_t> m_directoriesRemoved{ 0 };
+
+        std::mutex m_idleMutex;
+        std::condition_variable m_idleCondition;
+
+        std::mutex m_statisticsMutex;                   // Guards m_error, m_failures and the counters of m_statistics
+        std::error_code m_error;
+        Statistics m_statistics;
+        std::vector<Failure> m_failures;
+
+        void push(std::size_t worker, std::shared_ptr<Directory> directory)
+        {
+            ++m_pending;
+            const std::size_t queued = ++m_queued;
+            {
+                std::lock_guard lock(m_queues[worker].mutex);
+                m_queues[worker].items.push_back(WorkItem{ std::move(directory), worker });
+            }
+            {
+                std::lock_guard lock(m_statisticsMutex);
+                m_statistics.highWaterMark = std::max(m_statistics.highWaterMark, queued);
+            }
+            notifyIdleWorkers(false);
+        }
+
+        // Owners take their newest directory (depth first), thieves the oldest one (largest subtree)
+        std::optional<WorkItem> take(std::size_t worker)
+        {
+            {
+                auto& own = m_queues[worker];
+                std::lock_guard lock(own.mutex);
+                if (!own.items.empty( ))
+                {
+                    WorkItem item = std::move(own.items.back( ));
+                    own.items.pop_back( );
+                    return item;
+                }
+            }
+
+            for (std::size_t offset = 1; offset < m_workerCount; ++offset)
+            {
+                auto& victim = m_queues[(worker + offset) % m_workerCount];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.items.empty( ))
+                {
+                    WorkItem item = std::move(victim.items.front( ));
+                    victim.items.pop_front( );
+                    return item;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        void notifyIdleWorkers(bool all)
+        {
+            // Taking the lock orders the notification after a waiter's predicate check
+            {
+                std::lock_guard lock(m_idleMutex);
+            }
+
+            if (all)
+            {
+                m_idleCondition.notify_all( );
+            }
+            else
+            {
+                m_idleCondition.notify_one( );
+            }
+        }
+
+        void workerLoop(std::size_t worker)
+        {
+            while (true)
+            {
+                if (auto item = take(worker))
+                {
+                    --m_queued;
+                    if (!m_aborted)
+                    {
+                        if (item->foundBy != worker)
+                        {
+                            std::lock_guard lock(m_statisticsMutex);
+                            ++m_statistics.steals;
+                        }
+
+                        try
+                        {
+                            empty(worker, std::move(item->directory));
+                        }
+                        catch (const std::bad_alloc&)
+                        {
+                            fail(std::make_error_code(std::errc::not_enough_memory));
+                        }
+                    }
+
+                    if (--m_pending == 0)
+                    {
+                        notifyIdleWorkers(true);
+                    }
+                    continue;
+                }
+
+                std::unique_lock lock(m_idleMutex);
+                m_idleCondition.wait(lock, [this]
+                {
+                    return m_pending == 0 || m_queued > 0;
+                });
+
+                if (m_pending == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        // Removes the files of a directory and queues its sub directories. The directory is opened relative
+        // to its parent and everything in it is listed and removed relative to it.
+        void empty(std::size_t worker, std::shared_ptr<Directory> directory)
+        {
+            std::error_code errorCode;
+            directory->handle = directory->parent ? directory->parent->handle.openSubDirectory(directory->name, errorCode)
+                                                  : DirectoryHandle::open(directory->path, errorCode);
+            if (errorCode && errorCode != std::errc::no_such_file_or_directory)
+            {
+                recordFailure(directory->path, errorCode);
+                directory->incomplete = true;
+            }
+
+            std::vector<DirectoryHandle::Entry> entries;
+            while (directory->handle.isOpen( ) && !m_aborted && directory->handle.read(entries, errorCode))
+            {
+                for (auto& entry : entries)
+                {
+                    if (entry.isDirectory)
+                    {
+                        ++directory->remaining;
+                        auto path = directory->path / entry.name;
+                        push(worker, std::make_shared<Directory>(std::move(path), std::move(entry.name), directory));
+                        continue;
+                    }
+
+                    // Not removed without an error: somebody else removed it meanwhile
+                    std::error_code removeError;
+                    if (directory->handle.remove(entry.name, false, removeError))
+                    {
+                        ++m_filesRemoved;
+                    }
+                    else if (removeError)
+                    {
+                        recordFailure(directory->path / entry.name, removeError);
+                        directory->incomplete = true;
+                    }
+                }
+            }
+
+            if (errorCode && directory->handle.isOpen( ))
+            {
+                // The listing broke off: whatever was not listed stays
+                recordFailure(directory->path, errorCode);
+                directory->incomplete = true;
+            }
+            finish(std::move(directory));
+        }
+
+        // One part of the directory is done; the last part removes it through its parent, then signals the parent.
+        // A directory that kept some of its entries is left in place, and so are the directories above it.
+        void finish(std::shared_ptr<Directory> directory)
+        {
+            while (directory && --directory->remaining == 0 && !m_aborted)
+            {
+                directory->handle.close( );
+
+                if (directory->incomplete)
+                {
+                    if (directory->parent)
+                    {
+                        directory->parent->incomplete = true;
+                    }
+                    directory = directory->parent;
+                    continue;
+                }
+
+                std::error_code errorCode;
+                const bool removed = directory->parent ? directory->parent->handle.remove(directory->name, true, errorCode)
+                                                       : std::filesystem::remove(directory->path, errorCode);
+                if (removed)
+                {
+                    ++m_directoriesRemoved;
+                }
+                else if (errorCode)
+                {
+                    recordFailure(directory->path, errorCode);
+                    if (directory->parent)
+                    {
+                        directory->parent->incomplete = true;
+                    }
+                }
+                directory = directory->parent;
+            }
+        }
+
+        void recordFailure(const std::filesystem::path& path, std::error_code errorCode)
+        {
+            std::lock_guard lock(m_statisticsMutex);
+            if (!m_error)
+            {
+                m_error = errorCode;
+            }
+            if (m_failures.size( ) < MAX_RECORDED_FAILURES)
+            {
+                m_failures.push_back(Failure{ path, errorCode });
+            }
+            ++m_statistics.failureCount;
+        }
+
+        // Stops the deletion, e.g. when memory runs out
+        void fail(std::error_code errorCode)
+        {
+            std::lock_guard lock(m_statisticsMutex);
+            if (!m_error)
+            {
+                m_error = errorCode;
+            }
+            m_aborted = true;
+        }
+    };
+}
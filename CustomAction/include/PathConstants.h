@@ -1,26 +1,25 @@
 #pragma once
 
-#include <string>
-#include <vector>
-#include <filesystem>
+#include <array>
+#include <string_view>
 
 namespace WinLogon::CustomActions::Constants
 {
     class PathConstants
     {
     public:
-        static inline const std::vector<std::wstring_view> logonAppFoldersPath = {
+        static constexpr std::array<std::wstring_view, 2> logonAppFoldersPath = {
             L"C:\\ProgramData\\WatchGuard\\Logon App",
             L"C:\\Program Files\\WatchGuard\\Logon App"
         };
 
-        static inline const std::vector<std::wstring_view> watchGuardFoldersPath = {
+        static constexpr std::array<std::wstring_view, 2> watchGuardFoldersPath = {
             L"C:\\ProgramData\\WatchGuard",
             L"C:\\Program Files\\WatchGuard"
         };
 
         // Uninstall
-        static inline const std::vector<std::filesystem::path> filesFromV3ToRemove = {
+        static constexpr std::array<std::wstring_view, 6> filesFromV3ToRemove = {
             L"C:\\Windows\\System32\\WLcacert.pem",
             L"C:\\Windows\\System32\\wlconfig.cfg",
             L"C:\\Windows\\System32\\WLlibcurl.dll",
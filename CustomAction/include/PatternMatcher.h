@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+
+#include "CaseFolding.h"
+
+namespace WinLogon::CustomActions::Text
+{
+    // Case-insensitive multi-pattern substring matcher.
+    // The pattern set is compiled once into an Aho-Corasick automaton, so a text is checked
+    // against every pattern in a single pass, whatever the number of patterns.
+    class PatternMatcher
+    {
+    public:
+        PatternMatcher( ) = default;
+
+        explicit PatternMatcher(std::vector<std::wstring> patterns) : m_patterns(std::move(patterns))
+        {
+            build( );
+        }
+
+        // True if any pattern occurs in text, ignoring case
+        bool matchesAny(std::wstring_view text) const noexcept
+        {
+            if (m_states.empty( ))
+            {
+                return false;
+            }
+
+            std::int32_t state = 0;
+            if (m_states[state].terminal)
+            {
+                return true;  // An empty pattern matches everything
+            }
+
+            for (const wchar_t ch : text)
+            {
+                // ASCII input is looked up unfolded, the table has the upper case edges too
+                state = (static_cast<std::uint32_t>(ch) < ASCII_SIZE) ? m_states[state].ascii[ch] : next(state, foldCase(ch));
+                if (m_states[state].terminal)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        const std::vector<std::wstring>& getPatterns( ) const noexcept
+        {
+            return m_patterns;
+        }
+
+        // Splits a list of patterns such as "AuthPoint|Logon App". Surrounding whitespace is trimmed and
+        // empty entries are dropped: an empty pattern would match everything.
+        static std::vector<std::wstring> parsePatterns(std::wstring_view list, wchar_t separator = L'|')
+        {
+            std::vector<std::wstring> patterns;
+            while (!list.empty( ))
+            {
+                const auto end = list.find(separator);
+                std::wstring_view pattern = list.substr(0, end);
+                list = (end == std::wstring_view::npos) ? std::wstring_view{ } : list.substr(end + 1);
+
+                const auto first = pattern.find_first_not_of(L" \t\r\n");
+                if (first != std::wstring_view::npos)
+                {
+                    patterns.emplace_back(pattern.substr(first, pattern.find_last_not_of(L" \t\r\n") - first + 1));
+                }
+            }
+            return patterns;
+        }
+
+    private:
+        static constexpr std::size_t ASCII_SIZE = 128;
+
+        struct State
+        {
+            std::array<std::int32_t, ASCII_SIZE> ascii{ };            // Complete transition table for ASCII input
+            std::vector<std::pair<wchar_t, std::int32_t>> other;      // Trie edges for non-ASCII input, sorted
+            std::int32_t failure = 0;
+            bool terminal = false;                                    // A pattern ends here or at a suffix state
+        };
+
+        std::vector<std::wstring> m_patterns;
+        std::vector<State> m_states;
+
+        std::int32_t next(std::int32_t state, wchar_t ch) const noexcept
+        {
+            if (static_cast<std::uint32_t>(ch) < ASCII_SIZE)
+            {
+                return m_states[state].ascii[ch];
+            }
+
+            // Non-ASCII characters follow failure links until an edge (or the root) is found
+            while (true)
+            {
+                const auto& edges = m_states[state].other;
+                const auto it = std::lower_bound(edges.begin( ), edges.end( ), ch, [](const auto& edge, wchar_t value)
+                {
+                    return edge.first < value;
+                });
+                if (it != edges.end( ) && it->first == ch)
+                {
+                    return it->second;
+                }
+                if (state == 0)
+                {
+                    return 0;
+                }
+                state = m_states[state].failure;
+            }
+        }
+
+        void build( )
+        {
+            m_states.assign(1, State{ });
+
+            // Trie of the folded patterns; -1 marks a missing ASCII edge until the automaton is completed
+            m_states[0].ascii.fill(-1);
+            for (const auto& pattern : m_patterns)
+            {
+                std::int32_t state = 0;
+                for (const wchar_t rawCh : pattern)
+                {
+                    const wchar_t ch = foldCase(rawCh);
+                    std::int32_t target = findEdge(state, ch);
+                    if (target < 0)
+                    {
+                        target = static_cast<std::int32_t>(m_states.size( ));
+                        m_states.emplace_back( );
+                        m_states.back( ).ascii.fill(-1);
+                        addEdge(state, ch, target);
+                    }
+                    state = target;
+                }
+                m_states[state].terminal = true;
+            }
+
+            // Breadth-first pass computing failure links and completing the ASCII table
+            std::vector<std::int32_t> queue;
+            for (std::size_t ch = 0; ch < ASCII_SIZE; ++ch)
+            {
+                auto& edge = m_states[0].ascii[ch];
+                if (edge < 0)
+                {
+                    edge = 0;
+                }
+                else
+                {
+                    queue.push_back(edge);
+                }
+            }
+            for (const auto& [ch, target] : m_states[0].other)
+            {
+                queue.push_back(target);
+            }
+
+            for (std::size_t head = 0; head < queue.size( ); ++head)
+            {
+                const std::int32_t state = queue[head];
+                const std::int32_t failure = m_states[state].failure;
+                m_states[state].terminal = m_states[state].terminal || m_states[failure].terminal;
+
+                for (std::size_t ch = 0; ch < ASCII_SIZE; ++ch)
+                {
+                    auto& edge = m_states[state].ascii[ch];
+                    if (edge < 0)
+                    {
+                        edge = m_states[failure].ascii[ch];
+                    }
+                    else
+                    {
+                        m_states[edge].failure = m_states[failure].ascii[ch];
+                        queue.push_back(edge);
+                    }
+                }
+
+                for (const auto& [ch, target] : m_states[state].other)
+                {
+                    m_states[target].failure = next(failure, ch);
+                    queue.push_back(target);
+                }
+            }
+
+            for (auto& state : m_states)
+            {
+                for (wchar_t ch = L'A'; ch <= L'Z'; ++ch)
+                {
+                    state.ascii[ch] = state.ascii[foldCase(ch)];
+                }
+            }
+        }
+
+        std::int32_t findEdge(std::int32_t state, wchar_t ch) const
+        {
+            if (static_cast<std::uint32_t>(ch) < ASCII_SIZE)
+            {
+                return m_states[state].ascii[ch];
+            }
+
+            for (const auto& [edgeCh, target] : m_states[state].other)
+            {
+                if (edgeCh == ch)
+                {
+                    return target;
+                }
+            }
+            return -1;
+        }
+
+        void addEdge(std::int32_t state, wchar_t ch, std::int32_t target)
+        {
+            if (static_cast<std::uint32_t>(ch) < ASCII_SIZE)
+            {
+                m_states[state].ascii[ch] = target;
+                return;
+            }
+
+            auto& edges = m_states[state].other;
+            edges.insert(std::upper_bound(edges.begin( ), edges.end( ), std::make_pair(ch, target)), { ch, target });
+        }
+    };
+}
\ No newline at end of file
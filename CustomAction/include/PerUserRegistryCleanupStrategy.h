@@ -0,0 +1,257 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include "CaseFolding.h"
+#include "UserHiveScanner.h"
+#include "WinRegistryAccess.h"
+#include "RegistryCleanupStrategy.h"
+#include "OfflineHiveRegistryAccess.h"
+#include "AuthPointRegistryCleanupStrategy.h"
+
+namespace WinLogon::CustomActions::Cleanup::Strategies
+{
+    // Strategy for cleaning the AuthPoint/LogonApp entries of every user hive: the ones loaded under
+    // HKEY_USERS and the NTUSER.DAT of the profiles nobody is logged on to. Hives are processed in
+    // parallel, a few at a time, with the search patterns of the AuthPoint cleanup.
+    class PerUserRegistryCleanupStrategy : public RegistryCleanupStrategy
+    {
+    public:
+        struct UserProfile
+        {
+            std::wstring sid;
+            std::filesystem::path hiveFile;   // NTUSER.DAT, for profiles that are not loaded
+            bool loaded = false;              // Hive loaded under HKEY_USERS\<SID>
+        };
+
+        using RegistryCleanupStrategy::RegistryCleanupStrategy;
+
+        bool execute(std::shared_ptr<Logger::ILogger> logger) override
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            logger->log(LOG_INFO, L"=== Per-User Registry Cleanup - Started ===");
+
+            const auto profiles = enumerateProfiles(logger);
+            const auto loadedCount = std::count_if(profiles.begin( ), profiles.end( ), [](const UserProfile& profile)
+            {
+                return profile.loaded;
+            });
+            logger->log(LOG_INFO, std::format(L"Searching {} user hives ({} loaded, {} from profile files).",
+                                              profiles.size( ), loadedCount, profiles.size( ) - loadedCount));
+
+            const Registry::UserHiveScanner scanner(m_matcher);
+
+            // Hives are cleaned concurrently; results are reported afterwards, in profile order
+            const auto results = Registry::UserHiveScanner::forEachHive<HiveResult>(profiles.size( ), m_maxConcurrentHives, [&](std::size_t i)
+            {
+                return cleanHive(profiles[i], scanner);
+            });
+
+            bool success = true;
+            std::size_t entryCount = 0;
+            for (std::size_t i = 0; i < profiles.size( ); ++i)
+            {
+                const std::wstring location = getHiveLocation(profiles[i]);
+                const HiveResult& result = results[i];
+                if (!result.error.empty( ))
+                {
+                    logger->log(LOG_ERROR, std::format(L"- {}: {}", location, result.error));
+                    success = false;
+                    continue;
+                }
+                if (result.matches.empty( ))
+                {
+                    logger->log(LOG_TRACE, std::format(L"- {}: no entries found.", location));
+                    continue;
+                }
+
+                logger->log(LOG_INFO, std::format(L"- {}: {} entries found.", location, result.matches.size( )));
+                for (std::size_t j = 0; j < result.matches.size( ); ++j)
+                {
+                    const auto& match = result.matches[j];
+                    logger->log(LOG_INFO, std::format(L"  Removing: {} ({})", match.path, match.displayName));
+                    success &= reportKeyDeletion(std::format(L"{}\\{}", location, match.path), result.results[j], logger);
+                }
+                entryCount += result.matches.size( );
+            }
+
+            if (entryCount == 0)
+            {
+                logger->log(LOG_INFO, L"No AuthPoint/LogonApp related entries found in the user hives.");
+            }
+
+            logHandleCacheStatistics(logger);
+            logger->log(LOG_INFO, L"=== Per-User Registry Cleanup - Finished ===\n");
+            return success;
+        }
+
+        std::wstring getName( ) const override
+        {
+            return L"Per-User Registry Cleanup Strategy";
+        }
+
+        // Maximum number of user hives scanned and cleaned at the same time
+        void setMaxConcurrentHives(std::size_t maxConcurrentHives) noexcept
+        {
+            m_maxConcurrentHives = std::max<std::size_t>(1, maxConcurrentHives);
+        }
+
+        // Replaces the search patterns, which are the built-in ones of the AuthPoint cleanup by default
+        void setSearchPatterns(std::vector<std::wstring> patterns)
+        {
+            m_matcher = Text::PatternMatcher(std::move(patterns));
+        }
+
+        // Loaded user hives first, in HKEY_USERS order, then the profiles whose hive file is not loaded
+        std::vector<UserProfile> enumerateProfiles(std::shared_ptr<Logger::ILogger> logger) const
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+
+            const Registry::WinRegistryAccess registry(handleCache( ));
+            std::vector<UserProfile> profiles;
+
+            if (const auto users = registry.openKey(Registry::RegistryHive::Users, L""))
+            {
+                for (auto& sid : users->enumerateSubKeys( ))
+                {
+                    if (isUserSid(sid))
+                    {
+                        profiles.push_back({ .sid = std::move(sid), .hiveFile = { }, .loaded = true });
+                    }
+                }
+            }
+
+            const auto profileList = registry.openKey(Registry::RegistryHive::LocalMachine, PROFILE_LIST_PATH);
+            if (!profileList)
+            {
+                logger->log(LOG_WARNING, L"Could not open the profile list, only loaded user hives are cleaned.");
+                return profiles;
+            }
+
+            const std::size_t loadedCount = profiles.size( );
+            for (auto& sid : profileList->enumerateSubKeys( ))
+            {
+                const auto isLoaded = [&sid](const UserProfile& profile)
+                {
+                    return Text::equalsIgnoreCase(profile.sid, sid);
+                };
+                if (!isUserSid(sid) || std::any_of(profiles.begin( ), profiles.begin( ) + loadedCount, isLoaded))
+                {
+                    continue;
+                }
+
+                const auto profileKey = profileList->openSubKey(sid);
+                const auto imagePath = profileKey ? profileKey->getStringValue(L"ProfileImagePath") : std::nullopt;
+                if (!imagePath)
+                {
+                    continue;
+                }
+
+                std::filesystem::path hiveFile = std::filesystem::path(expandEnvironmentStrings(*imagePath)) / USER_HIVE_FILE_NAME;
+                std::error_code error;
+                if (!std::filesystem::is_regular_file(hiveFile, error))
+                {
+                    logger->log(LOG_TRACE, std::format(L"No user hive for {} at {}.", sid, hiveFile.wstring( )));
+                    continue;
+                }
+
+                profiles.push_back({ .sid = std::move(sid), .hiveFile = std::move(hiveFile), .loaded = false });
+            }
+
+            return profiles;
+        }
+
+    private:
+        // Each hive is read from disk as a whole; a few at a time keep the disk busy without thrashing it
+        static constexpr std::size_t DEFAULT_MAX_CONCURRENT_HIVES = 4;
+
+        static constexpr std::wstring_view PROFILE_LIST_PATH = L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\ProfileList";
+        static constexpr std::wstring_view USER_HIVE_FILE_NAME = L"NTUSER.DAT";
+
+        // Outcome of one hive
+        struct HiveResult
+        {
+            std::vector<Registry::UserHiveScanner::Match> matches;
+            std::vector<LONG> results;   // RegDeleteTreeW result of each match
+            std::wstring error;          // Why the hive could not be cleaned, empty if it was
+        };
+
+        std::size_t m_maxConcurrentHives = DEFAULT_MAX_CONCURRENT_HIVES;
+        Text::PatternMatcher m_matcher{ AuthPointRegistryCleanupStrategy::getDefaultSearchPatterns( ) };
+
+        // Local and domain accounts (S-1-5-21-...) and Microsoft Entra ID accounts (S-1-12-1-...).
+        // HKEY_USERS\<SID>_Classes is a separate hive, loaded from UsrClass.dat.
+        static bool isUserSid(std::wstring_view name) noexcept
+        {
+            return (name.starts_with(L"S-1-5-21-") || name.starts_with(L"S-1-12-1-")) && !name.ends_with(L"_Classes");
+        }
+
+        static std::wstring getHiveLocation(const UserProfile& profile)
+        {
+            return profile.loaded ? std::format(L"HKEY_USERS\\{}", profile.sid) : profile.hiveFile.wstring( );
+        }
+
+        // Runs on a worker thread: nothing is logged here
+        HiveResult cleanHive(const UserProfile& profile, const Registry::UserHiveScanner& scanner) const
+        {
+            HiveResult hiveResult;
+            try
+            {
+                if (profile.loaded)
+                {
+                    const Registry::WinRegistryAccess registry(handleCache( ));
+                    hiveResult.matches = scanner.scan(registry, Registry::RegistryHive::Users, profile.sid);
+                    for (const auto& match : hiveResult.matches)
+                    {
+                        hiveResult.results.push_back(handleCache( )->deleteTree(HKEY_USERS, std::format(L"{}\\{}", profile.sid, match.path)));
+                    }
+                    return hiveResult;
+                }
+
+                {
+                    // Most hives hold nothing to remove: they are only read, from the file. The mapping is
+                    // released before the hive is loaded, which needs exclusive access to the file.
+                    const Registry::OfflineHiveRegistryAccess registry(profile.hiveFile, Registry::RegistryHive::Users, profile.sid);
+                    hiveResult.matches = scanner.scan(registry, Registry::RegistryHive::Users, profile.sid);
+                }
+                if (hiveResult.matches.empty( ))
+                {
+                    return hiveResult;
+                }
+
+                HKEY hKey = nullptr;
+                const LONG result = RegLoadAppKeyW(profile.hiveFile.c_str( ), &hKey, KEY_ALL_ACCESS, 0, 0);
+                if (result != ERROR_SUCCESS)
+                {
+                    // e.g. the user logged on meanwhile
+                    hiveResult.error = std::format(L"Could not load the hive (Error Code: {} - {}).",
+                                                   result, getFriendlyErrorMessage(result).value_or(L"Unknown error"));
+                    return hiveResult;
+                }
+
+                // The hive is unloaded when its last handle is closed
+                const Registry::HKeyPtr hive(hKey);
+                for (const auto& match : hiveResult.matches)
+                {
+                    hiveResult.results.push_back(RegDeleteTreeW(hive.get( ), match.path.c_str( )));
+                }
+            }
+            catch (const std::exception& e)
+            {
+                hiveResult.error = std::format(L"Could not read the hive: {}", std::wstring(e.what( ), e.what( ) + strlen(e.what( ))));
+            }
+            return hiveResult;
+        }
+    };
+}
\ No newline at end of file
@@ -7,25 +7,84 @@
 #include <string_view>
 #include <optional>
 #include <memory>
+#include <vector>
 
+#include "ParallelFor.h"
 #include "ICleanupStrategy.h"
 #include "RegistryConstants.h"
+#include "RegistryHandleCache.h"
 
 namespace WinLogon::CustomActions::Cleanup
 {
     class RegistryCleanupStrategy : public ICleanupStrategy
     {
+    public:
+        RegistryCleanupStrategy( ) : m_handleCache(std::make_shared<Registry::RegistryHandleCache>( )) {}
+
+        // Strategies of one cleanup session share their open registry handles
+        explicit RegistryCleanupStrategy(std::shared_ptr<Registry::RegistryHandleCache> handleCache)
+            : m_handleCache(handleCache ? std::move(handleCache) : std::make_shared<Registry::RegistryHandleCache>( ))
+        {
+        }
+
+        // Flushes the deletions of this strategy when the session flushes per strategy
+        bool commit(std::shared_ptr<Logger::ILogger> logger) override
+        {
+            if (m_handleCache->getFlushMode( ) != Registry::RegistryHandleCache::FlushMode::PerStrategy)
+            {
+                return true;
+            }
+            return commitRegistryChanges(*m_handleCache, logger);
+        }
+
+        // Durability point of the deletions made through handleCache, with the flush cost so far
+        static bool commitRegistryChanges(Registry::RegistryHandleCache& handleCache, std::shared_ptr<Logger::ILogger> logger)
+        {
+            using enum Logger::LogLevel;
+
+            const auto flushResult = handleCache.flush( );
+            const auto statistics = handleCache.getStatistics( );
+            logger->log(LOG_INFO,
+                        std::format(L"Registry changes committed ({} flush): {} hives flushed in {:.1f} ms; {} deletions, {} flushes, {:.1f} ms flushing so far.",
+                                    Registry::RegistryHandleCache::getFlushModeName(handleCache.getFlushMode( )),
+                                    flushResult.hiveCount, flushResult.duration.count( ) / 1000.0,
+                                    statistics.deletions, statistics.flushes, statistics.flushTime.count( ) / 1000.0));
+
+            if (flushResult.error != ERROR_SUCCESS)
+            {
+                logger->log(LOG_ERROR, std::format(L"Could not flush the registry (Error Code: {}).", flushResult.error));
+                return false;
+            }
+            return true;
+        }
+
     protected:
-        [[nodiscard]] std::wstring formatKeyPath(const std::pair<HKEY, std::wstring>& keyPair) const
+        const std::shared_ptr<Registry::RegistryHandleCache>& handleCache( ) const noexcept
+        {
+            return m_handleCache;
+        }
+
+        [[nodiscard]] std::wstring formatKeyPath(Registry::RegistryHive hive, std::wstring_view path) const
+        {
+            return std::format(L"{}\\{}", Registry::toString(hive), path);
+        }
+
+        // Registry paths often use %SystemRoot%, %ProgramFiles%, ...; the text is returned as is if it cannot be expanded
+        static std::wstring expandEnvironmentStrings(const std::wstring& text)
         {
-            if (const auto it = Constants::RegistryConstants::hKeyToWStr.find(keyPair.first);
-                it != Constants::RegistryConstants::hKeyToWStr.end( ))
+            const DWORD length = ExpandEnvironmentStringsW(text.c_str( ), nullptr, 0);
+            if (length == 0)
             {
-                return std::format(L"{}\\{}", it->second, keyPair.second);
+                return text;
             }
 
-            // Error fallback
-            return std::format(L"UNKNOWN_KEY\\{}", keyPair.second);
+            std::wstring expanded(length, L'\0');
+            if (ExpandEnvironmentStringsW(text.c_str( ), expanded.data( ), length) == 0)
+            {
+                return text;
+            }
+            expanded.resize(length - 1);
+            return expanded;
         }
 
         [[nodiscard]] std::optional<std::wstring> getFriendlyErrorMessage(LONG errorCode) const noexcept
@@ -73,9 +132,40 @@ namespace WinLogon::CustomActions::Cleanup
         bool deleteRegistryKey(HKEY hKeyRoot, std::wstring_view subKey,
                                std::shared_ptr<Logger::ILogger> logger) const
         {
-            using enum Logger::LogLevel;
+            const LONG result = m_handleCache->deleteTree(hKeyRoot, subKey);
+            return reportKeyDeletion(subKey, result, logger);
+        }
+
+        // Deletes disjoint subtrees with up to workerCount threads and returns the RegDeleteTreeW result of
+        // each one, in order. Nothing is logged here, so callers can report the results in a stable order.
+        std::vector<LONG> deleteRegistryTrees(HKEY hKeyRoot, const std::vector<std::wstring>& subKeys,
+                                              std::size_t workerCount) const
+        {
+            std::vector<LONG> results(subKeys.size( ), ERROR_SUCCESS);
+            Threading::parallelFor(subKeys.size( ), workerCount, [&](std::size_t i)
+            {
+                results[i] = m_handleCache->deleteTree(hKeyRoot, subKeys[i]);
+            });
+
+            return results;
+        }
 
-            const LONG result = RegDeleteTreeW(hKeyRoot, subKey.data( ));
+        // Same, for subtrees under different roots
+        std::vector<LONG> deleteRegistryTrees(const std::vector<std::pair<HKEY, std::wstring_view>>& keys,
+                                              std::size_t workerCount) const
+        {
+            std::vector<LONG> results(keys.size( ), ERROR_SUCCESS);
+            Threading::parallelFor(keys.size( ), workerCount, [&](std::size_t i)
+            {
+                results[i] = m_handleCache->deleteTree(keys[i].first, keys[i].second);
+            });
+
+            return results;
+        }
+
+        bool reportKeyDeletion(std::wstring_view subKey, LONG result, std::shared_ptr<Logger::ILogger> logger) const
+        {
+            using enum Logger::LogLevel;
 
             switch (result)
             {
@@ -100,9 +190,20 @@ namespace WinLogon::CustomActions::Cleanup
             }
         }
 
+        void logHandleCacheStatistics(std::shared_ptr<Logger::ILogger> logger) const
+        {
+            const auto statistics = m_handleCache->getStatistics( );
+            logger->log(Logger::LogLevel::LOG_TRACE,
+                        std::format(L"Registry handle cache: {} hits, {} misses ({}% hit rate), {} handles dropped by deletions.",
+                                    statistics.hits, statistics.misses, statistics.hitRate( ), statistics.invalidated));
+        }
+
     public:
         // Specific implementation will be provided by derived classes
         bool execute(std::shared_ptr<Logger::ILogger> logger) override = 0;
         [[nodiscard]] std::wstring getName( ) const override = 0;
+
+    private:
+        std::shared_ptr<Registry::RegistryHandleCache> m_handleCache;
     };
 }
\ No newline at end of file
@@ -1,63 +1,63 @@
 #pragma once
 
-#include <map>
-#include <string>
-#include <vector>
-#include <Windows.h>
+#include <array>
 #include <string_view>
 
 #include "UUIDs.h"
+#include "JoinedString.h"
+#include "IRegistryAccess.h"
 
 namespace WinLogon::CustomActions::Constants
 {
     class RegistryConstants
     {
     public:
-        static inline const std::map<HKEY, std::wstring> hKeyToWStr = {
-            {HKEY_CLASSES_ROOT, L"HKEY_CLASSES_ROOT"},
-            {HKEY_CURRENT_USER, L"HKEY_CURRENT_USER"},
-            {HKEY_LOCAL_MACHINE, L"HKEY_LOCAL_MACHINE"},
-            {HKEY_USERS, L"HKEY_USERS"},
-            {HKEY_CURRENT_CONFIG, L"HKEY_CURRENT_CONFIG"}
-        };
-
-        static inline std::wstring makeAuthenticationPath(const std::wstring& extra_path, std::wstring_view uuid)
+        struct InstallationKey
         {
-            return std::wstring(L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Authentication\\") + extra_path + L"\\" + std::wstring(uuid);
-        }
+            Registry::RegistryHive hive;
+            std::wstring_view path;
+        };
 
-        static inline std::vector<std::pair<HKEY, std::wstring>> getInstallationKeysToDelete()
+        // The paths are joined at compile time and the list is returned by value: no string is allocated
+        static constexpr std::array<InstallationKey, 12> getInstallationKeysToDelete( ) noexcept
         {
-            return {
+            using enum Registry::RegistryHive;
+            return { {
                 // Logon App Entries
-                { HKEY_LOCAL_MACHINE, L"SOFTWARE\\WatchGuard\\Logon App"},
+                { LocalMachine, LOGON_APP_PATH },
 
                 // Credential Provider Filter
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Provider Filters", UUIDs::APPLICATION_UUID) },
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDER_FILTERS_PATH, UUIDs::APPLICATION_UUID>::value },
 
                 // Password
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Providers\\", UUIDs::APPLICATION_UUID) },
-                { HKEY_CLASSES_ROOT, std::wstring(L"CLSID\\") + std::wstring(UUIDs::APPLICATION_UUID) },
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDERS_PATH, UUIDs::APPLICATION_UUID>::value },
+                { ClassesRoot, Text::JoinedString<CLASSES_ROOT_CLSID_PATH, UUIDs::APPLICATION_UUID>::value },
 
                 // Face Recognition
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Providers\\", UUIDs::FACE_RECOGNITION_UUID) },
-                { HKEY_LOCAL_MACHINE, std::wstring(L"SOFTWARE\\Classes\\CLSID\\") + std::wstring(UUIDs::FACE_RECOGNITION_UUID) },
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDERS_PATH, UUIDs::FACE_RECOGNITION_UUID>::value },
+                { LocalMachine, Text::JoinedString<CLASSES_CLSID_PATH, UUIDs::FACE_RECOGNITION_UUID>::value },
 
                 // PIN
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Providers\\", UUIDs::PIN_UUID) },
-                { HKEY_LOCAL_MACHINE, std::wstring(L"SOFTWARE\\Classes\\CLSID\\") + std::wstring(UUIDs::PIN_UUID) },
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDERS_PATH, UUIDs::PIN_UUID>::value },
+                { LocalMachine, Text::JoinedString<CLASSES_CLSID_PATH, UUIDs::PIN_UUID>::value },
 
                 // Fingerprint
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Providers\\", UUIDs::FINGERPRINT_UUID) },
-                { HKEY_LOCAL_MACHINE, std::wstring(L"SOFTWARE\\Classes\\CLSID\\") + std::wstring(UUIDs::FINGERPRINT_UUID) },
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDERS_PATH, UUIDs::FINGERPRINT_UUID>::value },
+                { LocalMachine, Text::JoinedString<CLASSES_CLSID_PATH, UUIDs::FINGERPRINT_UUID>::value },
 
                 // SmartCard
-                { HKEY_LOCAL_MACHINE, makeAuthenticationPath(L"Credential Providers\\", UUIDs::SMARTCARD_UUID) },
-                { HKEY_LOCAL_MACHINE, std::wstring(L"SOFTWARE\\Classes\\CLSID\\") + std::wstring(UUIDs::SMARTCARD_UUID) }
-            };
+                { LocalMachine, Text::JoinedString<CREDENTIAL_PROVIDERS_PATH, UUIDs::SMARTCARD_UUID>::value },
+                { LocalMachine, Text::JoinedString<CLASSES_CLSID_PATH, UUIDs::SMARTCARD_UUID>::value }
+            } };
         }
 
     private:
+        static constexpr std::wstring_view LOGON_APP_PATH = L"SOFTWARE\\WatchGuard\\Logon App";
+        static constexpr std::wstring_view CREDENTIAL_PROVIDER_FILTERS_PATH = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Authentication\\Credential Provider Filters\\";
+        static constexpr std::wstring_view CREDENTIAL_PROVIDERS_PATH = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Authentication\\Credential Providers\\";
+        static constexpr std::wstring_view CLASSES_ROOT_CLSID_PATH = L"CLSID\\";
+        static constexpr std::wstring_view CLASSES_CLSID_PATH = L"SOFTWARE\\Classes\\CLSID\\";
+
         RegistryConstants() = delete; // Prevents instantiation
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <unordered_map>
+
+#include "KeyPathPool.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Reduces a list of keys to delete to the smallest set of disjoint subtrees covering all of them.
+    // A key below another listed key disappears with it, so only the topmost listed keys are deleted,
+    // once each, and the roots can then be removed independently (in parallel).
+    class RegistryDeletionPlanner
+    {
+    public:
+        using Node = KeyPathPool::Node;
+
+        struct Plan
+        {
+            std::vector<const Node*> roots;      // Keys to delete, in the order they first appear in the input
+            std::vector<std::size_t> rootOf;     // For each input key, the index of the root that removes it
+        };
+
+        // Keys must come from the same KeyPathPool, so a shared prefix is a shared node
+        static Plan plan(std::span<const Node* const> keys)
+        {
+            std::unordered_map<const Node*, std::size_t> listed;
+            listed.reserve(keys.size( ));
+            for (const Node* key : keys)
+            {
+                listed.emplace(key, 0);
+            }
+
+            // Topmost listed ancestor (or the key itself) of every key
+            std::vector<const Node*> topmost(keys.size( ));
+            for (std::size_t i = 0; i < keys.size( ); ++i)
+            {
+                topmost[i] = keys[i];
+                for (const Node* ancestor = keys[i]->parent; ancestor; ancestor = ancestor->parent)
+                {
+                    if (listed.contains(ancestor))
+                    {
+                        topmost[i] = ancestor;
+                    }
+                }
+            }
+
+            Plan plan;
+            plan.rootOf.resize(keys.size( ));
+
+            std::unordered_map<const Node*, std::size_t> rootIndex;
+            for (std::size_t i = 0; i < keys.size( ); ++i)
+            {
+                const auto [it, inserted] = rootIndex.emplace(topmost[i], plan.roots.size( ));
+                if (inserted)
+                {
+                    plan.roots.push_back(topmost[i]);
+                }
+                plan.rootOf[i] = it->second;
+            }
+
+            return plan;
+        }
+    };
+}
\ No newline at end of file
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <span>
 #include <format>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <string_view>
 
 #include "RegistryConstants.h"
+#include "WinRegistryAccess.h"
 #include "RegistryCleanupStrategy.h"
 
 namespace WinLogon::CustomActions::Cleanup::Strategies
@@ -10,19 +16,17 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
     class RegistryEntriesCleanupStrategy : public RegistryCleanupStrategy
     {
     public:
+        using RegistryCleanupStrategy::RegistryCleanupStrategy;
+
         bool execute(std::shared_ptr<Logger::ILogger> logger) override
         {
             using enum WinLogon::CustomActions::Logger::LogLevel;
             logger->log(Logger::LogLevel::LOG_INFO, L"=== Deleting Registry Entries - Started ===");
 
-            bool result = true;
-            for (const auto& keyPair : Constants::RegistryConstants::getInstallationKeysToDelete( ))
-            {
-                logger->log(Logger::LogLevel::LOG_INFO,
-                            std::format(L"- Processing: {}.", formatKeyPath(keyPair)));
-                result &= deleteRegistryKey(keyPair.first, keyPair.second, logger);
-            }
+            const auto keysToDelete = Constants::RegistryConstants::getInstallationKeysToDelete( );
+            const bool result = m_batchMode ? deleteBatch(keysToDelete, logger) : deleteSequentially(keysToDelete, logger);
 
+            logHandleCacheStatistics(logger);
             logger->log(Logger::LogLevel::LOG_INFO, L"=== Deleting Registry Entries - Finished! ===\n");
             return result;
         }
@@ -31,5 +35,75 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
         {
             return L"Registry Entries Cleanup Strategy";
         }
+
+        // Probes every key first and deletes the existing ones concurrently (on by default).
+        // Otherwise each key is deleted in turn, whether it exists or not.
+        void setBatchMode(bool enabled) noexcept
+        {
+            m_batchMode = enabled;
+        }
+
+        // Maximum number of keys deleted at the same time in batch mode
+        void setDeleteWorkerCount(std::size_t workerCount) noexcept
+        {
+            m_deleteWorkerCount = std::max<std::size_t>(1, workerCount);
+        }
+
+    private:
+        // The keys are independent subtrees; a few concurrent deletions are enough for a dozen of them
+        static constexpr std::size_t DEFAULT_DELETE_WORKER_COUNT = 4;
+
+        bool m_batchMode = true;
+        std::size_t m_deleteWorkerCount = DEFAULT_DELETE_WORKER_COUNT;
+
+        using InstallationKey = Constants::RegistryConstants::InstallationKey;
+
+        bool deleteSequentially(std::span<const InstallationKey> keysToDelete, std::shared_ptr<Logger::ILogger> logger) const
+        {
+            bool result = true;
+            for (const auto& [hive, path] : keysToDelete)
+            {
+                logger->log(Logger::LogLevel::LOG_INFO,
+                            std::format(L"- Processing: {}.", formatKeyPath(hive, path)));
+                result &= deleteRegistryKey(Registry::WinRegistryAccess::toHKey(hive), path, logger);
+            }
+            return result;
+        }
+
+        // Keys already gone cost one open relative to their (shared, cached) parent instead of a delete
+        // attempt. The outcome of every key is reported afterwards, in the order and format of
+        // deleteSequentially.
+        bool deleteBatch(std::span<const InstallationKey> keysToDelete, std::shared_ptr<Logger::ILogger> logger) const
+        {
+            std::vector<LONG> results(keysToDelete.size( ), ERROR_FILE_NOT_FOUND);
+            std::vector<std::size_t> present;
+            std::vector<std::pair<HKEY, std::wstring_view>> keysPresent;
+            for (std::size_t i = 0; i < keysToDelete.size( ); ++i)
+            {
+                // Anything but "not found" (e.g. no read access) is left to the deletion to decide
+                const HKEY root = Registry::WinRegistryAccess::toHKey(keysToDelete[i].hive);
+                if (handleCache( )->probe(root, keysToDelete[i].path) != ERROR_FILE_NOT_FOUND)
+                {
+                    present.push_back(i);
+                    keysPresent.emplace_back(root, keysToDelete[i].path);
+                }
+            }
+
+            const auto deleteResults = deleteRegistryTrees(keysPresent, m_deleteWorkerCount);
+            for (std::size_t i = 0; i < present.size( ); ++i)
+            {
+                results[present[i]] = deleteResults[i];
+            }
+
+            bool result = true;
+            for (std::size_t i = 0; i < keysToDelete.size( ); ++i)
+            {
+                const auto& [hive, path] = keysToDelete[i];
+                logger->log(Logger::LogLevel::LOG_INFO,
+                            std::format(L"- Processing: {}.", formatKeyPath(hive, path)));
+                result &= reportKeyDeletion(path, results[i], logger);
+            }
+            return result;
+        }
     };
-}
\ No newline at end of file
+}
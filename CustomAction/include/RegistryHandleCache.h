@@ -0,0 +1,401 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+#include "CaseFolding.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Open registry keys shared by the cleanup strategies of one session. Strategies borrow the handle
+    // of a parent key (e.g. ...\Authentication\Credential Providers or Installer\Products) and run their
+    // deletions and enumerations relative to it, instead of opening the same path again for every key.
+    // Handles are reference counted: dropping one from the cache (when its subtree is deleted) closes it
+    // once the last borrower releases it. Thread safe.
+    //
+    // Deletions go through the cache, which also decides when they are flushed to disk. By default it
+    // leaves that to Windows, which writes modified hives back lazily, one write-back per burst of changes;
+    // the cache can instead flush after every deletion, or collect the modified hives and flush each of
+    // them once at a durability point. Explicit flushes cost RegFlushKey I/O and are opt-in.
+    class RegistryHandleCache
+    {
+    public:
+        using Handle = std::shared_ptr<HKEY__>;
+
+        enum class FlushMode
+        {
+            Lazy,          // No explicit flush: the lazy writer of the registry writes the hives back
+            Immediate,     // Every deletion is flushed at once
+            PerStrategy,   // Flushed when each cleanup strategy finishes
+            PerSession     // Flushed once, when the cleanup session finishes
+        };
+
+        // Outcome of one durability point
+        struct FlushResult
+        {
+            std::size_t hiveCount = 0;                    // Hives flushed
+            LONG error = ERROR_SUCCESS;                   // First RegFlushKey failure, immediate flushes included
+            std::chrono::microseconds duration{ 0 };
+        };
+
+        struct Statistics
+        {
+            std::size_t hits = 0;          // Opens answered with a cached handle
+            std::size_t misses = 0;        // Opens that went to the registry
+            std::size_t invalidated = 0;   // Handles dropped because their key was deleted
+            std::size_t cached = 0;        // Handles currently in the cache
+            std::size_t deletions = 0;     // Subtrees deleted
+            std::size_t flushes = 0;       // RegFlushKey calls
+            std::chrono::microseconds flushTime{ 0 };   // Time spent in RegFlushKey
+
+            std::size_t hitRate( ) const noexcept
+            {
+                const std::size_t lookups = hits + misses;
+                return lookups == 0 ? 0 : hits * 100 / lookups;
+            }
+        };
+
+        RegistryHandleCache( ) = default;
+        RegistryHandleCache(const RegistryHandleCache&) = delete;
+        RegistryHandleCache& operator=(const RegistryHandleCache&) = delete;
+
+        // Handle of root\path, opened for reading (and deleting, when granted) relative to the closest
+        // cached ancestor. Null when the key cannot be opened; error then receives the reason.
+        Handle open(HKEY root, std::wstring_view path, LONG* error = nullptr)
+        {
+            const std::wstring normalizedPath = normalize(path);
+            if (error)
+            {
+                *error = ERROR_SUCCESS;
+            }
+            if (normalizedPath.empty( ))
+            {
+                // Predefined keys are never closed
+                return Handle(root, [](HKEY) {});
+            }
+
+            CacheKey key{ root, fold(normalizedPath) };
+            Handle parent;
+            std::wstring_view relativePath = normalizedPath;
+            std::uint64_t generation;
+            {
+                std::lock_guard lock(m_mutex);
+                if (const auto it = m_handles.find(key); it != m_handles.end( ))
+                {
+                    ++m_statistics.hits;
+                    return it->second;
+                }
+                ++m_statistics.misses;
+
+                for (auto separator = normalizedPath.rfind(L'\\'); separator != std::wstring::npos && separator != 0;
+                     separator = normalizedPath.rfind(L'\\', separator - 1))
+                {
+                    if (const auto it = m_handles.find(CacheKey{ root, key.path.substr(0, separator) }); it != m_handles.end( ))
+                    {
+                        parent = it->second;
+                        relativePath = std::wstring_view(normalizedPath).substr(separator + 1);
+                        break;
+                    }
+                }
+                generation = m_generation;
+            }
+
+            // Opened without the lock; concurrent opens of the same key keep the first handle cached
+            const std::wstring subKey{ relativePath };
+            HKEY hKey = nullptr;
+            LONG result = RegOpenKeyExW(parent ? parent.get( ) : root, subKey.c_str( ), 0, KEY_READ | DELETE, &hKey);
+            if (result == ERROR_ACCESS_DENIED)
+            {
+                result = RegOpenKeyExW(parent ? parent.get( ) : root, subKey.c_str( ), 0, KEY_READ, &hKey);
+            }
+            if (result != ERROR_SUCCESS)
+            {
+                if (error)
+                {
+                    *error = result;
+                }
+                return nullptr;
+            }
+
+            Handle handle(hKey, [](HKEY openKey)
+            {
+                RegCloseKey(openKey);
+            });
+
+            std::lock_guard lock(m_mutex);
+            if (generation != m_generation)
+            {
+                // A subtree was deleted meanwhile, maybe this one: use the handle but do not cache it
+                return handle;
+            }
+            return m_handles.emplace(std::move(key), std::move(handle)).first->second;
+        }
+
+        // RegDeleteTreeW of root\path, through the cached handle of its parent when there is one.
+        // Cached handles of the deleted subtree are dropped.
+        LONG deleteTree(HKEY root, std::wstring_view path)
+        {
+            const std::wstring normalizedPath = normalize(path);
+            const auto separator = normalizedPath.rfind(L'\\');
+
+            LONG result = ERROR_ACCESS_DENIED;
+            if (separator != std::wstring::npos)
+            {
+                LONG openError = ERROR_SUCCESS;
+                if (const auto parent = open(root, std::wstring_view(normalizedPath).substr(0, separator), &openError))
+                {
+                    result = RegDeleteTreeW(parent.get( ), normalizedPath.c_str( ) + separator + 1);
+                }
+                else if (openError == ERROR_FILE_NOT_FOUND)
+                {
+                    // No parent, nothing to delete
+                    result = ERROR_FILE_NOT_FOUND;
+                }
+            }
+
+            // Parent not readable or not opened with DELETE access: let the registry resolve the full path
+            if (result == ERROR_ACCESS_DENIED)
+            {
+                result = RegDeleteTreeW(root, normalizedPath.c_str( ));
+            }
+
+            invalidate(root, normalizedPath);
+            if (result == ERROR_SUCCESS)
+            {
+                onDeleted(root, normalizedPath);
+            }
+            return result;
+        }
+
+        void setFlushMode(FlushMode mode) noexcept
+        {
+            std::lock_guard lock(m_mutex);
+            m_flushMode = mode;
+        }
+
+        FlushMode getFlushMode( ) const noexcept
+        {
+            std::lock_guard lock(m_mutex);
+            return m_flushMode;
+        }
+
+        static constexpr std::wstring_view getFlushModeName(FlushMode mode) noexcept
+        {
+            switch (mode)
+            {
+                case FlushMode::Lazy:
+                    return L"lazy";
+
+                case FlushMode::Immediate:
+                    return L"immediate";
+
+                case FlushMode::PerStrategy:
+                    return L"per strategy";
+
+                default:
+                    return L"per session";
+            }
+        }
+
+        // Durability point: flushes every hive modified since the previous one, each once.
+        // In Lazy and Immediate modes there is nothing left to flush.
+        FlushResult flush( )
+        {
+            FlushResult flushResult;
+            std::vector<CacheKey> hives;
+            {
+                std::lock_guard lock(m_mutex);
+                hives.swap(m_modifiedHives);
+                std::swap(flushResult.error, m_immediateFlushError);
+            }
+
+            const auto start = std::chrono::steady_clock::now( );
+            for (const auto& hive : hives)
+            {
+                const LONG result = flushHive(hive);
+                flushResult.error = (flushResult.error == ERROR_SUCCESS) ? result : flushResult.error;
+                ++flushResult.hiveCount;
+            }
+
+            flushResult.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now( ) - start);
+            return flushResult;
+        }
+
+        // Whether root\path exists: ERROR_SUCCESS, ERROR_FILE_NOT_FOUND, or the reason it could not be told.
+        // The key is opened relative to its cached parent and closed at once; only the parent is cached.
+        LONG probe(HKEY root, std::wstring_view path)
+        {
+            const std::wstring normalizedPath = normalize(path);
+            const auto separator = normalizedPath.rfind(L'\\');
+
+            Handle parent;
+            std::wstring_view subKey = normalizedPath;
+            if (separator != std::wstring::npos)
+            {
+                LONG openError = ERROR_SUCCESS;
+                parent = open(root, std::wstring_view(normalizedPath).substr(0, separator), &openError);
+                if (!parent)
+                {
+                    return openError;
+                }
+                subKey = std::wstring_view(normalizedPath).substr(separator + 1);
+            }
+
+            HKEY hKey = nullptr;
+            const LONG result = RegOpenKeyExW(parent ? parent.get( ) : root, std::wstring(subKey).c_str( ), 0, KEY_QUERY_VALUE, &hKey);
+            if (result == ERROR_SUCCESS)
+            {
+                RegCloseKey(hKey);
+            }
+            return result;
+        }
+
+        // Drops the cached handles of root\path and of every key below it
+        void invalidate(HKEY root, std::wstring_view path)
+        {
+            const std::wstring prefix = fold(normalize(path));
+
+            std::lock_guard lock(m_mutex);
+            ++m_generation;
+            std::erase_if(m_handles, [&](const auto& entry)
+            {
+                const CacheKey& key = entry.first;
+                const bool below = key.root == root && key.path.starts_with(prefix) &&
+                                   (key.path.size( ) == prefix.size( ) || prefix.empty( ) || key.path[prefix.size( )] == L'\\');
+                m_statistics.invalidated += below ? 1 : 0;
+                return below;
+            });
+        }
+
+        Statistics getStatistics( ) const
+        {
+            std::lock_guard lock(m_mutex);
+            Statistics statistics = m_statistics;
+            statistics.cached = m_handles.size( );
+            return statistics;
+        }
+
+    private:
+        struct CacheKey
+        {
+            HKEY root;
+            std::wstring path;   // Case folded
+
+            bool operator==(const CacheKey&) const = default;
+        };
+
+        struct CacheKeyHash
+        {
+            std::size_t operator()(const CacheKey& key) const noexcept
+            {
+                return std::hash<std::wstring>{ }(key.path) * 31 + std::hash<HKEY>{ }(key.root);
+            }
+        };
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<CacheKey, Handle, CacheKeyHash> m_handles;
+        std::uint64_t m_generation = 0;   // Incremented by every invalidation
+        Statistics m_statistics;
+
+        FlushMode m_flushMode = FlushMode::Lazy;
+        std::vector<CacheKey> m_modifiedHives;          // Waiting for the next durability point
+        LONG m_immediateFlushError = ERROR_SUCCESS;     // Reported at the next durability point
+
+        // A hive is identified by the first component below its root: HKEY_USERS\<SID>, HKEY_LOCAL_MACHINE\SOFTWARE, ...
+        static CacheKey getHive(HKEY root, std::wstring_view path)
+        {
+            return CacheKey{ root, fold(path.substr(0, path.find(L'\\'))) };
+        }
+
+        void onDeleted(HKEY root, std::wstring_view path)
+        {
+            CacheKey hive = getHive(root, path);
+            {
+                std::lock_guard lock(m_mutex);
+                ++m_statistics.deletions;
+                if (m_flushMode == FlushMode::Lazy)
+                {
+                    return;
+                }
+                if (m_flushMode != FlushMode::Immediate)
+                {
+                    if (std::find(m_modifiedHives.begin( ), m_modifiedHives.end( ), hive) == m_modifiedHives.end( ))
+                    {
+                        m_modifiedHives.push_back(std::move(hive));
+                    }
+                    return;
+                }
+            }
+
+            if (const LONG result = flushHive(hive); result != ERROR_SUCCESS)
+            {
+                std::lock_guard lock(m_mutex);
+                m_immediateFlushError = (m_immediateFlushError == ERROR_SUCCESS) ? result : m_immediateFlushError;
+            }
+        }
+
+        LONG flushHive(const CacheKey& hive)
+        {
+            const auto start = std::chrono::steady_clock::now( );
+
+            LONG result = ERROR_SUCCESS;
+            const Handle key = open(hive.root, hive.path, &result);
+            if (key)
+            {
+                result = RegFlushKey(key.get( ));
+            }
+            else if (result == ERROR_FILE_NOT_FOUND)
+            {
+                // The whole hive root was deleted: flush what holds it
+                result = RegFlushKey(hive.root);
+            }
+
+            const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now( ) - start);
+            std::lock_guard lock(m_mutex);
+            ++m_statistics.flushes;
+            m_statistics.flushTime += duration;
+            return result;
+        }
+
+        // Backslash separated, without empty components
+        static std::wstring normalize(std::wstring_view path)
+        {
+            std::wstring result;
+            result.reserve(path.size( ));
+            for (const wchar_t ch : path)
+            {
+                if (ch == L'\\' && (result.empty( ) || result.back( ) == L'\\'))
+                {
+                    continue;
+                }
+                result.push_back(ch);
+            }
+            if (!result.empty( ) && result.back( ) == L'\\')
+            {
+                result.pop_back( );
+            }
+            return result;
+        }
+
+        static std::wstring fold(std::wstring_view path)
+        {
+            std::wstring result(path);
+            for (auto& ch : result)
+            {
+                ch = Text::foldCase(ch);
+            }
+            return result;
+        }
+    };
+}
\ No newline at end of file
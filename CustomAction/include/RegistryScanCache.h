@@ -0,0 +1,234 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Cache of what registry scans read (sub key lists and string values), keyed by key path. It lives in
+    // memory only, for the process (e.g. the custom action server of one installation session): nothing
+    // is persisted where a record could be planted.
+    // A record is only trusted while the key's last write time is unchanged: the registry updates it
+    // whenever a value or the list of direct children of that key changes, so a key that was modified
+    // (or re-created) is always read again. Deleted keys simply never match again.
+    class RegistryScanCache
+    {
+    public:
+        struct Statistics
+        {
+            std::size_t hits = 0;      // Reads answered from the cache
+            std::size_t misses = 0;    // Reads that went to the registry
+        };
+
+        // Cached data of one key
+        struct Record
+        {
+            std::uint64_t lastWriteTime = 0;
+            std::optional<std::vector<std::wstring>> subKeys;
+            std::map<std::wstring, std::optional<std::wstring>, Text::CaseInsensitiveLess> values;
+        };
+
+        // Forgets every record. Must not be called while a scan uses the cache.
+        void invalidate( )
+        {
+            std::lock_guard lock(m_mutex);
+            m_records.clear( );
+        }
+
+        // Returns the record of a key, reset if the key changed since it was cached.
+        // Records are only removed by invalidate, so the reference stays valid during a scan.
+        Record& acquire(const std::wstring& path, std::uint64_t lastWriteTime)
+        {
+            std::lock_guard lock(m_mutex);
+            Record& record = m_records[path];
+            if (record.lastWriteTime != lastWriteTime)
+            {
+                record = Record{ };
+                record.lastWriteTime = lastWriteTime;
+            }
+            return record;
+        }
+
+        std::mutex& mutex( ) const noexcept
+        {
+            return m_mutex;
+        }
+
+        void recordHit( ) noexcept
+        {
+            ++m_hits;
+        }
+
+        void recordMiss( ) noexcept
+        {
+            ++m_misses;
+        }
+
+        Statistics getStatistics( ) const noexcept
+        {
+            return { m_hits.load( ), m_misses.load( ) };
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::wstring, Record> m_records;
+
+        std::atomic<std::size_t> m_hits{ 0 };
+        std::atomic<std::size_t> m_misses{ 0 };
+    };
+
+    // Registry backend decorator that answers sub key enumerations and string value reads from a
+    // RegistryScanCache when the key did not change. Only the last write time is queried for such keys.
+    class CachingRegistryAccess : public IRegistryAccess
+    {
+    public:
+        CachingRegistryAccess(std::shared_ptr<const IRegistryAccess> inner, std::shared_ptr<RegistryScanCache> cache)
+            : m_inner(std::move(inner)), m_cache(std::move(cache))
+        {
+        }
+
+        std::unique_ptr<IRegistryKey> openKey(RegistryHive hive, std::wstring_view path) const override
+        {
+            auto key = m_inner->openKey(hive, path);
+            if (!key)
+            {
+                return nullptr;
+            }
+
+            std::wstring keyPath{ toString(hive) };
+            appendPath(keyPath, path);
+            return wrap(std::move(key), std::move(keyPath));
+        }
+
+    private:
+        class Key : public IRegistryKey
+        {
+        public:
+            Key(const CachingRegistryAccess& owner, std::unique_ptr<IRegistryKey> inner, std::wstring path,
+                RegistryScanCache::Record* record)
+                : m_owner(owner), m_inner(std::move(inner)), m_path(std::move(path)), m_record(record)
+            {
+            }
+
+            std::unique_ptr<IRegistryKey> openSubKey(std::wstring_view name) const override
+            {
+                auto subKey = m_inner->openSubKey(name);
+                if (!subKey)
+                {
+                    return nullptr;
+                }
+
+                std::wstring subKeyPath = m_path;
+                appendPath(subKeyPath, name);
+                return m_owner.wrap(std::move(subKey), std::move(subKeyPath));
+            }
+
+            std::vector<std::wstring> enumerateSubKeys( ) const override
+            {
+                auto& cache = *m_owner.m_cache;
+                if (m_record)
+                {
+                    std::lock_guard lock(cache.mutex( ));
+                    if (m_record->subKeys)
+                    {
+                        cache.recordHit( );
+                        return *m_record->subKeys;
+                    }
+                }
+
+                cache.recordMiss( );
+                auto subKeys = m_inner->enumerateSubKeys( );
+                if (m_record)
+                {
+                    std::lock_guard lock(cache.mutex( ));
+                    m_record->subKeys = subKeys;
+                }
+                return subKeys;
+            }
+
+            std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+            {
+                auto& cache = *m_owner.m_cache;
+                if (m_record)
+                {
+                    std::lock_guard lock(cache.mutex( ));
+                    if (const auto it = m_record->values.find(valueName); it != m_record->values.end( ))
+                    {
+                        cache.recordHit( );
+                        return it->second;
+                    }
+                }
+
+                cache.recordMiss( );
+                auto value = m_inner->getStringValue(valueName);
+                if (m_record)
+                {
+                    std::lock_guard lock(cache.mutex( ));
+                    m_record->values.insert_or_assign(std::wstring(valueName), value);
+                }
+                return value;
+            }
+
+            // Not cached: only scans go through the cache, and they read string values by name
+            std::vector<RegistryValue> enumerateValues( ) const override
+            {
+                return m_inner->enumerateValues( );
+            }
+
+            std::optional<std::uint64_t> getLastWriteTime( ) const override
+            {
+                return m_inner->getLastWriteTime( );
+            }
+
+        private:
+            const CachingRegistryAccess& m_owner;
+            std::unique_ptr<IRegistryKey> m_inner;
+            std::wstring m_path;
+            RegistryScanCache::Record* m_record;   // Null when the backend has no last write time
+        };
+
+        std::shared_ptr<const IRegistryAccess> m_inner;
+        std::shared_ptr<RegistryScanCache> m_cache;
+
+        std::unique_ptr<IRegistryKey> wrap(std::unique_ptr<IRegistryKey> key, std::wstring path) const
+        {
+            RegistryScanCache::Record* record = nullptr;
+            if (const auto lastWriteTime = key->getLastWriteTime( ))
+            {
+                record = &m_cache->acquire(path, *lastWriteTime);
+            }
+            return std::make_unique<Key>(*this, std::move(key), std::move(path), record);
+        }
+
+        // Cache paths are case-folded so differently cased opens share a record. Every component is
+        // preceded by a separator, whatever separators name has, so distinct keys never share a path.
+        static void appendPath(std::wstring& path, std::wstring_view name)
+        {
+            while (!name.empty( ))
+            {
+                const auto separator = name.find(L'\\');
+                const auto component = name.substr(0, separator);
+                if (!component.empty( ))
+                {
+                    path.push_back(L'\\');
+                    for (const wchar_t ch : component)
+                    {
+                        path.push_back(Text::foldCase(ch));
+                    }
+                }
+                name = (separator == std::wstring_view::npos) ? std::wstring_view{ } : name.substr(separator + 1);
+            }
+        }
+    };
+}
\ No newline at end of file
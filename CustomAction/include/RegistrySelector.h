@@ -0,0 +1,284 @@
+#pragma once
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cwctype>
+#include <stdexcept>
+#include <string_view>
+
+#include "CaseFolding.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Declarative description of the keys a scan is interested in:
+    //
+    //   SOFTWARE\Microsoft\Windows\CurrentVersion\Installer\UserData\*\Products\*\InstallProperties:DisplayName
+    //
+    // Path components are matched case-insensitively and may be
+    //   name      a literal key name
+    //   S-1-5-*   a glob, '*' matches any run of characters and '?' a single one
+    //   *         exactly one key, whatever its name
+    //   **        any number of keys, including none; "**{3}" stops after 3 levels
+    // The text after the last ':' names the value to test. The leading literal components form the
+    // root key where the scan starts.
+    //
+    // The pattern is compiled into a small automaton over key names (one bit per position in the
+    // pattern), so the scan can tell from a sub key name alone whether anything below it can match
+    // and never opens the subtrees that cannot.
+    class RegistrySelector
+    {
+    public:
+        // Set of pattern positions reached by a key; 0 means nothing below the key can match
+        using StateSet = std::uint64_t;
+
+        static constexpr std::size_t UNLIMITED_DEPTH = std::numeric_limits<std::size_t>::max( );
+        static constexpr std::size_t MAX_STEPS = 63;
+
+        explicit RegistrySelector(std::wstring_view text) : m_text(text)
+        {
+            if (const auto separator = text.rfind(L':');
+                separator != std::wstring_view::npos && text.find(L'\\', separator) == std::wstring_view::npos)
+            {
+                m_valueName = text.substr(separator + 1);
+                text = text.substr(0, separator);
+            }
+
+            bool inPattern = false;
+            while (!text.empty( ))
+            {
+                const auto separator = text.find(L'\\');
+                const auto component = text.substr(0, separator);
+                text = (separator == std::wstring_view::npos) ? std::wstring_view{ } : text.substr(separator + 1);
+                if (component.empty( ))
+                {
+                    continue;
+                }
+
+                inPattern = inPattern || component.find_first_of(L"*?") != std::wstring_view::npos;
+                if (!inPattern)
+                {
+                    if (!m_rootPath.empty( ))
+                    {
+                        m_rootPath.push_back(L'\\');
+                    }
+                    m_rootPath.append(component);
+                    continue;
+                }
+
+                addStep(component);
+            }
+
+            if (m_rootPath.empty( ))
+            {
+                throw std::invalid_argument("Registry selector needs a literal root key");
+            }
+        }
+
+        const std::wstring& getText( ) const noexcept
+        {
+            return m_text;
+        }
+
+        // Key where the scan starts, relative to the hive
+        const std::wstring& getRootPath( ) const noexcept
+        {
+            return m_rootPath;
+        }
+
+        // Value to test on matching keys, empty when the selector does not name one
+        const std::wstring& getValueName( ) const noexcept
+        {
+            return m_valueName;
+        }
+
+        // Deepest level below the root a match can be found at
+        std::size_t getMaxDepth( ) const noexcept
+        {
+            std::size_t depth = 0;
+            for (const auto& step : m_steps)
+            {
+                if (step.kind == StepKind::AnyPath)
+                {
+                    return UNLIMITED_DEPTH;
+                }
+                ++depth;
+            }
+            return depth;
+        }
+
+        // State of the root key
+        StateSet initialState( ) const noexcept
+        {
+            return closure(1);
+        }
+
+        // State of the sub key subKeyName of a key in state
+        StateSet next(StateSet state, std::wstring_view subKeyName) const noexcept
+        {
+            StateSet result = 0;
+            for (std::size_t i = 0; i < m_steps.size( ); ++i)
+            {
+                if ((state & bit(i)) != 0 && m_steps[i].matches(subKeyName))
+                {
+                    result |= (m_steps[i].kind == StepKind::AnyPath) ? bit(i) : bit(i + 1);
+                }
+            }
+            return closure(result);
+        }
+
+        // True if a key in this state is selected
+        bool accepts(StateSet state) const noexcept
+        {
+            return (state & bit(m_steps.size( ))) != 0;
+        }
+
+        // True if a sub key of a key in this state can still be selected
+        bool canDescend(StateSet state) const noexcept
+        {
+            return (state & (bit(m_steps.size( )) - 1)) != 0;
+        }
+
+    private:
+        enum class StepKind
+        {
+            Literal,
+            Glob,
+            AnyKey,
+            OptionalKey,   // One level of a bounded "**"
+            AnyPath
+        };
+
+        struct Step
+        {
+            StepKind kind;
+            std::wstring pattern;
+
+            bool matches(std::wstring_view name) const noexcept
+            {
+                switch (kind)
+                {
+                    case StepKind::Literal:
+                        return Text::equalsIgnoreCase(name, pattern);
+
+                    case StepKind::Glob:
+                        return globMatches(pattern, name);
+
+                    default:
+                        return true;
+                }
+            }
+
+            bool skippable( ) const noexcept
+            {
+                return kind == StepKind::OptionalKey || kind == StepKind::AnyPath;
+            }
+        };
+
+        std::wstring m_text;
+        std::wstring m_rootPath;
+        std::wstring m_valueName;
+        std::vector<Step> m_steps;
+
+        static constexpr StateSet bit(std::size_t position) noexcept
+        {
+            return StateSet{ 1 } << position;
+        }
+
+        void addStep(std::wstring_view component)
+        {
+            if (component == L"*")
+            {
+                pushStep({ StepKind::AnyKey, { } });
+            }
+            else if (component == L"**")
+            {
+                pushStep({ StepKind::AnyPath, { } });
+            }
+            else if (component.starts_with(L"**{") && component.ends_with(L'}') && component.size( ) > 4)
+            {
+                std::size_t levels = 0;
+                for (const wchar_t ch : component.substr(3, component.size( ) - 4))
+                {
+                    if (!std::iswdigit(ch) || levels > MAX_STEPS)
+                    {
+                        throw std::invalid_argument("Invalid depth bound in registry selector");
+                    }
+                    levels = levels * 10 + static_cast<std::size_t>(ch - L'0');
+                }
+
+                for (std::size_t i = 0; i < levels; ++i)
+                {
+                    pushStep({ StepKind::OptionalKey, { } });
+                }
+            }
+            else if (component.find_first_of(L"*?") != std::wstring_view::npos)
+            {
+                pushStep({ StepKind::Glob, std::wstring(component) });
+            }
+            else
+            {
+                pushStep({ StepKind::Literal, std::wstring(component) });
+            }
+        }
+
+        void pushStep(Step step)
+        {
+            if (m_steps.size( ) >= MAX_STEPS)
+            {
+                throw std::invalid_argument("Registry selector has too many components");
+            }
+            m_steps.push_back(std::move(step));
+        }
+
+        // Adds the positions reachable by skipping optional steps
+        StateSet closure(StateSet state) const noexcept
+        {
+            for (std::size_t i = 0; i < m_steps.size( ); ++i)
+            {
+                if ((state & bit(i)) != 0 && m_steps[i].skippable( ))
+                {
+                    state |= bit(i + 1);
+                }
+            }
+            return state;
+        }
+
+        // Iterative glob matching with backtracking to the last '*'
+        static bool globMatches(std::wstring_view pattern, std::wstring_view name) noexcept
+        {
+            std::size_t p = 0, n = 0;
+            std::size_t starPattern = std::wstring_view::npos, starName = 0;
+
+            while (n < name.size( ))
+            {
+                if (p < pattern.size( ) && pattern[p] == L'*')
+                {
+                    starPattern = p++;
+                    starName = n;
+                }
+                else if (p < pattern.size( ) && (pattern[p] == L'?' || Text::foldCase(pattern[p]) == Text::foldCase(name[n])))
+                {
+                    ++p;
+                    ++n;
+                }
+                else if (starPattern != std::wstring_view::npos)
+                {
+                    p = starPattern + 1;
+                    n = ++starName;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            while (p < pattern.size( ) && pattern[p] == L'*')
+            {
+                ++p;
+            }
+            return p == pattern.size( );
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Depth-first traversal of a registry subtree.
+    // Every child is opened relative to its already open parent, so the registry never has to
+    // resolve the full path from the hive root again, and visitors read values through that same handle.
+    class RegistryTraversal
+    {
+    public:
+        using Visitor = std::function<void(const std::wstring& keyPath, const IRegistryKey& key)>;
+
+        // Visits key and all its descendants in pre-order. Returns the number of keys visited.
+        static std::size_t walk(const IRegistryKey& key, std::wstring_view keyPath, const Visitor& visitor)
+        {
+            std::wstring path{ keyPath };
+            return walkFrom(key, path, visitor);
+        }
+
+    private:
+        RegistryTraversal( ) = delete;  // Prevents instantiation
+
+        static std::size_t walkFrom(const IRegistryKey& key, std::wstring& path, const Visitor& visitor)
+        {
+            visitor(path, key);
+
+            std::size_t visited = 1;
+            const std::size_t pathLength = path.size( );
+
+            for (const auto& subKeyName : key.enumerateSubKeys( ))
+            {
+                auto subKey = key.openSubKey(subKeyName);
+                if (!subKey)
+                {
+                    continue;
+                }
+
+                // Reuse a single path buffer for the whole walk
+                path.push_back(L'\\');
+                path.append(subKeyName);
+                visited += walkFrom(*subKey, path, visitor);
+                path.resize(pathLength);
+            }
+
+            return visited;
+        }
+    };
+}
\ No newline at end of file
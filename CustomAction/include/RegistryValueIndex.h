@@ -0,0 +1,537 @@
+#pragma once
+
+#include <span>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <iterator>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <initializer_list>
+#include <string_view>
+#include <unordered_map>
+
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+#include "ParallelRegistryScanner.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Values of registry subtrees, read in a single walk and indexed so that several queries can be
+    // answered without walking the registry again, e.g.
+    //
+    //   any value containing "Program Files\WatchGuard\Logon App"
+    //   Publisher = "WatchGuard Technologies" AND DisplayVersion < 4
+    //
+    // String values (REG_SZ, REG_EXPAND_SZ, each string of a REG_MULTI_SZ) and REG_DWORD values (in decimal)
+    // are indexed by name and by whole value. Their words also go to an inverted index, so a substring
+    // query only checks the values holding every word the query surely contains. Comparisons ignore case.
+    // Works on any backend; the index itself is not thread safe.
+    class RegistryValueIndex
+    {
+    public:
+        using KeyId = std::uint32_t;
+
+        static constexpr std::size_t UNLIMITED_DEPTH = std::numeric_limits<std::size_t>::max( );
+
+        struct Root
+        {
+            RegistryHive hive;
+            std::wstring path;
+            std::size_t maxDepth = UNLIMITED_DEPTH;   // Deepest level indexed below the root
+        };
+
+        struct Key
+        {
+            RegistryHive hive;
+            std::wstring path;
+        };
+
+        // One criterion of a query. A query matches the keys that meet all of its criteria.
+        struct Condition
+        {
+            enum class Kind
+            {
+                Exists,           // The value is present
+                Equals,           // The whole value is operand
+                Contains,         // The value contains operand
+                VersionLess,      // The value is a dotted version lower than operand
+                VersionAtLeast    // The value is a dotted version not lower than operand
+            };
+
+            Kind kind;
+            std::optional<std::wstring> valueName;    // Any value of the key when not set ("" is the default value)
+            std::wstring operand;
+
+            static Condition exists(std::wstring valueName)
+            {
+                return { Kind::Exists, std::move(valueName), { } };
+            }
+
+            static Condition equals(std::wstring valueName, std::wstring value)
+            {
+                return { Kind::Equals, std::move(valueName), std::move(value) };
+            }
+
+            static Condition contains(std::wstring valueName, std::wstring text)
+            {
+                return { Kind::Contains, std::move(valueName), std::move(text) };
+            }
+
+            static Condition anyValueContains(std::wstring text)
+            {
+                return { Kind::Contains, std::nullopt, std::move(text) };
+            }
+
+            static Condition versionLess(std::wstring valueName, std::wstring version)
+            {
+                return { Kind::VersionLess, std::move(valueName), std::move(version) };
+            }
+
+            static Condition versionAtLeast(std::wstring valueName, std::wstring version)
+            {
+                return { Kind::VersionAtLeast, std::move(valueName), std::move(version) };
+            }
+        };
+
+        // Walks every root once, with up to workerCount threads (0 selects one per hardware thread),
+        // and indexes the values of every key. Keys are numbered in root order, then in pre-order.
+        static RegistryValueIndex build(const IRegistryAccess& registry, std::span<const Root> roots, std::size_t workerCount = 0)
+        {
+            struct KeyValues
+            {
+                std::wstring path;
+                std::vector<RegistryValue> values;
+            };
+            using Scanner = ParallelRegistryScanner<KeyValues>;
+
+            std::vector<typename Scanner::Root> scanRoots;
+            scanRoots.reserve(roots.size( ));
+            for (const auto& root : roots)
+            {
+                scanRoots.push_back({
+                    .key = registry.openKey(root.hive, root.path),
+                    .path = root.path,
+                    .visitor = [](const std::wstring& path, const IRegistryKey& key, std::size_t) -> std::optional<KeyValues>
+                    {
+                        return KeyValues{ path, key.enumerateValues( ) };
+                    },
+                    .maxDepth = root.maxDepth,
+                    .selector = nullptr });
+            }
+
+            Scanner scanner(workerCount);
+            auto results = scanner.scan(std::move(scanRoots));
+
+            RegistryValueIndex index;
+            for (std::size_t i = 0; i < results.size( ); ++i)
+            {
+                for (auto& key : results[i].matches)
+                {
+                    index.add(roots[i].hive, std::move(key.path), key.values);
+                }
+            }
+            return index;
+        }
+
+        // Indexes one more key, e.g. from a scan that reads the values anyway
+        KeyId add(RegistryHive hive, std::wstring path, std::span<const RegistryValue> values)
+        {
+            const auto keyId = static_cast<KeyId>(m_keys.size( ));
+            m_keys.push_back({ hive, std::move(path) });
+
+            for (const auto& value : values)
+            {
+                const std::uint32_t nameId = internName(value.name);
+                switch (value.type)
+                {
+                    case REG_SZ_TYPE:
+                    case REG_EXPAND_SZ_TYPE:
+                        addValue(keyId, nameId, trimNulls(decodeUtf16(value.data)));
+                        break;
+
+                    case REG_MULTI_SZ_TYPE:
+                    {
+                        const std::wstring strings = decodeUtf16(value.data);
+                        std::wstring_view rest = strings;
+                        while (!rest.empty( ))
+                        {
+                            const auto end = rest.find(L'\0');
+                            if (end != 0)
+                            {
+                                addValue(keyId, nameId, std::wstring(rest.substr(0, end)));
+                            }
+                            rest = (end == std::wstring_view::npos) ? std::wstring_view{ } : rest.substr(end + 1);
+                        }
+                        break;
+                    }
+
+                    case REG_DWORD_TYPE:
+                        if (value.data.size( ) >= 4)
+                        {
+                            const std::uint32_t number = value.data[0] | (value.data[1] << 8) | (value.data[2] << 16) |
+                                                         (static_cast<std::uint32_t>(value.data[3]) << 24);
+                            addValue(keyId, nameId, std::to_wstring(number));
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+            return keyId;
+        }
+
+        // Keys meeting every condition, in key order. No condition matches every key.
+        std::vector<KeyId> find(std::span<const Condition> conditions) const
+        {
+            if (conditions.empty( ))
+            {
+                std::vector<KeyId> keys(m_keys.size( ));
+                std::iota(keys.begin( ), keys.end( ), KeyId{ 0 });
+                return keys;
+            }
+
+            std::vector<KeyId> keys = findKeys(conditions.front( ));
+            for (const auto& condition : conditions.subspan(1))
+            {
+                if (keys.empty( ))
+                {
+                    break;
+                }
+
+                const auto matching = findKeys(condition);
+
+                std::vector<KeyId> both;
+                std::set_intersection(keys.begin( ), keys.end( ), matching.begin( ), matching.end( ), std::back_inserter(both));
+                keys = std::move(both);
+            }
+            return keys;
+        }
+
+        std::vector<KeyId> find(std::initializer_list<Condition> conditions) const
+        {
+            return find(std::span<const Condition>(conditions.begin( ), conditions.size( )));
+        }
+
+        const Key& getKey(KeyId keyId) const noexcept
+        {
+            return m_keys[keyId];
+        }
+
+        // First indexed value of that name of the key (as text), nullopt when it has none
+        std::optional<std::wstring_view> getValue(KeyId keyId, std::wstring_view valueName) const
+        {
+            const auto name = m_names.find(fold(valueName));
+            if (name == m_names.end( ))
+            {
+                return std::nullopt;
+            }
+
+            const auto& values = m_valuesByName[name->second];
+            const auto it = std::lower_bound(values.begin( ), values.end( ), keyId, [this](ValueId valueId, KeyId key)
+            {
+                return m_values[valueId].key < key;
+            });
+            if (it == values.end( ) || m_values[*it].key != keyId)
+            {
+                return std::nullopt;
+            }
+            return m_values[*it].text;
+        }
+
+        std::size_t getKeyCount( ) const noexcept
+        {
+            return m_keys.size( );
+        }
+
+        std::size_t getValueCount( ) const noexcept
+        {
+            return m_values.size( );
+        }
+
+        std::size_t getWordCount( ) const noexcept
+        {
+            return m_valuesByWord.size( );
+        }
+
+    private:
+        using ValueId = std::uint32_t;
+
+        static constexpr std::uint32_t REG_SZ_TYPE = 1;
+        static constexpr std::uint32_t REG_EXPAND_SZ_TYPE = 2;
+        static constexpr std::uint32_t REG_DWORD_TYPE = 4;
+        static constexpr std::uint32_t REG_MULTI_SZ_TYPE = 7;
+
+        struct IndexedValue
+        {
+            KeyId key;
+            std::uint32_t name;
+            std::wstring text;
+            std::wstring folded;
+        };
+
+        std::vector<Key> m_keys;
+        std::vector<IndexedValue> m_values;                                    // In key order
+        std::unordered_map<std::wstring, std::uint32_t> m_names;               // Folded value name -> id
+        std::vector<std::vector<ValueId>> m_valuesByName;                      // By name id
+        std::unordered_map<std::wstring, std::vector<ValueId>> m_valuesByText; // Folded whole value
+        std::unordered_map<std::wstring, std::vector<ValueId>> m_valuesByWord; // Folded word
+
+        static std::wstring fold(std::wstring_view text)
+        {
+            std::wstring folded(text);
+            for (auto& ch : folded)
+            {
+                ch = Text::foldCase(ch);
+            }
+            return folded;
+        }
+
+        // Words are runs of letters and digits; any other ASCII character separates them
+        static bool isSeparator(wchar_t ch) noexcept
+        {
+            return ch < 0x80 && !((ch >= L'0' && ch <= L'9') || (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z'));
+        }
+
+        template<typename Callback>
+        static void forEachWord(std::wstring_view text, Callback&& callback)
+        {
+            std::size_t start = 0;
+            for (std::size_t i = 0; i <= text.size( ); ++i)
+            {
+                if (i == text.size( ) || isSeparator(text[i]))
+                {
+                    if (i > start)
+                    {
+                        // The flags tell whether the word is bounded on each side within text
+                        callback(text.substr(start, i - start), start > 0, i < text.size( ));
+                    }
+                    start = i + 1;
+                }
+            }
+        }
+
+        static std::wstring decodeUtf16(const std::vector<std::uint8_t>& data)
+        {
+            std::wstring text;
+            text.reserve(data.size( ) / 2);
+            for (std::size_t i = 0; i + 1 < data.size( ); i += 2)
+            {
+                const std::uint32_t unit = data[i] | (data[i + 1] << 8);
+                if constexpr (sizeof(wchar_t) == 4)
+                {
+                    if (unit >= 0xD800 && unit <= 0xDBFF && i + 3 < data.size( ))
+                    {
+                        const std::uint32_t low = data[i + 2] | (data[i + 3] << 8);
+                        if (low >= 0xDC00 && low <= 0xDFFF)
+                        {
+                            text.push_back(static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00)));
+                            i += 2;
+                            continue;
+                        }
+                    }
+                }
+                text.push_back(static_cast<wchar_t>(unit));
+            }
+            return text;
+        }
+
+        static std::wstring trimNulls(std::wstring text)
+        {
+            if (const auto end = text.find(L'\0'); end != std::wstring::npos)
+            {
+                text.resize(end);
+            }
+            return text;
+        }
+
+        std::uint32_t internName(std::wstring_view name)
+        {
+            const auto [it, inserted] = m_names.try_emplace(fold(name), static_cast<std::uint32_t>(m_valuesByName.size( )));
+            if (inserted)
+            {
+                m_valuesByName.emplace_back( );
+            }
+            return it->second;
+        }
+
+        void addValue(KeyId keyId, std::uint32_t nameId, std::wstring text)
+        {
+            const auto valueId = static_cast<ValueId>(m_values.size( ));
+            std::wstring folded = fold(text);
+
+            m_valuesByName[nameId].push_back(valueId);
+            m_valuesByText[folded].push_back(valueId);
+            forEachWord(folded, [&](std::wstring_view word, bool, bool)
+            {
+                auto& values = m_valuesByWord[std::wstring(word)];
+                if (values.empty( ) || values.back( ) != valueId)
+                {
+                    values.push_back(valueId);
+                }
+            });
+
+            m_values.push_back({ keyId, nameId, std::move(text), std::move(folded) });
+        }
+
+        // Values the condition may hold for, in value order; the condition itself is checked by the caller
+        std::vector<ValueId> candidates(const Condition& condition, std::optional<std::uint32_t> nameId) const
+        {
+            if (condition.kind == Condition::Kind::Equals)
+            {
+                const auto it = m_valuesByText.find(fold(condition.operand));
+                return it != m_valuesByText.end( ) ? it->second : std::vector<ValueId>{ };
+            }
+
+            if (condition.kind == Condition::Kind::Contains)
+            {
+                // Only the words with a separator on both sides are whole words of the values that match;
+                // the first and the last may be parts of longer ones
+                std::optional<std::vector<ValueId>> values;
+                bool missing = false;
+                forEachWord(fold(condition.operand), [&](std::wstring_view word, bool boundedBefore, bool boundedAfter)
+                {
+                    if (missing || !boundedBefore || !boundedAfter)
+                    {
+                        return;
+                    }
+
+                    const auto it = m_valuesByWord.find(std::wstring(word));
+                    if (it == m_valuesByWord.end( ))
+                    {
+                        missing = true;
+                        return;
+                    }
+                    if (!values)
+                    {
+                        values = it->second;
+                        return;
+                    }
+
+                    std::vector<ValueId> both;
+                    std::set_intersection(values->begin( ), values->end( ), it->second.begin( ), it->second.end( ), std::back_inserter(both));
+                    *values = std::move(both);
+                });
+
+                if (missing)
+                {
+                    return { };
+                }
+                if (values)
+                {
+                    return std::move(*values);
+                }
+            }
+
+            if (nameId)
+            {
+                return m_valuesByName[*nameId];
+            }
+
+            std::vector<ValueId> all(m_values.size( ));
+            std::iota(all.begin( ), all.end( ), ValueId{ 0 });
+            return all;
+        }
+
+        std::vector<KeyId> findKeys(const Condition& condition) const
+        {
+            std::optional<std::uint32_t> nameId;
+            if (condition.valueName)
+            {
+                const auto it = m_names.find(fold(*condition.valueName));
+                if (it == m_names.end( ))
+                {
+                    return { };
+                }
+                nameId = it->second;
+            }
+
+            const std::wstring operand = fold(condition.operand);
+            const auto version = parseVersion(operand);
+
+            std::vector<KeyId> keys;
+            for (const ValueId valueId : candidates(condition, nameId))
+            {
+                const IndexedValue& value = m_values[valueId];
+                if ((nameId && value.name != *nameId) || (!keys.empty( ) && keys.back( ) == value.key))
+                {
+                    continue;
+                }
+
+                bool matches = false;
+                switch (condition.kind)
+                {
+                    case Condition::Kind::Exists:
+                        matches = true;
+                        break;
+
+                    case Condition::Kind::Equals:
+                        matches = value.folded == operand;
+                        break;
+
+                    case Condition::Kind::Contains:
+                        matches = value.folded.find(operand) != std::wstring::npos;
+                        break;
+
+                    case Condition::Kind::VersionLess:
+                    case Condition::Kind::VersionAtLeast:
+                        if (const auto valueVersion = parseVersion(value.folded); valueVersion && version)
+                        {
+                            const bool less = compareVersions(*valueVersion, *version) < 0;
+                            matches = (condition.kind == Condition::Kind::VersionLess) ? less : !less;
+                        }
+                        break;
+                }
+
+                if (matches)
+                {
+                    keys.push_back(value.key);
+                }
+            }
+            return keys;
+        }
+
+        // "4.1.2" -> { 4, 1, 2 }; nullopt unless the text starts with a number
+        static std::optional<std::vector<std::uint32_t>> parseVersion(std::wstring_view text)
+        {
+            std::vector<std::uint32_t> parts;
+            std::size_t i = 0;
+            while (i < text.size( ) && text[i] >= L'0' && text[i] <= L'9')
+            {
+                std::uint32_t part = 0;
+                for (; i < text.size( ) && text[i] >= L'0' && text[i] <= L'9'; ++i)
+                {
+                    part = part * 10 + static_cast<std::uint32_t>(text[i] - L'0');
+                }
+                parts.push_back(part);
+
+                if (i + 1 >= text.size( ) || text[i] != L'.')
+                {
+                    break;
+                }
+                ++i;
+            }
+            return parts.empty( ) ? std::nullopt : std::make_optional(std::move(parts));
+        }
+
+        // Missing parts count as zero: 4 == 4.0.0
+        static int compareVersions(const std::vector<std::uint32_t>& lhs, const std::vector<std::uint32_t>& rhs) noexcept
+        {
+            for (std::size_t i = 0; i < std::max(lhs.size( ), rhs.size( )); ++i)
+            {
+                const std::uint32_t left = i < lhs.size( ) ? lhs[i] : 0;
+                const std::uint32_t right = i < rhs.size( ) ? rhs[i] : 0;
+                if (left != right)
+                {
+                    return left < right ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+    };
+}
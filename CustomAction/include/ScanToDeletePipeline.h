@@ -0,0 +1,126 @@
+#pragma once
+
+#include <span>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "BoundedQueue.h"
+#include "ParallelRegistryScanner.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Deletes the matches of a registry scan while the scan goes on, with bounded memory. The scan runs
+    // on a thread of its own and feeds a bounded queue; the calling thread empties it in batches, so only
+    // that thread removes (and logs). A full queue holds the scan workers back. If the deletion stage
+    // throws, the queue is closed and the scan stops at its next match; if the scan throws, what was
+    // already queued is still removed.
+    // Matches the scan still descends below are not queued (see forward): deleting them would pull the
+    // subtree from under the workers, so they come back with the scan results and are removed, in walk
+    // order, once the scan is over.
+    template<typename Entry>
+    class ScanToDeletePipeline
+    {
+    public:
+        using Scanner = ParallelRegistryScanner<Entry>;
+        using Sink = std::function<void(const Entry&)>;
+
+        // Runs the scan, handing the matches it does not return to sink
+        using Scan = std::function<std::vector<typename Scanner::RootResult>(const Sink& sink)>;
+
+        // Removes a batch of entries; false when one of them could not be removed
+        using Remove = std::function<bool(std::span<const Entry> entries)>;
+
+        struct Result
+        {
+            bool removed = true;                // Every remove call succeeded
+            std::size_t entryCount = 0;         // Entries handed to remove
+            std::size_t heldBackCount = 0;      // Of which removed after the scan
+            std::size_t keysVisited = 0;
+            std::exception_ptr scanError;       // Set when the scan stopped
+            std::exception_ptr removeError;     // Set when the deletion stage stopped; nothing was held back
+            typename Threading::BoundedQueue<Entry>::Statistics queue;
+        };
+
+        explicit ScanToDeletePipeline(std::size_t capacity) : m_capacity(capacity) {}
+
+        Result run(const Scan& scan, const Remove& remove) const
+        {
+            Threading::BoundedQueue<Entry> queue(m_capacity);
+            std::vector<typename Scanner::RootResult> scanResults;
+            Result result;
+
+            std::thread scanner([&]
+            {
+                try
+                {
+                    scanResults = scan([&queue](const Entry& entry)
+                    {
+                        if (!queue.push(entry))
+                        {
+                            throw std::runtime_error("Registry deletion stage stopped");
+                        }
+                    });
+                }
+                catch (...)
+                {
+                    result.scanError = std::current_exception( );
+                }
+                queue.close( );
+            });
+
+            try
+            {
+                std::vector<Entry> batch;
+                while (queue.popAll(batch))
+                {
+                    result.entryCount += batch.size( );
+                    result.removed = remove(batch) && result.removed;
+                }
+            }
+            catch (...)
+            {
+                queue.close( );
+                result.removeError = std::current_exception( );
+                result.removed = false;
+            }
+            scanner.join( );
+
+            // No scan worker is left below the held back matches
+            std::vector<Entry> heldBack;
+            for (const auto& rootResult : scanResults)
+            {
+                heldBack.insert(heldBack.end( ), rootResult.matches.begin( ), rootResult.matches.end( ));
+                result.keysVisited += rootResult.keysVisited;
+            }
+            if (!heldBack.empty( ) && !result.removeError)
+            {
+                result.heldBackCount = heldBack.size( );
+                result.entryCount += heldBack.size( );
+                result.removed = remove(heldBack) && result.removed;
+            }
+
+            result.queue = queue.getStatistics( );
+            return result;
+        }
+
+        // Visitor side: hands a match to sink, if any, unless the scan goes on below it (subtreeScanned);
+        // such matches are returned with the scan results instead
+        static std::optional<Entry> forward(std::optional<Entry> entry, const Sink& sink, bool subtreeScanned)
+        {
+            if (entry && sink && !subtreeScanned)
+            {
+                sink(*entry);
+                return std::nullopt;
+            }
+            return entry;
+        }
+
+    private:
+        const std::size_t m_capacity;
+    };
+}
@@ -0,0 +1,523 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+#include "CaseFolding.h"
+
+namespace WinLogon::CustomActions::Snapshot
+{
+    enum class ItemKind : std::uint8_t
+    {
+        RegistryKey = 1,
+        RegistryValue = 2,
+        Directory = 3,
+        File = 4
+    };
+
+    constexpr std::wstring_view toString(ItemKind kind) noexcept
+    {
+        switch (kind)
+        {
+            case ItemKind::RegistryKey:
+                return L"key";
+
+            case ItemKind::RegistryValue:
+                return L"value";
+
+            case ItemKind::Directory:
+                return L"directory";
+
+            case ItemKind::File:
+                return L"file";
+
+            default:
+                return L"item";
+        }
+    }
+
+    // One captured registry key, registry value, directory or file. Paths are backslash separated
+    // on every platform; registry paths start with the hive name (HKEY_LOCAL_MACHINE\...).
+    struct SnapshotItem
+    {
+        ItemKind kind = ItemKind::RegistryKey;
+        std::wstring path;         // Full path; for values, the path of their key
+        std::wstring name;         // Value name, empty for the other kinds
+        std::uint32_t type = 0;    // Value type (REG_SZ, ...)
+        std::uint64_t size = 0;    // Size of the value data or of the file
+        std::uint64_t digest = 0;  // FNV-1a of the value data, last write time of the file
+
+        // Path as shown to users, "key:value" for values
+        std::wstring getDisplayPath( ) const
+        {
+            if (kind != ItemKind::RegistryValue)
+            {
+                return path;
+            }
+            return path + L":" + (name.empty( ) ? std::wstring(L"(Default)") : name);
+        }
+    };
+
+    // Paths are ordered component by component, case-insensitively, so a key or a directory comes
+    // right before everything below it: a depth-first walk visiting children sorted by name produces
+    // items in this order, and two such streams can be merged.
+    constexpr int comparePaths(std::wstring_view lhs, std::wstring_view rhs) noexcept
+    {
+        const auto orderOf = [](wchar_t ch) noexcept
+        {
+            return ch == L'\\' ? 0u : static_cast<std::uint32_t>(Text::foldCase(ch)) + 1;
+        };
+
+        const std::size_t length = std::min(lhs.size( ), rhs.size( ));
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            const std::uint32_t left = orderOf(lhs[i]);
+            const std::uint32_t right = orderOf(rhs[i]);
+            if (left != right)
+            {
+                return left < right ? -1 : 1;
+            }
+        }
+
+        if (lhs.size( ) == rhs.size( ))
+        {
+            return 0;
+        }
+        return lhs.size( ) < rhs.size( ) ? -1 : 1;
+    }
+
+    // Snapshot order: by path, a key before its values, values by name
+    constexpr int compareItems(const SnapshotItem& lhs, const SnapshotItem& rhs) noexcept
+    {
+        if (const int order = comparePaths(lhs.path, rhs.path); order != 0)
+        {
+            return order;
+        }
+        if (lhs.kind != rhs.kind)
+        {
+            return lhs.kind < rhs.kind ? -1 : 1;
+        }
+        if (Text::lessIgnoreCase(lhs.name, rhs.name))
+        {
+            return -1;
+        }
+        return Text::lessIgnoreCase(rhs.name, lhs.name) ? 1 : 0;
+    }
+
+    // FNV-1a, used as the digest of registry value data
+    constexpr std::uint64_t computeDigest(const std::uint8_t* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull) noexcept
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Binary snapshot file:
+    //   header   "WLSN", format version (u32)
+    //   items    kind (u8), path as the number of UTF-16 units shared with the previous path followed by
+    //            the rest, name, then type, size (varints) and digest (u64)
+    //   trailer  kind 0, item count
+    // Integers are little-endian, counts and lengths LEB128 varints, texts UTF-16 so snapshots taken on
+    // Windows can be read anywhere. Items must be written in snapshot order (see compareItems): sibling
+    // paths then share most of their text, and a diff is a single merge of the two files.
+    class SnapshotFormat
+    {
+    protected:
+        static constexpr std::array<char, 4> FILE_MAGIC = { 'W', 'L', 'S', 'N' };
+        static constexpr std::uint32_t FILE_VERSION = 1;
+        static constexpr std::uint8_t END_OF_ITEMS = 0;
+
+        // Longest text accepted when reading, protects against corrupted lengths
+        static constexpr std::uint64_t MAX_TEXT_LENGTH = 1 << 20;
+
+        static std::u16string toUtf16(std::wstring_view text)
+        {
+            if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+            {
+                return std::u16string(text.begin( ), text.end( ));
+            }
+            else
+            {
+                std::u16string result;
+                result.reserve(text.size( ));
+                for (const wchar_t ch : text)
+                {
+                    const auto codePoint = static_cast<std::uint32_t>(ch);
+                    if (codePoint >= 0x10000)
+                    {
+                        result.push_back(static_cast<char16_t>(0xD800 + ((codePoint - 0x10000) >> 10)));
+                        result.push_back(static_cast<char16_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+                    }
+                    else
+                    {
+                        result.push_back(static_cast<char16_t>(codePoint));
+                    }
+                }
+                return result;
+            }
+        }
+
+        static std::wstring fromUtf16(std::u16string_view text)
+        {
+            if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+            {
+                return std::wstring(text.begin( ), text.end( ));
+            }
+            else
+            {
+                std::wstring result;
+                result.reserve(text.size( ));
+                for (std::size_t i = 0; i < text.size( ); ++i)
+                {
+                    const char32_t unit = text[i];
+                    if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < text.size( ) && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+                    {
+                        result.push_back(static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (text[i + 1] - 0xDC00)));
+                        ++i;
+                        continue;
+                    }
+                    result.push_back(static_cast<wchar_t>(unit));
+                }
+                return result;
+            }
+        }
+    };
+
+    // Streams items into a snapshot file. Only the previous item is kept in memory.
+    class SnapshotWriter : private SnapshotFormat
+    {
+    public:
+        explicit SnapshotWriter(std::ostream& stream) : m_stream(stream)
+        {
+            m_stream.write(FILE_MAGIC.data( ), FILE_MAGIC.size( ));
+            writeFixed(FILE_VERSION);
+        }
+
+        void write(const SnapshotItem& item)
+        {
+            if (m_itemCount != 0 && compareItems(m_previous, item) >= 0)
+            {
+                throw std::logic_error("Snapshot items must be written in snapshot order");
+            }
+
+            const std::u16string path = toUtf16(item.path);
+            const auto shared = static_cast<std::size_t>(
+                std::mismatch(path.begin( ), path.end( ), m_previousPath.begin( ), m_previousPath.end( )).first - path.begin( ));
+
+            m_stream.put(static_cast<char>(item.kind));
+            writeVarint(shared);
+            writeText(std::u16string_view(path).substr(shared));
+            writeText(toUtf16(item.name));
+            writeVarint(item.type);
+            writeVarint(item.size);
+            writeFixed(item.digest);
+
+            m_previousPath = path;
+            m_previous = item;
+            ++m_itemCount;
+        }
+
+        // Writes the trailer; the file is incomplete (and rejected by readers) without it
+        void finish( )
+        {
+            m_stream.put(static_cast<char>(END_OF_ITEMS));
+            writeVarint(m_itemCount);
+            m_stream.flush( );
+            if (!m_stream)
+            {
+                throw std::runtime_error("Failed to write the snapshot");
+            }
+        }
+
+        std::uint64_t getItemCount( ) const noexcept
+        {
+            return m_itemCount;
+        }
+
+    private:
+        std::ostream& m_stream;
+        std::u16string m_previousPath;
+        SnapshotItem m_previous;
+        std::uint64_t m_itemCount = 0;
+
+        template<typename T>
+        void writeFixed(T value)
+        {
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                m_stream.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+            }
+        }
+
+        void writeVarint(std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_stream.put(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            m_stream.put(static_cast<char>(value));
+        }
+
+        void writeText(std::u16string_view text)
+        {
+            writeVarint(text.size( ));
+            for (const char16_t unit : text)
+            {
+                writeFixed(static_cast<std::uint16_t>(unit));
+            }
+        }
+    };
+
+    // Streams items back from a snapshot file, checking their order. Throws std::runtime_error on
+    // foreign, truncated or corrupted files.
+    class SnapshotReader : private SnapshotFormat
+    {
+    public:
+        explicit SnapshotReader(std::istream& stream) : m_stream(stream)
+        {
+            std::array<char, 4> magic{ };
+            m_stream.read(magic.data( ), magic.size( ));
+            if (!m_stream || magic != FILE_MAGIC || readFixed<std::uint32_t>( ) != FILE_VERSION)
+            {
+                throw std::runtime_error("Not a snapshot file");
+            }
+        }
+
+        // Reads the next item into item; false once all items were read
+        bool next(SnapshotItem& item)
+        {
+            if (m_finished)
+            {
+                return false;
+            }
+
+            const std::uint8_t kind = readFixed<std::uint8_t>( );
+            if (kind == END_OF_ITEMS)
+            {
+                if (readVarint( ) != m_itemCount)
+                {
+                    throw std::runtime_error("Corrupted snapshot: item count mismatch");
+                }
+                m_finished = true;
+                return false;
+            }
+            if (kind > static_cast<std::uint8_t>(ItemKind::File))
+            {
+                throw std::runtime_error("Corrupted snapshot: unknown item kind");
+            }
+
+            const std::uint64_t shared = readVarint( );
+            if (shared > m_path.size( ))
+            {
+                throw std::runtime_error("Corrupted snapshot: invalid path prefix");
+            }
+            m_path.resize(static_cast<std::size_t>(shared));
+            readText(m_path);
+
+            m_name.clear( );
+            readText(m_name);
+
+            item.kind = static_cast<ItemKind>(kind);
+            item.path = fromUtf16(m_path);
+            item.name = fromUtf16(m_name);
+            item.type = static_cast<std::uint32_t>(readVarint( ));
+            item.size = readVarint( );
+            item.digest = readFixed<std::uint64_t>( );
+
+            if (m_itemCount != 0 && compareItems(m_previous, item) >= 0)
+            {
+                throw std::runtime_error("Corrupted snapshot: items out of order");
+            }
+            m_previous = item;
+            ++m_itemCount;
+            return true;
+        }
+
+    private:
+        std::istream& m_stream;
+        std::u16string m_path;
+        std::u16string m_name;
+        SnapshotItem m_previous;
+        std::uint64_t m_itemCount = 0;
+        bool m_finished = false;
+
+        std::uint8_t readByte( )
+        {
+            const auto ch = m_stream.get( );
+            if (ch == std::istream::traits_type::eof( ))
+            {
+                throw std::runtime_error("Corrupted snapshot: unexpected end of file");
+            }
+            return static_cast<std::uint8_t>(ch);
+        }
+
+        template<typename T>
+        T readFixed( )
+        {
+            T value = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                value |= static_cast<T>(static_cast<T>(readByte( )) << (i * 8));
+            }
+            return value;
+        }
+
+        std::uint64_t readVarint( )
+        {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7)
+            {
+                const std::uint8_t byte = readByte( );
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            throw std::runtime_error("Corrupted snapshot: invalid number");
+        }
+
+        // Appends a length-prefixed text to text
+        void readText(std::u16string& text)
+        {
+            const std::uint64_t length = readVarint( );
+            if (length > MAX_TEXT_LENGTH)
+            {
+                throw std::runtime_error("Corrupted snapshot: text too long");
+            }
+            for (std::uint64_t i = 0; i < length; ++i)
+            {
+                text.push_back(static_cast<char16_t>(readFixed<std::uint16_t>( )));
+            }
+        }
+    };
+
+    enum class ChangeKind
+    {
+        Added,
+        Removed,
+        Changed
+    };
+
+    constexpr std::wstring_view toString(ChangeKind kind) noexcept
+    {
+        switch (kind)
+        {
+            case ChangeKind::Added:
+                return L"added";
+
+            case ChangeKind::Removed:
+                return L"removed";
+
+            case ChangeKind::Changed:
+                return L"changed";
+
+            default:
+                return L"unknown";
+        }
+    }
+
+    // Difference between two snapshots: one item (removed/added), or both versions of it (changed)
+    struct Change
+    {
+        ChangeKind kind;
+        const SnapshotItem* before;   // Null for added items
+        const SnapshotItem* after;    // Null for removed items
+
+        const SnapshotItem& item( ) const noexcept
+        {
+            return after ? *after : *before;
+        }
+
+        // e.g. "removed key HKEY_LOCAL_MACHINE\SOFTWARE\WatchGuard\Logon App"
+        std::wstring toString( ) const
+        {
+            return std::wstring(Snapshot::toString(kind)) + L" " + std::wstring(Snapshot::toString(item( ).kind)) + L" " +
+                   item( ).getDisplayPath( );
+        }
+    };
+
+    // Compares two snapshots in one pass over both, holding a single item of each in memory
+    class SnapshotDiff
+    {
+    public:
+        struct Statistics
+        {
+            std::size_t added = 0;
+            std::size_t removed = 0;
+            std::size_t changed = 0;
+            std::size_t unchanged = 0;
+        };
+
+        using ChangeHandler = std::function<void(const Change&)>;
+
+        static Statistics diff(SnapshotReader& before, SnapshotReader& after, const ChangeHandler& onChange)
+        {
+            Statistics statistics;
+            SnapshotItem beforeItem, afterItem;
+            bool hasBefore = before.next(beforeItem);
+            bool hasAfter = after.next(afterItem);
+
+            while (hasBefore || hasAfter)
+            {
+                const int order = !hasAfter ? -1 : (!hasBefore ? 1 : compareItems(beforeItem, afterItem));
+                if (order < 0)
+                {
+                    ++statistics.removed;
+                    onChange({ ChangeKind::Removed, &beforeItem, nullptr });
+                    hasBefore = before.next(beforeItem);
+                }
+                else if (order > 0)
+                {
+                    ++statistics.added;
+                    onChange({ ChangeKind::Added, nullptr, &afterItem });
+                    hasAfter = after.next(afterItem);
+                }
+                else
+                {
+                    if (beforeItem.type != afterItem.type || beforeItem.size != afterItem.size || beforeItem.digest != afterItem.digest)
+                    {
+                        ++statistics.changed;
+                        onChange({ ChangeKind::Changed, &beforeItem, &afterItem });
+                    }
+                    else
+                    {
+                        ++statistics.unchanged;
+                    }
+                    hasBefore = before.next(beforeItem);
+                    hasAfter = after.next(afterItem);
+                }
+            }
+
+            return statistics;
+        }
+
+        static Statistics diffFiles(const std::filesystem::path& beforeFile, const std::filesystem::path& afterFile,
+                                    const ChangeHandler& onChange)
+        {
+            std::ifstream beforeStream(beforeFile, std::ios::binary);
+            std::ifstream afterStream(afterFile, std::ios::binary);
+            if (!beforeStream || !afterStream)
+            {
+                throw std::runtime_error("Failed to open a snapshot file");
+            }
+
+            SnapshotReader before(beforeStream);
+            SnapshotReader after(afterStream);
+            return diff(before, after, onChange);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include "Snapshot.h"
+#include "CaseFolding.h"
+#include "IRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Snapshot
+{
+    // Registry subtree or file system path (file or directory) to capture
+    struct SnapshotRoot
+    {
+        enum class Kind
+        {
+            Registry,
+            FileSystem
+        };
+
+        Kind kind;
+        Registry::RegistryHive hive;   // Registry roots only
+        std::wstring path;             // Key path relative to the hive, or file system path
+
+        static SnapshotRoot registryKey(Registry::RegistryHive hive, std::wstring path)
+        {
+            return { Kind::Registry, hive, std::move(path) };
+        }
+
+        static SnapshotRoot fileSystemPath(std::wstring path)
+        {
+            return { Kind::FileSystem, Registry::RegistryHive::LocalMachine, std::move(path) };
+        }
+
+        // Path of the root item in the snapshot
+        std::wstring getSnapshotPath( ) const
+        {
+            std::wstring snapshotPath;
+            if (kind == Kind::Registry)
+            {
+                snapshotPath = Registry::toString(hive);
+                if (!path.empty( ))
+                {
+                    snapshotPath.push_back(L'\\');
+                }
+            }
+            snapshotPath.append(path);
+
+            std::replace(snapshotPath.begin( ), snapshotPath.end( ), L'/', L'\\');
+            while (snapshotPath.size( ) > 1 && snapshotPath.back( ) == L'\\')
+            {
+                snapshotPath.pop_back( );
+            }
+            return snapshotPath;
+        }
+    };
+
+    // Walks registry subtrees and directories depth first, children sorted by name, and streams what it
+    // finds to a SnapshotWriter. Memory is bounded by the sibling lists along the current path.
+    class SnapshotCapture
+    {
+    public:
+        struct Statistics
+        {
+            std::size_t keys = 0;
+            std::size_t values = 0;
+            std::size_t directories = 0;
+            std::size_t files = 0;
+            std::size_t missingRoots = 0;   // Roots that do not exist (they are simply absent from the snapshot)
+            std::size_t errors = 0;         // Keys, directories or files that could not be read
+        };
+
+        explicit SnapshotCapture(std::shared_ptr<const Registry::IRegistryAccess> registry) : m_registry(std::move(registry)) {}
+
+        // Roots below another root are captured once, with the outer one
+        Statistics capture(std::vector<SnapshotRoot> roots, SnapshotWriter& writer) const
+        {
+            std::sort(roots.begin( ), roots.end( ), [](const SnapshotRoot& lhs, const SnapshotRoot& rhs)
+            {
+                return comparePaths(lhs.getSnapshotPath( ), rhs.getSnapshotPath( )) < 0;
+            });
+
+            Statistics statistics;
+            std::wstring previousRoot;
+            for (const auto& root : roots)
+            {
+                std::wstring path = root.getSnapshotPath( );
+                if (!previousRoot.empty( ) && isSameOrBelow(path, previousRoot))
+                {
+                    continue;
+                }
+                previousRoot = path;
+
+                if (root.kind == SnapshotRoot::Kind::Registry)
+                {
+                    captureRegistryRoot(root, path, writer, statistics);
+                }
+                else
+                {
+                    captureFileSystemRoot(root, path, writer, statistics);
+                }
+            }
+
+            return statistics;
+        }
+
+    private:
+        std::shared_ptr<const Registry::IRegistryAccess> m_registry;
+
+        static bool isSameOrBelow(std::wstring_view path, std::wstring_view ancestor) noexcept
+        {
+            if (path.size( ) < ancestor.size( ) || comparePaths(path.substr(0, ancestor.size( )), ancestor) != 0)
+            {
+                return false;
+            }
+            return path.size( ) == ancestor.size( ) || path[ancestor.size( )] == L'\\';
+        }
+
+        static void sortNames(std::vector<std::wstring>& names)
+        {
+            std::sort(names.begin( ), names.end( ), Text::CaseInsensitiveLess{ });
+        }
+
+        void captureRegistryRoot(const SnapshotRoot& root, std::wstring& path, SnapshotWriter& writer, Statistics& statistics) const
+        {
+            auto key = m_registry->openKey(root.hive, root.path);
+            if (!key)
+            {
+                ++statistics.missingRoots;
+                return;
+            }
+            captureKey(*key, path, writer, statistics);
+        }
+
+        void captureKey(const Registry::IRegistryKey& key, std::wstring& path, SnapshotWriter& writer, Statistics& statistics) const
+        {
+            writer.write({ .kind = ItemKind::RegistryKey, .path = path, .name = { }, .type = 0, .size = 0, .digest = 0 });
+            ++statistics.keys;
+
+            auto values = key.enumerateValues( );
+            std::sort(values.begin( ), values.end( ), [](const Registry::RegistryValue& lhs, const Registry::RegistryValue& rhs)
+            {
+                return Text::lessIgnoreCase(lhs.name, rhs.name);
+            });
+            for (const auto& value : values)
+            {
+                writer.write({ .kind = ItemKind::RegistryValue, .path = path, .name = value.name, .type = value.type,
+                               .size = value.data.size( ), .digest = computeDigest(value.data.data( ), value.data.size( )) });
+                ++statistics.values;
+            }
+
+            auto subKeyNames = key.enumerateSubKeys( );
+            sortNames(subKeyNames);
+
+            const std::size_t pathLength = path.size( );
+            for (const auto& subKeyName : subKeyNames)
+            {
+                const auto subKey = key.openSubKey(subKeyName);
+                if (!subKey)
+                {
+                    // Deleted since the enumeration, or not readable
+                    ++statistics.errors;
+                    continue;
+                }
+
+                path.push_back(L'\\');
+                path.append(subKeyName);
+                captureKey(*subKey, path, writer, statistics);
+                path.resize(pathLength);
+            }
+        }
+
+        void captureFileSystemRoot(const SnapshotRoot& root, std::wstring& path, SnapshotWriter& writer, Statistics& statistics) const
+        {
+            std::error_code error;
+            const std::filesystem::path rootPath(root.path);
+            const auto status = std::filesystem::symlink_status(rootPath, error);
+            if (error || !std::filesystem::exists(status))
+            {
+                ++statistics.missingRoots;
+                return;
+            }
+
+            if (std::filesystem::is_directory(status))
+            {
+                captureDirectory(rootPath, path, writer, statistics);
+            }
+            else
+            {
+                captureFile(rootPath, path, writer, statistics);
+            }
+        }
+
+        void captureDirectory(const std::filesystem::path& directory, std::wstring& path, SnapshotWriter& writer, Statistics& statistics) const
+        {
+            writer.write({ .kind = ItemKind::Directory, .path = path, .name = { }, .type = 0, .size = 0, .digest = 0 });
+            ++statistics.directories;
+
+            struct Entry
+            {
+                std::wstring name;
+                bool isDirectory;
+            };
+
+            std::vector<Entry> entries;
+            std::error_code error;
+            for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+            {
+                try
+                {
+                    // Links are captured as files, never followed
+                    entries.push_back({ it->path( ).filename( ).wstring( ), it->is_directory( ) && !it->is_symlink( ) });
+                }
+                catch (const std::exception&)
+                {
+                    // Name not representable in the native encoding
+                    ++statistics.errors;
+                }
+            }
+            if (error)
+            {
+                ++statistics.errors;
+            }
+
+            std::sort(entries.begin( ), entries.end( ), [](const Entry& lhs, const Entry& rhs)
+            {
+                return Text::lessIgnoreCase(lhs.name, rhs.name);
+            });
+
+            const std::size_t pathLength = path.size( );
+            for (const auto& entry : entries)
+            {
+                path.push_back(L'\\');
+                path.append(entry.name);
+                if (entry.isDirectory)
+                {
+                    captureDirectory(directory / entry.name, path, writer, statistics);
+                }
+                else
+                {
+                    captureFile(directory / entry.name, path, writer, statistics);
+                }
+                path.resize(pathLength);
+            }
+        }
+
+        static void captureFile(const std::filesystem::path& file, const std::wstring& path, SnapshotWriter& writer, Statistics& statistics)
+        {
+            std::error_code error;
+            std::uint64_t size = 0;
+            if (std::filesystem::is_regular_file(file, error))
+            {
+                size = std::filesystem::file_size(file, error);
+            }
+
+            // The last write time is compared as is, in the unit of the file clock of the capturing system
+            std::uint64_t lastWriteTime = 0;
+            if (!error)
+            {
+                lastWriteTime = static_cast<std::uint64_t>(std::filesystem::last_write_time(file, error).time_since_epoch( ).count( ));
+            }
+
+            if (error)
+            {
+                ++statistics.errors;
+                size = 0;
+                lastWriteTime = 0;
+            }
+
+            writer.write({ .kind = ItemKind::File, .path = path, .name = { }, .type = 0, .size = size, .digest = lastWriteTime });
+            ++statistics.files;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string_view>
+
+#include "InstallerGuid.h"
+#include "InMemoryRegistryAccess.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Fills an InMemoryRegistryAccess with the shapes the registry strategies search, so that scans can
+    // be measured on any platform against trees the size of a real machine or terminal server:
+    //
+    //   HKLM\SOFTWARE\Microsoft\Windows\CurrentVersion\Uninstall\{code}
+    //   HKLM\SOFTWARE\Microsoft\Windows\CurrentVersion\Installer\UserData\<SID>\Products\<packed>\InstallProperties
+    //   HKLM\SOFTWARE\Microsoft\Windows\CurrentVersion\Installer\Managed\<SID>\Installer\Products\<packed>
+    //   HKLM\Software\Classes\Installer\Products\<packed>
+    //   HKU\<SID>\Software\Microsoft\Windows\CurrentVersion\Uninstall\{code}
+    //   HKU\<SID>\Software\Microsoft\Installer\Products\<packed>
+    //   HKCR\CLSID\{clsid}\InprocServer32 (or LocalServer32)
+    //
+    // The same options and seed always produce the same tree.
+    class SyntheticRegistry
+    {
+    public:
+        struct Options
+        {
+            std::size_t productCount = 1000;          // Machine-wide products
+            std::size_t sidCount = 4;                 // User SIDs, each with a hive under HKEY_USERS
+            std::size_t userProductCount = 20;        // Per-user products of each SID
+            std::size_t depth = 2;                    // Levels of sub keys below each product key
+            std::size_t fanOut = 2;                   // Sub keys per level
+            double matchDensity = 0.01;               // Share of the products named after AuthPoint/LogonApp
+            double managedDensity = 0.05;             // Share of the machine-wide products also advertised per user
+            std::size_t classCount = 0;               // COM classes under HKEY_CLASSES_ROOT\CLSID
+            double ownedClassDensity = 0.001;         // Share of the classes whose in-process server is one of ours
+            std::uint32_t seed = 1;
+        };
+
+        // What was generated, to check a scan against
+        struct Summary
+        {
+            std::size_t keyCount = 0;                 // Product keys and the sub keys below them
+            std::size_t productCount = 0;             // Products, machine-wide and per user
+            std::size_t matchingProductCount = 0;     // Products whose name matches the AuthPoint patterns
+            std::size_t expectedEntryCount = 0;       // Matching keys below HKEY_LOCAL_MACHINE, found by the AuthPoint cleanup
+            std::size_t expectedUserEntryCount = 0;   // Matching keys below HKEY_USERS, found by the per-user cleanup
+            std::size_t classCount = 0;               // COM classes
+            std::size_t ownedClassCount = 0;          // Classes served by one of our binaries, found by the COM class cleanup
+            std::vector<std::wstring> sids;
+        };
+
+        static Summary populate(InMemoryRegistryAccess& registry, const Options& options)
+        {
+            Generator generator(registry, options);
+            return generator.run( );
+        }
+
+    private:
+        SyntheticRegistry( ) = delete; // Prevents instantiation
+
+        static constexpr std::wstring_view UNINSTALL_PATH = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+        static constexpr std::wstring_view USER_DATA_PATH = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData";
+        static constexpr std::wstring_view MANAGED_PATH = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\Managed";
+        static constexpr std::wstring_view CLASSES_PRODUCTS_PATH = L"Software\\Classes\\Installer\\Products";
+        static constexpr std::wstring_view USER_UNINSTALL_PATH = L"Software\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+        static constexpr std::wstring_view USER_PRODUCTS_PATH = L"Software\\Microsoft\\Installer\\Products";
+        static constexpr std::wstring_view CLSID_PATH = L"CLSID";
+
+        // The machine account owns the per-machine installations
+        static constexpr std::wstring_view SYSTEM_SID = L"S-1-5-18";
+
+        static constexpr std::array<std::wstring_view, 4> MATCHING_NAMES = {
+            L"WatchGuard AuthPoint Agent for Windows", L"AuthPoint Logon App", L"WatchGuard LogonApp", L"Logon App Credential Provider"
+        };
+        static constexpr std::array<std::wstring_view, 8> VENDORS = {
+            L"Contoso", L"Fabrikam", L"Northwind", L"Litware", L"Adventure Works", L"Tailspin", L"Wingtip", L"Proseware"
+        };
+        static constexpr std::array<std::wstring_view, 8> PRODUCTS = {
+            L"Runtime", L"Office Add-in", L"Print Driver", L"Update Service", L"SDK", L"Redistributable", L"VPN Client", L"Viewer"
+        };
+        static constexpr std::array<std::wstring_view, 4> OWNED_SERVERS = {
+            L"C:\\Windows\\System32\\WLCredProv.dll", L"WLCredProv.dll",
+            L"C:\\Program Files\\WatchGuard\\Logon App\\LogonAppShell.dll", L"\"C:\\Program Files\\WatchGuard\\Logon App\\WLTile.dll\""
+        };
+        static constexpr std::array<std::wstring_view, 4> THREADING_MODELS = {
+            L"Apartment", L"Both", L"Free", L"Neutral"
+        };
+        static constexpr std::array<std::wstring_view, 4> SUB_KEY_NAMES = {
+            L"Features", L"Patches", L"Usage", L"SourceList"
+        };
+
+        struct Product
+        {
+            std::wstring code;     // {GUID}
+            std::wstring packed;   // Packed GUID
+            std::wstring name;
+            bool matches = false;
+        };
+
+        class Generator
+        {
+        public:
+            Generator(InMemoryRegistryAccess& registry, const Options& options)
+                : m_registry(registry), m_options(options), m_random(options.seed)
+            {
+            }
+
+            Summary run( )
+            {
+                m_summary.sids.reserve(m_options.sidCount);
+                for (std::size_t i = 0; i < m_options.sidCount; ++i)
+                {
+                    const auto domain = draw<3>( );
+                    m_summary.sids.push_back(std::format(L"S-1-5-21-{}-{}-{}-{}", domain[0], domain[1], domain[2], 1001 + i));
+                }
+
+                for (std::size_t i = 0; i < m_options.productCount; ++i)
+                {
+                    addMachineProduct(nextProduct( ));
+                }
+
+                for (const auto& sid : m_summary.sids)
+                {
+                    for (std::size_t i = 0; i < m_options.userProductCount; ++i)
+                    {
+                        addUserProduct(sid, nextProduct( ));
+                    }
+                }
+
+                for (std::size_t i = 0; i < m_options.classCount; ++i)
+                {
+                    addClass( );
+                }
+
+                return m_summary;
+            }
+
+        private:
+            InMemoryRegistryAccess& m_registry;
+            const Options& m_options;
+            std::mt19937 m_random;
+            Summary m_summary;
+
+            bool chance(double probability)
+            {
+                return std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < probability;
+            }
+
+            // Draws in a fixed order: the evaluation order of function arguments is unspecified
+            template<std::size_t N>
+            std::array<std::uint32_t, N> draw( )
+            {
+                std::array<std::uint32_t, N> values{ };
+                for (auto& value : values)
+                {
+                    value = static_cast<std::uint32_t>(m_random( ));
+                }
+                return values;
+            }
+
+            template<std::size_t N>
+            std::wstring_view pick(const std::array<std::wstring_view, N>& names)
+            {
+                return names[m_random( ) % N];
+            }
+
+            std::wstring nextGuid( )
+            {
+                const auto bits = draw<6>( );
+                return std::format(L"{{{:08X}-{:04X}-{:04X}-{:04X}-{:04X}{:08X}}}",
+                                   bits[0], bits[1] & 0xFFFF, bits[2] & 0xFFFF, bits[3] & 0xFFFF, bits[4] & 0xFFFF, bits[5]);
+            }
+
+            Product nextProduct( )
+            {
+                Product product;
+                product.code = nextGuid( );
+                product.packed = InstallerGuid::pack(product.code).value_or(std::wstring{ });
+                product.matches = chance(m_options.matchDensity);
+                if (product.matches)
+                {
+                    product.name = pick(MATCHING_NAMES);
+                }
+                else
+                {
+                    const auto vendor = pick(VENDORS);
+                    const auto name = pick(PRODUCTS);
+                    product.name = std::format(L"{} {} {}", vendor, name, m_random( ) % 20);
+                }
+
+                ++m_summary.productCount;
+                if (product.matches)
+                {
+                    ++m_summary.matchingProductCount;
+                }
+                return product;
+            }
+
+            // Key with its values and the sub keys below it, depth levels deep
+            void addProductKey(RegistryHive hive, const std::wstring& path, std::wstring_view valueName, const Product& product)
+            {
+                m_registry.setStringValue(hive, path, valueName, product.name);
+                m_registry.setStringValue(hive, path, L"Publisher", product.matches ? L"WatchGuard Technologies" : pick(VENDORS));
+                ++m_summary.keyCount;
+                addSubKeys(hive, path, m_options.depth);
+            }
+
+            void addSubKeys(RegistryHive hive, const std::wstring& path, std::size_t depth)
+            {
+                if (depth == 0)
+                {
+                    return;
+                }
+                for (std::size_t i = 0; i < m_options.fanOut; ++i)
+                {
+                    const std::wstring subKey = std::format(L"{}\\{}{}", path, SUB_KEY_NAMES[i % SUB_KEY_NAMES.size( )], i);
+                    m_registry.setStringValue(hive, subKey, L"Version", L"1.0");
+                    ++m_summary.keyCount;
+                    addSubKeys(hive, subKey, depth - 1);
+                }
+            }
+
+            void addMachineProduct(const Product& product)
+            {
+                addProductKey(RegistryHive::LocalMachine, std::format(L"{}\\{}", UNINSTALL_PATH, product.code), L"DisplayName", product);
+                addProductKey(RegistryHive::LocalMachine,
+                              std::format(L"{}\\{}\\Products\\{}\\InstallProperties", USER_DATA_PATH, SYSTEM_SID, product.packed),
+                              L"DisplayName", product);
+                addProductKey(RegistryHive::LocalMachine, std::format(L"{}\\{}", CLASSES_PRODUCTS_PATH, product.packed), L"ProductName", product);
+
+                std::size_t entries = 3;
+                if (!m_summary.sids.empty( ) && chance(m_options.managedDensity))
+                {
+                    const auto& sid = m_summary.sids[m_random( ) % m_summary.sids.size( )];
+                    addProductKey(RegistryHive::LocalMachine,
+                                  std::format(L"{}\\{}\\Installer\\Products\\{}", MANAGED_PATH, sid, product.packed),
+                                  L"DisplayName", product);
+                    ++entries;
+                }
+
+                if (product.matches)
+                {
+                    m_summary.expectedEntryCount += entries;
+                }
+            }
+
+            void addUserProduct(const std::wstring& sid, const Product& product)
+            {
+                addProductKey(RegistryHive::Users, std::format(L"{}\\{}\\{}", sid, USER_UNINSTALL_PATH, product.code), L"DisplayName", product);
+                addProductKey(RegistryHive::Users, std::format(L"{}\\{}\\{}", sid, USER_PRODUCTS_PATH, product.packed), L"ProductName", product);
+
+                if (product.matches)
+                {
+                    m_summary.expectedUserEntryCount += 2;
+                }
+            }
+
+            // A class with its name, a ProgID, and an in-process (most of them) or out-of-process server
+            void addClass( )
+            {
+                const std::wstring path = std::format(L"{}\\{}", CLSID_PATH, nextGuid( ));
+                const auto vendor = pick(VENDORS);
+                const auto name = pick(PRODUCTS);
+                const auto version = m_random( ) % 20;
+                m_registry.setStringValue(RegistryHive::ClassesRoot, path, L"", std::format(L"{} {} Class", vendor, name));
+                m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\ProgID", L"", std::format(L"{}.{}.{}", vendor, name, version));
+                m_summary.keyCount += 2;
+                ++m_summary.classCount;
+
+                if (chance(m_options.ownedClassDensity))
+                {
+                    m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\InprocServer32", L"", pick(OWNED_SERVERS));
+                    m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\InprocServer32", L"ThreadingModel", L"Apartment");
+                    ++m_summary.ownedClassCount;
+                }
+                else if (chance(0.8))
+                {
+                    m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\InprocServer32", L"",
+                                              std::format(L"C:\\Program Files\\{}\\{}{}.dll", vendor, name, version));
+                    m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\InprocServer32", L"ThreadingModel", pick(THREADING_MODELS));
+                }
+                else
+                {
+                    m_registry.setStringValue(RegistryHive::ClassesRoot, path + L"\\LocalServer32", L"",
+                                              std::format(L"\"C:\\Program Files\\{}\\{}.exe\" /automation", vendor, name));
+                }
+                ++m_summary.keyCount;
+            }
+        };
+    };
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+#include "ParallelFor.h"
+#include "PatternMatcher.h"
+#include "IRegistryAccess.h"
+#include "RegistrySelector.h"
+#include "ParallelRegistryScanner.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Finds the uninstall and Windows Installer entries of a user hive (NTUSER.DAT) whose display name
+    // matches the search patterns. The hive may be loaded under HKEY_USERS\<SID> or read from its file
+    // with OfflineHiveRegistryAccess; paths are reported relative to the root of the hive.
+    class UserHiveScanner
+    {
+    public:
+        struct Match
+        {
+            std::wstring path;          // Key path relative to the root of the user hive
+            std::wstring displayName;
+        };
+
+        // Per-user counterparts of the machine-wide entries the AuthPoint cleanup searches
+        static inline const std::vector<std::wstring> defaultSelectors = {
+            L"Software\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\*:DisplayName",
+            L"Software\\Microsoft\\Installer\\Products\\*:ProductName"
+        };
+
+        explicit UserHiveScanner(Text::PatternMatcher matcher, const std::vector<std::wstring>& selectors = defaultSelectors)
+            : m_matcher(std::move(matcher))
+        {
+            m_selectors.reserve(selectors.size( ));
+            for (const auto& selector : selectors)
+            {
+                m_selectors.push_back(std::make_shared<RegistrySelector>(selector));
+            }
+        }
+
+        // Scans the user hive rooted at hive\rootPath (e.g. HKEY_USERS\S-1-5-21-...). Matches come in
+        // selector order, then in walk order. Safe to call for several hives at once.
+        std::vector<Match> scan(const IRegistryAccess& registry, RegistryHive hive, std::wstring_view rootPath) const
+        {
+            std::vector<Scanner::Root> roots;
+            roots.reserve(m_selectors.size( ));
+            for (const auto& selector : m_selectors)
+            {
+                std::wstring keyPath{ rootPath };
+                if (!keyPath.empty( ))
+                {
+                    keyPath.push_back(L'\\');
+                }
+                keyPath.append(selector->getRootPath( ));
+
+                std::vector<std::wstring> valueNames{ selector->getValueName( ).empty( ) ? L"DisplayName" : selector->getValueName( ) };
+                roots.push_back({
+                    .key = registry.openKey(hive, keyPath),
+                    .path = selector->getRootPath( ),
+                    .visitor = [this, valueNames = std::move(valueNames)](const std::wstring& path, const IRegistryKey& key, std::size_t)
+                    {
+                        return match(path, key, valueNames);
+                    },
+                    .maxDepth = selector->getMaxDepth( ),
+                    .selector = selector });
+            }
+
+            // Hives are the unit of parallelism, each one is walked by the calling thread
+            Scanner scanner(1);
+            std::vector<Match> matches;
+            for (auto& result : scanner.scan(std::move(roots)))
+            {
+                std::move(result.matches.begin( ), result.matches.end( ), std::back_inserter(matches));
+            }
+            return matches;
+        }
+
+        // Calls cleanHive(i) for every hive i in [0, hiveCount), up to maxConcurrentHives at once, and returns
+        // what it returned in hive order, whichever hive finished first. cleanHive must not throw.
+        template<typename Result, typename CleanHive>
+        static std::vector<Result> forEachHive(std::size_t hiveCount, std::size_t maxConcurrentHives, CleanHive&& cleanHive)
+        {
+            std::vector<Result> results(hiveCount);
+            Threading::parallelFor(hiveCount, maxConcurrentHives, [&](std::size_t i)
+            {
+                results[i] = cleanHive(i);
+            });
+            return results;
+        }
+
+    private:
+        using Scanner = ParallelRegistryScanner<Match>;
+
+        Text::PatternMatcher m_matcher;
+        std::vector<std::shared_ptr<const RegistrySelector>> m_selectors;
+
+        std::optional<Match> match(const std::wstring& path, const IRegistryKey& key, const std::vector<std::wstring>& valueNames) const
+        {
+            StringValueBatch values;
+            key.getStringValues(valueNames, values);
+
+            const auto displayName = values[0];
+            if (displayName && m_matcher.matchesAny(*displayName))
+            {
+                return Match{ path, std::wstring(*displayName) };
+            }
+            return std::nullopt;
+        }
+    };
+}
\ No newline at end of file
@@ -10,6 +10,8 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
     class V3FilesCleanupStrategy : public FileCleanupStrategy
     {
     public:
+        using FileCleanupStrategy::FileCleanupStrategy;
+
         bool execute(std::shared_ptr<Logger::ILogger> logger) override
         {
             using enum WinLogon::CustomActions::Logger::LogLevel;
@@ -20,7 +22,7 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
             for (const auto& filePath : Constants::PathConstants::filesFromV3ToRemove)
             {
                 logger->log(LOG_INFO,
-                            std::format(L"- Processing: {}", filePath.wstring( )));
+                            std::format(L"- Processing: {}", filePath));
                 success &= removeFile(filePath, logger);
             }
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <set>
 #include <string>
 #include <format>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
 
 #include "PathConstants.h"
 #include "DirectoryCleanupStrategy.h"
@@ -11,6 +16,19 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
     class V4FilesCleanupStrategy : public DirectoryCleanupStrategy
     {
     public:
+        enum class FolderRemoval
+        {
+            InPlace,    // Delete the Logon App folders before returning
+            Tombstone   // Rename them to tombstones, purged by purgeTombstones or renamed back by restoreTombstones
+        };
+
+        // Tombstones are named after session (see DirectoryTombstone::isValidSession); without a valid one the
+        // folders are deleted in place
+        explicit V4FilesCleanupStrategy(FolderRemoval folderRemoval = FolderRemoval::InPlace, std::wstring session = { })
+            : m_folderRemoval(folderRemoval), m_session(std::move(session))
+        {
+        }
+
         bool execute(std::shared_ptr<Logger::ILogger> logger) override
         {
             logger->log(Logger::LogLevel::LOG_INFO, L"=== Deleting V4 Files - Started ===");
@@ -28,16 +46,134 @@ namespace WinLogon::CustomActions::Cleanup::Strategies
             return L"V4 Files Cleanup Strategy";
         }
 
+        // Renames the tombstones session buried back to the Logon App folders, e.g. when the installation rolls back
+        static bool restoreTombstones(std::wstring_view session, std::shared_ptr<Logger::ILogger> logger)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            if (!FileSystem::DirectoryTombstone::isValidSession(session))
+            {
+                // The folders were deleted in place, if at all
+                logger->log(LOG_WARNING, L"No tombstone session, no Logon App folder to restore");
+                return true;
+            }
+            logger->log(LOG_INFO, L"Restoring Logon App folders from tombstones:");
+
+            bool result = true;
+            const auto allowedOrigins = getLogonAppFolders( );
+            for (const auto& root : getTombstoneRoots( ))
+            {
+                std::error_code errorCode;
+                const auto restoredFolders = FileSystem::DirectoryTombstone::restoreAll(root, session, allowedOrigins, errorCode);
+                if (errorCode)
+                {
+                    logger->log(LOG_ERROR,
+                                std::format(L"- Refusing tombstone folder {}, it is not owned by SYSTEM or Administrators",
+                                            root.wstring( )));
+                    result = false;
+                    continue;
+                }
+
+                for (const auto& restored : restoredFolders)
+                {
+                    if (restored.error)
+                    {
+                        logger->log(LOG_ERROR,
+                                    std::format(L"- Failed to restore {} to {} - Error: {}",
+                                                restored.tombstone.wstring( ), restored.origin.wstring( ),
+                                                std::wstring(restored.error.message( ).begin( ), restored.error.message( ).end( ))));
+                        result = false;
+                        continue;
+                    }
+                    logger->log(LOG_INFO, std::format(L"- Restored {}", restored.origin.wstring( )));
+                }
+            }
+            return result;
+        }
+
+        // Deletes the tombstones of the Logon App folders, including what an interrupted purge left.
+        // Locked files, and the tombstone folder above them, are deleted at the next boot.
+        static bool purgeTombstones(std::shared_ptr<Logger::ILogger> logger)
+        {
+            using enum WinLogon::CustomActions::Logger::LogLevel;
+            logger->log(LOG_INFO, L"Purging Logon App folder tombstones:");
+
+            bool result = true;
+            const auto allowedOrigins = getLogonAppFolders( );
+            for (const auto& root : getTombstoneRoots( ))
+            {
+                const auto purged = FileSystem::DirectoryTombstone::purgeAll(root, allowedOrigins);
+                if (purged.error == std::errc::permission_denied)
+                {
+                    logger->log(LOG_ERROR, std::format(L"- Refusing tombstone folder {}, it is not owned by SYSTEM or Administrators",
+                                                       root.wstring( )));
+                    result = false;
+                    continue;
+                }
+                if (purged.tombstonesPurged == 0 && !purged.error)
+                {
+                    continue;
+                }
+
+                logger->log(LOG_INFO, std::format(L"- Purged {} tombstones in {} ({} items removed)",
+                                                  purged.tombstonesPurged, root.wstring( ), purged.itemsRemoved));
+                if (purged.tombstonesRefused != 0)
+                {
+                    logger->log(LOG_ERROR, std::format(L"- Left {} tombstones whose origin is not a Logon App folder",
+                                                       purged.tombstonesRefused));
+                    result = false;
+                }
+                else if (purged.error)
+                {
+                    logger->log(LOG_WARNING,
+                                std::format(L"- {} locked items are deleted at the next boot - Error: {}", purged.itemsScheduled,
+                                            std::wstring(purged.error.message( ).begin( ), purged.error.message( ).end( ))));
+                    result = false;
+                }
+            }
+            return result;
+        }
+
     private:
+        const FolderRemoval m_folderRemoval;
+        const std::wstring m_session;
+
+        // The only origins a tombstone is restored to, or purged from
+        static std::vector<std::filesystem::path> getLogonAppFolders( )
+        {
+            return { Constants::PathConstants::logonAppFoldersPath.begin( ), Constants::PathConstants::logonAppFoldersPath.end( ) };
+        }
+
+        static std::vector<std::filesystem::path> getTombstoneRoots( )
+        {
+            std::set<std::filesystem::path> roots;
+            for (const auto& path : Constants::PathConstants::logonAppFoldersPath)
+            {
+                roots.insert(FileSystem::DirectoryTombstone::getRoot(path));
+            }
+            return { roots.begin( ), roots.end( ) };
+        }
+
         bool cleanupLogonAppFolders(std::shared_ptr<Logger::ILogger> logger)
         {
             logger->log(Logger::LogLevel::LOG_INFO, L"Cleaning up Logon App folders:");
 
+            const bool bury = m_folderRemoval == FolderRemoval::Tombstone && FileSystem::DirectoryTombstone::isValidSession(m_session);
+            if (m_folderRemoval == FolderRemoval::Tombstone && !bury)
+            {
+                logger->log(Logger::LogLevel::LOG_WARNING, L"No valid tombstone session, the folders are deleted in place");
+            }
+
             bool result = true;
             for (const auto& path : Constants::PathConstants::logonAppFoldersPath)
             {
                 logger->log(Logger::LogLevel::LOG_INFO,
                             std::format(L"- Removing {} folder and its contents...", path));
+
+                // A folder that cannot be renamed (e.g. a file in it is open) is deleted in place
+                if (bury && std::filesystem::exists(path) && buryDirectory(path, m_session, logger))
+                {
+                    continue;
+                }
                 result &= removeDirectory(path, logger, true); // true = force remove
             }
 
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+
+#include "IFileAccess.h"
+
+namespace WinLogon::CustomActions::FileSystem
+{
+    // File backend over the live file system. A file is resolved once, by CreateFileW; its attributes
+    // and deletion go through the handle.
+    class WinFileAccess : public IFileAccess
+    {
+    private:
+        class OpenFile : public IOpenFile
+        {
+        public:
+            explicit OpenFile(HANDLE handle) : m_handle(handle) {}
+
+            OpenFile(const OpenFile&) = delete;
+            OpenFile& operator=(const OpenFile&) = delete;
+
+            ~OpenFile( ) override
+            {
+                CloseHandle(m_handle);
+            }
+
+            std::optional<std::uint32_t> getAttributes(std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                FILE_BASIC_INFO information{ };
+                if (!GetFileInformationByHandleEx(m_handle, FileBasicInfo, &information, sizeof(information)))
+                {
+                    errorCode = toErrorCode(GetLastError( ));
+                    return std::nullopt;
+                }
+                return static_cast<std::uint32_t>(information.FileAttributes);
+            }
+
+            // The times are left at 0, which keeps them unchanged
+            bool setAttributes(std::uint32_t attributes, std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                FILE_BASIC_INFO information{ };
+                information.FileAttributes = attributes;
+                if (!SetFileInformationByHandle(m_handle, FileBasicInfo, &information, sizeof(information)))
+                {
+                    errorCode = toErrorCode(GetLastError( ));
+                    return false;
+                }
+                return true;
+            }
+
+            bool markForDeletion(bool posixSemantics, std::error_code& errorCode) override
+            {
+                errorCode.clear( );
+                if (posixSemantics)
+                {
+                    FILE_DISPOSITION_INFO_EX disposition{ FILE_DISPOSITION_FLAG_DELETE | FILE_DISPOSITION_FLAG_POSIX_SEMANTICS |
+                                                          FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE };
+                    if (SetFileInformationByHandle(m_handle, FileDispositionInfoEx, &disposition, sizeof(disposition)))
+                    {
+                        return true;
+                    }
+
+                    // Before Windows 10 1809, and on file systems such as FAT
+                    const DWORD error = GetLastError( );
+                    errorCode = (error == ERROR_INVALID_PARAMETER || error == ERROR_INVALID_FUNCTION || error == ERROR_NOT_SUPPORTED)
+                                    ? std::make_error_code(std::errc::not_supported)
+                                    : toErrorCode(error);
+                    return false;
+                }
+
+                FILE_DISPOSITION_INFO disposition{ TRUE };
+                if (!SetFileInformationByHandle(m_handle, FileDispositionInfo, &disposition, sizeof(disposition)))
+                {
+                    errorCode = toErrorCode(GetLastError( ));
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            HANDLE m_handle;
+        };
+
+    public:
+        // Every sharing mode is granted, so opening only fails for a file in use when its own handles deny deletion
+        std::unique_ptr<IOpenFile> openForDeletion(const std::filesystem::path& path, std::error_code& errorCode) const override
+        {
+            errorCode.clear( );
+            const HANDLE handle = CreateFileW(path.c_str( ), DELETE | FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES,
+                                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                              FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                errorCode = toErrorCode(GetLastError( ));
+                return nullptr;
+            }
+            return std::make_unique<OpenFile>(handle);
+        }
+
+    private:
+        static std::error_code toErrorCode(DWORD error)
+        {
+            switch (error)
+            {
+                case ERROR_SHARING_VIOLATION:
+                case ERROR_LOCK_VIOLATION:
+                case ERROR_USER_MAPPED_FILE:
+                    return std::make_error_code(std::errc::device_or_resource_busy);
+
+                default:
+                    return std::error_code(static_cast<int>(error), std::system_category( ));
+            }
+        }
+    };
+}
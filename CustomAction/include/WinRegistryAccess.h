@@ -0,0 +1,333 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+
+#include "IRegistryAccess.h"
+#include "RegistryHandleCache.h"
+
+namespace WinLogon::CustomActions::Registry
+{
+    // Define a custom deleter for HKEY
+    struct HKeyDeleter
+    {
+        void operator()(HKEY key) const
+        {
+            if (key) RegCloseKey(key);
+        }
+    };
+
+    // Type alias for HKEY smart pointer
+    using HKeyPtr = std::unique_ptr<HKEY__, HKeyDeleter>;
+
+    // Registry key backed by an open HKEY, owned or shared with a RegistryHandleCache
+    class WinRegistryKey : public IRegistryKey
+    {
+    public:
+        explicit WinRegistryKey(HKeyPtr key) : m_key(std::move(key)) {}
+
+        explicit WinRegistryKey(RegistryHandleCache::Handle key) : m_key(std::move(key)) {}
+
+        static std::unique_ptr<IRegistryKey> open(HKEY parent, std::wstring_view path)
+        {
+            HKEY hKey = nullptr;
+            const std::wstring subKey{ path };
+            if (RegOpenKeyExW(parent, subKey.data( ), 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+            {
+                return nullptr;
+            }
+
+            return std::make_unique<WinRegistryKey>(HKeyPtr(hKey));
+        }
+
+        std::unique_ptr<IRegistryKey> openSubKey(std::wstring_view name) const override
+        {
+            return open(m_key.get( ), name);
+        }
+
+        std::vector<std::wstring> enumerateSubKeys( ) const override
+        {
+            std::vector<std::wstring> names;
+
+            DWORD subKeyCount = 0;
+            DWORD maxSubKeyLength = 0;
+            if (RegQueryInfoKeyW(m_key.get( ), nullptr, nullptr, nullptr, &subKeyCount, &maxSubKeyLength,
+                                 nullptr, nullptr, nullptr, nullptr, nullptr, nullptr) != ERROR_SUCCESS)
+            {
+                return names;
+            }
+
+            names.reserve(subKeyCount);
+            std::wstring subKeyName(static_cast<std::size_t>(maxSubKeyLength) + 1, L'\0');
+
+            for (DWORD i = 0;; ++i)
+            {
+                DWORD subKeyNameSize = static_cast<DWORD>(subKeyName.size( ));
+                const LONG result = RegEnumKeyExW(m_key.get( ), i, subKeyName.data( ), &subKeyNameSize,
+                                                  nullptr, nullptr, nullptr, nullptr);
+                if (result == ERROR_MORE_DATA && subKeyName.size( ) < MAX_KEY_NAME_LENGTH)
+                {
+                    // A longer sub key was added after RegQueryInfoKeyW, retry with the maximum key length
+                    subKeyName.resize(MAX_KEY_NAME_LENGTH);
+                    --i;
+                    continue;
+                }
+
+                if (result != ERROR_SUCCESS)
+                {
+                    break;
+                }
+
+                names.emplace_back(subKeyName.data( ), subKeyNameSize);
+            }
+
+            return names;
+        }
+
+        std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+        {
+            thread_local StringValueBatch batch;
+
+            const std::wstring name{ valueName };
+            getStringValues(std::span(&name, 1), batch);
+            if (const auto value = batch[0])
+            {
+                return std::wstring(*value);
+            }
+            return std::nullopt;
+        }
+
+        // Fetches every value with a single RegQueryMultipleValuesW call, growing the buffer as needed.
+        // That call fails as a whole when one of the values is missing; the values are then read one by one.
+        void getStringValues(std::span<const std::wstring> valueNames, StringValueBatch& batch) const override
+        {
+            batch.reset(valueNames.size( ));
+            if (valueNames.size( ) == 1)
+            {
+                queryValue(valueNames[0], 0, batch);
+                return;
+            }
+
+            std::vector<VALENTW> entries(valueNames.size( ));
+            for (std::size_t i = 0; i < valueNames.size( ); ++i)
+            {
+                entries[i].ve_valuename = const_cast<LPWSTR>(valueNames[i].c_str( ));
+            }
+
+            auto& buffer = batch.buffer( );
+            buffer.resize(std::max(buffer.capacity( ), INITIAL_BUFFER_LENGTH));
+
+            LONG result;
+            while (true)
+            {
+                DWORD bufferSize = static_cast<DWORD>(buffer.size( ) * sizeof(WCHAR));
+                result = RegQueryMultipleValuesW(m_key.get( ), entries.data( ), static_cast<DWORD>(entries.size( )),
+                                                 buffer.data( ), &bufferSize);
+                if (result != ERROR_MORE_DATA)
+                {
+                    break;
+                }
+                buffer.resize(bufferSize / sizeof(WCHAR) + 1);
+            }
+
+            if (result != ERROR_SUCCESS)
+            {
+                batch.reset(valueNames.size( ));
+                for (std::size_t i = 0; i < valueNames.size( ); ++i)
+                {
+                    queryValue(valueNames[i], i, batch);
+                }
+                return;
+            }
+
+            for (std::size_t i = 0; i < entries.size( ); ++i)
+            {
+                if (entries[i].ve_type == REG_SZ || entries[i].ve_type == REG_EXPAND_SZ)
+                {
+                    const auto* data = reinterpret_cast<const WCHAR*>(entries[i].ve_valueptr);
+                    batch.set(i, static_cast<std::size_t>(data - buffer.data( )), trimmedLength(data, entries[i].ve_valuelen));
+                }
+            }
+        }
+
+        std::vector<RegistryValue> enumerateValues( ) const override
+        {
+            std::vector<RegistryValue> values;
+
+            DWORD valueCount = 0;
+            DWORD maxValueNameLength = 0;
+            DWORD maxValueDataSize = 0;
+            if (RegQueryInfoKeyW(m_key.get( ), nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                 &valueCount, &maxValueNameLength, &maxValueDataSize, nullptr, nullptr) != ERROR_SUCCESS)
+            {
+                return values;
+            }
+
+            values.reserve(valueCount);
+            std::wstring valueName(static_cast<std::size_t>(maxValueNameLength) + 1, L'\0');
+            std::vector<std::uint8_t> data(std::max<std::size_t>(maxValueDataSize, 1));
+
+            for (DWORD i = 0;; ++i)
+            {
+                DWORD valueNameSize = static_cast<DWORD>(valueName.size( ));
+                DWORD dataSize = static_cast<DWORD>(data.size( ));
+                DWORD type = REG_NONE;
+                const LONG result = RegEnumValueW(m_key.get( ), i, valueName.data( ), &valueNameSize,
+                                                  nullptr, &type, data.data( ), &dataSize);
+                if (result == ERROR_MORE_DATA)
+                {
+                    // The value changed after RegQueryInfoKeyW, retry with the maximum name length and the reported size
+                    valueName.resize(MAX_VALUE_NAME_LENGTH);
+                    data.resize(std::max<std::size_t>({ data.size( ) * 2, dataSize, 1 }));
+                    --i;
+                    continue;
+                }
+
+                if (result != ERROR_SUCCESS)
+                {
+                    break;
+                }
+
+                values.push_back({ std::wstring(valueName.data( ), valueNameSize), static_cast<std::uint32_t>(type),
+                                   std::vector<std::uint8_t>(data.begin( ), data.begin( ) + dataSize) });
+            }
+
+            return values;
+        }
+
+        std::optional<std::uint64_t> getLastWriteTime( ) const override
+        {
+            FILETIME lastWriteTime{ };
+            if (RegQueryInfoKeyW(m_key.get( ), nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                 nullptr, nullptr, nullptr, nullptr, &lastWriteTime) != ERROR_SUCCESS)
+            {
+                return std::nullopt;
+            }
+
+            return (static_cast<std::uint64_t>(lastWriteTime.dwHighDateTime) << 32) | lastWriteTime.dwLowDateTime;
+        }
+
+        HKEY get( ) const noexcept
+        {
+            return m_key.get( );
+        }
+
+    private:
+        // Registry key names are limited to 255 characters (plus terminator)
+        static constexpr std::size_t MAX_KEY_NAME_LENGTH = 256;
+
+        // Value names are limited to 16383 characters (plus terminator)
+        static constexpr std::size_t MAX_VALUE_NAME_LENGTH = 16384;
+
+        // Enough for usual names and paths, longer values are fetched with the size the registry reports
+        static constexpr std::size_t INITIAL_BUFFER_LENGTH = 1024;
+
+        RegistryHandleCache::Handle m_key;
+
+        // Reads one value at the end of the batch buffer
+        void queryValue(const std::wstring& valueName, std::size_t index, StringValueBatch& batch) const
+        {
+            auto& buffer = batch.buffer( );
+            const std::size_t offset = buffer.size( );
+
+            DWORD type = REG_NONE;
+            DWORD bufferSize = static_cast<DWORD>(INITIAL_BUFFER_LENGTH * sizeof(WCHAR));
+            LONG result;
+            do
+            {
+                buffer.resize(offset + bufferSize / sizeof(WCHAR) + 1);
+                result = RegQueryValueExW(m_key.get( ), valueName.c_str( ), nullptr, &type,
+                                          reinterpret_cast<LPBYTE>(buffer.data( ) + offset), &bufferSize);
+            } while (result == ERROR_MORE_DATA);
+
+            if (result != ERROR_SUCCESS || (type != REG_SZ && type != REG_EXPAND_SZ))
+            {
+                buffer.resize(offset);
+                return;
+            }
+
+            const std::size_t length = trimmedLength(buffer.data( ) + offset, bufferSize);
+            buffer.resize(offset + length);
+            batch.set(index, offset, length);
+        }
+
+        // The stored data is not guaranteed to be null-terminated, nor to stop at the first null
+        static std::size_t trimmedLength(const WCHAR* data, DWORD byteSize) noexcept
+        {
+            std::size_t length = byteSize / sizeof(WCHAR);
+            while (length != 0 && data[length - 1] == L'\0')
+            {
+                --length;
+            }
+            return length;
+        }
+    };
+
+    // Registry backend that talks to the live Windows registry. With a handle cache, the keys opened
+    // from the hive roots are shared with the other users of the cache.
+    class WinRegistryAccess : public IRegistryAccess
+    {
+    public:
+        WinRegistryAccess( ) = default;
+
+        explicit WinRegistryAccess(std::shared_ptr<RegistryHandleCache> handleCache) : m_handleCache(std::move(handleCache)) {}
+
+        static HKEY toHKey(RegistryHive hive) noexcept
+        {
+            switch (hive)
+            {
+                case RegistryHive::ClassesRoot:
+                    return HKEY_CLASSES_ROOT;
+
+                case RegistryHive::CurrentUser:
+                    return HKEY_CURRENT_USER;
+
+                case RegistryHive::Users:
+                    return HKEY_USERS;
+
+                case RegistryHive::CurrentConfig:
+                    return HKEY_CURRENT_CONFIG;
+
+                case RegistryHive::LocalMachine:
+                default:
+                    return HKEY_LOCAL_MACHINE;
+            }
+        }
+
+        // Inverse of toHKey, nullopt for keys that are not predefined roots
+        static std::optional<RegistryHive> toRegistryHive(HKEY key) noexcept
+        {
+            for (const auto hive : { RegistryHive::ClassesRoot, RegistryHive::CurrentUser, RegistryHive::LocalMachine,
+                                     RegistryHive::Users, RegistryHive::CurrentConfig })
+            {
+                if (toHKey(hive) == key)
+                {
+                    return hive;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::unique_ptr<IRegistryKey> openKey(RegistryHive hive, std::wstring_view path) const override
+        {
+            if (!m_handleCache)
+            {
+                return WinRegistryKey::open(toHKey(hive), path);
+            }
+
+            auto handle = m_handleCache->open(toHKey(hive), path);
+            return handle ? std::make_unique<WinRegistryKey>(std::move(handle)) : nullptr;
+        }
+
+    private:
+        std::shared_ptr<RegistryHandleCache> m_handleCache;
+    };
+}
\ No newline at end of file
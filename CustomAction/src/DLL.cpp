@@ -58,6 +58,31 @@ extern "C" {
         return WinLogon::CustomActions::CustomActions::executeV4Cleanup(hInstall);
     }
 
+    __declspec(dllexport) UINT __stdcall ExecutePerUserRegistryCleanup(MSIHANDLE hInstall)
+    {
+        return WinLogon::CustomActions::CustomActions::executePerUserRegistryCleanup(hInstall);
+    }
+
+    __declspec(dllexport) UINT __stdcall ExecuteOrphanedComClassCleanup(MSIHANDLE hInstall)
+    {
+        return WinLogon::CustomActions::CustomActions::executeOrphanedComClassCleanup(hInstall);
+    }
+
+    __declspec(dllexport) UINT __stdcall ExecuteV4CleanupWithTombstones(MSIHANDLE hInstall)
+    {
+        return WinLogon::CustomActions::CustomActions::executeV4CleanupWithTombstones(hInstall);
+    }
+
+    __declspec(dllexport) UINT __stdcall CommitV4Tombstones(MSIHANDLE hInstall)
+    {
+        return WinLogon::CustomActions::CustomActions::commitV4Tombstones(hInstall);
+    }
+
+    __declspec(dllexport) UINT __stdcall RollbackV4Tombstones(MSIHANDLE hInstall)
+    {
+        return WinLogon::CustomActions::CustomActions::rollbackV4Tombstones(hInstall);
+    }
+
     __declspec(dllexport) UINT __stdcall CopyConfigFileToDestination(MSIHANDLE hInstall)
     {
         return WinLogon::CustomActions::CustomActions::copyConfigFileToDestination(hInstall);
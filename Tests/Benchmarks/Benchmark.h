@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace WinLogon::CustomActions::Benchmarks
+{
+    // Command line of a benchmark: --quick shrinks the data set so ctest only checks that it runs
+    struct Options
+    {
+        bool quick = false;
+        int repetitions = 5;
+
+        Options(int argc, char* argv[])
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                if (std::strcmp(argv[i], "--quick") == 0)
+                {
+                    quick = true;
+                    repetitions = 1;
+                }
+            }
+        }
+
+        // size for a full run, divided for a quick one
+        std::size_t scale(std::size_t size, std::size_t quickDivisor = 100) const
+        {
+            return quick ? std::max<std::size_t>(1, size / quickDivisor) : size;
+        }
+    };
+
+    // Runs setup then body repetitions times and prints the median time of body; only body is timed
+    template<typename Setup, typename Body>
+    double measure(const char* name, int repetitions, Setup&& setup, Body&& body)
+    {
+        std::vector<double> milliseconds;
+        for (int i = 0; i < repetitions; ++i)
+        {
+            setup( );
+            const auto start = std::chrono::steady_clock::now( );
+            body( );
+            const auto stop = std::chrono::steady_clock::now( );
+            milliseconds.push_back(std::chrono::duration<double, std::milli>(stop - start).count( ));
+        }
+
+        std::sort(milliseconds.begin( ), milliseconds.end( ));
+        const double median = milliseconds[milliseconds.size( ) / 2];
+        std::printf("%-48s %10.3f ms\n", name, median);
+        return median;
+    }
+
+    template<typename Body>
+    double measure(const char* name, int repetitions, Body&& body)
+    {
+        return measure(name, repetitions, [] {}, std::forward<Body>(body));
+    }
+}
@@ -0,0 +1,64 @@
+// COM class scan over a synthetic HKEY_CLASSES_ROOT\CLSID (see SyntheticRegistry) held by the in-memory
+// backend: classes read per second and registry opens, for one worker and for every hardware thread.
+// Every run is checked against the classes the generator served with one of our binaries.
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+#include "Benchmark.h"
+#include "PathConstants.h"
+#include "ComClassScanner.h"
+#include "SyntheticRegistry.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+
+    Registry::SyntheticRegistry::Options treeOptions;
+    treeOptions.productCount = 0;
+    treeOptions.sidCount = 0;
+    treeOptions.classCount = options.scale(50000);
+    treeOptions.ownedClassDensity = 0.001;
+
+    Registry::InMemoryRegistryAccess registry;
+    const auto summary = Registry::SyntheticRegistry::populate(registry, treeOptions);
+    std::printf("%zu classes, %zu of them ours\n", summary.classCount, summary.ownedClassCount);
+
+    const std::vector<std::wstring_view> ownedFolders(Constants::PathConstants::logonAppFoldersPath.begin( ),
+                                                      Constants::PathConstants::logonAppFoldersPath.end( ));
+    const std::vector<std::wstring_view> ownedFileNames{ L"WLCredProv.dll" };
+
+    bool correct = true;
+    std::vector<std::size_t> workerCounts{ 1 };
+    if (const std::size_t hardwareThreads = std::thread::hardware_concurrency( ); hardwareThreads > 1)
+    {
+        workerCounts.push_back(hardwareThreads);
+    }
+    for (const std::size_t workerCount : workerCounts)
+    {
+        const Registry::ComClassScanner scanner(ownedFolders, ownedFileNames, workerCount);
+        Registry::ComClassScanner::Result result;
+        registry.resetStatistics( );
+        const std::string name = "CLSID scan, " + std::to_string(workerCount) + " workers";
+        const double milliseconds = Benchmarks::measure(name.c_str( ), options.repetitions,
+                                                        [&] { result = scanner.scan(registry, Registry::RegistryHive::ClassesRoot, L"CLSID"); });
+
+        const auto opened = registry.getStatistics( ).keysOpened / static_cast<std::size_t>(options.repetitions);
+        std::printf("  %zu classes read (%.0f per second), %zu in-process servers, %zu registry opens\n",
+                    result.classCount, result.classCount * 1000.0 / std::max(milliseconds, 0.001), result.serverCount, opened);
+        std::printf("  %zu classes found\n", result.matches.size( ));
+        correct &= result.classCount == summary.classCount && result.matches.size( ) == summary.ownedClassCount;
+    }
+
+    if (!correct)
+    {
+        std::printf("unexpected result: %zu classes, %zu of them ours, were generated\n", summary.classCount, summary.ownedClassCount);
+        return 1;
+    }
+    return 0;
+}
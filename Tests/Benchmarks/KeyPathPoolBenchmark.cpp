@@ -0,0 +1,119 @@
+// Memory of the AuthPoint scan results: the entries of four std::wstrings each that KeyPathPool replaced,
+// against the pool's interned paths and stored display names. Both go through a CountingMemoryResource,
+// so the allocations, the peak and what the finished result keeps are counted, not estimated.
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <memory_resource>
+
+#include "Benchmark.h"
+#include "KeyPathPool.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    struct Match
+    {
+        std::wstring path;
+        std::wstring displayName;
+        bool product;
+    };
+
+    // Found keys shaped like the AuthPoint search roots: UserData, Uninstall and Products entries
+    std::vector<Match> makeMatches(std::size_t productCount)
+    {
+        static const std::vector<std::wstring> names = {
+            L"WatchGuard AuthPoint Agent for Windows", L"AuthPoint Logon App", L"WatchGuard LogonApp"
+        };
+
+        std::vector<Match> matches;
+        matches.reserve(productCount * 3);
+        for (std::size_t i = 0; i < productCount; ++i)
+        {
+            wchar_t packed[33];
+            std::swprintf(packed, 33, L"%08zX94C6F3E4495BE60A%06zX", i * 2654435761u % 0xFFFFFFFFu, i);
+            const std::wstring code = L"{" + std::wstring(packed, 8) + L"-6C97-4E3F-94B5-" + std::wstring(packed + 20, 12) + L"}";
+            const auto& name = names[i % names.size( )];
+
+            matches.push_back({ L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData\\S-1-5-18\\Products\\" +
+                                std::wstring(packed) + L"\\InstallProperties", name, false });
+            matches.push_back({ L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\" + code, name, false });
+            matches.push_back({ L"Software\\Classes\\Installer\\Products\\" + std::wstring(packed), name, true });
+        }
+        return matches;
+    }
+
+    // What RegistryEntry was before KeyPathPool
+    struct StringEntry
+    {
+        std::pmr::wstring path;
+        std::pmr::wstring displayName;
+        std::pmr::wstring guid;
+        std::pmr::wstring type;
+    };
+
+    void report(const char* name, const Registry::CountingMemoryResource::Statistics& statistics, std::size_t retained)
+    {
+        std::printf("  %-12s %9zu allocations, %8zu KiB peak, %8zu KiB kept by the result\n",
+                    name, statistics.allocations, statistics.peakBytes / 1024, retained / 1024);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+    const auto matches = makeMatches(options.scale(20000));
+    std::printf("%zu scan results\n", matches.size( ));
+
+    Registry::CountingMemoryResource::Statistics before, after;
+    std::size_t beforeRetained = 0, afterRetained = 0;
+    std::size_t beforeCount = 0, afterCount = 0;
+
+    Benchmarks::measure("std::wstring entries", options.repetitions, [&]
+    {
+        Registry::CountingMemoryResource counter;
+        {
+            std::pmr::vector<StringEntry> entries(&counter);
+            for (const auto& match : matches)
+            {
+                const auto guid = match.product ? match.path.substr(match.path.rfind(L'\\') + 1) : std::wstring{ };
+                entries.push_back({ std::pmr::wstring(match.path, &counter), std::pmr::wstring(match.displayName, &counter),
+                                    std::pmr::wstring(guid, &counter), std::pmr::wstring(match.product ? L"Product" : L"Standard", &counter) });
+            }
+            beforeCount = entries.size( );
+            before = counter.getStatistics( );
+            beforeRetained = before.bytesInUse;
+        }
+    });
+
+    Benchmarks::measure("KeyPathPool entries", options.repetitions, [&]
+    {
+        Registry::CountingMemoryResource counter;
+        {
+            // The entries themselves: a node pointer, a display name view and a type
+            struct PoolEntry
+            {
+                const Registry::KeyPathPool::Node* key;
+                std::wstring_view displayName;
+                std::uint8_t type;
+            };
+
+            Registry::KeyPathPool pool(&counter);
+            std::pmr::vector<PoolEntry> entries(&counter);
+            for (const auto& match : matches)
+            {
+                entries.push_back({ pool.intern(match.path), pool.store(match.displayName), static_cast<std::uint8_t>(match.product) });
+            }
+            afterCount = entries.size( );
+            after = counter.getStatistics( );
+            afterRetained = after.bytesInUse;
+        }
+    });
+
+    report("strings", before, beforeRetained);
+    report("KeyPathPool", after, afterRetained);
+
+    return (beforeCount == matches.size( ) && afterCount == matches.size( )) ? 0 : 1;
+}
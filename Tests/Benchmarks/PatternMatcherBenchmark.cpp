@@ -0,0 +1,87 @@
+// Display name matching: the compiled PatternMatcher against the loops it replaced, a case-sensitive
+// find per pattern and the same loop over case-folded copies (what case-insensitive matching costs
+// without an automaton).
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+#include "Benchmark.h"
+#include "CaseFolding.h"
+#include "PatternMatcher.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    std::vector<std::wstring> makeDisplayNames(std::size_t count)
+    {
+        static const std::vector<std::wstring> vendors = {
+            L"Microsoft Visual C++ 2015-2022 Redistributable (x64)", L"Google Chrome", L"Mozilla Firefox (x64 en-US)",
+            L"Adobe Acrobat Reader DC", L"Intel(R) Management Engine Components", L"NVIDIA Graphics Driver",
+            L"Realtek High Definition Audio Driver", L"7-Zip 23.01 (x64 edition)", L"Windows SDK AddOn",
+            L"Python 3.12.1 Core Interpreter (64-bit)"
+        };
+
+        std::vector<std::wstring> names;
+        names.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            names.push_back(i % 200 == 0 ? L"WatchGuard AuthPoint Logon App " + std::to_wstring(i)
+                                         : vendors[i % vendors.size( )] + L" " + std::to_wstring(i));
+        }
+        return names;
+    }
+
+    std::wstring fold(std::wstring_view text)
+    {
+        std::wstring folded(text);
+        std::transform(folded.begin( ), folded.end( ), folded.begin( ), Text::foldCase);
+        return folded;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+    const auto names = makeDisplayNames(options.scale(200000));
+    const std::vector<std::wstring> patterns = { L"AuthPoint", L"Logon App", L"LogonApp", L"WatchGuard" };
+
+    std::vector<std::wstring> foldedPatterns;
+    for (const auto& pattern : patterns)
+    {
+        foldedPatterns.push_back(fold(pattern));
+    }
+    const Text::PatternMatcher matcher(patterns);
+
+    std::printf("%zu display names, %zu patterns\n", names.size( ), patterns.size( ));
+
+    std::size_t findMatches = 0, foldedMatches = 0, matcherMatches = 0;
+    Benchmarks::measure("find per pattern (case-sensitive)", options.repetitions, [&]
+    {
+        findMatches = static_cast<std::size_t>(std::count_if(names.begin( ), names.end( ), [&](const std::wstring& name)
+        {
+            return std::any_of(patterns.begin( ), patterns.end( ), [&](const std::wstring& pattern) { return name.find(pattern) != std::wstring::npos; });
+        }));
+    });
+
+    Benchmarks::measure("find per pattern on folded copies", options.repetitions, [&]
+    {
+        foldedMatches = static_cast<std::size_t>(std::count_if(names.begin( ), names.end( ), [&](const std::wstring& name)
+        {
+            const auto folded = fold(name);
+            return std::any_of(foldedPatterns.begin( ), foldedPatterns.end( ), [&](const std::wstring& pattern) { return folded.find(pattern) != std::wstring::npos; });
+        }));
+    });
+
+    Benchmarks::measure("PatternMatcher::matchesAny", options.repetitions, [&]
+    {
+        matcherMatches = static_cast<std::size_t>(std::count_if(names.begin( ), names.end( ), [&](const std::wstring& name)
+        {
+            return matcher.matchesAny(name);
+        }));
+    });
+
+    std::printf("%zu matches\n", matcherMatches);
+    return (findMatches == matcherMatches && foldedMatches == matcherMatches) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+// AuthPoint and per-user registry scans over a synthetic registry (see SyntheticRegistry) held by the
+// in-memory backend: keys visited per second, registry opens, and the memory of the path pool that
+// holds the found keys. Every run is checked against the entries the generator planted.
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <optional>
+
+#include "Benchmark.h"
+#include "KeyPathPool.h"
+#include "PatternMatcher.h"
+#include "UserHiveScanner.h"
+#include "RegistrySelector.h"
+#include "SyntheticRegistry.h"
+#include "ParallelRegistryScanner.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    using Scanner = Registry::ParallelRegistryScanner<const Registry::KeyPathPool::Node*>;
+
+    // Search roots of the AuthPoint cleanup
+    const std::vector<std::wstring> selectors = {
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData\\*\\Products\\*\\InstallProperties:DisplayName",
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\*:DisplayName",
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\Managed\\**:DisplayName",
+        L"Software\\Classes\\Installer\\Products\\*:ProductName"
+    };
+
+    struct ScanStatistics
+    {
+        std::size_t matches = 0;
+        std::size_t keysVisited = 0;
+        std::size_t keysPruned = 0;
+        Registry::KeyPathPool::Statistics pool;
+    };
+
+    ScanStatistics scanMachine(const Registry::IRegistryAccess& registry, const Text::PatternMatcher& matcher, std::size_t workerCount)
+    {
+        Registry::KeyPathPool pool;
+        std::vector<Scanner::Root> roots;
+        for (const auto& text : selectors)
+        {
+            const auto selector = std::make_shared<Registry::RegistrySelector>(text);
+            roots.push_back({
+                .key = registry.openKey(Registry::RegistryHive::LocalMachine, selector->getRootPath( )),
+                .path = selector->getRootPath( ),
+                .visitor = [&matcher, &pool, valueName = selector->getValueName( )](const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t)
+                {
+                    const auto displayName = key.getStringValue(valueName);
+                    return (displayName && matcher.matchesAny(*displayName)) ? std::optional(pool.intern(keyPath)) : std::nullopt;
+                },
+                .maxDepth = selector->getMaxDepth( ),
+                .selector = selector });
+        }
+
+        ScanStatistics statistics;
+        for (const auto& result : Scanner(workerCount).scan(std::move(roots)))
+        {
+            statistics.matches += result.matches.size( );
+            statistics.keysVisited += result.keysVisited;
+            statistics.keysPruned += result.keysPruned;
+        }
+        statistics.pool = pool.getStatistics( );
+        return statistics;
+    }
+
+    std::size_t scanUsers(const Registry::IRegistryAccess& registry, const Text::PatternMatcher& matcher, const std::vector<std::wstring>& sids)
+    {
+        const Registry::UserHiveScanner scanner(matcher);
+        std::size_t matches = 0;
+        for (const auto& sid : sids)
+        {
+            matches += scanner.scan(registry, Registry::RegistryHive::Users, sid).size( );
+        }
+        return matches;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+
+    Registry::SyntheticRegistry::Options treeOptions;
+    treeOptions.productCount = options.scale(20000);
+    treeOptions.sidCount = options.scale(50, 10);
+    treeOptions.userProductCount = 40;
+    treeOptions.matchDensity = 0.01;
+
+    Registry::InMemoryRegistryAccess registry;
+    const auto summary = Registry::SyntheticRegistry::populate(registry, treeOptions);
+    const Text::PatternMatcher matcher(Text::PatternMatcher::parsePatterns(L"AuthPoint|Logon App|LogonApp|WatchGuard"));
+    std::printf("%zu products, %zu SIDs, %zu keys\n", summary.productCount, summary.sids.size( ), summary.keyCount);
+
+    bool correct = true;
+    std::vector<std::size_t> workerCounts{ 1 };
+    if (const std::size_t hardwareThreads = std::thread::hardware_concurrency( ); hardwareThreads > 1)
+    {
+        workerCounts.push_back(hardwareThreads);
+    }
+    for (const std::size_t workerCount : workerCounts)
+    {
+        ScanStatistics statistics;
+        registry.resetStatistics( );
+        const std::string name = "machine scan, " + std::to_string(workerCount) + " workers";
+        const double milliseconds = Benchmarks::measure(name.c_str( ), options.repetitions,
+                                                        [&] { statistics = scanMachine(registry, matcher, workerCount); });
+
+        const auto opened = registry.getStatistics( ).keysOpened / static_cast<std::size_t>(options.repetitions);
+        std::printf("  %zu keys visited (%.0f per second), %zu pruned, %zu registry opens\n",
+                    statistics.keysVisited, statistics.keysVisited * 1000.0 / std::max(milliseconds, 0.001),
+                    statistics.keysPruned, opened);
+        std::printf("  %zu entries found; path pool: %zu keys, %zu heap blocks, %zu bytes\n",
+                    statistics.matches, statistics.pool.nodes, statistics.pool.arenaBlocks, statistics.pool.arenaBytes);
+        correct &= statistics.matches == summary.expectedEntryCount;
+    }
+
+    std::size_t userMatches = 0;
+    Benchmarks::measure("per-user scan, every SID", options.repetitions,
+                        [&] { userMatches = scanUsers(registry, matcher, summary.sids); });
+    std::printf("  %zu entries found\n", userMatches);
+    correct &= userMatches == summary.expectedUserEntryCount;
+
+    if (!correct)
+    {
+        std::printf("unexpected result: %zu machine and %zu per-user entries were generated\n",
+                    summary.expectedEntryCount, summary.expectedUserEntryCount);
+        return 1;
+    }
+    return 0;
+}
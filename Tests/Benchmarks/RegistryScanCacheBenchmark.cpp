@@ -0,0 +1,120 @@
+// Cold and warm AuthPoint-style scans through the registry scan cache, over an offline hive with
+// installed products under Uninstall and Installer\UserData. Reads of a mapped hive are plain memory
+// reads, so the times show the overhead of the cache; the read counts show the registry calls
+// (one system call each on the live registry) that a warm cache saves.
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <optional>
+
+#include "Benchmark.h"
+#include "HiveBuilder.h"
+#include "TestFramework.h"
+#include "PatternMatcher.h"
+#include "RegistrySelector.h"
+#include "RegistryScanCache.h"
+#include "ParallelRegistryScanner.h"
+#include "OfflineHiveRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    using Scanner = Registry::ParallelRegistryScanner<std::wstring>;
+
+    const std::vector<std::wstring> selectors = {
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\UserData\\*\\Products\\*\\InstallProperties:DisplayName",
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\*:DisplayName",
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Installer\\Managed\\**:DisplayName"
+    };
+
+    void buildHive(const std::filesystem::path& path, std::size_t productCount)
+    {
+        Tests::HiveBuilder builder;
+        const auto currentVersion = builder.addKey(builder.addKey(builder.addKey(Tests::HiveBuilder::ROOT, L"Microsoft"), L"Windows"), L"CurrentVersion");
+        const auto uninstall = builder.addKey(currentVersion, L"Uninstall");
+        const auto installer = builder.addKey(currentVersion, L"Installer");
+        builder.addKey(installer, L"Managed");
+        const auto products = builder.addKey(builder.addKey(builder.addKey(installer, L"UserData"), L"S-1-5-18"), L"Products");
+
+        for (std::size_t i = 0; i < productCount; ++i)
+        {
+            const std::wstring name = (i % 50 == 0 ? L"WatchGuard AuthPoint Agent " : L"Vendor Product ") + std::to_wstring(i);
+            const std::wstring code = L"{" + std::to_wstring(10000000 + i) + L"-0000-0000-0000-000000000000}";
+
+            const auto entry = builder.addKey(uninstall, code);
+            builder.setValue(entry, L"Publisher", L"Vendor");
+            builder.setValue(entry, L"DisplayVersion", L"1.0." + std::to_wstring(i));
+            builder.setValue(entry, L"DisplayName", name);
+
+            const auto properties = builder.addKey(builder.addKey(products, std::to_wstring(90000000 + i) + L"00000000000000000000000"), L"InstallProperties");
+            builder.setValue(properties, L"DisplayName", name);
+            builder.addKey(properties, L"Features");
+        }
+        builder.write(path);
+    }
+
+    std::size_t scan(const Registry::IRegistryAccess& registry, const Text::PatternMatcher& matcher)
+    {
+        std::vector<Scanner::Root> roots;
+        for (const auto& text : selectors)
+        {
+            const auto selector = std::make_shared<Registry::RegistrySelector>(text);
+            roots.push_back({
+                .key = registry.openKey(Registry::RegistryHive::LocalMachine, selector->getRootPath( )),
+                .path = selector->getRootPath( ),
+                .visitor = [&matcher, valueName = selector->getValueName( )](const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t)
+                {
+                    const auto displayName = key.getStringValue(valueName);
+                    return (displayName && matcher.matchesAny(*displayName)) ? std::optional<std::wstring>(keyPath) : std::nullopt;
+                },
+                .maxDepth = selector->getMaxDepth( ),
+                .selector = selector });
+        }
+
+        std::size_t matches = 0;
+        for (const auto& result : Scanner(1).scan(std::move(roots)))
+        {
+            matches += result.matches.size( );
+        }
+        return matches;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+    const std::size_t productCount = options.scale(5000);
+
+    Tests::TemporaryDirectory directory;
+    buildHive(directory.path( ) / L"SOFTWARE", productCount);
+    const auto hive = std::make_shared<Registry::OfflineHiveRegistryAccess>(directory.path( ) / L"SOFTWARE");
+    const Text::PatternMatcher matcher({ L"AuthPoint", L"Logon App", L"LogonApp", L"WatchGuard" });
+
+    std::printf("%zu products, 1 scan worker\n", productCount);
+
+    std::size_t expected = 0;
+    Benchmarks::measure("uncached scan", options.repetitions, [&] { expected = scan(*hive, matcher); });
+
+    std::shared_ptr<Registry::RegistryScanCache> cache;
+    std::size_t matches = 0;
+    Benchmarks::measure("cold scan (empty cache)", options.repetitions,
+                        [&] { cache = std::make_shared<Registry::RegistryScanCache>( ); },
+                        [&] { matches = scan(Registry::CachingRegistryAccess(hive, cache), matcher); });
+    const auto cold = cache->getStatistics( );
+
+    Benchmarks::measure("warm scan (cache of the previous scan)", options.repetitions,
+                        [&] { cache = std::make_shared<Registry::RegistryScanCache>( ); scan(Registry::CachingRegistryAccess(hive, cache), matcher); },
+                        [&] { matches = scan(Registry::CachingRegistryAccess(hive, cache), matcher); });
+    const auto warm = cache->getStatistics( );
+
+    std::printf("cold: %zu reads from the hive; warm: %zu from the cache, %zu from the hive\n",
+                cold.misses, warm.hits, warm.misses - cold.misses);
+    if (matches != expected || warm.misses != cold.misses)
+    {
+        std::printf("unexpected result: %zu matches instead of %zu\n", matches, expected);
+        return 1;
+    }
+    return 0;
+}
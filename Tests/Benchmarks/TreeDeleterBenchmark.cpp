@@ -0,0 +1,71 @@
+// Deletes the same generated directory tree with std::filesystem::remove_all and with the
+// handle-relative ParallelTreeDeleter, on one worker and on several. Only the deletion is timed.
+// The outcome decides the default of DirectoryCleanupStrategy, so run it on the disk that matters.
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+#include "Benchmark.h"
+#include "TreeBuilder.h"
+#include "TestFramework.h"
+#include "ParallelTreeDeleter.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    bool benchmarkShape(const char* title, const Tests::TreeShape& shape, const Benchmarks::Options& options)
+    {
+        Tests::TemporaryDirectory directory;
+        const auto tree = directory.path( ) / "tree";
+        const std::uintmax_t expected = Tests::buildTree(tree, shape) + 1;
+        std::filesystem::remove_all(tree);
+        std::printf("%s: %ju items\n", title, expected);
+
+        bool correct = true;
+        std::uintmax_t removed = 0;
+        std::error_code errorCode;
+        const auto build = [&] { Tests::buildTree(tree, shape); };
+        const auto check = [&] { correct &= !errorCode && removed == expected; };
+
+        Benchmarks::measure("  remove_all", options.repetitions, build,
+                            [&] { removed = std::filesystem::remove_all(tree, errorCode); });
+        check( );
+
+        std::vector<std::size_t> workerCounts{ 1, 2 };
+        if (const std::size_t hardwareThreads = std::thread::hardware_concurrency( ); hardwareThreads > 2)
+        {
+            workerCounts.push_back(std::min<std::size_t>(hardwareThreads, 8));
+        }
+        for (const std::size_t workerCount : workerCounts)
+        {
+            const std::string name = "  ParallelTreeDeleter, " + std::to_string(workerCount) + " workers";
+            Benchmarks::measure(name.c_str( ), options.repetitions, build, [&]
+            {
+                FileSystem::ParallelTreeDeleter deleter(workerCount);
+                removed = deleter.removeAll(tree, errorCode);
+            });
+            check( );
+        }
+        return correct;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Benchmarks::Options options(argc, argv);
+
+    // Wide: a data folder with many sub folders. Deep: a long chain of nested folders.
+    bool correct = benchmarkShape("wide tree", { .depth = options.quick ? 2u : 3u, .fanOut = 8, .fileCount = options.scale(40, 4) }, options);
+    correct &= benchmarkShape("deep tree", { .depth = options.scale(200, 20), .fanOut = 1, .fileCount = 20 }, options);
+
+    if (!correct)
+    {
+        std::printf("unexpected result: a deletion failed or removed a different number of items\n");
+        return 1;
+    }
+    return 0;
+}
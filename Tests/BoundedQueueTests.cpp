@@ -0,0 +1,74 @@
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "TestFramework.h"
+
+using namespace WinLogon::CustomActions;
+
+TEST(PopsEverythingQueuedInOrder)
+{
+    Threading::BoundedQueue<int> queue(8);
+    CHECK(queue.push(1) && queue.push(2) && queue.push(3));
+
+    std::vector<int> batch{ 42 };
+    CHECK(queue.popAll(batch));
+    CHECK((batch == std::vector<int>{ 1, 2, 3 }));
+    CHECK(queue.getStatistics( ).pushed == 3 && queue.getStatistics( ).highWaterMark == 3);
+}
+
+TEST(DrainsAfterClose)
+{
+    Threading::BoundedQueue<int> queue(8);
+    queue.push(1);
+    queue.close( );
+    CHECK(!queue.push(2));
+
+    std::vector<int> batch;
+    CHECK(queue.popAll(batch) && batch == std::vector<int>{ 1 });
+    CHECK(!queue.popAll(batch) && batch.empty( ));
+}
+
+TEST(HoldsProducersBackWhileFull)
+{
+    Threading::BoundedQueue<int> queue(4);
+    std::thread producer([&queue]
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            queue.push(i);
+        }
+        queue.close( );
+    });
+
+    std::vector<int> received;
+    std::vector<int> batch;
+    while (queue.popAll(batch))
+    {
+        CHECK(batch.size( ) <= 4);
+        received.insert(received.end( ), batch.begin( ), batch.end( ));
+    }
+    producer.join( );
+
+    CHECK(received.size( ) == 1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        CHECK(received[i] == i);
+    }
+    CHECK(queue.getStatistics( ).highWaterMark <= 4);
+}
+
+TEST(WakesBlockedProducersOnClose)
+{
+    Threading::BoundedQueue<int> queue(1);
+    queue.push(0);
+
+    bool pushed = true;
+    std::thread producer([&queue, &pushed]
+    {
+        pushed = queue.push(1);
+    });
+    queue.close( );
+    producer.join( );
+    CHECK(!pushed);
+}
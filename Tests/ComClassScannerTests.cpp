@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <string_view>
+
+#include "TestFramework.h"
+#include "ComClassScanner.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+using Registry::ComClassScanner;
+using ServerState = ComClassScanner::ServerState;
+
+namespace
+{
+    constexpr auto HKCR = Registry::RegistryHive::ClassesRoot;
+
+    void addClass(Registry::InMemoryRegistryAccess& registry, const std::wstring& clsid, const std::wstring& server)
+    {
+        registry.setStringValue(HKCR, L"CLSID\\" + clsid, L"", clsid + L" Class");
+        registry.setStringValue(HKCR, L"CLSID\\" + clsid + L"\\InprocServer32", L"", server);
+    }
+
+    ComClassScanner makeScanner(std::size_t workerCount)
+    {
+        return ComClassScanner({ L"C:\\Program Files\\WatchGuard\\Logon App" }, { L"WLCredProv.dll" }, workerCount,
+                               [](const std::wstring& path)
+                               {
+                                   std::wstring expanded = path;
+                                   if (expanded.starts_with(L"%ProgramFiles%"))
+                                   {
+                                       expanded.replace(0, 14, L"C:\\Program Files");
+                                   }
+                                   return expanded;
+                               });
+    }
+
+    std::vector<std::wstring> clsids(const std::vector<ComClassScanner::Match>& matches)
+    {
+        std::vector<std::wstring> result;
+        for (const auto& match : matches)
+        {
+            result.push_back(match.clsid);
+        }
+        return result;
+    }
+}
+
+TEST(FindsClassesServedByOurBinaries)
+{
+    Registry::InMemoryRegistryAccess registry;
+    addClass(registry, L"{A1}", L"C:\\Windows\\System32\\WLCredProv.dll");
+    addClass(registry, L"{A2}", L"wlcredprov.DLL");
+    addClass(registry, L"{A3}", L"\"C:\\Program Files\\WatchGuard\\Logon App\\WLTile.dll\"");
+    addClass(registry, L"{A4}", L"%ProgramFiles%\\WatchGuard\\Logon App\\LogonAppShell.dll");
+    addClass(registry, L"{B1}", L"C:\\Program Files\\WatchGuard\\Logon App Agent\\Agent.dll");      // Another folder
+    addClass(registry, L"{B2}", L"C:\\Program Files\\Contoso\\WLCredProv.dll.bak");
+    addClass(registry, L"{B3}", L"");
+    registry.setStringValue(HKCR, L"CLSID\\{B4}\\LocalServer32", L"", L"C:\\Program Files\\WatchGuard\\Logon App\\wl.exe");
+
+    for (const std::size_t workerCount : { 1, 3 })
+    {
+        const auto result = makeScanner(workerCount).scan(registry, HKCR, L"CLSID");
+        CHECK(result.classCount == 8 && result.serverCount == 6);
+        CHECK((clsids(result.matches) == std::vector<std::wstring>{ L"{A1}", L"{A2}", L"{A3}", L"{A4}" }));
+        CHECK(result.matches.size( ) == 4 &&
+              result.matches[2].serverPath == L"C:\\Program Files\\WatchGuard\\Logon App\\WLTile.dll" &&
+              result.matches[3].serverPath == L"C:\\Program Files\\WatchGuard\\Logon App\\LogonAppShell.dll");
+    }
+
+    CHECK(makeScanner(1).scan(registry, HKCR, L"WOW6432Node\\CLSID").classCount == 0);
+}
+
+TEST(KeepsClassesWhoseServerIsPresentOrUnknown)
+{
+    Registry::InMemoryRegistryAccess registry;
+    addClass(registry, L"{A1}", L"C:\\Program Files\\WatchGuard\\Logon App\\Present.dll");
+    addClass(registry, L"{A2}", L"C:\\Program Files\\WatchGuard\\Logon App\\Missing.dll");
+    addClass(registry, L"{A3}", L"C:\\Program Files\\WatchGuard\\Logon App\\Denied.dll");
+    addClass(registry, L"{A4}", L"C:\\Program Files\\WatchGuard\\Logon App\\Gone.dll");
+
+    const auto result = makeScanner(2).scan(registry, HKCR, L"CLSID");
+    const auto orphans = ComClassScanner::findOrphans(result.matches, [](const std::wstring& serverPath)
+    {
+        if (serverPath.ends_with(L"Present.dll"))
+        {
+            return ServerState::Present;
+        }
+        return serverPath.ends_with(L"Denied.dll") ? ServerState::Unknown : ServerState::Missing;
+    });
+
+    CHECK((clsids(orphans.orphaned) == std::vector<std::wstring>{ L"{A2}", L"{A4}" }));
+    CHECK((clsids(orphans.kept) == std::vector<std::wstring>{ L"{A1}", L"{A3}" }));
+}
+
+TEST(ChecksServerFilesOnDisk)
+{
+    Tests::TemporaryDirectory directory;
+    const auto system = directory.path( ) / L"System32";
+    std::filesystem::create_directories(system);
+    std::ofstream(system / L"WLCredProv.dll") << "MZ";
+    std::ofstream(directory.path( ) / L"LogonAppShell.dll") << "MZ";
+
+    const auto probe = [&system](std::wstring_view serverPath, bool withSystemFolder)
+    {
+        return ComClassScanner::probeServer(std::wstring(serverPath), withSystemFolder ? system : std::filesystem::path( ));
+    };
+    const std::wstring present = (directory.path( ) / L"LogonAppShell.dll").wstring( );
+    const std::wstring missing = (directory.path( ) / L"WLTile.dll").wstring( );
+
+    CHECK(probe(present, true) == ServerState::Present);
+    CHECK(probe(missing, true) == ServerState::Missing);
+
+    // Without a folder the server is looked up in the system folder; without one it cannot be checked
+    CHECK(probe(L"WLCredProv.dll", true) == ServerState::Present);
+    CHECK(probe(L"WLTile.dll", true) == ServerState::Missing);
+    CHECK(probe(L"WLCredProv.dll", false) == ServerState::Unknown);
+    CHECK(probe(L"WLTile.dll", false) == ServerState::Unknown);
+
+    // A class whose server cannot be checked is never returned for removal
+    const std::vector<ComClassScanner::Match> matches = {
+        { L"{A1}", present }, { L"{A2}", missing }, { L"{A3}", L"WLTile.dll" }
+    };
+    const auto orphans = ComClassScanner::findOrphans(matches, [&probe](const std::wstring& serverPath) { return probe(serverPath, false); });
+    CHECK((clsids(orphans.orphaned) == std::vector<std::wstring>{ L"{A2}" }));
+    CHECK((clsids(orphans.kept) == std::vector<std::wstring>{ L"{A1}", L"{A3}" }));
+}
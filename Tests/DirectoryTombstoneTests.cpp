@@ -0,0 +1,229 @@
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "TreeBuilder.h"
+#include "TestFramework.h"
+#include "DirectoryTombstone.h"
+
+using namespace WinLogon::CustomActions;
+using FileSystem::DirectoryTombstone;
+
+namespace
+{
+    const Tests::TreeShape shape{ .depth = 2, .fanOut = 3, .fileCount = 4 };
+
+    constexpr auto SESSION = L"{6F1B2C3D-0000-4A5B-9C8D-112233445566}";
+
+    // A tombstone with its record, the way bury leaves them, made by somebody else
+    std::filesystem::path plantTombstone(const std::filesystem::path& root, const std::string& name, const std::string& origin)
+    {
+        const auto tombstone = root / name;
+        Tests::buildTree(tombstone, shape);
+        std::ofstream(root / (name + ".origin"), std::ios::binary) << origin;
+        return tombstone;
+    }
+}
+
+TEST(RestoresBuriedDirectories)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto target = directory.path( ) / "Logon App";
+    Tests::buildTree(target, shape);
+
+    std::error_code errorCode;
+    const auto tombstone = DirectoryTombstone::bury(target, root, SESSION, errorCode);
+    CHECK(!errorCode);
+    CHECK(!std::filesystem::exists(target));
+    CHECK(tombstone.parent_path( ) == root && std::filesystem::exists(tombstone));
+
+    const std::vector<std::filesystem::path> allowed{ target };
+    const auto restored = DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode);
+    CHECK(!errorCode);
+    CHECK(restored.size( ) == 1);
+    CHECK(!restored[0].error && restored[0].origin == target);
+    CHECK(std::filesystem::exists(target / "dir1" / "log1.txt"));
+    CHECK(!std::filesystem::exists(root));
+}
+
+TEST(DoesNotRestoreOverAnExistingDirectory)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto target = directory.path( ) / "Logon App";
+    Tests::buildTree(target, shape);
+
+    std::error_code errorCode;
+    const auto tombstone = DirectoryTombstone::bury(target, root, SESSION, errorCode);
+    std::filesystem::create_directories(target);
+    std::ofstream(target / "new.txt") << "data";
+
+    const std::vector<std::filesystem::path> allowed{ target };
+    const auto restored = DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode);
+    CHECK(!errorCode);
+    CHECK(restored.size( ) == 1 && restored[0].error);
+    CHECK(std::filesystem::exists(tombstone));
+    CHECK(std::filesystem::exists(target / "new.txt"));
+}
+
+TEST(PurgesEveryTombstoneAndTheirFolder)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto expected = Tests::buildTree(directory.path( ) / "Logon App", shape) + 1;
+    Tests::buildTree(directory.path( ) / "Logon App Data", shape);
+
+    std::error_code errorCode;
+    DirectoryTombstone::bury(directory.path( ) / "Logon App", root, SESSION, errorCode);
+    DirectoryTombstone::bury(directory.path( ) / "Logon App Data", root, L"other-session", errorCode);
+    CHECK(!errorCode);
+
+    // Whichever session buried them
+    const std::vector<std::filesystem::path> allowed{ directory.path( ) / "Logon App", directory.path( ) / "Logon App Data" };
+    const auto purged = DirectoryTombstone::purgeAll(root, allowed, 2);
+    CHECK(!purged.error);
+    CHECK(purged.tombstonesPurged == 2);
+    CHECK(purged.itemsRemoved == 2 * expected);
+    CHECK(purged.itemsScheduled == 0);
+    CHECK(!std::filesystem::exists(root));
+}
+
+// A purge that was killed after deleting the records and part of a tombstone: nothing can be
+// restored any more, and the next purge deletes the rest, the tombstone folder included
+TEST(CompletesAnInterruptedPurge)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    Tests::buildTree(directory.path( ) / "Logon App", shape);
+    Tests::buildTree(directory.path( ) / "Logon App Data", shape);
+
+    std::error_code errorCode;
+    const auto first = DirectoryTombstone::bury(directory.path( ) / "Logon App", root, SESSION, errorCode);
+    const auto second = DirectoryTombstone::bury(directory.path( ) / "Logon App Data", root, SESSION, errorCode);
+    CHECK(!errorCode);
+
+    for (const auto& tombstone : { first, second })
+    {
+        auto record = tombstone;
+        record += ".origin";
+        CHECK(std::filesystem::remove(record));
+    }
+    std::filesystem::remove_all(first / "dir1");
+    std::filesystem::remove(first / "log1.txt");
+
+    const std::vector<std::filesystem::path> allowed{ directory.path( ) / "Logon App", directory.path( ) / "Logon App Data" };
+    CHECK(DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode).empty( ) && !errorCode);
+    CHECK(std::filesystem::exists(first) && std::filesystem::exists(second));
+
+    const auto purged = DirectoryTombstone::purgeAll(root, allowed);
+    CHECK(!purged.error);
+    CHECK(purged.tombstonesPurged == 2);
+    CHECK(!std::filesystem::exists(root));
+    CHECK(!std::filesystem::exists(directory.path( ) / "Logon App"));
+}
+
+TEST(PurgesRecordsLeftWithoutTombstone)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    std::filesystem::create_directories(root);
+    std::ofstream(root / "Logon App.1.origin") << "C:\\Program Files\\WatchGuard\\Logon App";
+
+    const std::vector<std::filesystem::path> allowed{ L"C:\\Program Files\\WatchGuard\\Logon App" };
+    const auto purged = DirectoryTombstone::purgeAll(root, allowed);
+    CHECK(purged.tombstonesPurged == 0 && !purged.error);
+    CHECK(!std::filesystem::exists(root));
+}
+
+// A standard user can create the tombstone folder before us and fill it with records naming any path;
+// a folder anybody may write to is refused, whatever it holds
+TEST(RefusesATombstoneFolderItDoesNotTrust)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto target = directory.path( ) / "Logon App";
+    std::filesystem::create_directories(root);
+    const auto planted = plantTombstone(root, "Logon App.{6F1B2C3D-0000-4A5B-9C8D-112233445566}.1", target.string( ));
+    std::filesystem::permissions(root, std::filesystem::perms::all);
+    CHECK(!DirectoryTombstone::isTrustedRoot(root));
+
+    std::error_code errorCode;
+    const std::vector<std::filesystem::path> allowed{ target };
+    CHECK(DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode).empty( ));
+    CHECK(errorCode == std::errc::permission_denied);
+    CHECK(!std::filesystem::exists(target) && std::filesystem::exists(planted));
+
+    const auto purged = DirectoryTombstone::purgeAll(root, allowed);
+    CHECK(purged.error == std::errc::permission_denied && purged.tombstonesPurged == 0);
+    CHECK(std::filesystem::exists(planted));
+
+    // Nothing is buried there either
+    Tests::buildTree(target, shape);
+    CHECK(DirectoryTombstone::bury(target, root, SESSION, errorCode).empty( ));
+    CHECK(errorCode == std::errc::permission_denied);
+    CHECK(std::filesystem::exists(target / "dir1" / "log1.txt"));
+}
+
+TEST(RestoresOnlyTheTombstonesOfItsSession)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto target = directory.path( ) / "Logon App";
+    const auto other = directory.path( ) / "Logon App Data";
+    Tests::buildTree(target, shape);
+    Tests::buildTree(other, shape);
+
+    std::error_code errorCode;
+    DirectoryTombstone::bury(target, root, SESSION, errorCode);
+    const auto otherTombstone = DirectoryTombstone::bury(other, root, L"another-installation", errorCode);
+    CHECK(!errorCode);
+
+    const std::vector<std::filesystem::path> allowed{ target, other };
+    const auto restored = DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode);
+    CHECK(!errorCode);
+    CHECK(restored.size( ) == 1 && !restored[0].error && restored[0].origin == target);
+    CHECK(std::filesystem::exists(target / "dir1" / "log1.txt"));
+    CHECK(!std::filesystem::exists(other) && std::filesystem::exists(otherTombstone));
+
+    // Without a session nothing is restored
+    CHECK(DirectoryTombstone::restoreAll(root, L"", allowed, errorCode).empty( ) && !errorCode);
+    CHECK(DirectoryTombstone::restoreAll(root, L"..\\x", allowed, errorCode).empty( ) && !errorCode);
+    CHECK(std::filesystem::exists(otherTombstone));
+}
+
+// A record pointing outside the allowed paths, e.g. to a system folder, is never renamed to nor purged
+TEST(RefusesOriginsOutsideTheAllowedPaths)
+{
+    Tests::TemporaryDirectory directory;
+    const auto root = directory.path( ) / "tombstones";
+    const auto target = directory.path( ) / "Logon App";
+    const auto outside = directory.path( ) / "System32";
+    Tests::buildTree(target, shape);
+
+    std::error_code errorCode;
+    DirectoryTombstone::bury(target, root, SESSION, errorCode);
+    CHECK(!errorCode && DirectoryTombstone::isTrustedRoot(root));
+    const auto planted = plantTombstone(root, "System32.{6F1B2C3D-0000-4A5B-9C8D-112233445566}.1", outside.string( ));
+
+    const std::vector<std::filesystem::path> allowed{ target };
+    const auto restored = DirectoryTombstone::restoreAll(root, SESSION, allowed, errorCode);
+    CHECK(!errorCode);
+    CHECK(restored.size( ) == 2);
+    for (const auto& result : restored)
+    {
+        CHECK(result.origin == target ? !result.error : result.error == std::errc::operation_not_permitted);
+    }
+    CHECK(std::filesystem::exists(target / "dir1" / "log1.txt"));
+    CHECK(!std::filesystem::exists(outside) && std::filesystem::exists(planted));
+
+    // The purge leaves it, and its record, alone
+    DirectoryTombstone::bury(target, root, SESSION, errorCode);
+    const auto purged = DirectoryTombstone::purgeAll(root, allowed);
+    CHECK(purged.tombstonesPurged == 1 && purged.tombstonesRefused == 1);
+    CHECK(purged.error == std::errc::operation_not_permitted);
+    CHECK(std::filesystem::exists(planted / "dir1" / "log1.txt"));
+    CHECK(std::filesystem::exists(root / "System32.{6F1B2C3D-0000-4A5B-9C8D-112233445566}.1.origin"));
+    CHECK(!std::filesystem::exists(target));
+}
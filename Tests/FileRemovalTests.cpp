@@ -0,0 +1,100 @@
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <system_error>
+
+#include "FileRemoval.h"
+#include "TestFramework.h"
+#include "InMemoryFileAccess.h"
+
+using namespace WinLogon::CustomActions;
+using FileSystem::FileAttribute;
+using FileSystem::FileRemovalResult;
+using FileSystem::InMemoryFileAccess;
+
+namespace
+{
+    constexpr std::uint32_t ARCHIVE = 0x20;
+
+    std::vector<std::filesystem::path> addFiles(InMemoryFileAccess& fileAccess, std::size_t count)
+    {
+        std::vector<std::filesystem::path> paths;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            paths.emplace_back(L"C:\\Program Files\\WatchGuard\\Logon App\\file" + std::to_wstring(i) + L".dll");
+            // Every other file carries the attributes the classic deletion has to clear
+            fileAccess.addFile(paths.back( ), (i % 2 == 0) ? FileAttribute::READONLY | FileAttribute::HIDDEN : ARCHIVE);
+        }
+        return paths;
+    }
+}
+
+TEST(OpensEachRemovedFileOnce)
+{
+    for (const bool posixDeletion : { true, false })
+    {
+        InMemoryFileAccess fileAccess;
+        fileAccess.setPosixDeletionSupported(posixDeletion);
+        const auto paths = addFiles(fileAccess, 10);
+
+        std::error_code errorCode;
+        for (const auto& path : paths)
+        {
+            CHECK(FileSystem::removeFile(fileAccess, path, errorCode) == FileRemovalResult::Removed);
+            CHECK(!errorCode);
+            CHECK(!fileAccess.exists(path));
+        }
+
+        const auto statistics = fileAccess.getStatistics( );
+        CHECK(statistics.opens == paths.size( ));
+        CHECK(statistics.closes == paths.size( ));
+    }
+}
+
+TEST(MarksForDeletionOnceWithPosixSemantics)
+{
+    InMemoryFileAccess fileAccess;
+    fileAccess.addFile(L"C:\\Windows\\System32\\WLCredProv.dll", FileAttribute::READONLY | FileAttribute::HIDDEN | FileAttribute::SYSTEM);
+
+    std::error_code errorCode;
+    CHECK(FileSystem::removeFile(fileAccess, L"c:\\windows\\system32\\wlcredprov.dll", errorCode) == FileRemovalResult::Removed);
+    CHECK(!fileAccess.exists(L"C:\\Windows\\System32\\WLCredProv.dll"));
+
+    const auto statistics = fileAccess.getStatistics( );
+    CHECK(statistics.dispositions == 1);
+    CHECK(statistics.attributeReads == 0 && statistics.attributeWrites == 0);
+}
+
+TEST(ClearsAttributesThroughTheSameHandleWithoutPosixSemantics)
+{
+    InMemoryFileAccess fileAccess;
+    fileAccess.setPosixDeletionSupported(false);
+    fileAccess.addFile(L"C:\\readonly.dll", FileAttribute::READONLY | ARCHIVE);
+    fileAccess.addFile(L"C:\\plain.dll", ARCHIVE);
+
+    std::error_code errorCode;
+    CHECK(FileSystem::removeFile(fileAccess, L"C:\\readonly.dll", errorCode) == FileRemovalResult::Removed);
+    auto statistics = fileAccess.getStatistics( );
+    CHECK(statistics.opens == 1 && statistics.attributeWrites == 1 && statistics.dispositions == 2);
+
+    fileAccess.resetStatistics( );
+    CHECK(FileSystem::removeFile(fileAccess, L"C:\\plain.dll", errorCode) == FileRemovalResult::Removed);
+    statistics = fileAccess.getStatistics( );
+    CHECK(statistics.opens == 1 && statistics.attributeWrites == 0);
+    CHECK(!fileAccess.exists(L"C:\\readonly.dll") && !fileAccess.exists(L"C:\\plain.dll"));
+}
+
+TEST(ClassifiesFilesThatCannotBeRemoved)
+{
+    InMemoryFileAccess fileAccess;
+    fileAccess.addFile(L"C:\\busy.dll", 0, InMemoryFileAccess::FileState::InUse);
+    fileAccess.addFile(L"C:\\denied.dll", 0, InMemoryFileAccess::FileState::AccessDenied);
+
+    std::error_code errorCode;
+    CHECK(FileSystem::removeFile(fileAccess, L"C:\\missing.dll", errorCode) == FileRemovalResult::NotFound);
+    CHECK(errorCode);
+    CHECK(FileSystem::removeFile(fileAccess, L"C:\\busy.dll", errorCode) == FileRemovalResult::InUse);
+    CHECK(FileSystem::removeFile(fileAccess, L"C:\\denied.dll", errorCode) == FileRemovalResult::AccessDenied);
+    CHECK(fileAccess.exists(L"C:\\busy.dll") && fileAccess.exists(L"C:\\denied.dll"));
+    CHECK(fileAccess.getStatistics( ).opens == 3);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <filesystem>
+
+namespace WinLogon::CustomActions::Tests
+{
+    // Writes small regf hive files for OfflineHiveRegistryAccess: one hbin, lf sub key lists,
+    // compressed names and REG_SZ values. addLink corrupts the tree the way a damaged hive would.
+    class HiveBuilder
+    {
+    public:
+        static constexpr std::size_t ROOT = 0;
+
+        HiveBuilder( )
+        {
+            m_nodes.push_back({ L"ROOT", ROOT, { }, { } });
+        }
+
+        std::size_t addKey(std::size_t parent, std::wstring name)
+        {
+            m_nodes.push_back({ std::move(name), parent, { }, { } });
+            m_nodes[parent].children.push_back(m_nodes.size( ) - 1);
+            return m_nodes.size( ) - 1;
+        }
+
+        void setValue(std::size_t key, std::wstring name, std::wstring value)
+        {
+            m_nodes[key].values.emplace_back(std::move(name), std::move(value));
+        }
+
+        // Lists an existing key as a sub key of key as well, without changing its parent
+        void addLink(std::size_t key, std::size_t subKey)
+        {
+            m_nodes[key].children.push_back(subKey);
+        }
+
+        void write(const std::filesystem::path& path) const
+        {
+            std::vector<std::uint8_t> file(HBINS_START + HBIN_HEADER_SIZE, 0);
+
+            std::vector<std::uint32_t> offsets;
+            for (const auto& node : m_nodes)
+            {
+                offsets.push_back(allocate(file, 0x4C + node.name.size( )));
+            }
+
+            for (std::size_t i = 0; i < m_nodes.size( ); ++i)
+            {
+                const auto& node = m_nodes[i];
+                const std::size_t nk = HBINS_START + offsets[i] + 4;
+                std::memcpy(&file[nk], "nk", 2);
+                put<std::uint16_t>(file, nk + 0x02, static_cast<std::uint16_t>(i == ROOT ? 0x2C : 0x20));
+                put<std::uint64_t>(file, nk + 0x04, 132000000000000000ULL + i);
+                put<std::uint32_t>(file, nk + 0x10, i == ROOT ? NO_OFFSET : offsets[node.parent]);
+                put<std::uint32_t>(file, nk + 0x14, static_cast<std::uint32_t>(node.children.size( )));
+                put<std::uint32_t>(file, nk + 0x1C, NO_OFFSET);
+                put<std::uint32_t>(file, nk + 0x20, NO_OFFSET);
+                put<std::uint32_t>(file, nk + 0x24, static_cast<std::uint32_t>(node.values.size( )));
+                put<std::uint32_t>(file, nk + 0x28, NO_OFFSET);
+                put<std::uint32_t>(file, nk + 0x2C, NO_OFFSET);
+                put<std::uint32_t>(file, nk + 0x30, NO_OFFSET);
+                put<std::uint16_t>(file, nk + 0x48, static_cast<std::uint16_t>(node.name.size( )));
+                putLatin1(file, nk + 0x4C, node.name);
+
+                if (!node.children.empty( ))
+                {
+                    const std::uint32_t list = allocate(file, 4 + 8 * node.children.size( ));
+                    const std::size_t lf = HBINS_START + list + 4;
+                    std::memcpy(&file[lf], "lf", 2);
+                    put<std::uint16_t>(file, lf + 0x02, static_cast<std::uint16_t>(node.children.size( )));
+                    for (std::size_t j = 0; j < node.children.size( ); ++j)
+                    {
+                        put<std::uint32_t>(file, lf + 4 + 8 * j, offsets[node.children[j]]);
+                    }
+                    put<std::uint32_t>(file, nk + 0x1C, list);
+                }
+
+                if (!node.values.empty( ))
+                {
+                    const std::uint32_t list = allocate(file, 4 * node.values.size( ));
+                    for (std::size_t j = 0; j < node.values.size( ); ++j)
+                    {
+                        const auto& [name, text] = node.values[j];
+                        const std::uint32_t value = allocate(file, 0x14 + name.size( ));
+                        const std::uint32_t data = allocate(file, (text.size( ) + 1) * 2);
+
+                        const std::size_t vk = HBINS_START + value + 4;
+                        std::memcpy(&file[vk], "vk", 2);
+                        put<std::uint16_t>(file, vk + 0x02, static_cast<std::uint16_t>(name.size( )));
+                        put<std::uint32_t>(file, vk + 0x04, static_cast<std::uint32_t>((text.size( ) + 1) * 2));
+                        put<std::uint32_t>(file, vk + 0x08, data);
+                        put<std::uint32_t>(file, vk + 0x0C, REG_SZ_TYPE);
+                        put<std::uint16_t>(file, vk + 0x10, 0x0001);
+                        putLatin1(file, vk + 0x14, name);
+
+                        for (std::size_t k = 0; k < text.size( ); ++k)
+                        {
+                            put<std::uint16_t>(file, HBINS_START + data + 4 + 2 * k, static_cast<std::uint16_t>(text[k]));
+                        }
+                        put<std::uint32_t>(file, HBINS_START + list + 4 + 4 * j, value);
+                    }
+                    put<std::uint32_t>(file, nk + 0x28, list);
+                }
+            }
+
+            file.resize(HBINS_START + (file.size( ) - HBINS_START + 0xFFF) / 0x1000 * 0x1000, 0);
+            const auto hbinsSize = static_cast<std::uint32_t>(file.size( ) - HBINS_START);
+
+            std::memcpy(&file[0], "regf", 4);
+            put<std::uint32_t>(file, 0x14, 1);
+            put<std::uint32_t>(file, 0x18, 5);
+            put<std::uint32_t>(file, 0x24, offsets[ROOT]);
+            put<std::uint32_t>(file, 0x28, hbinsSize);
+            std::memcpy(&file[HBINS_START], "hbin", 4);
+            put<std::uint32_t>(file, HBINS_START + 0x08, hbinsSize);
+
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(file.data( )), static_cast<std::streamsize>(file.size( )));
+        }
+
+    private:
+        static constexpr std::size_t HBINS_START = 0x1000;
+        static constexpr std::size_t HBIN_HEADER_SIZE = 0x20;
+        static constexpr std::uint32_t NO_OFFSET = 0xFFFFFFFF;
+        static constexpr std::uint32_t REG_SZ_TYPE = 1;
+
+        struct Node
+        {
+            std::wstring name;
+            std::size_t parent;
+            std::vector<std::size_t> children;
+            std::vector<std::pair<std::wstring, std::wstring>> values;
+        };
+
+        std::vector<Node> m_nodes;
+
+        // Appends a zeroed allocated cell and returns its offset from the start of the hive bins
+        static std::uint32_t allocate(std::vector<std::uint8_t>& file, std::size_t payloadSize)
+        {
+            const std::size_t cellSize = (payloadSize + 4 + 7) / 8 * 8;
+            const auto offset = static_cast<std::uint32_t>(file.size( ) - HBINS_START);
+            file.resize(file.size( ) + cellSize, 0);
+            put<std::int32_t>(file, HBINS_START + offset, -static_cast<std::int32_t>(cellSize));
+            return offset;
+        }
+
+        template<typename T>
+        static void put(std::vector<std::uint8_t>& file, std::size_t position, T value)
+        {
+            std::memcpy(&file[position], &value, sizeof(value));
+        }
+
+        static void putLatin1(std::vector<std::uint8_t>& file, std::size_t position, const std::wstring& text)
+        {
+            for (std::size_t i = 0; i < text.size( ); ++i)
+            {
+                file[position + i] = static_cast<std::uint8_t>(text[i]);
+            }
+        }
+    };
+}
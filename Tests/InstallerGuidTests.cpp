@@ -0,0 +1,50 @@
+#include <string>
+
+#include "TestFramework.h"
+#include "InstallerGuid.h"
+
+using namespace WinLogon::CustomActions;
+using Registry::InstallerGuid;
+
+TEST(PacksRegistryFormattedGuids)
+{
+    CHECK(InstallerGuid::pack(L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA5}") == L"94327BCB79C6F3E4495BE60A548FC55A");
+    CHECK(InstallerGuid::pack(L"BCB72349-6C97-4E3F-94B5-6EA045F85CA5") == L"94327BCB79C6F3E4495BE60A548FC55A");
+    CHECK(InstallerGuid::pack(L"{bcb72349-6c97-4e3f-94b5-6ea045f85ca5}") == L"94327BCB79C6F3E4495BE60A548FC55A");
+    CHECK(InstallerGuid::pack(L"{00000000-0000-0000-0000-000000000000}") == std::wstring(32, L'0'));
+}
+
+TEST(UnpacksPackedGuids)
+{
+    CHECK(InstallerGuid::unpack(L"94327BCB79C6F3E4495BE60A548FC55A") == L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA5}");
+    CHECK(InstallerGuid::unpack(L"94327bcb79c6f3e4495be60a548fc55a") == L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA5}");
+}
+
+TEST(RoundTripsEveryDigitPosition)
+{
+    const std::wstring digits = L"0123456789ABCDEFFEDCBA9876543210";
+    for (std::size_t i = 0; i < digits.size( ); ++i)
+    {
+        std::wstring packed = digits;
+        std::swap(packed[0], packed[i]);
+        const auto guid = InstallerGuid::unpack(packed);
+        CHECK(guid && InstallerGuid::pack(*guid) == packed);
+    }
+}
+
+TEST(RejectsWhatIsNotAGuid)
+{
+    CHECK(!InstallerGuid::pack(L""));
+    CHECK(!InstallerGuid::pack(L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA}"));      // One digit short
+    CHECK(!InstallerGuid::pack(L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA55}"));    // One digit too many
+    CHECK(!InstallerGuid::pack(L"{BCB72349-6C974-E3F-94B5-6EA045F85CA5}"));     // Misplaced dash
+    CHECK(!InstallerGuid::pack(L"{BCB7234G-6C97-4E3F-94B5-6EA045F85CA5}"));     // Not hexadecimal
+    CHECK(!InstallerGuid::pack(L"(BCB72349-6C97-4E3F-94B5-6EA045F85CA5)"));
+    CHECK(!InstallerGuid::pack(L"94327BCB79C6F3E4495BE60A548FC55A"));          // Already packed
+
+    CHECK(!InstallerGuid::unpack(L""));
+    CHECK(!InstallerGuid::unpack(L"94327BCB79C6F3E4495BE60A548FC55"));
+    CHECK(!InstallerGuid::unpack(L"94327BCB79C6F3E4495BE60A548FC55AB"));
+    CHECK(!InstallerGuid::unpack(L"94327BCB79C6F3E4495BE60A548FC55Z"));
+    CHECK(!InstallerGuid::unpack(L"{BCB72349-6C97-4E3F-94B5-6EA045F85CA5}"));
+}
@@ -0,0 +1,100 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory_resource>
+
+#include "KeyPathPool.h"
+#include "TestFramework.h"
+
+using namespace WinLogon::CustomActions;
+using Registry::KeyPathPool;
+
+TEST(SharesPrefixesBetweenPaths)
+{
+    KeyPathPool pool;
+    const auto* first = pool.intern(L"SOFTWARE\\Microsoft\\Uninstall\\{A}");
+    const auto* second = pool.intern(L"SOFTWARE\\Microsoft\\Uninstall\\{B}");
+    const auto* parent = pool.intern(L"SOFTWARE\\Microsoft\\Uninstall");
+
+    CHECK(first != second);
+    CHECK(first->parent == parent && second->parent == parent);
+    CHECK(KeyPathPool::isAncestorOf(parent, first));
+    CHECK(!KeyPathPool::isAncestorOf(first, parent));
+    CHECK(KeyPathPool::toString(first) == L"SOFTWARE\\Microsoft\\Uninstall\\{A}");
+    CHECK(first->pathLength == KeyPathPool::toString(first).size( ));
+    CHECK(pool.getStatistics( ).nodes == 5);
+
+    // Empty components (doubled or trailing separators) are ignored
+    CHECK(pool.intern(L"SOFTWARE\\\\Microsoft\\Uninstall\\") == parent);
+    CHECK(pool.intern(L"") == nullptr);
+    CHECK(KeyPathPool::toString(nullptr).empty( ));
+}
+
+TEST(InternsComponentsIgnoringCase)
+{
+    KeyPathPool pool;
+    const auto* key = pool.intern(L"SOFTWARE\\Classes\\Installer\\Products\\94327BCB79C6F3E4495BE60A548FC55A");
+    CHECK(pool.intern(L"software\\CLASSES\\installer\\products\\94327bcb79c6f3e4495be60a548fc55a") == key);
+
+    // The first spelling is kept
+    CHECK(KeyPathPool::toString(pool.intern(L"software\\classes")) == L"SOFTWARE\\Classes");
+    CHECK(pool.getStatistics( ).nodes == 5);
+}
+
+TEST(StoresEqualTextsOnce)
+{
+    KeyPathPool pool;
+    const auto first = pool.store(L"WatchGuard AuthPoint Agent");
+    const auto second = pool.store(std::wstring(L"WatchGuard AuthPoint Agent"));
+    const auto other = pool.store(L"watchguard authpoint agent");
+
+    CHECK(first == L"WatchGuard AuthPoint Agent");
+    CHECK(first.data( ) == second.data( ));
+    CHECK(other.data( ) != first.data( ));   // Display names are kept as they are, case included
+    CHECK(pool.store(L"").empty( ));
+}
+
+TEST(InternsFromSeveralThreads)
+{
+    KeyPathPool pool;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<const KeyPathPool::Node*>> nodes(4);
+    for (std::size_t t = 0; t < nodes.size( ); ++t)
+    {
+        threads.emplace_back([&pool, &nodes, t]
+        {
+            for (int i = 0; i < 500; ++i)
+            {
+                nodes[t].push_back(pool.intern(L"SOFTWARE\\Uninstall\\Product" + std::to_wstring(i) + L"\\InstallProperties"));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join( );
+    }
+
+    for (std::size_t t = 1; t < nodes.size( ); ++t)
+    {
+        CHECK(nodes[t] == nodes[0]);
+    }
+    CHECK(pool.getStatistics( ).nodes == 2 + 500 * 2);
+}
+
+TEST(CountsArenaMemory)
+{
+    Registry::CountingMemoryResource upstream;
+    {
+        KeyPathPool pool(&upstream);
+        for (int i = 0; i < 1000; ++i)
+        {
+            pool.intern(L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\Product" + std::to_wstring(i));
+        }
+
+        const auto statistics = pool.getStatistics( );
+        CHECK(statistics.arenaBlocks > 0 && statistics.arenaBytes > 0);
+        CHECK(statistics.arenaBlocks < 100);   // Blocks, not one allocation per name
+        CHECK(upstream.getStatistics( ).bytesInUse == statistics.arenaBytes);
+    }
+    CHECK(upstream.getStatistics( ).bytesInUse == 0);
+}
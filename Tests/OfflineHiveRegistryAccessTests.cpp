@@ -0,0 +1,133 @@
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "HiveBuilder.h"
+#include "TestFramework.h"
+#include "RegistrySelector.h"
+#include "ParallelRegistryScanner.h"
+#include "OfflineHiveRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+using Tests::HiveBuilder;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+
+    // Scans HKLM\SOFTWARE\Root with an unbounded selector, like the Managed\** search root
+    std::size_t scanEverything(const Registry::IRegistryAccess& registry, std::size_t workerCount)
+    {
+        using Scanner = Registry::ParallelRegistryScanner<int>;
+
+        const auto selector = std::make_shared<Registry::RegistrySelector>(L"SOFTWARE\\Root\\**");
+        std::vector<Scanner::Root> roots;
+        roots.push_back({
+            .key = registry.openKey(HKLM, selector->getRootPath( )),
+            .path = selector->getRootPath( ),
+            .visitor = [](const std::wstring&, const Registry::IRegistryKey&, std::size_t) { return std::optional<int>(1); },
+            .maxDepth = selector->getMaxDepth( ),
+            .selector = selector });
+
+        Scanner scanner(workerCount, 1);
+        return scanner.scan(std::move(roots)).front( ).matches.size( );
+    }
+
+    // SOFTWARE hive with Root\A\B and Root\C; returns the builder and the key indexes
+    struct SampleHive
+    {
+        HiveBuilder builder;
+        std::size_t root, a, b, c;
+
+        SampleHive( )
+        {
+            root = builder.addKey(HiveBuilder::ROOT, L"Root");
+            a = builder.addKey(root, L"A");
+            b = builder.addKey(a, L"B");
+            c = builder.addKey(root, L"C");
+            builder.setValue(b, L"DisplayName", L"WatchGuard AuthPoint");
+        }
+    };
+}
+
+TEST(ReadsKeysAndValues)
+{
+    Tests::TemporaryDirectory directory;
+    SampleHive hive;
+    hive.builder.write(directory.path( ) / L"SOFTWARE");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"SOFTWARE");
+    const auto root = registry.openKey(HKLM, L"software\\ROOT");
+    CHECK(root);
+    CHECK((root->enumerateSubKeys( ) == std::vector<std::wstring>{ L"A", L"C" }));
+
+    const auto key = registry.openKey(HKLM, L"SOFTWARE\\Root\\A\\B");
+    CHECK(key);
+    CHECK(key->getStringValue(L"displayname") == L"WatchGuard AuthPoint");
+    CHECK(!registry.openKey(HKLM, L"SOFTWARE\\Root\\B"));
+    CHECK(scanEverything(registry, 1) == 4);
+}
+
+TEST(RejectsSubKeyPointingAtAncestor)
+{
+    Tests::TemporaryDirectory directory;
+    SampleHive hive;
+    hive.builder.addLink(hive.b, hive.root);
+    hive.builder.write(directory.path( ) / L"SOFTWARE");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"SOFTWARE");
+    const auto key = registry.openKey(HKLM, L"SOFTWARE\\Root\\A\\B");
+    CHECK(key);
+    CHECK_THROWS(key->enumerateSubKeys( ));
+    CHECK_THROWS(key->openSubKey(L"Root"));
+    CHECK_THROWS(scanEverything(registry, 1));
+    CHECK_THROWS(scanEverything(registry, 4));
+}
+
+TEST(RejectsSubKeyPointingAtHiveRoot)
+{
+    Tests::TemporaryDirectory directory;
+    SampleHive hive;
+    hive.builder.addLink(hive.c, HiveBuilder::ROOT);
+    hive.builder.write(directory.path( ) / L"SOFTWARE");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"SOFTWARE");
+    CHECK_THROWS(registry.openKey(HKLM, L"SOFTWARE\\Root\\C")->enumerateSubKeys( ));
+    CHECK_THROWS(scanEverything(registry, 2));
+}
+
+TEST(RejectsSubKeyListedTwice)
+{
+    Tests::TemporaryDirectory directory;
+    SampleHive hive;
+    hive.builder.addLink(hive.a, hive.b);
+    hive.builder.write(directory.path( ) / L"SOFTWARE");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"SOFTWARE");
+    CHECK_THROWS(registry.openKey(HKLM, L"SOFTWARE\\Root\\A")->enumerateSubKeys( ));
+    CHECK(registry.openKey(HKLM, L"SOFTWARE\\Root\\C"));
+}
+
+TEST(RejectsKeysNestedTooDeep)
+{
+    Tests::TemporaryDirectory directory;
+    HiveBuilder builder;
+    std::wstring path = L"SOFTWARE";
+    std::size_t key = HiveBuilder::ROOT;
+    for (std::size_t depth = 1; depth <= 600; ++depth)
+    {
+        key = builder.addKey(key, L"K");
+        path += L"\\K";
+        if (depth == 512)
+        {
+            builder.setValue(key, L"Depth", L"512");
+        }
+    }
+    builder.write(directory.path( ) / L"SOFTWARE");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"SOFTWARE");
+    const auto deepest = registry.openKey(HKLM, std::wstring_view(path).substr(0, std::wstring_view(L"SOFTWARE").size( ) + 512 * 2));
+    CHECK(deepest);
+    CHECK(deepest->getStringValue(L"Depth") == L"512");
+    CHECK_THROWS(registry.openKey(HKLM, path));
+}
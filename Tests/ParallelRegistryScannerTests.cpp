@@ -0,0 +1,143 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+#include "TestFramework.h"
+#include "InMemoryRegistryAccess.h"
+#include "ParallelRegistryScanner.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+    using Scanner = Registry::ParallelRegistryScanner<std::wstring>;
+
+    // Products\Product<i>\Level<j>\Leaf<k>, every third key marked with a value
+    void populate(Registry::InMemoryRegistryAccess& registry)
+    {
+        std::size_t count = 0;
+        for (int i = 0; i < 12; ++i)
+        {
+            const std::wstring product = L"SOFTWARE\\Products\\Product" + std::to_wstring(i);
+            for (int j = 0; j < 4; ++j)
+            {
+                const std::wstring level = product + L"\\Level" + std::to_wstring(j);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const std::wstring leaf = level + L"\\Leaf" + std::to_wstring(k);
+                    registry.createKey(HKLM, leaf);
+                    if (++count % 3 == 0)
+                    {
+                        registry.setStringValue(HKLM, leaf, L"DisplayName", L"AuthPoint");
+                    }
+                }
+                if (j == 1)
+                {
+                    registry.setStringValue(HKLM, level, L"DisplayName", L"AuthPoint");
+                }
+            }
+        }
+    }
+
+    Scanner::Root makeRoot(const Registry::IRegistryAccess& registry, const std::wstring& path, Scanner::Visitor visitor,
+                           std::size_t maxDepth = Scanner::UNLIMITED_DEPTH)
+    {
+        return { .key = registry.openKey(HKLM, path), .path = path, .visitor = std::move(visitor), .maxDepth = maxDepth, .selector = nullptr };
+    }
+
+    std::vector<Scanner::Root> makeRoots(const Registry::IRegistryAccess& registry)
+    {
+        const Scanner::Visitor visitor = [](const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t) -> std::optional<std::wstring>
+        {
+            if (key.getStringValue(L"DisplayName"))
+            {
+                return keyPath;
+            }
+            return std::nullopt;
+        };
+
+        std::vector<Scanner::Root> roots;
+        roots.push_back(makeRoot(registry, L"SOFTWARE\\Products", visitor));
+        roots.push_back(makeRoot(registry, L"SOFTWARE\\Missing", visitor));
+        roots.push_back(makeRoot(registry, L"SOFTWARE\\Products\\Product3", visitor, 1));
+        return roots;
+    }
+
+    // Sequential pre-order walk, the reference order
+    void walk(const Registry::IRegistryKey& key, const std::wstring& path, std::vector<std::wstring>& matches)
+    {
+        if (key.getStringValue(L"DisplayName"))
+        {
+            matches.push_back(path);
+        }
+        for (const auto& name : key.enumerateSubKeys( ))
+        {
+            walk(*key.openSubKey(name), path + L"\\" + name, matches);
+        }
+    }
+}
+
+TEST(ReturnsMatchesInSequentialPreOrder)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    std::vector<std::wstring> expected;
+    walk(*registry.openKey(HKLM, L"SOFTWARE\\Products"), L"SOFTWARE\\Products", expected);
+
+    const auto results = Scanner(1).scan(makeRoots(registry));
+    CHECK(results.size( ) == 3);
+    CHECK(results[0].matches == expected);
+    CHECK(results[0].keysVisited == 1 + 12 + 12 * 4 + 12 * 4 * 3);
+    CHECK(results[1].matches.empty( ) && results[1].keysVisited == 0);
+    CHECK((results[2].matches == std::vector<std::wstring>{ L"SOFTWARE\\Products\\Product3\\Level1" }));
+    CHECK(results[2].keysVisited == 5);
+}
+
+TEST(GivesTheSameResultsWithOneOrManyWorkers)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    const auto reference = Scanner(1).scan(makeRoots(registry));
+    for (const std::size_t workerCount : { 2, 4, 8 })
+    {
+        for (const std::size_t splitDepth : { 0, 1, 3 })
+        {
+            for (int repetition = 0; repetition < 5; ++repetition)
+            {
+                const auto results = Scanner(workerCount, splitDepth).scan(makeRoots(registry));
+                CHECK(results.size( ) == reference.size( ));
+                for (std::size_t i = 0; i < results.size( ); ++i)
+                {
+                    CHECK(results[i].matches == reference[i].matches);
+                    CHECK(results[i].keysVisited == reference[i].keysVisited);
+                }
+            }
+        }
+    }
+}
+
+TEST(RethrowsTheFirstVisitorError)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    for (const std::size_t workerCount : { 1, 4 })
+    {
+        std::vector<Scanner::Root> roots;
+        roots.push_back(makeRoot(registry, L"SOFTWARE\\Products",
+                                 [](const std::wstring& keyPath, const Registry::IRegistryKey&, std::size_t) -> std::optional<std::wstring>
+        {
+            if (keyPath.ends_with(L"Product7\\Level2"))
+            {
+                throw std::runtime_error("visitor failed");
+            }
+            return std::nullopt;
+        }));
+        CHECK_THROWS(Scanner(workerCount).scan(std::move(roots)));
+    }
+}
@@ -0,0 +1,212 @@
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+
+#include "ILogger.h"
+#include "TreeBuilder.h"
+#include "TestFramework.h"
+#include "DirectoryRemoval.h"
+#include "ParallelTreeDeleter.h"
+
+using namespace WinLogon::CustomActions;
+using Logger::LogLevel;
+
+namespace
+{
+    const Tests::TreeShape shape{ .depth = 3, .fanOut = 3, .fileCount = 5 };
+
+    struct RecordingLogger : Logger::ILogger
+    {
+        std::vector<std::pair<LogLevel, std::wstring>> lines;
+
+        void log(LogLevel level, const std::wstring& message) override
+        {
+            lines.emplace_back(level, message);
+        }
+    };
+
+    // A file that cannot be deleted until the object goes: held open without delete sharing on Windows,
+    // in a read-only directory elsewhere, or immutable on Linux when running as root, who may write anywhere
+    class UndeletableFile
+    {
+    public:
+        explicit UndeletableFile(std::filesystem::path path) : m_path(std::move(path))
+        {
+            std::ofstream(m_path) << "locked";
+#ifdef _WIN32
+            m_stream.open(m_path);
+            m_locked = m_stream.is_open( );
+#else
+            if (geteuid( ) != 0)
+            {
+                std::filesystem::permissions(m_path.parent_path( ), std::filesystem::perms::owner_write, std::filesystem::perm_options::remove);
+                m_locked = true;
+            }
+#ifdef __linux__
+            else
+            {
+                m_locked = setImmutable(true);
+            }
+#endif
+#endif
+        }
+
+        UndeletableFile(const UndeletableFile&) = delete;
+        UndeletableFile& operator=(const UndeletableFile&) = delete;
+
+        ~UndeletableFile( )
+        {
+#ifndef _WIN32
+            std::error_code errorCode;
+            std::filesystem::permissions(m_path.parent_path( ), std::filesystem::perms::owner_write, std::filesystem::perm_options::add, errorCode);
+#ifdef __linux__
+            if (geteuid( ) == 0)
+            {
+                setImmutable(false);
+            }
+#endif
+#endif
+        }
+
+        const std::filesystem::path& path( ) const noexcept
+        {
+            return m_path;
+        }
+
+        bool isLocked( ) const noexcept
+        {
+            return m_locked;
+        }
+
+    private:
+        std::filesystem::path m_path;
+        bool m_locked = false;
+#ifdef _WIN32
+        std::ifstream m_stream;
+#elif defined(__linux__)
+        bool setImmutable(bool immutable)
+        {
+            const int file = open(m_path.c_str( ), O_RDONLY);
+            int flags = 0;
+            bool set = file >= 0 && ioctl(file, FS_IOC_GETFLAGS, &flags) == 0;
+            flags = immutable ? (flags | FS_IMMUTABLE_FL) : (flags & ~FS_IMMUTABLE_FL);
+            set = set && ioctl(file, FS_IOC_SETFLAGS, &flags) == 0;
+            if (file >= 0)
+            {
+                close(file);
+            }
+            return set;
+        }
+#endif
+    };
+}
+
+TEST(CountsLikeRemoveAll)
+{
+    Tests::TemporaryDirectory directory;
+    const auto expected = Tests::buildTree(directory.path( ) / "remove_all", shape) + 1;
+    Tests::buildTree(directory.path( ) / "parallel", shape);
+
+    std::error_code errorCode;
+    CHECK(std::filesystem::remove_all(directory.path( ) / "remove_all", errorCode) == expected);
+    CHECK(!errorCode);
+
+    for (const std::size_t workerCount : { 1, 4 })
+    {
+        Tests::buildTree(directory.path( ) / "parallel", shape);
+        FileSystem::ParallelTreeDeleter deleter(workerCount);
+        CHECK(deleter.removeAll(directory.path( ) / "parallel", errorCode) == expected);
+        CHECK(!errorCode);
+        CHECK(!std::filesystem::exists(directory.path( ) / "parallel"));
+        CHECK(deleter.getFailures( ).empty( ));
+    }
+}
+
+TEST(RemovesSingleFilesAndIgnoresMissingPaths)
+{
+    Tests::TemporaryDirectory directory;
+    std::ofstream(directory.path( ) / "file.txt") << "data";
+
+    std::error_code errorCode;
+    FileSystem::ParallelTreeDeleter deleter(2);
+    CHECK(deleter.removeAll(directory.path( ) / "file.txt", errorCode) == 1);
+    CHECK(!errorCode);
+    CHECK(deleter.removeAll(directory.path( ) / "file.txt", errorCode) == 0);
+    CHECK(!errorCode);
+}
+
+TEST(RemovesLinksWithoutFollowingThem)
+{
+    Tests::TemporaryDirectory directory;
+    Tests::buildTree(directory.path( ) / "target", { .depth = 1, .fanOut = 2, .fileCount = 2 });
+    std::filesystem::create_directories(directory.path( ) / "tree");
+    std::filesystem::create_directory_symlink(directory.path( ) / "target", directory.path( ) / "tree" / "link");
+
+    std::error_code errorCode;
+    FileSystem::ParallelTreeDeleter deleter(2);
+    CHECK(deleter.removeAll(directory.path( ) / "tree", errorCode) == 2);
+    CHECK(!errorCode);
+    CHECK(std::filesystem::exists(directory.path( ) / "target" / "dir1" / "log1.txt"));
+}
+
+// Whichever way the tree is deleted, a failure is logged entry by entry with its error, and only the entry
+// and the directories above it are left
+TEST(RemoveDirectoryLogsEachEntryItCouldNotRemove)
+{
+    for (const auto workerCount : { std::optional<std::size_t>( ), std::optional<std::size_t>(2) })
+    {
+        Tests::TemporaryDirectory directory;
+        const auto tree = directory.path( ) / "Logon App";
+        Tests::buildTree(tree, shape);
+        const UndeletableFile locked(tree / "dir1" / "dir2" / "locked.dll");
+        CHECK(locked.isLocked( ));
+
+        const auto logger = std::make_shared<RecordingLogger>( );
+        CHECK(!FileSystem::DirectoryRemoval::removeDirectory(tree, logger, true, workerCount));
+
+        std::vector<std::wstring> failures;
+        bool headline = false;
+        for (const auto& [level, message] : logger->lines)
+        {
+            headline |= level == LogLevel::LOG_ERROR && message.starts_with(L"  Failed to remove directory: " + tree.wstring( ));
+            if (level == LogLevel::LOG_WARNING && message.starts_with(L"  - "))
+            {
+                failures.push_back(message);
+            }
+        }
+        CHECK(headline);
+        CHECK(failures.size( ) == 1);
+        CHECK(!failures.empty( ) && failures[0].starts_with(L"  - " + locked.path( ).wstring( ) + L": ") &&
+              failures[0].size( ) > locked.path( ).wstring( ).size( ) + 6);
+
+        CHECK(std::filesystem::exists(locked.path( )));
+        CHECK(!std::filesystem::exists(tree / "log0.txt") && !std::filesystem::exists(tree / "dir0"));
+        CHECK(!std::filesystem::exists(tree / "dir1" / "log0.txt") && !std::filesystem::exists(tree / "dir1" / "dir2" / "log0.txt"));
+    }
+}
+
+TEST(RemoveDirectoryLogsWhatItRemoved)
+{
+    Tests::TemporaryDirectory directory;
+    const auto expected = Tests::buildTree(directory.path( ) / "Logon App", shape) + 1;
+
+    const auto logger = std::make_shared<RecordingLogger>( );
+    CHECK(FileSystem::DirectoryRemoval::removeDirectory(directory.path( ) / "Logon App", logger));
+    CHECK(!std::filesystem::exists(directory.path( ) / "Logon App"));
+    CHECK(logger->lines.size( ) == 1 && logger->lines[0].first == LogLevel::LOG_INFO &&
+          logger->lines[0].second.ends_with(L" (" + std::to_wstring(expected) + L" items deleted)"));
+}
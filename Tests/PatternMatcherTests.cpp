@@ -0,0 +1,45 @@
+#include <string>
+#include <vector>
+
+#include "TestFramework.h"
+#include "PatternMatcher.h"
+
+using namespace WinLogon::CustomActions;
+
+TEST(MatchesAnyPatternIgnoringCase)
+{
+    const Text::PatternMatcher matcher({ L"AuthPoint", L"Logon App", L"LogonApp", L"WatchGuard" });
+    CHECK(matcher.matchesAny(L"WatchGuard AuthPoint Agent"));
+    CHECK(matcher.matchesAny(L"AUTHPOINT"));
+    CHECK(matcher.matchesAny(L"my logonapp helper"));
+    CHECK(matcher.matchesAny(L"The Logon App"));
+    CHECK(!matcher.matchesAny(L"Logon Ap"));
+    CHECK(!matcher.matchesAny(L"Google Chrome"));
+    CHECK(!matcher.matchesAny(L""));
+}
+
+TEST(MatchesOverlappingPatterns)
+{
+    const Text::PatternMatcher matcher({ L"abcd", L"bce" });
+    CHECK(matcher.matchesAny(L"xxabcexx"));
+    CHECK(matcher.matchesAny(L"ABCD"));
+    CHECK(!matcher.matchesAny(L"abc"));
+}
+
+TEST(ParsesPatternLists)
+{
+    CHECK((Text::PatternMatcher::parsePatterns(L"AuthPoint| Logon App |WatchGuard") ==
+           std::vector<std::wstring>{ L"AuthPoint", L"Logon App", L"WatchGuard" }));
+    CHECK((Text::PatternMatcher::parsePatterns(L"a,b", L',') == std::vector<std::wstring>{ L"a", L"b" }));
+}
+
+TEST(DropsEmptyPatterns)
+{
+    CHECK(Text::PatternMatcher::parsePatterns(L"").empty( ));
+    CHECK(Text::PatternMatcher::parsePatterns(L"| |\t|").empty( ));
+    CHECK((Text::PatternMatcher::parsePatterns(L"||AuthPoint||") == std::vector<std::wstring>{ L"AuthPoint" }));
+
+    // An empty pattern would make the matcher accept every display name
+    CHECK(Text::PatternMatcher(std::vector<std::wstring>{ L"" }).matchesAny(L"anything"));
+    CHECK(!Text::PatternMatcher(Text::PatternMatcher::parsePatterns(L"|")).matchesAny(L"anything"));
+}
@@ -0,0 +1,74 @@
+#include <string>
+#include <vector>
+
+#include "KeyPathPool.h"
+#include "TestFramework.h"
+#include "RegistryDeletionPlanner.h"
+
+using namespace WinLogon::CustomActions;
+using Registry::KeyPathPool;
+using Registry::RegistryDeletionPlanner;
+
+namespace
+{
+    std::vector<std::wstring> toStrings(const std::vector<const KeyPathPool::Node*>& nodes)
+    {
+        std::vector<std::wstring> paths;
+        for (const auto* node : nodes)
+        {
+            paths.push_back(KeyPathPool::toString(node));
+        }
+        return paths;
+    }
+}
+
+TEST(CollapsesKeysIntoTheirTopmostListedAncestor)
+{
+    KeyPathPool pool;
+    const std::vector<const KeyPathPool::Node*> keys{
+        pool.intern(L"Managed\\S-1-5-18\\Installer\\Products\\P1\\InstallProperties"),
+        pool.intern(L"Uninstall\\{A}"),
+        pool.intern(L"Managed\\S-1-5-18\\Installer\\Products\\P1"),
+        pool.intern(L"Managed\\S-1-5-18"),
+        pool.intern(L"Uninstall\\{B}")
+    };
+
+    const auto plan = RegistryDeletionPlanner::plan(keys);
+    CHECK((toStrings(plan.roots) == std::vector<std::wstring>{ L"Managed\\S-1-5-18", L"Uninstall\\{A}", L"Uninstall\\{B}" }));
+    CHECK((plan.rootOf == std::vector<std::size_t>{ 0, 1, 0, 0, 2 }));
+}
+
+TEST(DoesNotCollapseSiblingsOrNamePrefixes)
+{
+    KeyPathPool pool;
+    const std::vector<const KeyPathPool::Node*> keys{
+        pool.intern(L"Uninstall\\AuthPoint"),
+        pool.intern(L"Uninstall\\AuthPoint Agent"),
+        pool.intern(L"Uninstall\\AuthPoint\\..\\Other")   // Not a path syntax: a key named ".."
+    };
+
+    const auto plan = RegistryDeletionPlanner::plan(keys);
+    CHECK((toStrings(plan.roots) == std::vector<std::wstring>{ L"Uninstall\\AuthPoint", L"Uninstall\\AuthPoint Agent" }));
+    CHECK((plan.rootOf == std::vector<std::size_t>{ 0, 1, 0 }));
+}
+
+TEST(MatchesKeysIgnoringCase)
+{
+    KeyPathPool pool;
+    const std::vector<const KeyPathPool::Node*> keys{
+        pool.intern(L"SOFTWARE\\Classes\\Installer\\Products\\94327BCB79C6F3E4495BE60A548FC55A\\SourceList"),
+        pool.intern(L"software\\classes\\installer\\products\\94327bcb79c6f3e4495be60a548fc55a"),
+        pool.intern(L"SOFTWARE\\CLASSES\\INSTALLER\\PRODUCTS\\94327BCB79C6F3E4495BE60A548FC55A")
+    };
+
+    const auto plan = RegistryDeletionPlanner::plan(keys);
+    CHECK(plan.roots.size( ) == 1);
+    CHECK(plan.roots[0] == keys[1] && keys[1] == keys[2]);
+    CHECK((plan.rootOf == std::vector<std::size_t>{ 0, 0, 0 }));
+}
+
+TEST(PlansAnEmptyList)
+{
+    const auto plan = RegistryDeletionPlanner::plan({ });
+    CHECK(plan.roots.empty( ) && plan.rootOf.empty( ));
+}
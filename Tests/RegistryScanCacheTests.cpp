@@ -0,0 +1,124 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "TestFramework.h"
+#include "RegistryScanCache.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+
+    // Reports the same last write time for every key, so only the path tells cache records apart
+    class FixedWriteTimeRegistryAccess : public Registry::IRegistryAccess
+    {
+    public:
+        explicit FixedWriteTimeRegistryAccess(std::shared_ptr<const Registry::IRegistryAccess> inner) : m_inner(std::move(inner)) {}
+
+        std::unique_ptr<Registry::IRegistryKey> openKey(Registry::RegistryHive hive, std::wstring_view path) const override
+        {
+            auto key = m_inner->openKey(hive, path);
+            return key ? std::make_unique<Key>(std::move(key)) : nullptr;
+        }
+
+    private:
+        class Key : public Registry::IRegistryKey
+        {
+        public:
+            explicit Key(std::unique_ptr<Registry::IRegistryKey> inner) : m_inner(std::move(inner)) {}
+
+            std::unique_ptr<Registry::IRegistryKey> openSubKey(std::wstring_view name) const override
+            {
+                auto key = m_inner->openSubKey(name);
+                return key ? std::make_unique<Key>(std::move(key)) : nullptr;
+            }
+
+            std::vector<std::wstring> enumerateSubKeys( ) const override
+            {
+                return m_inner->enumerateSubKeys( );
+            }
+
+            std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+            {
+                return m_inner->getStringValue(valueName);
+            }
+
+            std::vector<Registry::RegistryValue> enumerateValues( ) const override
+            {
+                return m_inner->enumerateValues( );
+            }
+
+            std::optional<std::uint64_t> getLastWriteTime( ) const override
+            {
+                return 1;
+            }
+
+        private:
+            std::unique_ptr<Registry::IRegistryKey> m_inner;
+        };
+
+        std::shared_ptr<const Registry::IRegistryAccess> m_inner;
+    };
+
+    std::shared_ptr<Registry::InMemoryRegistryAccess> makeUninstallRegistry( )
+    {
+        auto registry = std::make_shared<Registry::InMemoryRegistryAccess>( );
+        registry->setStringValue(HKLM, L"SOFTWARE\\Uninstall\\X", L"DisplayName", L"Nested");
+        registry->setStringValue(HKLM, L"SOFTWARE\\UninstallX", L"DisplayName", L"Sibling");
+        return registry;
+    }
+}
+
+TEST(KeysWhosePathsConcatenateAlikeDoNotShareRecords)
+{
+    const auto cache = std::make_shared<Registry::RegistryScanCache>( );
+    const Registry::CachingRegistryAccess registry(std::make_shared<FixedWriteTimeRegistryAccess>(makeUninstallRegistry( )), cache);
+
+    const auto nested = registry.openKey(HKLM, L"SOFTWARE\\Uninstall")->openSubKey(L"X");
+    CHECK(nested->getStringValue(L"DisplayName") == L"Nested");
+
+    const auto sibling = registry.openKey(HKLM, L"SOFTWARE\\UninstallX");
+    CHECK(sibling->getStringValue(L"DisplayName") == L"Sibling");
+    CHECK(cache->getStatistics( ).hits == 0);
+
+    const auto siblingFromSoftware = registry.openKey(HKLM, L"SOFTWARE")->openSubKey(L"UninstallX");
+    CHECK(siblingFromSoftware->getStringValue(L"DisplayName") == L"Sibling");
+    CHECK(cache->getStatistics( ).hits == 1);
+}
+
+TEST(PathsOfOpenKeyAndOpenSubKeyShareRecords)
+{
+    const auto cache = std::make_shared<Registry::RegistryScanCache>( );
+    const Registry::CachingRegistryAccess registry(makeUninstallRegistry( ), cache);
+
+    CHECK(registry.openKey(HKLM, L"\\SOFTWARE\\\\Uninstall\\")->openSubKey(L"x")->getStringValue(L"DisplayName") == L"Nested");
+    CHECK(registry.openKey(HKLM, L"software")->openSubKey(L"UNINSTALL\\X")->getStringValue(L"displayname") == L"Nested");
+    CHECK(registry.openKey(HKLM, L"SOFTWARE\\Uninstall\\X")->getStringValue(L"DisplayName") == L"Nested");
+
+    const auto statistics = cache->getStatistics( );
+    CHECK(statistics.misses == 1);
+    CHECK(statistics.hits == 2);
+}
+
+TEST(ChangedKeysAreReadAgain)
+{
+    const auto cache = std::make_shared<Registry::RegistryScanCache>( );
+    const auto inner = makeUninstallRegistry( );
+    const Registry::CachingRegistryAccess registry(inner, cache);
+
+    CHECK((registry.openKey(HKLM, L"SOFTWARE\\Uninstall")->enumerateSubKeys( ) == std::vector<std::wstring>{ L"X" }));
+    inner->createKey(HKLM, L"SOFTWARE\\Uninstall\\Y");
+    CHECK((registry.openKey(HKLM, L"SOFTWARE\\Uninstall")->enumerateSubKeys( ) == std::vector<std::wstring>{ L"X", L"Y" }));
+    CHECK(cache->getStatistics( ).hits == 0);
+
+    CHECK((registry.openKey(HKLM, L"SOFTWARE\\Uninstall")->enumerateSubKeys( ) == std::vector<std::wstring>{ L"X", L"Y" }));
+    CHECK(cache->getStatistics( ).hits == 1);
+
+    cache->invalidate( );
+    CHECK((registry.openKey(HKLM, L"SOFTWARE\\Uninstall")->enumerateSubKeys( ) == std::vector<std::wstring>{ L"X", L"Y" }));
+    CHECK(cache->getStatistics( ).hits == 1);
+}
@@ -0,0 +1,152 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "TestFramework.h"
+#include "RegistrySelector.h"
+#include "InMemoryRegistryAccess.h"
+#include "ParallelRegistryScanner.h"
+
+using namespace WinLogon::CustomActions;
+using Registry::RegistrySelector;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+    using Scanner = Registry::ParallelRegistryScanner<std::wstring>;
+
+    //   UserData\S-1-5-18\Products\P1\InstallProperties
+    //   UserData\S-1-5-18\Products\P1\Features
+    //   UserData\S-1-5-18\Components\C1
+    //   UserData\S-1-5-21-1001\Products\P2\InstallProperties
+    void populate(Registry::InMemoryRegistryAccess& registry)
+    {
+        registry.createKey(HKLM, L"SOFTWARE\\Root\\UserData\\S-1-5-18\\Products\\P1\\InstallProperties");
+        registry.createKey(HKLM, L"SOFTWARE\\Root\\UserData\\S-1-5-18\\Products\\P1\\Features");
+        registry.createKey(HKLM, L"SOFTWARE\\Root\\UserData\\S-1-5-18\\Components\\C1");
+        registry.createKey(HKLM, L"SOFTWARE\\Root\\UserData\\S-1-5-21-1001\\Products\\P2\\InstallProperties");
+    }
+
+    // Scans with the selector the way the registry strategies do and returns the selected keys
+    Scanner::RootResult scan(const Registry::IRegistryAccess& registry, const std::wstring& text, std::size_t workerCount = 1)
+    {
+        const auto selector = std::make_shared<RegistrySelector>(text);
+        std::vector<Scanner::Root> roots;
+        roots.push_back({
+            .key = registry.openKey(HKLM, selector->getRootPath( )),
+            .path = selector->getRootPath( ),
+            .visitor = [](const std::wstring& keyPath, const Registry::IRegistryKey&, std::size_t)
+            {
+                return std::optional(keyPath.substr(keyPath.find(L"UserData")));
+            },
+            .maxDepth = selector->getMaxDepth( ),
+            .selector = selector });
+        return Scanner(workerCount).scan(std::move(roots)).front( );
+    }
+}
+
+TEST(ParsesRootPathValueNameAndDepth)
+{
+    const RegistrySelector selector(L"SOFTWARE\\Microsoft\\Installer\\UserData\\*\\Products\\*\\InstallProperties:DisplayName");
+    CHECK(selector.getRootPath( ) == L"SOFTWARE\\Microsoft\\Installer\\UserData");
+    CHECK(selector.getValueName( ) == L"DisplayName");
+    CHECK(selector.getMaxDepth( ) == 4);
+
+    const RegistrySelector products(L"Software\\Classes\\Installer\\Products\\*");
+    CHECK(products.getRootPath( ) == L"Software\\Classes\\Installer\\Products");
+    CHECK(products.getValueName( ).empty( ));
+    CHECK(products.getMaxDepth( ) == 1);
+
+    CHECK(RegistrySelector(L"SOFTWARE\\Uninstall\\**:DisplayName").getMaxDepth( ) == RegistrySelector::UNLIMITED_DEPTH);
+    CHECK(RegistrySelector(L"SOFTWARE\\Uninstall\\**{3}\\Product").getMaxDepth( ) == 4);
+
+    // A ':' followed by a backslash belongs to a key name
+    const RegistrySelector colon(L"SOFTWARE\\a:b\\*");
+    CHECK(colon.getRootPath( ) == L"SOFTWARE\\a:b" && colon.getValueName( ).empty( ));
+}
+
+TEST(RejectsInvalidSelectors)
+{
+    CHECK_THROWS(RegistrySelector(L"*\\Products"));
+    CHECK_THROWS(RegistrySelector(L"SOFTWARE\\**{x}"));
+    CHECK_THROWS(RegistrySelector(L"SOFTWARE\\**{99}"));
+
+    std::wstring tooLong = L"SOFTWARE";
+    for (std::size_t i = 0; i <= RegistrySelector::MAX_STEPS; ++i)
+    {
+        tooLong += L"\\*";
+    }
+    CHECK_THROWS(RegistrySelector(tooLong));
+}
+
+TEST(MatchesNamesIgnoringCase)
+{
+    const RegistrySelector selector(L"SOFTWARE\\Root\\S-1-5-2?-*\\Products");
+    const auto root = selector.initialState( );
+    CHECK(selector.next(root, L"s-1-5-21-1001") != 0);
+    CHECK(selector.next(root, L"S-1-5-20-") != 0);
+    CHECK(selector.next(root, L"S-1-5-18") == 0);
+
+    const auto sid = selector.next(root, L"S-1-5-21-1001");
+    CHECK(!selector.accepts(sid) && selector.canDescend(sid));
+    CHECK(selector.accepts(selector.next(sid, L"PRODUCTS")));
+    CHECK(!selector.canDescend(selector.next(sid, L"products")));
+    CHECK(selector.next(sid, L"Components") == 0);
+}
+
+TEST(PrunesEveryLevelOfAFixedShape)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    const auto result = scan(registry, L"SOFTWARE\\Root\\UserData\\*\\Products\\*\\InstallProperties:DisplayName");
+    CHECK((result.matches == std::vector<std::wstring>{
+        L"UserData\\S-1-5-18\\Products\\P1\\InstallProperties",
+        L"UserData\\S-1-5-21-1001\\Products\\P2\\InstallProperties" }));
+    CHECK(result.keysVisited == 9);
+    CHECK(result.keysPruned == 2);   // Components, Features
+}
+
+TEST(PrunesGlobsAndStopsBelowTheLastStep)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    const auto result = scan(registry, L"SOFTWARE\\Root\\UserData\\S-1-5-21-*\\Products\\*");
+    CHECK((result.matches == std::vector<std::wstring>{ L"UserData\\S-1-5-21-1001\\Products\\P2" }));
+    CHECK(result.keysVisited == 4);  // P2 is selected, its sub keys are never opened
+    CHECK(result.keysPruned == 1);   // S-1-5-18
+}
+
+TEST(WalksEverythingBelowAnyPath)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    const auto result = scan(registry, L"SOFTWARE\\Root\\UserData\\**\\InstallProperties");
+    CHECK((result.matches == std::vector<std::wstring>{
+        L"UserData\\S-1-5-18\\Products\\P1\\InstallProperties",
+        L"UserData\\S-1-5-21-1001\\Products\\P2\\InstallProperties" }));
+    CHECK(result.keysVisited == 12);
+    CHECK(result.keysPruned == 0);
+}
+
+TEST(BoundsAnyPathByLevels)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+    registry.createKey(HKLM, L"SOFTWARE\\Root\\UserData\\S-1-5-18\\Components\\C1\\Products");
+
+    // Products one or two levels below UserData; the one three levels down is out of reach
+    const auto result = scan(registry, L"SOFTWARE\\Root\\UserData\\**{2}\\Products");
+    CHECK((result.matches == std::vector<std::wstring>{
+        L"UserData\\S-1-5-18\\Products",
+        L"UserData\\S-1-5-21-1001\\Products" }));
+    CHECK(result.keysVisited == 6);  // UserData, both SIDs, both Products, Components
+    CHECK(result.keysPruned == 3);   // P1, P2 and C1, whose Products is too deep
+
+    const auto parallel = scan(registry, L"SOFTWARE\\Root\\UserData\\**{2}\\Products", 4);
+    CHECK(parallel.matches == result.matches);
+    CHECK(parallel.keysVisited == result.keysVisited && parallel.keysPruned == result.keysPruned);
+}
@@ -0,0 +1,163 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "TestFramework.h"
+#include "RegistryValueIndex.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+using Condition = Registry::RegistryValueIndex::Condition;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+    constexpr auto UNINSTALL = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+
+    // Uninstall entries: AuthPoint 3.9.1 and 4.0, a leftover only linked to us by its install folder,
+    // and an unrelated product
+    Registry::RegistryValueIndex buildUninstallIndex(std::size_t workerCount)
+    {
+        Registry::InMemoryRegistryAccess registry;
+        const std::wstring uninstall = UNINSTALL;
+        registry.setStringValue(HKLM, uninstall + L"\\{AP3}", L"DisplayName", L"WatchGuard AuthPoint Agent");
+        registry.setStringValue(HKLM, uninstall + L"\\{AP3}", L"Publisher", L"WatchGuard Technologies");
+        registry.setStringValue(HKLM, uninstall + L"\\{AP3}", L"DisplayVersion", L"3.9.1");
+        registry.setStringValue(HKLM, uninstall + L"\\{AP4}", L"DisplayName", L"WatchGuard AuthPoint Agent");
+        registry.setStringValue(HKLM, uninstall + L"\\{AP4}", L"Publisher", L"WatchGuard Technologies");
+        registry.setStringValue(HKLM, uninstall + L"\\{AP4}", L"DisplayVersion", L"4.0");
+        registry.setStringValue(HKLM, uninstall + L"\\Helper", L"DisplayName", L"Credential Helper");
+        registry.setStringValue(HKLM, uninstall + L"\\Helper", L"InstallLocation", L"C:\\Program Files\\WatchGuard\\Logon App\\");
+        registry.setStringValue(HKLM, uninstall + L"\\Contoso", L"DisplayName", L"Contoso Runtime");
+        registry.setStringValue(HKLM, uninstall + L"\\Contoso", L"Publisher", L"Contoso");
+        registry.setStringValue(HKLM, uninstall + L"\\Contoso", L"DisplayVersion", L"10.2");
+        registry.setStringValue(HKLM, uninstall + L"\\Contoso", L"InstallLocation", L"C:\\Program Files\\Contoso\\Logon");
+        registry.createKey(HKLM, uninstall + L"\\Contoso\\Components");
+
+        const Registry::RegistryValueIndex::Root roots[] = { { .hive = HKLM, .path = uninstall, .maxDepth = 1 } };
+        return Registry::RegistryValueIndex::build(registry, roots, workerCount);
+    }
+
+    std::vector<std::wstring> keyNames(const Registry::RegistryValueIndex& index, const std::vector<Registry::RegistryValueIndex::KeyId>& keys)
+    {
+        std::vector<std::wstring> names;
+        for (const auto key : keys)
+        {
+            const auto& path = index.getKey(key).path;
+            names.push_back(path.substr(path.rfind(L'\\') + 1));
+        }
+        return names;
+    }
+
+    std::vector<std::uint8_t> utf16(std::wstring_view text)
+    {
+        std::vector<std::uint8_t> data;
+        for (const wchar_t ch : text)
+        {
+            data.push_back(static_cast<std::uint8_t>(ch));
+            data.push_back(static_cast<std::uint8_t>(ch >> 8));
+        }
+        return data;
+    }
+}
+
+TEST(IndexesEveryKeyOfTheWalk)
+{
+    for (const std::size_t workerCount : { 1, 4 })
+    {
+        const auto index = buildUninstallIndex(workerCount);
+
+        // The root and its four entries, in pre-order; Contoso\Components is below maxDepth
+        CHECK(index.getKeyCount( ) == 5);
+        CHECK(index.getValueCount( ) == 12);
+        CHECK(index.getKey(0).path == UNINSTALL && index.getKey(0).hive == HKLM);
+        CHECK((keyNames(index, index.find({ })) == std::vector<std::wstring>{ L"Uninstall", L"Contoso", L"Helper", L"{AP3}", L"{AP4}" }));
+    }
+}
+
+TEST(FindsKeysByExistenceAndWholeValue)
+{
+    const auto index = buildUninstallIndex(1);
+
+    CHECK((keyNames(index, index.find({ Condition::exists(L"installlocation") })) == std::vector<std::wstring>{ L"Contoso", L"Helper" }));
+    CHECK(index.find({ Condition::exists(L"UninstallString") }).empty( ));
+
+    CHECK((keyNames(index, index.find({ Condition::equals(L"Publisher", L"watchguard TECHNOLOGIES") })) == std::vector<std::wstring>{ L"{AP3}", L"{AP4}" }));
+    CHECK(index.find({ Condition::equals(L"Publisher", L"WatchGuard") }).empty( ));
+    CHECK(index.find({ Condition::equals(L"DisplayName", L"WatchGuard Technologies") }).empty( ));
+
+    const auto helper = index.find({ Condition::equals(L"DisplayName", L"Credential Helper") });
+    CHECK(helper.size( ) == 1 && index.getValue(helper.front( ), L"InstallLocation") == L"C:\\Program Files\\WatchGuard\\Logon App\\");
+    CHECK(!index.getValue(helper.front( ), L"Publisher"));
+}
+
+TEST(FindsKeysBySubstring)
+{
+    const auto index = buildUninstallIndex(1);
+
+    // The only link of Helper to us is its install folder
+    CHECK((keyNames(index, index.find({ Condition::anyValueContains(L"Program Files\\WatchGuard\\Logon App") })) == std::vector<std::wstring>{ L"Helper" }));
+
+    // First and last words may be parts of longer ones
+    CHECK((keyNames(index, index.find({ Condition::anyValueContains(L"ogram Files\\WatchGuard\\Logon Ap") })) == std::vector<std::wstring>{ L"Helper" }));
+    CHECK((keyNames(index, index.find({ Condition::contains(L"InstallLocation", L"Files\\Contoso\\Log") })) == std::vector<std::wstring>{ L"Contoso" }));
+    CHECK((keyNames(index, index.find({ Condition::contains(L"DisplayName", L"thPoi") })) == std::vector<std::wstring>{ L"{AP3}", L"{AP4}" }));
+    CHECK((keyNames(index, index.find({ Condition::anyValueContains(L"logon") })) == std::vector<std::wstring>{ L"Contoso", L"Helper" }));
+
+    // Whole words in the middle must be words of the value
+    CHECK(index.find({ Condition::anyValueContains(L"Program Files\\Watch\\Logon App") }).empty( ));
+    CHECK(index.find({ Condition::anyValueContains(L"Files\\Fabrikam\\Logon") }).empty( ));
+    CHECK(index.find({ Condition::contains(L"Publisher", L"Program Files") }).empty( ));
+}
+
+TEST(ComparesDottedVersions)
+{
+    const auto index = buildUninstallIndex(1);
+
+    CHECK((keyNames(index, index.find({ Condition::versionLess(L"DisplayVersion", L"4.0") })) == std::vector<std::wstring>{ L"{AP3}" }));
+    CHECK((keyNames(index, index.find({ Condition::versionAtLeast(L"DisplayVersion", L"4.0") })) == std::vector<std::wstring>{ L"Contoso", L"{AP4}" }));
+    CHECK((keyNames(index, index.find({ Condition::versionAtLeast(L"DisplayVersion", L"4") })) == std::vector<std::wstring>{ L"Contoso", L"{AP4}" }));
+    CHECK((keyNames(index, index.find({ Condition::versionLess(L"DisplayVersion", L"3.9.10") })) == std::vector<std::wstring>{ L"{AP3}" }));
+    CHECK(index.find({ Condition::versionLess(L"DisplayVersion", L"3.9.1") }).empty( ));
+
+    // Values that are not versions match neither way
+    CHECK(index.find({ Condition::versionLess(L"Publisher", L"99") }).empty( ));
+    CHECK(index.find({ Condition::versionAtLeast(L"Publisher", L"0") }).empty( ));
+
+    // Publisher = "WatchGuard Technologies" AND DisplayVersion < 4
+    CHECK((keyNames(index, index.find({ Condition::equals(L"Publisher", L"WatchGuard Technologies"),
+                                        Condition::versionLess(L"DisplayVersion", L"4") })) == std::vector<std::wstring>{ L"{AP3}" }));
+    CHECK(index.find({ Condition::equals(L"Publisher", L"Contoso"), Condition::versionLess(L"DisplayVersion", L"4") }).empty( ));
+}
+
+TEST(IndexesMultiStringAndDwordValues)
+{
+    Registry::RegistryValueIndex index;
+    const std::vector<Registry::RegistryValue> values = {
+        { .name = L"Dependencies", .type = 7, .data = utf16(std::wstring(L"RpcSs\0WLCredProv\0\0", 18)) },
+        { .name = L"Start", .type = 4, .data = { 0x02, 0x01, 0x00, 0x00 } },
+        { .name = L"Type", .type = 4, .data = { 0x10 } },                                   // Truncated, ignored
+        { .name = L"ImagePath", .type = 2, .data = utf16(std::wstring(L"%ProgramFiles%\\WatchGuard\\wlsvc.exe\0", 36)) },
+        { .name = L"Blob", .type = 3, .data = utf16(L"WLCredProv") }                        // REG_BINARY, not indexed
+    };
+    const auto service = index.add(HKLM, L"SYSTEM\\CurrentControlSet\\Services\\WLService", values);
+    index.add(HKLM, L"SYSTEM\\CurrentControlSet\\Services\\Other", { });
+
+    CHECK(index.getKeyCount( ) == 2 && index.getValueCount( ) == 4);
+
+    // Each string of a REG_MULTI_SZ is a value of its own
+    CHECK((index.find({ Condition::equals(L"Dependencies", L"wlcredprov") }) == std::vector<Registry::RegistryValueIndex::KeyId>{ service }));
+    CHECK((index.find({ Condition::equals(L"Dependencies", L"RpcSs") }) == std::vector<Registry::RegistryValueIndex::KeyId>{ service }));
+    CHECK(index.find({ Condition::contains(L"Dependencies", L"RpcSs\\WLCredProv") }).empty( ));
+    CHECK(index.getValue(service, L"Dependencies") == L"RpcSs");
+
+    // REG_DWORD in decimal: 0x102
+    CHECK(index.getValue(service, L"Start") == L"258");
+    CHECK(index.find({ Condition::versionAtLeast(L"Start", L"258") }).size( ) == 1);
+    CHECK(index.find({ Condition::versionLess(L"Start", L"258") }).empty( ));
+    CHECK(!index.getValue(service, L"Type"));
+
+    CHECK(index.getValue(service, L"ImagePath") == L"%ProgramFiles%\\WatchGuard\\wlsvc.exe");
+    CHECK(!index.getValue(service, L"Blob"));
+    CHECK(index.find({ Condition::anyValueContains(L"WLCredProv") }).size( ) == 1);
+}
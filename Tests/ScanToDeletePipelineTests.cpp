@@ -0,0 +1,186 @@
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TestFramework.h"
+#include "RegistrySelector.h"
+#include "ScanToDeletePipeline.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+    using Pipeline = Registry::ScanToDeletePipeline<std::wstring>;
+
+    // Uninstall\Product<i>, a fixed shape whose matches are streamed, and Managed\**, whose matches the
+    // scan descends below and are held back
+    void populate(Registry::InMemoryRegistryAccess& registry)
+    {
+        for (int i = 0; i < 40; ++i)
+        {
+            const std::wstring path = L"SOFTWARE\\Uninstall\\Product" + std::to_wstring(i);
+            registry.setStringValue(HKLM, path, L"DisplayName", (i % 4 == 0) ? L"WatchGuard AuthPoint" : L"Contoso Runtime");
+        }
+        for (int sid = 0; sid < 3; ++sid)
+        {
+            for (int i = 0; i < 6; ++i)
+            {
+                const std::wstring path = L"SOFTWARE\\Managed\\S-1-5-21-" + std::to_wstring(sid) + L"\\Products\\P" + std::to_wstring(i);
+                registry.setStringValue(HKLM, path, L"DisplayName", (i % 3 == 0) ? L"Logon App" : L"Fabrikam Viewer");
+                registry.createKey(HKLM, path + L"\\SourceList");
+            }
+        }
+    }
+
+    // Scans the two roots like the AuthPoint cleanup does; throwAt names a key the visitor fails on
+    std::vector<Pipeline::Scanner::RootResult> scan(const Registry::IRegistryAccess& registry, const Pipeline::Sink& sink,
+                                                    std::size_t workerCount, const std::wstring& throwAt = { })
+    {
+        std::vector<Pipeline::Scanner::Root> roots;
+        for (const auto* text : { L"SOFTWARE\\Uninstall\\*:DisplayName", L"SOFTWARE\\Managed\\**:DisplayName" })
+        {
+            const auto selector = std::make_shared<Registry::RegistrySelector>(text);
+            roots.push_back({
+                .key = registry.openKey(HKLM, selector->getRootPath( )),
+                .path = selector->getRootPath( ),
+                .visitor = [&sink, &throwAt, maxDepth = selector->getMaxDepth( )](const std::wstring& keyPath, const Registry::IRegistryKey& key, std::size_t depth)
+                {
+                    if (!throwAt.empty( ) && keyPath.ends_with(throwAt))
+                    {
+                        throw std::runtime_error("scan failed");
+                    }
+
+                    std::optional<std::wstring> match;
+                    const auto displayName = key.getStringValue(L"DisplayName");
+                    if (displayName && (displayName->find(L"AuthPoint") != std::wstring::npos || displayName->find(L"Logon App") != std::wstring::npos))
+                    {
+                        match = keyPath;
+                    }
+                    return Pipeline::forward(std::move(match), sink, depth < maxDepth);
+                },
+                .maxDepth = selector->getMaxDepth( ),
+                .selector = selector });
+        }
+        return Pipeline::Scanner(workerCount).scan(std::move(roots));
+    }
+
+    // What CollectThenDelete removes: every match, in walk order
+    std::vector<std::wstring> collect(const Registry::IRegistryAccess& registry)
+    {
+        std::vector<std::wstring> matches;
+        for (const auto& rootResult : scan(registry, { }, 1))
+        {
+            matches.insert(matches.end( ), rootResult.matches.begin( ), rootResult.matches.end( ));
+        }
+        return matches;
+    }
+
+    std::vector<std::wstring> sorted(std::vector<std::wstring> paths)
+    {
+        std::sort(paths.begin( ), paths.end( ));
+        return paths;
+    }
+}
+
+TEST(StreamingRemovesWhatCollectThenDeleteRemoves)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+    const auto expected = collect(registry);
+    CHECK(expected.size( ) == 10 + 3 * 2);
+
+    for (const std::size_t workerCount : { 1, 4 })
+    {
+        for (const std::size_t capacity : { 1, 256 })
+        {
+            std::vector<std::wstring> removed;
+            std::vector<std::wstring> heldBack;
+            const auto result = Pipeline(capacity).run(
+                [&](const Pipeline::Sink& sink) { return scan(registry, sink, workerCount); },
+                [&](std::span<const std::wstring> entries)
+                {
+                    removed.insert(removed.end( ), entries.begin( ), entries.end( ));
+                    return true;
+                });
+
+            CHECK(!result.scanError && !result.removeError && result.removed);
+            CHECK(sorted(removed) == sorted(expected));
+            CHECK(result.entryCount == expected.size( ));
+            CHECK(result.queue.pushed == 10);
+            CHECK(result.queue.highWaterMark <= capacity);
+
+            // Matches below Managed\** are removed last, in walk order
+            CHECK(result.heldBackCount == 6);
+            CHECK(std::equal(removed.end( ) - 6, removed.end( ), expected.end( ) - 6));
+        }
+    }
+}
+
+TEST(ReportsEntriesThatWereNotRemoved)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    std::size_t calls = 0;
+    const auto result = Pipeline(4).run(
+        [&](const Pipeline::Sink& sink) { return scan(registry, sink, 2); },
+        [&](std::span<const std::wstring>) { return ++calls != 1; });
+    CHECK(!result.removed);
+    CHECK(!result.removeError && !result.scanError);
+    CHECK(result.entryCount == 16);
+}
+
+TEST(RemovesWhatWasQueuedWhenTheScanFails)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+    const auto expected = collect(registry);
+
+    for (const std::size_t workerCount : { 1, 4 })
+    {
+        std::vector<std::wstring> removed;
+        const auto result = Pipeline(2).run(
+            [&](const Pipeline::Sink& sink) { return scan(registry, sink, workerCount, L"Uninstall\\Product21"); },
+            [&](std::span<const std::wstring> entries)
+            {
+                removed.insert(removed.end( ), entries.begin( ), entries.end( ));
+                return true;
+            });
+
+        CHECK(result.scanError && !result.removeError);
+        CHECK(result.heldBackCount == 0);   // The scan results are lost with the scan
+        CHECK(result.entryCount == removed.size( ) && removed.size( ) == result.queue.pushed);
+        CHECK(removed.size( ) < expected.size( ));
+        for (const auto& path : removed)
+        {
+            CHECK(std::find(expected.begin( ), expected.end( ), path) != expected.end( ));
+        }
+    }
+}
+
+TEST(StopsTheScanWhenTheDeletionStageFails)
+{
+    Registry::InMemoryRegistryAccess registry;
+    populate(registry);
+
+    std::size_t removeCalls = 0;
+    const auto result = Pipeline(1).run(
+        [&](const Pipeline::Sink& sink) { return scan(registry, sink, 1); },
+        [&](std::span<const std::wstring>) -> bool
+        {
+            ++removeCalls;
+            throw std::runtime_error("deletion failed");
+        });
+
+    CHECK(result.removeError && !result.removed);
+    CHECK(result.scanError);            // Its next match found the queue closed
+    CHECK(removeCalls == 1);            // Nothing is removed after the failure, not even the held back matches
+    CHECK(result.heldBackCount == 0);
+    CHECK(result.queue.pushed < 10);
+}
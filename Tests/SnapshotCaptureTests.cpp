@@ -0,0 +1,64 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include "Snapshot.h"
+#include "TestFramework.h"
+#include "SnapshotCapture.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+using Snapshot::ItemKind;
+
+namespace
+{
+    std::vector<Snapshot::SnapshotItem> captureAndRead(std::shared_ptr<const Registry::IRegistryAccess> registry,
+                                                       std::vector<Snapshot::SnapshotRoot> roots)
+    {
+        std::stringstream stream;
+        Snapshot::SnapshotWriter writer(stream);
+        Snapshot::SnapshotCapture(std::move(registry)).capture(std::move(roots), writer);
+        writer.finish( );
+
+        std::vector<Snapshot::SnapshotItem> items;
+        Snapshot::SnapshotReader reader(stream);
+        for (Snapshot::SnapshotItem item; reader.next(item); )
+        {
+            items.push_back(item);
+        }
+        return items;
+    }
+}
+
+TEST(CapturesKeysWithoutNamesOrSizes)
+{
+    auto registry = std::make_shared<Registry::InMemoryRegistryAccess>( );
+    registry->setStringValue(Registry::RegistryHive::LocalMachine, L"SOFTWARE\\WatchGuard\\Logon App", L"Version", L"1.0");
+
+    const auto items = captureAndRead(registry, { Snapshot::SnapshotRoot::registryKey(Registry::RegistryHive::LocalMachine, L"SOFTWARE\\WatchGuard") });
+    CHECK(items.size( ) == 3);
+    CHECK(items[1].kind == ItemKind::RegistryKey);
+    CHECK(items[1].name.empty( ));
+    CHECK(items[1].size == 0 && items[1].digest == 0);
+    CHECK(items[2].kind == ItemKind::RegistryValue);
+    CHECK(items[2].name == L"Version");
+    CHECK(items[2].size != 0);
+}
+
+TEST(CapturesDirectoriesAndFiles)
+{
+    Tests::TemporaryDirectory directory;
+    std::filesystem::create_directory(directory.path( ) / L"Logon App");
+    std::ofstream(directory.path( ) / L"Logon App" / L"WLCredProv.dll") << "binary";
+
+    const auto items = captureAndRead(std::make_shared<Registry::InMemoryRegistryAccess>( ),
+                                      { Snapshot::SnapshotRoot::fileSystemPath(directory.path( ).wstring( )) });
+    CHECK(items.size( ) == 3);
+    CHECK(items[1].kind == ItemKind::Directory);
+    CHECK(items[1].name.empty( ) && items[1].size == 0);
+    CHECK(items[2].kind == ItemKind::File);
+    CHECK(items[2].name.empty( ));
+    CHECK(items[2].size == 6);
+}
@@ -0,0 +1,216 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Snapshot.h"
+#include "TestFramework.h"
+
+using namespace WinLogon::CustomActions;
+using Snapshot::ItemKind;
+using Snapshot::ChangeKind;
+using Snapshot::SnapshotItem;
+
+namespace
+{
+    SnapshotItem key(std::wstring path)
+    {
+        return { .kind = ItemKind::RegistryKey, .path = std::move(path), .name = { }, .type = 0, .size = 0, .digest = 0 };
+    }
+
+    SnapshotItem value(std::wstring path, std::wstring name, std::uint64_t digest)
+    {
+        return { .kind = ItemKind::RegistryValue, .path = std::move(path), .name = std::move(name), .type = 1, .size = 8, .digest = digest };
+    }
+
+    SnapshotItem file(std::wstring path, std::uint64_t size)
+    {
+        return { .kind = ItemKind::File, .path = std::move(path), .name = { }, .type = 0, .size = size, .digest = 7 };
+    }
+
+    std::string write(const std::vector<SnapshotItem>& items)
+    {
+        std::ostringstream stream;
+        Snapshot::SnapshotWriter writer(stream);
+        for (const auto& item : items)
+        {
+            writer.write(item);
+        }
+        writer.finish( );
+        return stream.str( );
+    }
+
+    std::vector<SnapshotItem> read(const std::string& bytes)
+    {
+        std::istringstream stream(bytes);
+        Snapshot::SnapshotReader reader(stream);
+        std::vector<SnapshotItem> items;
+        for (SnapshotItem item; reader.next(item); )
+        {
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    bool sameItem(const SnapshotItem& lhs, const SnapshotItem& rhs)
+    {
+        return lhs.kind == rhs.kind && lhs.path == rhs.path && lhs.name == rhs.name && lhs.type == rhs.type &&
+               lhs.size == rhs.size && lhs.digest == rhs.digest;
+    }
+
+    // Item encoded by hand, as SnapshotWriter would but without its order check
+    void appendItem(std::string& bytes, ItemKind kind, std::uint8_t shared, const std::wstring& path)
+    {
+        bytes.push_back(static_cast<char>(kind));
+        bytes.push_back(static_cast<char>(shared));
+        bytes.push_back(static_cast<char>(path.size( )));
+        for (const wchar_t ch : path)
+        {
+            bytes.push_back(static_cast<char>(ch));
+            bytes.push_back('\0');
+        }
+        bytes.append({ '\0', '\0', '\0' });         // Name, type and size
+        bytes.append(8, '\0');                      // Digest
+    }
+
+    const std::string HEADER("WLSN\x01\0\0\0", 8);
+
+    const std::vector<SnapshotItem> BEFORE = {
+        file(L"C:\\Program Files\\WatchGuard\\Logon App\\WLCredProv.dll", 100),
+        key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard"),
+        key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App"),
+        value(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App", L"", 1),
+        value(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App", L"Version", 2),
+        key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App\\Settings")
+    };
+}
+
+TEST(ReadsBackWhatWasWritten)
+{
+    const auto items = read(write(BEFORE));
+    CHECK(items.size( ) == BEFORE.size( ));
+    for (std::size_t i = 0; i < items.size( ) && i < BEFORE.size( ); ++i)
+    {
+        CHECK(sameItem(items[i], BEFORE[i]));
+    }
+    CHECK(read(write({ })).empty( ));
+}
+
+TEST(OrdersKeysBeforeEverythingBelowThem)
+{
+    // '\' sorts before any character, so "Logon App\Settings" comes before "Logon App Agent"
+    CHECK(Snapshot::comparePaths(L"A\\Logon App\\Settings", L"A\\Logon App Agent") < 0);
+    CHECK(Snapshot::comparePaths(L"A\\LOGON APP", L"a\\logon app") == 0);
+    CHECK(Snapshot::comparePaths(L"A\\Logon", L"A\\Logon App") < 0);
+
+    std::ostringstream stream;
+    Snapshot::SnapshotWriter writer(stream);
+    writer.write(key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App"));
+    CHECK_THROWS(writer.write(key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard")));
+    CHECK_THROWS(writer.write(key(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\LOGON APP")));
+}
+
+TEST(DiffReportsAddedRemovedAndChangedItems)
+{
+    auto after = BEFORE;
+    after.erase(after.begin( ) + 5);                                                                // Settings removed
+    after[4].digest = 3;                                                                           // Version changed
+    after.insert(after.begin( ) + 5, value(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App", L"Wizard", 4));
+    after.insert(after.begin( ) + 1, file(L"C:\\Program Files\\WatchGuard\\Logon App\\WLLogger.dll", 10));
+
+    Tests::TemporaryDirectory directory;
+    std::ofstream(directory.path( ) / L"before.snapshot", std::ios::binary) << write(BEFORE);
+    std::ofstream(directory.path( ) / L"after.snapshot", std::ios::binary) << write(after);
+
+    std::vector<std::wstring> changes;
+    const auto statistics = Snapshot::SnapshotDiff::diffFiles(directory.path( ) / L"before.snapshot", directory.path( ) / L"after.snapshot",
+        [&changes](const Snapshot::Change& change)
+        {
+            CHECK((change.before != nullptr) == (change.kind != ChangeKind::Added));
+            CHECK((change.after != nullptr) == (change.kind != ChangeKind::Removed));
+            changes.push_back(change.toString( ));
+        });
+
+    CHECK(statistics.added == 2 && statistics.removed == 1 && statistics.changed == 1 && statistics.unchanged == 4);
+    CHECK((changes == std::vector<std::wstring>{
+        L"added file C:\\Program Files\\WatchGuard\\Logon App\\WLLogger.dll",
+        L"changed value HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App:Version",
+        L"added value HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App:Wizard",
+        L"removed key HKEY_LOCAL_MACHINE\\SOFTWARE\\WatchGuard\\Logon App\\Settings"
+    }));
+}
+
+TEST(DiffOfIdenticalSnapshotsIsEmpty)
+{
+    std::istringstream beforeStream(write(BEFORE)), afterStream(write(BEFORE));
+    Snapshot::SnapshotReader before(beforeStream), after(afterStream);
+
+    std::size_t changes = 0;
+    const auto statistics = Snapshot::SnapshotDiff::diff(before, after, [&changes](const Snapshot::Change&) { ++changes; });
+    CHECK(changes == 0 && statistics.unchanged == BEFORE.size( ));
+}
+
+TEST(RejectsForeignFiles)
+{
+    CHECK_THROWS(read(""));
+    CHECK_THROWS(read(std::string("MZ\x90\0\x03\0\0\0\x04\0", 10)));          // An executable
+    CHECK_THROWS(read(std::string("WLSN\x02\0\0\0", 8) + std::string(2, '\0')));   // Another format version
+
+    Tests::TemporaryDirectory directory;
+    std::ofstream(directory.path( ) / L"before.snapshot", std::ios::binary) << write(BEFORE);
+    CHECK_THROWS(Snapshot::SnapshotDiff::diffFiles(directory.path( ) / L"before.snapshot", directory.path( ) / L"missing.snapshot",
+                                                   [](const Snapshot::Change&) { }));
+}
+
+TEST(RejectsTruncatedFiles)
+{
+    const std::string bytes = write(BEFORE);
+    for (std::size_t length = 0; length < bytes.size( ); ++length)
+    {
+        CHECK_THROWS(read(bytes.substr(0, length)));
+    }
+}
+
+TEST(RejectsCorruptedFiles)
+{
+    // Item count in the trailer
+    std::string bytes = write(BEFORE);
+    bytes.back( ) = static_cast<char>(BEFORE.size( ) + 1);
+    CHECK_THROWS(read(bytes));
+
+    // Unknown item kind
+    bytes = HEADER;
+    appendItem(bytes, static_cast<ItemKind>(9), 0, L"A");
+    CHECK_THROWS(read(bytes));
+
+    // Path sharing more than the previous path
+    bytes = HEADER;
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"A");
+    appendItem(bytes, ItemKind::RegistryKey, 2, L"B");
+    CHECK_THROWS(read(bytes));
+}
+
+TEST(RejectsItemsOutOfOrder)
+{
+    std::string bytes = HEADER;
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"B");
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"A");
+    bytes.append({ '\0', '\x02' });
+    CHECK_THROWS(read(bytes));
+
+    // The same item twice
+    bytes = HEADER;
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"A");
+    appendItem(bytes, ItemKind::RegistryKey, 1, L"");
+    bytes.append({ '\0', '\x02' });
+    CHECK_THROWS(read(bytes));
+
+    // In order, the same bytes read fine
+    bytes = HEADER;
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"A");
+    appendItem(bytes, ItemKind::RegistryKey, 0, L"B");
+    bytes.append({ '\0', '\x02' });
+    CHECK(read(bytes).size( ) == 2);
+}
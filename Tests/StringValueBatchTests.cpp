@@ -0,0 +1,111 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "CaseFolding.h"
+#include "TestFramework.h"
+#include "IRegistryAccess.h"
+#include "InMemoryRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+
+namespace
+{
+    constexpr auto HKLM = Registry::RegistryHive::LocalMachine;
+
+    // Longer than the initial buffer of the Windows backend, so that a batch has to grow
+    const std::wstring longValue = std::wstring(3000, L'x') + L"AuthPoint";
+
+    // Only implements getStringValue: getStringValues is the default of IRegistryKey
+    class ValueOnlyKey : public Registry::IRegistryKey
+    {
+    public:
+        explicit ValueOnlyKey(std::map<std::wstring, std::wstring, Text::CaseInsensitiveLess> values) : m_values(std::move(values)) {}
+
+        std::unique_ptr<Registry::IRegistryKey> openSubKey(std::wstring_view) const override
+        {
+            return nullptr;
+        }
+
+        std::vector<std::wstring> enumerateSubKeys( ) const override
+        {
+            return { };
+        }
+
+        std::optional<std::wstring> getStringValue(std::wstring_view valueName) const override
+        {
+            if (const auto it = m_values.find(valueName); it != m_values.end( ))
+            {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+
+        std::vector<Registry::RegistryValue> enumerateValues( ) const override
+        {
+            return { };
+        }
+
+        std::optional<std::uint64_t> getLastWriteTime( ) const override
+        {
+            return std::nullopt;
+        }
+
+    private:
+        std::map<std::wstring, std::wstring, Text::CaseInsensitiveLess> m_values;
+    };
+
+    void checkBatches(const Registry::IRegistryKey& key)
+    {
+        Registry::StringValueBatch batch;
+        const std::vector<std::wstring> names{ L"DisplayName", L"Missing", L"installlocation", L"Empty" };
+        key.getStringValues(names, batch);
+        CHECK(batch.size( ) == 4);
+        CHECK(batch[0] == std::optional<std::wstring_view>(longValue));
+        CHECK(!batch[1]);
+        CHECK(batch[2] == std::optional<std::wstring_view>(L"C:\\Program Files\\WatchGuard"));
+        CHECK(batch[3] && batch[3]->empty( ));
+
+        // A reused batch only holds the values of the last read
+        const std::vector<std::wstring> missing{ L"Missing" };
+        key.getStringValues(missing, batch);
+        CHECK(batch.size( ) == 1 && !batch[0]);
+
+        const std::vector<std::wstring> reversed{ L"InstallLocation", L"DISPLAYNAME" };
+        key.getStringValues(reversed, batch);
+        CHECK(batch[0] == std::optional<std::wstring_view>(L"C:\\Program Files\\WatchGuard"));
+        CHECK(batch[1] == std::optional<std::wstring_view>(longValue));
+    }
+}
+
+TEST(DefaultBatchReadsEachValue)
+{
+    const ValueOnlyKey key({
+        { L"DisplayName", longValue },
+        { L"InstallLocation", L"C:\\Program Files\\WatchGuard" },
+        { L"Empty", L"" } });
+    checkBatches(key);
+}
+
+TEST(InMemoryBatchReadsEachValue)
+{
+    Registry::InMemoryRegistryAccess registry;
+    registry.setStringValue(HKLM, L"SOFTWARE\\Product", L"DisplayName", longValue);
+    registry.setStringValue(HKLM, L"SOFTWARE\\Product", L"InstallLocation", L"C:\\Program Files\\WatchGuard");
+    registry.setStringValue(HKLM, L"SOFTWARE\\Product", L"Empty", L"");
+    checkBatches(*registry.openKey(HKLM, L"SOFTWARE\\Product"));
+}
+
+TEST(BatchAppendsAfterValuesSetInPlace)
+{
+    Registry::StringValueBatch batch;
+    batch.reset(3);
+    batch.buffer( ).assign({ L'a', L'b', L'c' });
+    batch.set(0, 1, 2);
+    batch.append(2, longValue);
+    CHECK(batch[0] == std::optional<std::wstring_view>(L"bc"));
+    CHECK(!batch[1]);
+    CHECK(batch[2] == std::optional<std::wstring_view>(longValue));
+}
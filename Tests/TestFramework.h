@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+
+namespace WinLogon::CustomActions::Tests
+{
+    // Minimal self-registering test cases; TestMain.cpp runs them all, or those named on the command line
+    struct TestCase
+    {
+        const char* name;
+        void (*body)( );
+    };
+
+    inline std::vector<TestCase>& testCases( )
+    {
+        static std::vector<TestCase> cases;
+        return cases;
+    }
+
+    struct TestRegistration
+    {
+        TestRegistration(const char* name, void (*body)( ))
+        {
+            testCases( ).push_back({ name, body });
+        }
+    };
+
+    class CheckFailure : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    [[noreturn]] inline void fail(const char* file, int line, const char* expression)
+    {
+        throw CheckFailure(std::string(file) + ":" + std::to_string(line) + ": CHECK(" + expression + ") failed");
+    }
+
+    // Unique directory below the system temporary directory, removed with everything in it
+    class TemporaryDirectory
+    {
+    public:
+        TemporaryDirectory( )
+        {
+            static std::atomic<unsigned> counter{ 0 };
+            const auto stamp = std::chrono::steady_clock::now( ).time_since_epoch( ).count( );
+            m_path = std::filesystem::temp_directory_path( ) /
+                     ("CustomActionTests." + std::to_string(stamp) + "." + std::to_string(counter++));
+            std::filesystem::create_directories(m_path);
+        }
+
+        TemporaryDirectory(const TemporaryDirectory&) = delete;
+        TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+        ~TemporaryDirectory( )
+        {
+            std::error_code errorCode;
+            std::filesystem::remove_all(m_path, errorCode);
+        }
+
+        const std::filesystem::path& path( ) const noexcept
+        {
+            return m_path;
+        }
+
+    private:
+        std::filesystem::path m_path;
+    };
+}
+
+#define TEST(name)                                                                                             \
+    static void name( );                                                                                       \
+    static const ::WinLogon::CustomActions::Tests::TestRegistration name##Registration(#name, &name);         \
+    static void name( )
+
+#define CHECK(expression)                                                                                      \
+    do                                                                                                         \
+    {                                                                                                          \
+        if (!(expression))                                                                                     \
+        {                                                                                                      \
+            ::WinLogon::CustomActions::Tests::fail(__FILE__, __LINE__, #expression);                           \
+        }                                                                                                      \
+    } while (false)
+
+#define CHECK_THROWS(expression)                                                                               \
+    do                                                                                                         \
+    {                                                                                                          \
+        bool thrown = false;                                                                                   \
+        try                                                                                                    \
+        {                                                                                                      \
+            static_cast<void>(expression);                                                                     \
+        }                                                                                                      \
+        catch (const std::exception&)                                                                          \
+        {                                                                                                      \
+            thrown = true;                                                                                     \
+        }                                                                                                      \
+        if (!thrown)                                                                                           \
+        {                                                                                                      \
+            ::WinLogon::CustomActions::Tests::fail(__FILE__, __LINE__, "throws " #expression);                 \
+        }                                                                                                      \
+    } while (false)
@@ -0,0 +1,49 @@
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include "TestFramework.h"
+
+int main(int argc, char* argv[])
+{
+    using namespace WinLogon::CustomActions::Tests;
+
+    const auto selected = [argc, argv](const char* name)
+    {
+        if (argc < 2)
+        {
+            return true;
+        }
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int failures = 0;
+    for (const auto& testCase : testCases( ))
+    {
+        if (!selected(testCase.name))
+        {
+            continue;
+        }
+
+        try
+        {
+            testCase.body( );
+            std::printf("[  PASSED  ] %s\n", testCase.name);
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("[  FAILED  ] %s\n    %s\n", testCase.name, e.what( ));
+            ++failures;
+        }
+    }
+
+    std::printf("%d test(s) failed.\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+namespace WinLogon::CustomActions::Tests
+{
+    // Writes a directory tree shaped like a data folder that grew for years: every directory holds
+    // fileCount small files and, down to depth levels, fanOut sub directories.
+    struct TreeShape
+    {
+        std::size_t depth = 3;
+        std::size_t fanOut = 4;
+        std::size_t fileCount = 10;
+    };
+
+    // Returns the number of files and directories created below root, i.e. what remove_all(root) reports
+    // minus root itself
+    inline std::uintmax_t buildTree(const std::filesystem::path& root, const TreeShape& shape)
+    {
+        std::filesystem::create_directories(root);
+
+        std::uintmax_t items = 0;
+        for (std::size_t i = 0; i < shape.fileCount; ++i)
+        {
+            std::ofstream(root / ("log" + std::to_string(i) + ".txt")) << "entry " << i << '\n';
+            ++items;
+        }
+        if (shape.depth == 0)
+        {
+            return items;
+        }
+
+        const TreeShape below{ shape.depth - 1, shape.fanOut, shape.fileCount };
+        for (std::size_t i = 0; i < shape.fanOut; ++i)
+        {
+            items += 1 + buildTree(root / ("dir" + std::to_string(i)), below);
+        }
+        return items;
+    }
+}
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HiveBuilder.h"
+#include "TestFramework.h"
+#include "UserHiveScanner.h"
+#include "OfflineHiveRegistryAccess.h"
+
+using namespace WinLogon::CustomActions;
+using Tests::HiveBuilder;
+
+namespace
+{
+    constexpr auto HKU = Registry::RegistryHive::Users;
+
+    const Text::PatternMatcher MATCHER({ L"AuthPoint", L"Logon App" });
+
+    // NTUSER.DAT with uninstallCount uninstall entries and two Windows Installer products; every third
+    // uninstall entry and the first product are AuthPoint ones
+    void writeUserHive(const std::filesystem::path& path, std::size_t uninstallCount)
+    {
+        HiveBuilder builder;
+        const auto software = builder.addKey(HiveBuilder::ROOT, L"Software");
+        const auto microsoft = builder.addKey(software, L"Microsoft");
+        const auto currentVersion = builder.addKey(builder.addKey(microsoft, L"Windows"), L"CurrentVersion");
+        const auto uninstall = builder.addKey(currentVersion, L"Uninstall");
+        for (std::size_t i = 0; i < uninstallCount; ++i)
+        {
+            const auto entry = builder.addKey(uninstall, L"Entry" + std::to_wstring(i));
+            builder.setValue(entry, L"DisplayName", (i % 3 == 0) ? L"WatchGuard AuthPoint Agent" : L"Contoso Runtime");
+        }
+        builder.addKey(uninstall, L"NoDisplayName");
+
+        const auto products = builder.addKey(builder.addKey(microsoft, L"Installer"), L"Products");
+        builder.setValue(builder.addKey(products, L"0FF1CE00112233445566778899AABBCC"), L"ProductName", L"WatchGuard Logon App");
+        const auto other = builder.addKey(products, L"FFEEDDCCBBAA99887766554433221100");
+        builder.setValue(other, L"ProductName", L"Fabrikam Viewer");
+        builder.setValue(other, L"DisplayName", L"WatchGuard AuthPoint");     // Products are matched by ProductName
+
+        // Outside the searched keys
+        builder.setValue(builder.addKey(software, L"AuthPoint"), L"DisplayName", L"WatchGuard AuthPoint");
+        builder.write(path);
+    }
+
+    std::vector<std::wstring> paths(const std::vector<Registry::UserHiveScanner::Match>& matches)
+    {
+        std::vector<std::wstring> result;
+        for (const auto& match : matches)
+        {
+            result.push_back(match.path);
+        }
+        return result;
+    }
+}
+
+TEST(FindsUninstallAndInstallerEntriesOfAnOfflineHive)
+{
+    Tests::TemporaryDirectory directory;
+    writeUserHive(directory.path( ) / L"NTUSER.DAT", 4);
+
+    const std::wstring sid = L"S-1-5-21-1004336348-1177238915-682003330-1001";
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"NTUSER.DAT", HKU, sid);
+    const auto matches = Registry::UserHiveScanner(MATCHER).scan(registry, HKU, sid);
+
+    CHECK((paths(matches) == std::vector<std::wstring>{
+        L"Software\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\Entry0",
+        L"Software\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\Entry3",
+        L"Software\\Microsoft\\Installer\\Products\\0FF1CE00112233445566778899AABBCC"
+    }));
+    CHECK(matches.size( ) == 3 && matches[0].displayName == L"WatchGuard AuthPoint Agent" &&
+          matches[2].displayName == L"WatchGuard Logon App");
+
+    // Another SID's hive is not mounted here
+    CHECK(Registry::UserHiveScanner(MATCHER).scan(registry, HKU, L"S-1-5-21-1-2-3-1002").empty( ));
+}
+
+TEST(ScansHivesWithoutTheSearchedKeys)
+{
+    Tests::TemporaryDirectory directory;
+    HiveBuilder builder;
+    builder.addKey(builder.addKey(HiveBuilder::ROOT, L"Software"), L"Contoso");
+    builder.write(directory.path( ) / L"NTUSER.DAT");
+
+    const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / L"NTUSER.DAT", HKU, L"S-1-5-21-1-2-3-1001");
+    CHECK(Registry::UserHiveScanner(MATCHER).scan(registry, HKU, L"S-1-5-21-1-2-3-1001").empty( ));
+}
+
+TEST(ReturnsPerHiveResultsInProfileOrder)
+{
+    // Hive i has 3 * (i + 1) uninstall entries, i + 1 of them matching
+    constexpr std::size_t HIVE_COUNT = 6;
+    Tests::TemporaryDirectory directory;
+    std::vector<std::wstring> sids;
+    for (std::size_t i = 0; i < HIVE_COUNT; ++i)
+    {
+        sids.push_back(L"S-1-5-21-1-2-3-" + std::to_wstring(1001 + i));
+        writeUserHive(directory.path( ) / (sids.back( ) + L".DAT"), 3 * (i + 1));
+    }
+
+    const Registry::UserHiveScanner scanner(MATCHER);
+    for (const std::size_t maxConcurrentHives : { std::size_t{ 1 }, std::size_t{ 3 }, HIVE_COUNT })
+    {
+        std::atomic<std::size_t> running{ 0 };
+        std::atomic<std::size_t> mostRunning{ 0 };
+        const auto results = Registry::UserHiveScanner::forEachHive<std::vector<Registry::UserHiveScanner::Match>>(
+            HIVE_COUNT, maxConcurrentHives, [&](std::size_t i)
+            {
+                const auto nowRunning = ++running;
+                for (auto most = mostRunning.load( ); nowRunning > most && !mostRunning.compare_exchange_weak(most, nowRunning); )
+                {
+                }
+
+                // Earlier hives take longer, so later ones finish first when hives run concurrently
+                std::this_thread::sleep_for(std::chrono::milliseconds(5 * (HIVE_COUNT - i)));
+                const Registry::OfflineHiveRegistryAccess registry(directory.path( ) / (sids[i] + L".DAT"), HKU, sids[i]);
+                auto matches = scanner.scan(registry, HKU, sids[i]);
+                --running;
+                return matches;
+            });
+
+        CHECK(results.size( ) == HIVE_COUNT);
+        CHECK(mostRunning <= maxConcurrentHives);
+        for (std::size_t i = 0; i < results.size( ); ++i)
+        {
+            CHECK(results[i].size( ) == i + 2);
+            CHECK(!results[i].empty( ) &&
+                  results[i][results[i].size( ) - 2].path == L"Software\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\Entry" + std::to_wstring(3 * i));
+        }
+    }
+}
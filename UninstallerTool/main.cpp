@@ -9,6 +9,7 @@
 #include <ConsoleLogger.h>
 #include "LoggerFactory.h"
 #include "CleanupFactory.h"
+#include "InstallationSnapshot.h"
 
 static bool IsRunAsAdmin( )
 {
@@ -52,12 +53,57 @@ public:
     }
 };
 
+// Read-only snapshot commands, to check what an uninstall leaves behind:
+//   --capture <file>          records the installation keys, folders and files into file
+//   --diff <before> <after>   lists what changed between two captures
+// Like diff, returns 0 when nothing changed, 1 when something did and 2 on errors.
+static int RunSnapshotCommand(int argc, char* argv[])
+{
+    using namespace WinLogon::CustomActions::Snapshot;
+
+    const std::string command = argv[1];
+    try
+    {
+        if (command == "--capture" && argc == 3)
+        {
+            const auto statistics = InstallationSnapshot::capture(argv[2]);
+            std::cout << "Captured " << statistics.keys << " keys, " << statistics.values << " values, "
+                      << statistics.directories << " directories and " << statistics.files << " files ("
+                      << statistics.missingRoots << " roots missing, " << statistics.errors << " errors)" << std::endl;
+            return statistics.errors == 0 ? 0 : 2;
+        }
 
-int main( )
+        if (command == "--diff" && argc == 4)
+        {
+            const auto statistics = SnapshotDiff::diffFiles(argv[2], argv[3], [](const Change& change)
+            {
+                std::wcout << change.toString( ) << std::endl;
+            });
+            std::cout << statistics.added << " added, " << statistics.removed << " removed, " << statistics.changed
+                      << " changed, " << statistics.unchanged << " unchanged" << std::endl;
+            return (statistics.added + statistics.removed + statistics.changed) == 0 ? 0 : 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what( ) << std::endl;
+        return 2;
+    }
+
+    std::cerr << "Usage: UninstallerTool [--capture <file> | --diff <before> <after>]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char* argv[])
 {
 
     using namespace WinLogon::CustomActions;
 
+    if (argc > 1)
+    {
+        return RunSnapshotCommand(argc, argv);
+    }
+
     if (!IsRunAsAdmin( ))
     {
         std::cout << "[ERROR] " << "This program requires administrator privileges." << std::endl;
@@ -75,6 +121,9 @@ int main( )
 
     try
     {
+        // The registry cleanups share the open keys of this run
+        const auto handleCache = Cleanup::CleanupFactory::createRegistryHandleCache( );
+
         // V3 Files
         logger->log(Logger::LogLevel::LOG_INFO, L"Executing V3 files cleanup...");
         auto v3CleanupManager = Cleanup::CleanupFactory::createV3CleanupManager(hInstall);
@@ -89,15 +138,17 @@ int main( )
 
         // Registries
         logger->log(Logger::LogLevel::LOG_INFO, L"Executing registry cleanup...");
-        auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall);
+        auto registryCleanupManager = Cleanup::CleanupFactory::createRegistryCleanupManager(hInstall, handleCache);
         bool registrySuccess = registryCleanupManager->executeAll( );
         progressDisplay.onTaskCompleted(L"Registry Cleanup", registrySuccess);
 
         // AuthPoint Registries
         logger->log(Logger::LogLevel::LOG_INFO, L"Executing AuthPoint registry cleanup...");
-        auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall);
+        auto authPointRegistryCleanupManager = Cleanup::CleanupFactory::createAuthPointRegistryCleanupManager(hInstall, handleCache);
         bool authPointSuccess = authPointRegistryCleanupManager->executeAll( );
         progressDisplay.onTaskCompleted(L"AuthPoint Registry Cleanup", authPointSuccess);
+
+        Cleanup::CleanupFactory::commitRegistryChanges(*handleCache, logger);
     }
     catch (const std::exception& e)
     {